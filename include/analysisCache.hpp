@@ -0,0 +1,70 @@
+#ifndef analysisCache_hpp
+#define analysisCache_hpp
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+/**
+ * @brief 以抓包文件内容哈希为键的分析结果缓存
+ *
+ * 每个缓存项是缓存目录下以哈希命名的子目录，保存数据库、JSON和索引等分析产物；
+ * 子目录的修改时间作为最近使用时间，总大小超过上限时按最久未使用的顺序淘汰。
+ * 每项记录写入时的kVersion，版本不同的缓存项视为未命中并删除
+ */
+class AnalysisCache
+{
+public:
+    static const uint32_t kVersion = 1; // 分析产物的格式版本，数据库表结构或索引格式变化时递增
+
+    /**
+     * @brief 构造函数
+     * @param cacheDir 缓存目录，不存在时自动创建
+     * @param maxBytes 缓存总大小上限
+     */
+    AnalysisCache(const std::string& cacheDir, uint64_t maxBytes = 2ULL << 30);
+
+    /**
+     * @brief 计算文件内容哈希
+     *
+     * 文件按4MB分块，多个线程并行计算每块的XXH64，再对块哈希序列求XXH64
+     *
+     * @param path 文件路径
+     * @param key 输出参数，16位十六进制哈希字符串
+     * @return true 计算成功
+     * @return false 文件无法读取
+     */
+    static bool hashFile(const std::string& path, std::string& key);
+
+    /**
+     * @brief 查找缓存，命中时把各产物复制到目标路径，版本不同的缓存项被删除
+     * @param key 内容哈希
+     * @param artifacts 产物名称到目标路径的映射
+     * @return true 命中，所有产物均已复制
+     * @return false 未命中
+     */
+    bool fetch(const std::string& key, const std::map<std::string, std::string>& artifacts);
+
+    /**
+     * @brief 保存分析产物，保存后按大小上限淘汰旧缓存项
+     * @param key 内容哈希
+     * @param artifacts 产物名称到源文件路径的映射
+     * @return true 保存成功
+     * @return false 保存失败
+     */
+    bool store(const std::string& key, const std::map<std::string, std::string>& artifacts);
+
+    uint64_t getHits() const { return hits; }
+    uint64_t getMisses() const { return misses; }
+
+private:
+    // 淘汰最久未使用的缓存项，直到总大小不超过上限；keep为刚写入、不可淘汰的缓存项
+    void evict(const std::string& keep);
+
+    std::string cacheDir;
+    uint64_t    maxBytes;
+    uint64_t    hits;
+    uint64_t    misses;
+};
+
+#endif
@@ -0,0 +1,201 @@
+#ifndef captureReader_hpp
+#define captureReader_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "compressedFile.hpp"
+#include "mappedFile.hpp"
+
+/**
+ * @brief 抓包文件中的一条数据包记录
+ */
+struct CaptureRecord
+{
+    uint64_t block_offset; // 记录（含记录头）在文件中的起始偏移
+    uint64_t block_end;    // 记录结束偏移，即下一条记录的起始偏移
+    uint64_t data_offset;  // 数据包内容的偏移
+    uint32_t cap_len;
+    uint32_t len;
+    uint32_t interface_id; // pcapng接口编号，pcap文件固定为0
+    uint16_t link_type;    // 链路层类型（LINKTYPE_*）
+    double   time;
+};
+
+/**
+ * @brief 抓包文件记录读取器
+ *
+ * 支持经典pcap和pcapng两种格式，直接在内存（通常是映射的文件）上解析记录头，
+ * 可从任意记录边界开始读取，末尾不完整的记录不会被返回，便于对正在写入的文件增量读取。
+ * pcapng文件按块解析：SHB（节头）、IDB（接口描述，含if_tsresol/if_tsoffset）、
+ * EPB/SPB/PB（数据包）和NRB（名称解析），其余块类型直接跳过
+ */
+class CaptureReader
+{
+public:
+    static const size_t kMaxRecordHeader = 28; // 数据包内容之前最长的记录头（pcapng EPB）
+
+    CaptureReader();
+
+    /**
+     * @brief 解析文件头
+     * @param data 文件起始地址
+     * @param size 可用的数据长度
+     * @return true 解析成功
+     * @return false 数据不足（见truncated()）或不是支持的抓包格式
+     */
+    bool readHeader(const unsigned char* data, uint64_t size);
+
+    /**
+     * @brief 从offset开始读取所有完整的记录
+     * @param data 文件起始地址
+     * @param size 可用的数据长度
+     * @param offset 起始偏移，必须是记录边界（首次读取时为headerSize()），
+     *               并且与上一次读取返回的nextOffset衔接
+     * @param records 输出参数，读取到的数据包记录追加到末尾
+     * @param nextOffset 输出参数，下一次读取的起始偏移
+     * @param maxRecords 最多读取的数据包记录数
+     * @return true 读取成功（可能没有新记录）
+     * @return false 遇到损坏的记录
+     */
+    bool readRecords(const unsigned char* data, uint64_t size, uint64_t offset,
+                     std::vector<CaptureRecord>& records, uint64_t& nextOffset,
+                     size_t maxRecords = SIZE_MAX);
+
+    /**
+     * @brief 由数据包内容之前的记录头确定一条记录的链路类型，用于按偏移随机读取数据包
+     * @param header 紧邻数据包内容之前的字节，pcapng文件需要kMaxRecordHeader字节
+     * @param headerLength header的长度
+     * @param capLen 记录的捕获长度，用于确认header确实是这条记录的记录头
+     * @param linkType 输出参数
+     * @return true 成功
+     * @return false 不是数据包记录，或所属接口的描述块尚未读取
+     */
+    bool linkTypeBefore(const unsigned char* header, size_t headerLength, uint32_t capLen,
+                        uint16_t& linkType) const;
+
+    /**
+     * @brief 文件头长度，即第一条记录的偏移
+     */
+    uint64_t headerSize() const { return fileHeaderSize; }
+
+    /**
+     * @brief 上一次readHeader失败是否只是因为数据还不完整
+     */
+    bool truncated() const { return headerTruncated; }
+
+    /**
+     * @brief 是否是pcapng格式
+     */
+    bool isPcapng() const { return pcapng; }
+
+    /**
+     * @brief 当前节中已读取的元数据块（SHB和IDB）的[起始偏移, 结束偏移)
+     *
+     * 把这些块写在后续记录之前即可组成一个可独立解析的抓包文件，
+     * 经典pcap文件只有一个文件头
+     */
+    const std::vector<std::pair<uint64_t, uint64_t>>& sectionBlocks() const
+    {
+        return metadataBlocks;
+    }
+
+    /**
+     * @brief 当前节中的接口数量
+     */
+    size_t interfaceCount() const { return interfaces.size(); }
+
+    /**
+     * @brief NRB中读取到的地址到名称的映射
+     */
+    const std::map<std::string, std::string>& resolvedNames() const { return names; }
+
+private:
+    // pcapng接口描述
+    struct Interface
+    {
+        uint16_t linkType;
+        double   unitsPerSecond; // 由if_tsresol得到，默认微秒
+        int64_t  tsOffset;       // if_tsoffset，单位秒
+    };
+
+    uint16_t read16(const unsigned char* p) const;
+    uint32_t read32(const unsigned char* p) const;
+
+    bool readPcapHeader(const unsigned char* data, uint64_t size);
+    bool readSectionHeader(const unsigned char* data, uint64_t size, uint64_t offset);
+    bool readPcapRecords(const unsigned char* data, uint64_t size,
+                         std::vector<CaptureRecord>& records, uint64_t& nextOffset,
+                         size_t maxRecords);
+    bool readPcapngBlocks(const unsigned char* data, uint64_t size,
+                          std::vector<CaptureRecord>& records, uint64_t& nextOffset,
+                          size_t maxRecords);
+    bool readInterface(const unsigned char* body, uint32_t bodyLength);
+    void readNameRecords(const unsigned char* body, uint32_t bodyLength);
+
+    bool     swapped;    // 文件字节序与本机相反
+    bool     nanosecond; // 时间戳小数部分以纳秒为单位（仅经典pcap）
+    bool     pcapng;
+    bool     headerTruncated;
+    uint64_t fileHeaderSize;
+    uint16_t pcapLinkType; // 经典pcap文件头中的链路类型
+
+    std::vector<Interface>                     interfaces;
+    std::vector<std::pair<uint64_t, uint64_t>> metadataBlocks;
+    std::map<std::string, std::string>         names;
+};
+
+/**
+ * @brief 从头到尾分批读取整个抓包文件的记录
+ *
+ * 未压缩的文件直接映射，gzip压缩的文件边解压边读取，只在内存中保留一个解压窗口，
+ * 记录的偏移都是解压后数据中的偏移
+ */
+class CaptureFileScanner
+{
+public:
+    CaptureFileScanner();
+
+    /**
+     * @brief 打开抓包文件并解析文件头
+     * @param path 文件路径
+     * @return true 打开成功
+     * @return false 文件无法读取、格式不支持或使用了不支持的压缩格式
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief 读取下一批记录
+     * @param records 输出参数，先被清空，读到文件末尾时为空
+     * @param maxRecords 最多读取的记录数
+     * @return true 读取成功
+     * @return false 遇到损坏的记录或解压失败
+     */
+    bool next(std::vector<CaptureRecord>& records, size_t maxRecords);
+
+    /**
+     * @brief 上一批记录中某条记录的数据包内容
+     * @param record next()返回的记录
+     * @return 数据包首地址，在下一次调用next()之前有效，不在当前窗口内时为nullptr
+     */
+    const unsigned char* recordData(const CaptureRecord& record) const;
+
+    bool isCompressed() const { return compressed.isOpen(); }
+
+private:
+    bool fillWindow();
+
+    CaptureReader              reader;
+    MappedFile                 mapped;
+    CompressedFile             compressed;
+    std::vector<unsigned char> window;      // 解压窗口
+    uint64_t                   windowStart; // 窗口在解压数据中的偏移
+    bool                       windowEof;   // 窗口已包含文件末尾
+    uint64_t                   nextOffset;
+};
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef compressedFile_hpp
+#define compressedFile_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 可随机访问的gzip压缩文件
+ *
+ * 顺序解压的同时每隔约1MB解压数据在deflate块边界处记录一个访问点（输入位置、
+ * 未用完的比特数和之前32KB的解压数据），随机读取时只需从最近的访问点开始解压，
+ * 不必从文件开头解压。支持多个gzip成员拼接而成的文件
+ */
+class CompressedFile
+{
+public:
+    enum Format
+    {
+        FORMAT_NONE, // 未压缩
+        FORMAT_GZIP,
+        FORMAT_ZSTD,
+    };
+
+    CompressedFile();
+    ~CompressedFile();
+
+    CompressedFile(const CompressedFile&)            = delete;
+    CompressedFile& operator=(const CompressedFile&) = delete;
+
+    /**
+     * @brief 根据文件头的魔数判断压缩格式
+     * @param path 文件路径
+     * @return 压缩格式，无法读取的文件视为未压缩
+     */
+    static Format detect(const std::string& path);
+
+    /**
+     * @brief 打开gzip压缩文件，已打开的文件会先关闭
+     * @param path 文件路径
+     * @return true 打开成功
+     * @return false 文件无法打开或不是gzip格式
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief 关闭文件并释放访问点索引
+     */
+    void close();
+
+    bool               isOpen() const { return fd >= 0; }
+    const std::string& path() const { return filePath; }
+
+    /**
+     * @brief 读取解压后[offset, offset + length)区间的数据
+     * @param offset 解压数据中的偏移
+     * @param buffer 输出缓冲区，至少length字节
+     * @param length 读取长度
+     * @return 实际读取的字节数，到达文件末尾或解压出错时小于length
+     */
+    size_t read(uint64_t offset, unsigned char* buffer, size_t length);
+
+    /**
+     * @brief 已建立的访问点数量
+     */
+    size_t accessPointCount() const { return accessPoints.size(); }
+
+private:
+    // 访问点：从in处（bits不为0时从in-1处的剩余比特）开始的原始deflate流，
+    // 解压出的第一个字节位于解压数据的out处
+    struct AccessPoint
+    {
+        uint64_t                   out;
+        uint64_t                   in;
+        int                        bits;
+        std::vector<unsigned char> window; // 访问点之前的解压数据，作为预设字典
+    };
+    struct Cursor;
+
+    bool   startCursor(Cursor& cursor, const AccessPoint* point);
+    size_t advance(Cursor& cursor, uint64_t offset, unsigned char* buffer, size_t length,
+                   bool buildIndex);
+
+    std::string filePath;
+    int         fd;
+
+    std::vector<AccessPoint> accessPoints;
+    // 从文件开头顺序解压并建立索引的游标，以及从访问点开始随机读取的游标
+    std::unique_ptr<Cursor> indexCursor;
+    std::unique_ptr<Cursor> randomCursor;
+};
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef flowTable_hpp
+#define flowTable_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "packetStore.hpp"
+#include "tsharkDataType.hpp"
+
+// 归一化的五元组：(地址, 端口)较小的一端为端点0，两个方向的数据包得到同一个键
+struct FlowKey
+{
+    IpAddress addr[2];
+    uint16_t  port[2];
+    uint8_t   ip_proto;
+    uint8_t   reserved[3]; // 补齐为定长，整个结构参与哈希和比较
+
+    bool operator==(const FlowKey& other) const { return memcmp(this, &other, sizeof(*this)) == 0; }
+};
+
+// 一条连接的统计，方向下标为FlowKey中的端点编号
+struct FlowRecord
+{
+    FlowKey  key;
+    uint8_t  initiator;    // 发送第一个数据包的端点
+    uint8_t  tcp_state;    // FlowTable::TcpState
+    uint8_t  tcp_flags[2]; // 每个端点发出的数据包中出现过的TCP标志位
+    double   first_time;
+    double   last_time;
+    uint64_t packets[2]; // 每个端点发出的数据包数
+    uint64_t bytes[2];   // 每个端点发出的字节数
+    // 第一个和最后一个数据包的下标，中间的数据包由FlowTable::forEachPacket遍历
+    uint32_t first_packet;
+    uint32_t last_packet;
+};
+
+/**
+ * @brief 按五元组聚合数据包的连接表
+ *
+ * 键是定长的二进制五元组，保存在开放寻址（线性探测）的哈希表中，槽位只存连接下标，
+ * 连接记录按出现顺序连续存放，下标即连接编号。分析和抓包时逐包更新，
+ * 发生变化的连接记入脏列表，由存储线程增量写入t_flows。
+ * 同一连接的数据包下标串成单向链表，按连接读取数据包时不必扫描全部数据包
+ */
+class FlowTable
+{
+public:
+    enum TcpState
+    {
+        TCP_NONE = 0,     // 不是TCP连接
+        TCP_SYN_SENT,     // 只看到SYN
+        TCP_SYN_RECEIVED, // 看到SYN+ACK
+        TCP_ESTABLISHED,  // 握手完成，或从连接中途开始抓包
+        TCP_CLOSING,      // 一端发送了FIN
+        TCP_CLOSED,       // 两端都发送了FIN
+        TCP_RESET,        // 出现RST
+    };
+
+    static const uint8_t kTcpFin = 0x01;
+    static const uint8_t kTcpSyn = 0x02;
+    static const uint8_t kTcpRst = 0x04;
+    static const uint8_t kTcpAck = 0x10;
+
+    static const uint32_t kNoPacket = UINT32_MAX; // 链表结尾
+
+    FlowTable();
+
+    /**
+     * @brief 统计一个数据包
+     * @param record 紧凑格式的数据包，地址无法还原为二进制的数据包不计入
+     * @param index 数据包的下标，必须大于之前计入的所有数据包
+     * @param flowId 输出参数，所属连接的编号
+     * @param direction 输出参数，发送端在FlowKey中的端点编号
+     * @return true 已计入
+     * @return false 没有IP地址
+     */
+    bool add(const CompactPacket& record, uint32_t index, uint32_t& flowId, uint8_t& direction);
+
+    bool add(const CompactPacket& record, uint32_t index, uint32_t& flowId)
+    {
+        uint8_t direction;
+        return add(record, index, flowId, direction);
+    }
+
+    /**
+     * @brief 按五元组查找连接，两个方向都能找到
+     * @param direction 输出参数，src在FlowKey中的端点编号
+     * @return true 找到
+     * @return false 连接不存在
+     */
+    bool find(const IpAddress& srcIp, uint16_t srcPort, const IpAddress& dstIp, uint16_t dstPort,
+              uint8_t ipProto, uint32_t& flowId, uint8_t& direction) const;
+
+    size_t            size() const { return flows.size(); }
+    const FlowRecord& at(size_t id) const { return flows[id]; }
+
+    /**
+     * @brief 把连接转换为以发起端为src的会话
+     * @param id 连接编号
+     * @param conversation 输出参数
+     */
+    void toConversation(size_t id, Conversation& conversation) const;
+
+    /**
+     * @brief 按顺序遍历一个连接的数据包
+     * @param id 连接编号
+     * @param fn 以数据包下标调用
+     */
+    template <typename Fn>
+    void forEachPacket(size_t id, Fn fn) const
+    {
+        for (uint32_t index = flows[id].first_packet; index != kNoPacket; index = nextPacket[index])
+        {
+            fn(index);
+        }
+    }
+
+    /**
+     * @brief 取出上次调用以来发生变化的连接编号
+     * @param ids 输出参数，按编号升序
+     */
+    void takeDirty(std::vector<uint32_t>& ids);
+
+    void clear();
+
+    /**
+     * @brief TCP状态的名称
+     */
+    static const char* stateName(uint8_t state);
+
+private:
+    static void normalize(const IpAddress& srcIp, uint16_t srcPort, const IpAddress& dstIp,
+                          uint16_t dstPort, uint8_t ipProto, FlowKey& key, uint8_t& direction);
+    static void updateTcpState(FlowRecord& flow, uint8_t direction, uint8_t flags);
+    size_t      probe(const FlowKey& key) const;
+    void        grow();
+
+    std::vector<uint32_t>   slots; // 连接下标加一，0表示空槽位，大小为2的幂
+    std::vector<FlowRecord> flows;
+    std::vector<uint32_t>   dirty;
+    std::vector<bool>       dirtyFlags;
+    std::vector<uint32_t>   nextPacket; // 按数据包下标，同一连接的下一个数据包
+};
+
+#endif
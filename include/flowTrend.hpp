@@ -0,0 +1,152 @@
+#ifndef flowTrend_hpp
+#define flowTrend_hpp
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "tsharkDataType.hpp"
+
+/**
+ * @brief 按秒统计的定长环形时间序列
+ *
+ * 每个槽位保存一秒的流量，槽位由秒数对kSlots取模得到，并记录所属的秒数，
+ * 因此超出窗口的旧数据被自然覆盖，不需要逐条删除。
+ * 只允许一个线程写入；读取使用序列锁，不阻塞写入线程，读到写入中途的数据时重试
+ */
+class FlowTrendRing
+{
+public:
+    static const size_t kSlots = 300;
+
+    FlowTrendRing();
+
+    FlowTrendRing(const FlowTrendRing&)            = delete;
+    FlowTrendRing& operator=(const FlowTrendRing&) = delete;
+
+    /**
+     * @brief 累加某一秒的流量，只能由写入线程调用
+     * @param second 时间戳（秒）
+     * @param value 流量
+     */
+    void add(long second, long value);
+
+    /**
+     * @brief 清空所有数据，只能由写入线程调用
+     */
+    void clear();
+
+    /**
+     * @brief 复制[start, start + count)这段时间的流量，没有数据的秒为0
+     * @param start 起始时间戳（秒）
+     * @param count 秒数
+     * @param out 输出缓冲区，至少count个元素
+     */
+    void snapshot(long start, size_t count, long* out) const;
+
+private:
+    static size_t slotOf(long second);
+
+    std::atomic<uint32_t> sequence; // 奇数表示正在写入
+    std::atomic<long>     seconds[kSlots];
+    std::atomic<long>     values[kSlots];
+};
+
+/**
+ * @brief 按1秒、1分钟、1小时三层降采样的流量趋势
+ *
+ * 每层是定长的环形桶数组，内存占用固定；每层保存总字节数、单秒最大字节数和数据包数。
+ * 分钟层和小时层的桶结束后放入待持久化列表，由调用方取出写入数据库，
+ * 长时间范围的查询直接使用粗粒度的层，不需要扫描每秒的数据
+ */
+class FlowTrendRollup
+{
+public:
+    enum Tier
+    {
+        TIER_SECOND = 0,
+        TIER_MINUTE = 1,
+        TIER_HOUR   = 2,
+        TIER_COUNT  = 3,
+    };
+
+    // 单次查询最多返回的桶数，约一年的小时级数据
+    static const size_t kMaxQueryBuckets = 8784;
+
+    /**
+     * @brief 构造函数，默认保存1小时的秒级、1天的分钟级和31天的小时级数据
+     * @param secondBuckets 秒级桶数
+     * @param minuteBuckets 分钟级桶数
+     * @param hourBuckets 小时级桶数
+     */
+    FlowTrendRollup(size_t secondBuckets = 3600, size_t minuteBuckets = 1440,
+                    size_t hourBuckets = 744);
+
+    FlowTrendRollup(const FlowTrendRollup&)            = delete;
+    FlowTrendRollup& operator=(const FlowTrendRollup&) = delete;
+
+    /**
+     * @brief 每层一个桶覆盖的秒数
+     */
+    static long tierSeconds(Tier tier);
+
+    /**
+     * @brief 选择能在内存中覆盖span秒的最细粒度的层
+     * @param span 查询的时间跨度（秒）
+     * @return 层
+     */
+    Tier tierForSpan(long span) const;
+
+    /**
+     * @brief 记录一秒的流量，每秒调用一次，时间不能倒退
+     * @param second 时间戳（秒）
+     * @param bytes 该秒的字节数
+     * @param packets 该秒的数据包数
+     */
+    void add(long second, uint64_t bytes, uint64_t packets);
+
+    /**
+     * @brief 查询[start, end)范围内某一层的桶，没有数据的桶为0
+     *
+     * start按桶宽度向下对齐，早于内存中最旧桶的部分被截掉，该层还没有数据时结果为空
+     *
+     * @param tier 层
+     * @param start 起始时间戳（秒）
+     * @param end 结束时间戳（秒，不包含）
+     * @param buckets 输出参数，按时间升序的连续桶
+     */
+    void query(Tier tier, long start, long end, std::vector<FlowTrendBucket>& buckets) const;
+
+    /**
+     * @brief 某一层内存中最旧的桶的起始时间，之前的数据只能从数据库查询
+     * @param tier 层
+     * @return 起始时间戳（秒）
+     */
+    long oldestStart(Tier tier) const;
+
+    /**
+     * @brief 取出已经结束、尚未持久化的分钟级和小时级桶
+     * @param completed 输出参数，(层, 桶)列表
+     */
+    void takeCompleted(std::vector<std::pair<Tier, FlowTrendBucket>>& completed);
+
+private:
+    struct Level
+    {
+        long                         width;   // 桶宽度（秒）
+        long                         current; // 最新桶的起始时间，-1表示还没有数据
+        long                         first;   // 第一个桶的起始时间
+        std::vector<FlowTrendBucket> buckets;
+    };
+
+    static long alignDown(long second, long width);
+
+    mutable std::mutex                            lock;
+    Level                                         levels[TIER_COUNT];
+    std::vector<std::pair<Tier, FlowTrendBucket>> pending;
+};
+
+#endif
@@ -0,0 +1,349 @@
+#ifndef liveStats_hpp
+#define liveStats_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tsharkDataType.hpp"
+
+/**
+ * @brief Space-Saving算法的高频项统计
+ *
+ * 最多跟踪capacity个键，新键在已满时替换计数最小的键并继承其计数，
+ * 因此计数是上界，error是可能多计的部分；真实计数超过总量/capacity的键一定在结果中。
+ * 键按字节数排序，数据包数按同样的规则累计
+ */
+class SpaceSaving
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param capacity 最多跟踪的键数
+     */
+    explicit SpaceSaving(size_t capacity = 256);
+
+    /**
+     * @brief 累加一个键
+     * @param key 键
+     * @param bytes 字节数
+     * @param packets 数据包数
+     */
+    void add(const std::string& key, uint64_t bytes, uint64_t packets = 1);
+
+    /**
+     * @brief 字节数最多的n个键
+     * @param n 数量
+     * @param items 输出参数，按字节数降序
+     */
+    void top(size_t n, std::vector<HeavyHitter>& items) const;
+
+    void   clear();
+    size_t size() const { return heap.size(); }
+
+    /**
+     * @brief 以二进制形式写出跟踪的键和计数
+     * @param file 输出文件
+     * @return true 写出成功
+     * @return false 写出失败
+     */
+    bool save(FILE* file) const;
+
+    /**
+     * @brief 从save写出的数据恢复，已有内容会被清空
+     * @param data 数据起始地址，成功后指向已读取部分之后
+     * @param end 数据结束地址
+     * @return true 恢复成功
+     * @return false 数据不完整或超出容量，统计被清空
+     */
+    bool load(const unsigned char*& data, const unsigned char* end);
+
+private:
+    void swapEntries(size_t a, size_t b);
+    void siftUp(size_t pos);
+    void siftDown(size_t pos);
+
+    size_t                                  capacity;
+    std::vector<HeavyHitter>                heap;      // 按字节数的最小堆
+    std::unordered_map<std::string, size_t> positions; // 键在堆中的位置
+};
+
+/**
+ * @brief Count-Min草图，用固定内存估计任意键的累计值
+ *
+ * depth行计数器，每行用不同的哈希映射到width个计数器之一，估计值取各行的最小值，
+ * 只会多估不会少估
+ */
+class CountMinSketch
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param width 每行计数器数量
+     * @param depth 行数
+     */
+    CountMinSketch(size_t width = 2048, size_t depth = 4);
+
+    void     add(const std::string& key, uint64_t value);
+    uint64_t estimate(const std::string& key) const;
+    void     clear();
+
+    /**
+     * @brief 以二进制形式写出全部计数器
+     */
+    bool save(FILE* file) const;
+
+    /**
+     * @brief 从save写出的数据恢复，宽度和行数必须与当前草图一致
+     * @return true 恢复成功
+     * @return false 数据不完整或尺寸不一致，草图被清空
+     */
+    bool load(const unsigned char*& data, const unsigned char* end);
+
+private:
+    size_t                width;
+    size_t                depth;
+    std::vector<uint64_t> counters;
+};
+
+/**
+ * @brief HyperLogLog基数估计
+ *
+ * 2^precision个寄存器，每个保存映射到它的哈希值中前导零的最大个数，
+ * 标准误差约为1.04/sqrt(2^precision)。两个精度相同的草图按寄存器取最大值即可合并，
+ * 合并结果等于对两者输入的并集做估计
+ */
+class HyperLogLog
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param precision 精度，4到16，默认11（2KB，误差约2.3%）
+     */
+    explicit HyperLogLog(int precision = 11);
+
+    /**
+     * @brief 加入一个元素的64位哈希值
+     */
+    void addHash(uint64_t hash);
+
+    /**
+     * @brief 合并另一个草图
+     * @param other 精度相同的草图
+     * @return true 合并成功
+     * @return false 精度不同
+     */
+    bool merge(const HyperLogLog& other);
+
+    /**
+     * @brief 估计不同元素的数量
+     */
+    double estimate() const;
+
+    void clear();
+    int  precision() const { return bits; }
+
+    /**
+     * @brief 以二进制形式写出精度和全部寄存器
+     */
+    bool save(FILE* file) const;
+
+    /**
+     * @brief 从save写出的数据恢复，精度必须与当前草图一致
+     * @return true 恢复成功
+     * @return false 数据不完整或精度不同，草图被清空
+     */
+    bool load(const unsigned char*& data, const unsigned char* end);
+
+private:
+    int                  bits;
+    std::vector<uint8_t> registers;
+};
+
+/**
+ * @brief 按分钟统计不同的源IP、目的IP和连接数
+ *
+ * 每分钟三个HyperLogLog，查询一段时间时合并其中每分钟的草图，不需要扫描数据包；
+ * 最多保留maxMinutes分钟，超出时丢弃最早的一分钟
+ */
+class EndpointCardinality
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param precision HyperLogLog精度
+     * @param maxMinutes 最多保留的分钟数
+     */
+    EndpointCardinality(int precision = 11, size_t maxMinutes = 1440);
+
+    /**
+     * @brief 统计一个数据包
+     * @param packet 数据包
+     */
+    void add(const Packet& packet);
+
+    /**
+     * @brief 合并另一个统计（例如另一个分析线程的结果），精度必须相同
+     * @param other 另一个统计
+     */
+    void merge(const EndpointCardinality& other);
+
+    void reset();
+
+    /**
+     * @brief 估计[start, end)内不同端点的数量，start和end按分钟对齐
+     * @param start 起始时间戳（秒）
+     * @param end 结束时间戳（秒，不包含）
+     * @param result 输出参数
+     * @return true 范围内有数据
+     * @return false 范围内没有数据
+     */
+    bool query(long start, long end, DistinctEndpoints& result) const;
+
+    /**
+     * @brief 按分钟列出[start, end)内每分钟不同端点的数量，只包含有数据的分钟
+     * @param start 起始时间戳（秒）
+     * @param end 结束时间戳（秒，不包含）
+     * @param minutes 输出参数，按时间升序
+     */
+    void perMinute(long start, long end, std::vector<DistinctEndpoints>& minutes) const;
+
+    /**
+     * @brief 以二进制形式写出每分钟的草图，随抓包文件的索引保存
+     * @param file 输出文件
+     * @return true 写出成功
+     * @return false 写出失败
+     */
+    bool save(FILE* file) const;
+
+    /**
+     * @brief 从save写出的数据恢复，已有统计被替换，超出maxMinutes时只保留最近的分钟
+     * @param data 数据起始地址，成功后指向已读取部分之后
+     * @param end 数据结束地址
+     * @return true 恢复成功
+     * @return false 数据不完整或精度不同，统计被清空
+     */
+    bool load(const unsigned char*& data, const unsigned char* end);
+
+private:
+    struct Window
+    {
+        explicit Window(int precision) : srcIps(precision), dstIps(precision), flows(precision) {}
+        HyperLogLog srcIps;
+        HyperLogLog dstIps;
+        HyperLogLog flows;
+    };
+
+    Window* windowOf(long minute);
+
+    int                    precision;
+    size_t                 maxMinutes;
+    mutable std::mutex     lock;
+    std::map<long, Window> minutes; // 分钟起始时间到草图
+};
+
+/**
+ * @brief 实时流量统计，按协议的包数和字节数以及源IP、目的IP、端口的Top-N
+ *
+ * 由processPacket逐包调用add，统计量都保存在定长的草图中；
+ * 每进入新的一秒把上一秒的结果发布为快照，仪表盘读取快照不访问数据库，也不等待逐包的更新
+ */
+class LiveTrafficStats
+{
+public:
+    enum Dimension
+    {
+        DIM_SRC_IP = 0,
+        DIM_DST_IP = 1,
+        DIM_PORT   = 2, // 源端口和目的端口都计入
+        DIM_COUNT  = 3,
+    };
+
+    /**
+     * @brief 构造函数
+     * @param topN 快照中每项Top列表的长度
+     * @param capacity 每个Space-Saving跟踪的键数，越大越准确
+     */
+    LiveTrafficStats(size_t topN = 10, size_t capacity = 256);
+
+    /**
+     * @brief 统计一个数据包
+     * @param packet 数据包
+     */
+    void add(const Packet& packet);
+
+    /**
+     * @brief 没有新数据包时推进时间，把second之前的秒发布出去，抓包期间定期调用
+     * @param second 时间戳（秒）
+     */
+    void advance(long second);
+
+    /**
+     * @brief 立即发布当前这一秒的统计，分析完整个文件后调用
+     */
+    void flush();
+
+    /**
+     * @brief 清空所有统计，开始新的抓包或分析时调用
+     */
+    void reset();
+
+    /**
+     * @brief 最近一次发布的快照
+     * @param snapshot 输出参数
+     */
+    void snapshot(LiveTrafficSnapshot& snapshot) const;
+
+    /**
+     * @brief 估计某个源IP、目的IP或端口的累计字节数，不要求在Top-N中
+     * @param dimension 统计维度
+     * @param key IP地址或十进制端口号
+     * @return 字节数的上界估计
+     */
+    uint64_t estimateBytes(Dimension dimension, const std::string& key) const;
+
+    /**
+     * @brief 以二进制形式写出全部统计状态，随抓包文件的索引保存
+     * @param file 输出文件
+     * @return true 写出成功
+     * @return false 写出失败
+     */
+    bool save(FILE* file) const;
+
+    /**
+     * @brief 从save写出的数据恢复并发布快照，已有统计被替换
+     * @param data 数据起始地址，成功后指向已读取部分之后
+     * @param end 数据结束地址
+     * @return true 恢复成功
+     * @return false 数据不完整，统计被清空
+     */
+    bool load(const unsigned char*& data, const unsigned char* end);
+
+private:
+    void publish();
+    void startSecond(long second);
+
+    size_t topN;
+
+    mutable std::mutex lock; // 保护以下逐包更新的统计量
+    long               currentSecond;
+    uint64_t           secondPackets;
+    uint64_t           secondBytes;
+    uint64_t           totalPackets;
+    uint64_t           totalBytes;
+    SpaceSaving        secondProtocols; // 当前这一秒的协议
+    SpaceSaving        protocols;       // 累计的协议
+    SpaceSaving        talkers[DIM_COUNT];
+    CountMinSketch     talkerBytes[DIM_COUNT];
+    std::string        portKey; // 复用的端口键
+
+    mutable std::mutex  publishLock;
+    LiveTrafficSnapshot published;
+};
+
+#endif
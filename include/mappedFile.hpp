@@ -0,0 +1,83 @@
+#ifndef mappedFile_hpp
+#define mappedFile_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 只读内存映射文件
+ *
+ * 整个文件映射一次，之后按偏移直接访问，不再产生read系统调用和数据拷贝
+ */
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief 映射文件，已映射的文件会先解除映射
+     * @param path 文件路径
+     * @return true 映射成功
+     * @return false 映射失败
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief 重新映射当前文件，用于文件在映射后被追加写入的情况
+     * @return true 映射成功
+     * @return false 映射失败
+     */
+    bool remap();
+
+    /**
+     * @brief 解除映射
+     */
+    void close();
+
+    bool                 isOpen() const { return !filePath.empty(); }
+    const std::string&   path() const { return filePath; }
+    const unsigned char* data() const { return base; }
+    uint64_t             size() const { return length; }
+
+    /**
+     * @brief 获取[offset, offset + count)区间的数据，区间超出映射范围时返回nullptr
+     * @param offset 起始偏移
+     * @param count 字节数
+     * @return 数据首地址
+     */
+    const unsigned char* range(uint64_t offset, uint64_t count) const
+    {
+        if (offset > length || count > length - offset)
+        {
+            return nullptr;
+        }
+        return base + offset;
+    }
+
+private:
+    std::string          filePath;
+    const unsigned char* base;
+    uint64_t             length;
+};
+
+/**
+ * @brief 一个数据包的原始字节，指向映射文件内部，mapping保证映射在使用期间不被解除；
+ *        压缩的抓包文件中的数据包解压到storage中，data指向storage的内容
+ */
+struct PacketBytes
+{
+    uint32_t                                    frame_number;
+    const unsigned char*                        data;   // 无法获取时为nullptr
+    uint32_t                                    length;
+    std::shared_ptr<std::vector<unsigned char>> storage;
+    std::shared_ptr<const MappedFile>           mapping;
+};
+
+#endif
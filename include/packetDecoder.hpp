@@ -0,0 +1,57 @@
+#ifndef packetDecoder_hpp
+#define packetDecoder_hpp
+
+#include <cstddef>
+#include <cstdint>
+
+#include "tsharkDataType.hpp"
+
+/**
+ * @brief 原生解析得到的网络层和传输层字段，指针指向传入的数据包内容
+ */
+struct DecodedPacket
+{
+    IpAddress            src_ip; // IPv4以::ffff:a.b.c.d映射存储，与NetUtil::parseIp一致
+    IpAddress            dst_ip;
+    uint16_t             src_port;
+    uint16_t             dst_port;
+    uint8_t              ip_proto;
+    bool                 fragment; // 非首个或后续还有分片，传输层字段不可用
+    uint8_t              tcp_flags;
+    uint16_t             tcp_window; // 未按窗口扩大因子换算的原始窗口
+    uint32_t             tcp_seq;
+    uint32_t             tcp_ack;
+    const unsigned char* payload; // 传输层负载
+    uint32_t             payload_length;
+};
+
+/**
+ * @brief 数据包的原生解码器
+ *
+ * 只解析链路层、IP和TCP/UDP头，用于不需要tshark完整解析的场景（流重组、TCP指标）。
+ * 支持以太网（含VLAN/QinQ）、RAW、IPv4、IPv6、Linux cooked（SLL/SLL2）和BSD loopback链路，
+ * 负载长度以IP头中的长度为准，并截断到实际捕获的长度
+ */
+class PacketDecoder
+{
+public:
+    /**
+     * @brief 解析一个数据包
+     * @param linkType 链路层类型（LINKTYPE_*）
+     * @param data 数据包内容
+     * @param length 捕获长度
+     * @param packet 输出参数
+     * @return true 解析到IP头
+     * @return false 不支持的链路类型、不是IP数据包或数据包被截断
+     */
+    static bool decode(uint16_t linkType, const unsigned char* data, uint32_t length,
+                       DecodedPacket& packet);
+
+private:
+    static bool decodeIpv4(const unsigned char* data, uint32_t length, DecodedPacket& packet);
+    static bool decodeIpv6(const unsigned char* data, uint32_t length, DecodedPacket& packet);
+    static void decodeTransport(const unsigned char* data, uint32_t length,
+                                DecodedPacket& packet);
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef packetFilter_hpp
+#define packetFilter_hpp
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "packetStore.hpp"
+#include "tsharkDataType.hpp"
+#include "utils.hpp"
+
+/**
+ * @brief 在PacketStore的紧凑记录上按条件过滤数据包
+ *
+ * 不另外保存数据包，直接扫描PacketStore中的定长记录：IP和MAC按二进制比较，
+ * 协议和归属地先对字典中的每个取值匹配一次再按ID查表，info在StringArena中原地匹配。
+ * 过滤时每个条件先编译成查找表或定长比较，再对记录做紧凑循环扫描，不经过数据库。
+ */
+class PacketFilter
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param store 被过滤的数据包存储，过滤期间不能被修改
+     */
+    explicit PacketFilter(const PacketStore& store);
+
+    /**
+     * @brief 按条件过滤数据包
+     *
+     * 支持的条件及匹配语义与SQLiteUtil::queryPackets一致：mac_address、ip_address、port、
+     * location、protocol、keyword（按LIKE语义匹配info）以及start_time、end_time
+     *
+     * @param conditions 查询条件
+     * @param indexes 输出参数，匹配的数据包在PacketStore中的下标，按升序排列
+     * @return true 过滤成功
+     * @return false 条件格式错误
+     */
+    bool filter(const std::map<std::string, std::string>& conditions,
+                std::vector<uint32_t>&                    indexes) const;
+
+private:
+    typedef std::vector<uint32_t> Selection;
+
+    // 以下各过滤函数在sel上原地筛选下标，first为true时sel尚未初始化，需要扫描全部记录
+    void filterTime(double startTime, double endTime, Selection& sel, bool first) const;
+    void filterPort(const std::string& pattern, Selection& sel, bool first) const;
+    void filterProtocol(const std::string& pattern, Selection& sel, bool first) const;
+    void filterLocation(const std::string& pattern, Selection& sel, bool first) const;
+    void filterIp(const std::string& pattern, Selection& sel, bool first) const;
+    void filterMac(const std::string& pattern, Selection& sel, bool first) const;
+    void filterInfo(const std::string& pattern, Selection& sel, bool first) const;
+
+    // 对每条记录调用match，保留匹配的下标
+    template <typename Match> void scan(Match match, Selection& sel, bool first) const;
+
+    const PacketStore& store;
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef packetIndexFile_hpp
+#define packetIndexFile_hpp
+
+#include <string>
+
+#include "liveStats.hpp"
+#include "packetStore.hpp"
+#include "tcpMetrics.hpp"
+
+/**
+ * @brief 抓包文件旁的二进制索引文件（<抓包文件>.idx）
+ *
+ * 首次分析后写出全部紧凑记录（帧偏移、长度、时间戳及摘要列）、按连接的TCP指标、实时流量和端点统计，
+ * 再次打开同一抓包文件时直接映射索引文件恢复，不再运行tshark，也不再读取抓包文件。
+ * 索引以抓包文件的大小、修改时间以及首尾各1MB内容的XXH64哈希校验，任一项不一致即失效
+ */
+class PacketIndexFile
+{
+public:
+    /**
+     * @brief 获取抓包文件对应的索引文件路径
+     * @param capturePath 抓包文件路径
+     * @return 索引文件路径
+     */
+    static std::string pathFor(const std::string& capturePath);
+
+    /**
+     * @brief 写出索引文件，先写临时文件再改名，不会留下不完整的索引
+     * @param capturePath 抓包文件路径
+     * @param store 抓包文件的全部数据包
+     * @param metrics 按连接的TCP指标，为nullptr时写出空的指标
+     * @param liveStats 实时流量统计，为nullptr时写出空的统计
+     * @param endpoints 每分钟的端点统计，为nullptr时写出空的统计
+     * @return true 写出成功
+     * @return false 写出失败
+     */
+    static bool save(const std::string& capturePath, const PacketStore& store,
+                     const TcpMetrics*          metrics   = nullptr,
+                     const LiveTrafficStats*    liveStats = nullptr,
+                     const EndpointCardinality* endpoints = nullptr);
+
+    /**
+     * @brief 加载索引文件
+     * @param capturePath 抓包文件路径
+     * @param store 输出参数，恢复的数据包
+     * @param metrics 输出参数，恢复的TCP指标，为nullptr时不恢复
+     * @param liveStats 输出参数，恢复的实时流量统计，为nullptr时不恢复
+     * @param endpoints 输出参数，恢复的端点统计，为nullptr时不恢复
+     * @return true 索引有效并加载成功
+     * @return false 索引不存在、已失效或损坏
+     */
+    static bool load(const std::string& capturePath, PacketStore& store,
+                     TcpMetrics* metrics = nullptr, LiveTrafficStats* liveStats = nullptr,
+                     EndpointCardinality* endpoints = nullptr);
+
+    /**
+     * @brief 将索引文件的校验信息更新为抓包文件当前的状态
+     *
+     * 用于调用方已确认内容相同、但修改时间发生变化的抓包文件（如从分析缓存恢复的文件）
+     *
+     * @param capturePath 抓包文件路径
+     * @return true 更新成功
+     * @return false 索引文件不存在或版本不匹配
+     */
+    static bool restamp(const std::string& capturePath);
+
+private:
+    struct Header
+    {
+        char     magic[8];
+        uint32_t version;
+        uint32_t recordSize; // sizeof(CompactPacket)，结构变化时索引自动失效
+        uint64_t fileSize;
+        int64_t  mtimeSec;
+        int64_t  mtimeNsec;
+        uint64_t sampleHash;
+    };
+
+    // 计算抓包文件的校验信息
+    static bool fingerprint(const std::string& capturePath, Header& header);
+};
+
+#endif
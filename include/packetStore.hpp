@@ -0,0 +1,329 @@
+#ifndef packetStore_hpp
+#define packetStore_hpp
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tsharkDataType.hpp"
+#include "utils.hpp"
+
+/**
+ * @brief 紧凑的数据包记录
+ *
+ * 地址以定长二进制保存，协议和归属地保存为字典ID，info保存在StringArena中，
+ * 记录本身不含任何需要单独分配的成员
+ */
+struct CompactPacket
+{
+    uint32_t  frame_number;
+    uint32_t  cap_len;
+    uint32_t  len;
+    uint16_t  src_port;
+    uint16_t  dst_port;
+    double    time;
+    uint64_t  file_offset;
+    uint64_t  src_mac; // 低48位，无法解析时为NetUtil::kInvalidMac
+    uint64_t  dst_mac;
+    IpAddress src_ip;
+    IpAddress dst_ip;
+    uint32_t  protocol_id;
+    uint32_t  src_location_id;
+    uint32_t  dst_location_id;
+    uint32_t  raw_address_id; // 地址无法由二进制形式还原时，原始文本在地址字典中的ID，否则为0
+    uint64_t  info_ref;       // info在StringArena中的位置
+    uint32_t  info_length;
+    uint8_t   ip_proto; // 占用结构体末尾的填充，不增加记录大小
+    uint8_t   tcp_flags;
+    uint16_t  stack_id; // frame.protocols在协议栈字典中的ID
+};
+
+/**
+ * @brief 分块的字符串内存池
+ *
+ * 字符串追加到固定大小的内存块中，不会跨块存放，已追加的字符串地址保持不变
+ */
+class StringArena
+{
+public:
+    /**
+     * @brief 追加一段字符串
+     * @param data 字符串数据
+     * @param length 字符串长度
+     * @return 字符串位置，高32位为块号，低32位为块内偏移
+     */
+    uint64_t append(const char* data, uint32_t length);
+
+    /**
+     * @brief 根据位置获取字符串
+     * @param ref append返回的位置
+     * @return 字符串首地址
+     */
+    const char* get(uint64_t ref) const { return blocks[ref >> 32].data.get() + (ref & 0xFFFFFFFF); }
+
+    /**
+     * @brief 释放所有内存块
+     */
+    void clear();
+
+    /**
+     * @brief 已分配的内存字节数
+     */
+    size_t memoryUsage() const;
+
+    /**
+     * @brief 写出所有内存块，load后已有的位置保持有效
+     * @param file 输出文件
+     * @return true 写出成功
+     * @return false 写出失败
+     */
+    bool save(FILE* file) const;
+
+    /**
+     * @brief 从save写出的数据恢复，已有内容会被清空
+     * @param data 数据起始地址，成功后指向已读取部分之后
+     * @param end 数据结束地址
+     * @return true 恢复成功
+     * @return false 数据不完整
+     */
+    bool load(const unsigned char*& data, const unsigned char* end);
+
+private:
+    static const uint32_t kBlockSize = 1 << 20;
+
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        uint32_t                capacity;
+        uint32_t                used;
+    };
+    std::vector<Block> blocks;
+};
+
+/**
+ * @brief 按捕获文件组织的数据包存储
+ *
+ * 数据包记录按块（slab）批量分配，每块kChunkSize条，追加时不再为单个数据包分配内存
+ */
+class PacketStore
+{
+public:
+    PacketStore();
+
+    /**
+     * @brief 追加一个数据包
+     * @param packet 数据包
+     * @return 数据包在存储中的下标
+     */
+    uint32_t append(const Packet& packet);
+
+    /**
+     * @brief 已保存的数据包数量
+     */
+    size_t size() const { return count; }
+
+    /**
+     * @brief 获取指定下标的紧凑记录
+     * @param index 下标
+     * @return 紧凑记录
+     */
+    const CompactPacket& at(size_t index) const
+    {
+        return chunks[index / kChunkSize][index % kChunkSize];
+    }
+
+    /**
+     * @brief 将紧凑记录还原为Packet
+     * @param record 紧凑记录
+     * @param packet 输出参数，还原的数据包
+     */
+    void toPacket(const CompactPacket& record, Packet& packet) const;
+
+    /**
+     * @brief 将指定下标的数据包还原为独立的Packet对象，用于对外接口
+     * @param index 下标
+     * @return 数据包
+     */
+    std::shared_ptr<Packet> materialize(size_t index) const;
+
+    /**
+     * @brief 根据stack_id获取协议栈文本
+     * @param id 紧凑记录中的stack_id
+     * @return frame.protocols，ID不存在时返回空字符串
+     */
+    const std::string& protocolStack(uint16_t id) const { return stackDict.lookup(id); }
+
+    /**
+     * @brief 协议名字典，紧凑记录中的protocol_id是其中的ID
+     */
+    const StringDict& protocols() const { return protocolDict; }
+
+    /**
+     * @brief 归属地字典，紧凑记录中的src_location_id和dst_location_id是其中的ID
+     */
+    const StringDict& locations() const { return locationDict; }
+
+    /**
+     * @brief 获取紧凑记录的info文本
+     * @param record 紧凑记录
+     * @return info首地址，长度为record.info_length
+     */
+    const char* info(const CompactPacket& record) const { return infoArena.get(record.info_ref); }
+
+    /**
+     * @brief 清空所有数据包，释放内存
+     */
+    void clear();
+
+    /**
+     * @brief 已分配的内存字节数
+     */
+    size_t memoryUsage() const;
+
+    /**
+     * @brief 以二进制形式写出全部记录、字典和info数据，仅供同一版本的程序load
+     * @param file 输出文件
+     * @return true 写出成功
+     * @return false 写出失败
+     */
+    bool save(FILE* file) const;
+
+    /**
+     * @brief 从save写出的数据恢复，记录按块整体拷贝，已有内容会被清空
+     * @param data 数据起始地址，成功后指向已读取部分之后
+     * @param end 数据结束地址
+     * @return true 恢复成功
+     * @return false 数据不完整，存储被清空
+     */
+    bool load(const unsigned char*& data, const unsigned char* end);
+
+private:
+    static const size_t   kChunkSize  = 4096;
+    static const uint16_t kMaxStackId = 0xFFFF;
+
+    uint16_t stackIdOf(const std::string& stack);
+
+    std::vector<std::unique_ptr<CompactPacket[]>> chunks;
+    size_t                                        count;
+
+    StringArena infoArena;
+    StringDict  protocolDict;
+    StringDict  locationDict;
+    StringDict  addressDict;
+    StringDict  stackDict;
+};
+
+/**
+ * @brief 帧编号到存储下标的索引
+ *
+ * 帧编号从1开始且基本连续，按kChunkSize个编号一块分配稠密数组，查找为一次数组寻址；
+ * 远超已有范围的编号（如合并多个文件后的跳号）记录在稀疏表中，避免为空洞分配内存
+ */
+class FrameIndex
+{
+public:
+    static const uint32_t kNone = 0xFFFFFFFF;
+
+    FrameIndex();
+
+    /**
+     * @brief 记录帧编号对应的下标
+     * @param frame 帧编号
+     * @param index 下标
+     */
+    void insert(uint32_t frame, uint32_t index);
+
+    /**
+     * @brief 查找帧编号对应的下标
+     * @param frame 帧编号
+     * @param index 输出参数，下标
+     * @return true 找到
+     * @return false 未找到
+     */
+    bool find(uint32_t frame, uint32_t& index) const
+    {
+        size_t chunk = frame / kChunkSize;
+        if (chunk < chunks.size() && chunks[chunk])
+        {
+            index = chunks[chunk][frame % kChunkSize];
+            if (index != kNone)
+            {
+                return true;
+            }
+        }
+        return !sparse.empty() && findSparse(frame, index);
+    }
+
+    /**
+     * @brief 按帧编号升序遍历[first, last]区间内的记录
+     * @param first 起始帧编号
+     * @param last 结束帧编号（包含）
+     * @param fn 回调，参数为(帧编号, 下标)
+     */
+    template <typename Fn>
+    void forEachInRange(uint32_t first, uint32_t last, Fn fn) const
+    {
+        if (first > last)
+        {
+            return;
+        }
+
+        auto sparseIt = sparse.lower_bound(first);
+        for (size_t chunk = first / kChunkSize; chunk < chunks.size(); chunk++)
+        {
+            size_t begin = std::max<size_t>(chunk * kChunkSize, first);
+            size_t end   = std::min<size_t>((chunk + 1) * kChunkSize - 1, last);
+            if (begin > last)
+            {
+                break;
+            }
+            if (!chunks[chunk])
+            {
+                continue;
+            }
+            for (size_t frame = begin; frame <= end; frame++)
+            {
+                uint32_t index = chunks[chunk][frame % kChunkSize];
+                if (index == kNone)
+                {
+                    continue;
+                }
+                for (; sparseIt != sparse.end() && sparseIt->first < frame; ++sparseIt)
+                {
+                    fn(sparseIt->first, sparseIt->second);
+                }
+                fn(static_cast<uint32_t>(frame), index);
+            }
+        }
+        for (; sparseIt != sparse.end() && sparseIt->first <= last; ++sparseIt)
+        {
+            fn(sparseIt->first, sparseIt->second);
+        }
+    }
+
+    /**
+     * @brief 已记录的帧数量
+     */
+    size_t size() const { return count; }
+
+    /**
+     * @brief 清空索引，释放内存
+     */
+    void clear();
+
+private:
+    static const size_t kChunkSize = 4096;
+    // 稠密数组最多向已有范围之外扩展的块数，更远的编号进入稀疏表
+    static const size_t kMaxGapChunks = 256;
+
+    bool findSparse(uint32_t frame, uint32_t& index) const;
+
+    std::vector<std::unique_ptr<uint32_t[]>> chunks;
+    std::map<uint32_t, uint32_t>             sparse;
+    size_t                                   count;
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef protocolHierarchy_hpp
+#define protocolHierarchy_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "tsharkDataType.hpp"
+
+/**
+ * @brief 协议分层统计，与tshark -z io,phs的结果相同
+ *
+ * 以frame为根的前缀树，每个数据包按frame.protocols从根走到叶子，沿途每个节点累计一次，
+ * 分析时逐包更新，界面查询时直接返回，不需要再次解析抓包文件
+ */
+class ProtocolHierarchy
+{
+public:
+    ProtocolHierarchy();
+
+    /**
+     * @brief 统计一个或一组协议栈相同的数据包
+     * @param stack frame.protocols，以冒号分隔，开头的frame可以省略
+     * @param bytes 帧长度之和
+     * @param packets 数据包数
+     */
+    void add(const std::string& stack, uint64_t bytes, uint64_t packets = 1);
+
+    /**
+     * @brief 按深度优先顺序列出所有节点，同一层按首次出现的顺序
+     * @param nodes 输出参数，没有数据包时为空
+     */
+    void snapshot(std::vector<ProtocolHierarchyNode>& nodes) const;
+
+    /**
+     * @brief 每次统计或清空后递增，用于判断是否需要重新保存
+     */
+    uint64_t version() const;
+
+    void clear();
+
+private:
+    struct Node
+    {
+        std::string           name;
+        uint64_t              packets;
+        uint64_t              bytes;
+        std::vector<uint32_t> children; // 子节点在nodes中的下标
+    };
+
+    uint32_t child(uint32_t parent, const std::string& stack, size_t start, size_t length);
+
+    mutable std::mutex lock;
+    std::vector<Node>  nodes; // nodes[0]为frame
+    uint64_t           changes;
+};
+
+#endif
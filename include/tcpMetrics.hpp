@@ -0,0 +1,115 @@
+#ifndef tcpMetrics_hpp
+#define tcpMetrics_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+#include "packetDecoder.hpp"
+#include "tsharkDataType.hpp"
+
+/**
+ * @brief 按连接统计TCP性能指标
+ *
+ * 直接使用TCP头中的序列号、确认号、标志位和窗口：
+ * - 握手时延取SYN到SYN/ACK的时间
+ * - 每个方向保存最多kMaxOutstanding个未确认分段的结束序列号和发送时间，
+ *   对端的确认覆盖某个分段时得到一个往返时间样本，重传之后的样本有歧义，按Karn算法丢弃
+ * - 序列号落后于已见最大序列号的分段，距离最大序列号出现不到一个往返时间（没有样本时3ms）的
+ *   记为乱序，否则记为重传
+ * - 每秒字节数计入按对数分桶的直方图，用于估计吞吐量分位数
+ * 每条连接的状态大小固定
+ */
+class TcpMetrics
+{
+public:
+    static const size_t kMaxOutstanding = 16;
+
+    /**
+     * @brief 统计一个TCP分段
+     * @param flowId 连接编号
+     * @param direction 发送端在FlowKey中的端点编号
+     * @param time 时间戳
+     * @param bytes 帧长度
+     * @param packet 解码后的TCP分段
+     */
+    void add(uint32_t flowId, uint8_t direction, double time, uint32_t bytes,
+             const DecodedPacket& packet);
+
+    /**
+     * @brief 获取一条连接的指标
+     * @param flowId 连接编号
+     * @param metrics 输出参数
+     * @return true 找到
+     * @return false 该连接没有TCP分段
+     */
+    bool get(uint32_t flowId, TcpFlowMetrics& metrics) const;
+
+    size_t size() const { return flows.size(); }
+    void   clear();
+
+    /**
+     * @brief 以二进制形式写出所有连接的统计状态，仅供同一版本的程序load
+     * @param file 输出文件
+     * @return true 写出成功
+     * @return false 写出失败
+     */
+    bool save(FILE* file) const;
+
+    /**
+     * @brief 从save写出的数据恢复，已有内容会被清空
+     * @param data 数据起始地址，成功后指向已读取部分之后
+     * @param end 数据结束地址
+     * @return true 恢复成功
+     * @return false 数据不完整，统计被清空
+     */
+    bool load(const unsigned char*& data, const unsigned char* end);
+
+private:
+    struct Segment
+    {
+        uint32_t seqEnd;
+        double   time;
+    };
+
+    struct Direction
+    {
+        bool     started;
+        uint32_t highestEnd;                   // 已见的最大结束序列号
+        double   highestTime;                  // highestEnd前进的时间
+        Segment  outstanding[kMaxOutstanding]; // 按序列号递增的环形队列
+        uint8_t  head;
+        uint8_t  count;
+    };
+
+    struct Flow
+    {
+        Flow();
+
+        Direction             directions[2];
+        double                synTime;
+        double                handshakeRtt;
+        double                rttMin;
+        double                rttMax;
+        double                rttSum;
+        uint32_t              rttSamples;
+        uint32_t              retransmissions;
+        uint32_t              outOfOrder;
+        uint32_t              zeroWindows;
+        long                  second; // 正在累计的秒
+        uint64_t              secondBytes;
+        uint64_t              maxSecondBytes;
+        std::vector<uint32_t> histogram; // 已结束的每秒字节数，第一次跨秒时分配
+    };
+
+    static void   sampleRtt(Flow& flow, Direction& sender, double time, uint32_t ack);
+    static size_t bucketOf(uint64_t value);
+    static double bucketValue(size_t bucket);
+    static double percentile(const std::vector<uint32_t>& histogram, double quantile);
+
+    std::unordered_map<uint32_t, Flow> flows;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef tcpReassembly_hpp
+#define tcpReassembly_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "packetDecoder.hpp"
+#include "tsharkDataType.hpp"
+
+/**
+ * @brief TCP流重组
+ *
+ * 按连接编号和方向维护下一个期望的序列号，序列号换算为相对于流起点的64位偏移，
+ * 可跨越32位回绕。按序的分段直接追加，重复的部分按重传丢弃，
+ * 超前的分段暂存到等待队列，前面的数据到达后依次交付；
+ * 等待队列超过上限或所有数据包都已加入时，跳过缺失的数据并记为空洞。
+ * 每个方向保存的负载不超过maxStreamBytes，超出的部分只计数
+ */
+class TcpReassembler
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param maxStreamBytes 每个方向最多保存的负载字节数
+     * @param maxPendingBytes 每个方向等待队列最多暂存的字节数
+     */
+    TcpReassembler(size_t maxStreamBytes = 1024 * 1024, size_t maxPendingBytes = 256 * 1024);
+
+    /**
+     * @brief 加入一个TCP分段
+     * @param flowId 连接编号
+     * @param direction 发送端在FlowKey中的端点编号
+     * @param packet 解码后的TCP分段
+     */
+    void add(uint32_t flowId, uint8_t direction, const DecodedPacket& packet);
+
+    /**
+     * @brief 所有数据包加入后调用，跨过空洞交付等待队列中剩余的分段
+     */
+    void finish();
+
+    /**
+     * @brief 获取一个方向重组后的数据
+     * @param flowId 连接编号
+     * @param direction 发送端在FlowKey中的端点编号
+     * @param data 输出参数
+     * @return true 找到
+     * @return false 该连接没有TCP分段
+     */
+    bool stream(uint32_t flowId, uint8_t direction, TcpStreamData& data) const;
+
+    size_t size() const { return streams.size(); }
+    void   clear();
+
+private:
+    struct Half
+    {
+        Half();
+
+        bool                                           started;
+        uint32_t                                       base;    // 偏移0对应的序列号
+        uint64_t                                       next;    // 下一个期望的偏移
+        TcpStreamData                                  result;
+        std::map<uint64_t, std::vector<unsigned char>> pending; // 偏移到超前的分段
+        size_t                                         pendingBytes;
+    };
+
+    struct Stream
+    {
+        Half halves[2];
+    };
+
+    void deliver(Half& half, const unsigned char* data, uint64_t length);
+    void drain(Half& half);
+    void skipGap(Half& half);
+
+    size_t                               maxStreamBytes;
+    size_t                               maxPendingBytes;
+    std::unordered_map<uint32_t, Stream> streams;
+};
+
+#endif
@@ -1,7 +1,10 @@
 #ifndef tsharkDataType_hpp
 #define tsharkDataType_hpp
 
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <vector>
 
 struct Packet
 {
@@ -17,9 +20,29 @@ struct Packet
     std::string dst_ip; // 目的IP地址
     std::string dst_location;
     uint16_t    dst_port;
+    uint8_t     ip_proto;        // IP层的上层协议号（6为TCP，17为UDP），非IP数据包为0
+    uint8_t     tcp_flags;       // TCP标志位，非TCP数据包为0
+    std::string frame_protocols; // 协议栈（frame.protocols），如eth:ethertype:ip:tcp
     std::string protocol;
     std::string info; // 数据包的概要信息
-    uint32_t    file_offset;
+    uint64_t    file_offset; // 数据包内容在抓包文件中的偏移
+};
+
+// 定长二进制IP地址，IPv4以::ffff:a.b.c.d映射存储，全零表示无地址
+struct IpAddress
+{
+    uint8_t bytes[16];
+
+    bool isEmpty() const
+    {
+        static const uint8_t zero[16] = {0};
+        return memcmp(bytes, zero, sizeof(bytes)) == 0;
+    }
+
+    bool operator==(const IpAddress& other) const
+    {
+        return memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+    }
 };
 
 // PCAP全局文件头
@@ -50,4 +73,127 @@ struct AdapterInfo
     std::string remark;
 };
 
+// 流量趋势中的一个时间段
+struct FlowTrendBucket
+{
+    long     start;     // 起始时间戳（秒）
+    uint64_t bytes;     // 总字节数
+    uint64_t max_bytes; // 时间段内单秒的最大字节数
+    uint64_t packets;   // 数据包数
+};
+
+// 高频项统计中的一项，计数是上界，error为可能多计的字节数
+struct HeavyHitter
+{
+    std::string key;
+    uint64_t    bytes;
+    uint64_t    packets;
+    uint64_t    error;
+};
+
+// 实时流量统计快照，按协议的统计为最近一个完整秒，Top列表为累计值
+struct LiveTrafficSnapshot
+{
+    long                     second; // 快照对应的秒，-1表示还没有数据
+    uint64_t                 packets;
+    uint64_t                 bytes;
+    uint64_t                 total_packets;
+    uint64_t                 total_bytes;
+    std::vector<HeavyHitter> protocols;       // 这一秒按协议统计，key为协议名
+    std::vector<HeavyHitter> total_protocols; // 累计按协议统计
+    std::vector<HeavyHitter> top_src_ips;
+    std::vector<HeavyHitter> top_dst_ips;
+    std::vector<HeavyHitter> top_ports; // key为十进制端口号
+};
+
+// 一段时间内不同端点的数量，由HyperLogLog估计
+struct DistinctEndpoints
+{
+    long   start; // 起始时间戳（秒）
+    long   end;   // 结束时间戳（秒，不包含）
+    double src_ips;
+    double dst_ips;
+    double flows; // 不同的连接（两端地址、端口和协议，不区分方向）
+};
+
+// 一条连接（会话）的统计，src为发送第一个数据包的一端
+struct Conversation
+{
+    uint32_t    flow_id;
+    std::string src_ip;
+    uint16_t    src_port;
+    std::string dst_ip;
+    uint16_t    dst_port;
+    uint8_t     ip_proto;
+    double      first_time;
+    double      last_time;
+    uint64_t    packets_sent; // src发出的数据包数
+    uint64_t    bytes_sent;
+    uint64_t    packets_received; // dst发出的数据包数
+    uint64_t    bytes_received;
+    uint8_t     tcp_flags_sent; // src发出的数据包中出现过的TCP标志位
+    uint8_t     tcp_flags_received;
+    std::string tcp_state; // 非TCP连接为空
+};
+
+// 一条TCP连接的性能指标，两个方向合计，时间单位为秒，没有样本的项为-1
+struct TcpFlowMetrics
+{
+    uint32_t flow_id;
+    double   handshake_rtt; // SYN到SYN/ACK的时间
+    double   rtt_min;       // 数据与其确认之间的往返时间
+    double   rtt_avg;
+    double   rtt_max;
+    uint32_t rtt_samples;
+    uint32_t retransmissions;
+    uint32_t out_of_order;
+    uint32_t zero_windows;   // 通告零窗口的分段数
+    double   throughput_p50; // 有数据的每一秒中字节数的分位数
+    double   throughput_p95;
+    double   throughput_max;
+};
+
+// 协议分层统计中的一个节点，path是从frame开始以冒号连接的协议栈前缀
+struct ProtocolHierarchyNode
+{
+    std::string path;     // 如frame:eth:ethertype:ip
+    std::string protocol; // 路径中的最后一个协议
+    uint32_t    depth;    // frame为0
+    uint64_t    packets;  // 协议栈以path开头的数据包数
+    uint64_t    bytes;    // 这些数据包的帧长度之和
+};
+
+// TCP连接一个方向上重组后的负载
+struct TcpStreamData
+{
+    std::vector<unsigned char> data;            // 按序重组的负载，超出上限的部分不保存
+    uint64_t                   total_bytes;     // 按序交付的负载字节数，含未保存的部分
+    uint64_t                   gap_bytes;       // 没有抓到而跳过的字节数
+    uint32_t                   gaps;            // 跳过的空洞个数
+    uint32_t                   retransmissions; // 全部或部分数据已交付过的分段
+    uint32_t                   out_of_order;    // 先于前面的数据到达的分段
+    bool                       truncated;       // data只包含前一部分负载
+};
+
+// 重组后的TCP流，client为发送第一个数据包的一端
+struct TcpStream
+{
+    uint32_t      flow_id;
+    std::string   client_ip;
+    uint16_t      client_port;
+    std::string   server_ip;
+    uint16_t      server_port;
+    TcpStreamData client; // client发出的数据
+    TcpStreamData server;
+};
+
+// 网卡自启动以来的累计收发计数，来自/proc/net/dev
+struct InterfaceCounters
+{
+    uint64_t rx_bytes;
+    uint64_t rx_packets;
+    uint64_t tx_bytes;
+    uint64_t tx_packets;
+};
+
 #endif
\ No newline at end of file
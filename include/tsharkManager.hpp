@@ -6,14 +6,26 @@
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
 #include "rapidxml/rapidxml.hpp"
+#include "captureReader.hpp"
+#include "flowTable.hpp"
+#include "flowTrend.hpp"
+#include "liveStats.hpp"
+#include "mappedFile.hpp"
+#include "packetFilter.hpp"
+#include "packetStore.hpp"
+#include "protocolHierarchy.hpp"
+#include "tcpMetrics.hpp"
+#include "tcpReassembly.hpp"
 #include "rapidxml/rapidxml_utils.hpp"
 #include "tsharkDataType.hpp"
 #include "utils.hpp"
 
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <mutex>
@@ -31,14 +43,39 @@ class AdapterMonitorInfo
 public:
     AdapterMonitorInfo()
     {
-        monitorTsharkPipe = nullptr;
-        tsharkPid         = 0;
+        lastBytes   = 0;
+        lastPackets = 0;
+        sampled     = false;
     }
-    std::string                  adapterName;       // 网卡名称
-    std::map<long, long>         flowTrendData;     // 流量趋势数据
-    std::shared_ptr<std::thread> monitorThread;     // 负责监控该网卡输出的线程
-    FILE*                        monitorTsharkPipe; // 线程与tshark通信的管道
-    pid_t                        tsharkPid;         // 负责捕获该网卡数据的tshark进程PID
+    std::string                 adapterName;      // 网卡名称
+    FlowTrendRing               flowTrend;        // 最近300秒的流量趋势，只由采样线程写入
+    FlowTrendRollup             flowRollup;       // 秒、分钟、小时三层降采样的流量趋势
+    std::map<std::string, long> protocolFlowData; // 按协议统计的流量，仅在开启协议统计时有数据
+    std::mutex                  protocolLock;     // 保护protocolFlowData，每个网卡一把锁
+    uint64_t                    lastBytes;        // 上一次采样时网卡的累计收发字节数
+    uint64_t                    lastPackets;      // 上一次采样时网卡的累计收发包数
+    bool                        sampled;          // 是否已有上一次采样
+};
+
+// 按协议统计流量的tshark管道，通过epoll_event.data.ptr交给读取线程，
+// 读取线程只访问自己的上下文，不需要全局锁
+class ProtocolMonitorContext
+{
+public:
+    ProtocolMonitorContext()
+    {
+        pipe        = nullptr;
+        pid         = 0;
+        lastAdapter = nullptr;
+    }
+    FILE*         pipe;
+    pid_t         pid;
+    LineAssembler lines; // 按行切分tshark输出
+    // 网卡名到统计数据，监控期间不变
+    std::unordered_map<std::string, AdapterMonitorInfo*> adapters;
+    AdapterMonitorInfo*                                  lastAdapter; // 上一行所属的网卡
+    std::string adapterKey;  // 复用的查找键，避免每行分配内存
+    std::string protocolKey;
 };
 
 class TsharkManager
@@ -57,12 +94,60 @@ public:
     // 分析数据包文件并返回数据包列表
     bool analysisFile(std::string filePath, std::vector<std::shared_ptr<Packet>>& packets);
 
+    // 设置存储线程使用的数据库
+    void setSQLiteUtil(std::shared_ptr<SQLiteUtil> sqliteUtil) { this->sqliteUtil = sqliteUtil; }
+
+    // 将尚未入库的数据包写入数据库
+    bool storePackets(SQLiteUtil& sqliteUtil);
+
+    // 获取已分析的数据包数量
+    size_t getPacketCount();
+
+    // 获取按五元组聚合的所有连接，按首次出现的顺序排列
+    void getConversations(std::vector<Conversation>& conversations);
+
+    // 获取一条TCP连接的RTT、重传、零窗口和吞吐量指标
+    bool getTcpMetrics(uint32_t flowId, TcpFlowMetrics& metrics);
+
+    // 获取协议分层统计，分析时逐包累计，不需要再运行tshark -z io,phs
+    void getProtocolHierarchy(std::vector<ProtocolHierarchyNode>& nodes);
+
+    // 获取重组后的TCP流，按连接表中的数据包位置只读取和重组这一个连接
+    bool getTcpStream(uint32_t flowId, TcpStream& stream);
+
+    // 开始增量分析正在写入的抓包文件，文件每次被追加后只解析新增的数据包
+    bool startIncrementalAnalysis(const std::string& filePath);
+
+    // 停止增量分析，停止前会处理完已写入的数据包
+    void stopIncrementalAnalysis();
+
+    // 解析增量分析的抓包文件自上次以来新增的完整数据包
+    bool analyzeAppendedPackets();
+
     // 打印所有数据包的信息
     void printAllPackets();
 
+    // 在allPackets中按条件过滤已分析的数据包，条件与SQLiteUtil::queryPackets一致
+    bool filterPackets(const std::map<std::string, std::string>& conditions,
+                       std::vector<std::shared_ptr<Packet>>&     packets);
+
+    // 按帧编号升序获取[firstFrame, lastFrame]区间内的数据包，用于界面分页展示
+    void getPackets(uint32_t firstFrame, uint32_t lastFrame,
+                    std::vector<std::shared_ptr<Packet>>& packets);
+
     // 获取指定编号数据包的十六进制数据
     bool getPacketHexData(uint32_t frameNumber, std::vector<unsigned char>& data);
 
+    // 获取指定编号数据包的原始字节，直接指向映射的抓包文件，不拷贝数据
+    bool getPacketBytes(uint32_t frameNumber, PacketBytes& bytes);
+
+    // 获取指定编号数据包的“偏移 十六进制 ASCII”格式转储文本
+    bool getPacketHexDump(uint32_t frameNumber, std::string& dump);
+
+    // 批量获取多个数据包的原始字节，无法获取的数据包data为nullptr
+    void getPacketsBytes(const std::vector<uint32_t>& frameNumbers,
+                         std::vector<PacketBytes>&    bytes);
+
     // 枚举网卡列表
     std::vector<AdapterInfo> getNetworkAdapterInfo();
 
@@ -72,18 +157,52 @@ public:
     // 停止抓包
     bool stopCapture();
 
-    // 监控所有网卡流量统计数据
-    void startMonitorAdaptersFlowTrend();
+    // 监控所有网卡流量统计数据，流量从/proc/net/dev采样，不需要抓包；
+    // protocolBreakdown为true时额外启动一个同时抓取所有网卡的tshark按协议统计流量
+    void startMonitorAdaptersFlowTrend(bool protocolBreakdown = false);
 
-    // 监控所有网卡流量趋势
+    // 读取按协议统计的tshark输出
     void adapterFlowTrendMonitorThreadEntry();
 
+    // 处理按协议统计的tshark输出的一行："网卡名\t帧长度\t协议"
+    void handleProtocolMonitorLine(ProtocolMonitorContext& context, const char* line,
+                                   size_t length);
+
     // 停止监控所有网卡流量统计数据
     void stopMonitorAdaptersFlowTrend();
 
     // 获取所有网卡流量统计数据
     void getAdaptersFlowTrendData(std::map<std::string, std::map<long, long>>& flowTrendData);
 
+    // 获取所有网卡从startTime开始连续count秒的流量，不阻塞采样线程
+    void getAdaptersFlowTrendSnapshot(long startTime, size_t count,
+                                      std::map<std::string, std::vector<long>>& snapshot);
+
+    // 设置保存分钟级和小时级流量趋势的数据库，长时间范围的查询从中补齐内存中已淘汰的数据
+    bool setFlowTrendSQLiteUtil(std::shared_ptr<SQLiteUtil> sqliteUtil);
+
+    // 查询网卡[startTime, endTime)的流量趋势，按时间跨度自动选择秒、分钟或小时粒度，
+    // tier返回所选的FlowTrendRollup::Tier
+    bool queryAdapterFlowTrend(const std::string& adapterName, long startTime, long endTime,
+                               std::vector<FlowTrendBucket>& buckets, int& tier);
+
+    // 获取所有网卡按协议统计的流量
+    void getAdaptersProtocolFlowData(
+        std::map<std::string, std::map<std::string, long>>& protocolFlowData);
+
+    // 获取实时流量统计：最近一个完整秒按协议的包数和字节数，以及源IP、目的IP、端口的Top-N
+    void getLiveTrafficStats(LiveTrafficSnapshot& snapshot);
+
+    // 估计某个源IP、目的IP或端口的累计字节数，不要求在Top-N中
+    uint64_t estimateTalkerBytes(LiveTrafficStats::Dimension dimension, const std::string& key);
+
+    // 估计[startTime, endTime)内不同的源IP、目的IP和连接数，按分钟对齐
+    bool getDistinctEndpoints(long startTime, long endTime, DistinctEndpoints& result);
+
+    // 按分钟列出[startTime, endTime)内不同的源IP、目的IP和连接数
+    void getDistinctEndpointsPerMinute(long startTime, long endTime,
+                                       std::vector<DistinctEndpoints>& minutes);
+
     // 获取tshark路径
     std::string getTsharkPath() const { return tsharkPath; }
 
@@ -98,14 +217,44 @@ private:
     void convertXmlNodeToJson(rapidxml::xml_node<>* xmlNode, rapidjson::Value& jsonNode,
                               rapidjson::Document::AllocatorType& allocator);
 
-    // 解析行数据
-    bool parseLine(std::string line, std::shared_ptr<Packet> packet);
+    // 运行tshark解析抓包文件，每解析出一个数据包回调一次
+    bool readTsharkFields(const std::string&                  filePath,
+                          const std::function<void(Packet&)>& onPacket);
+
+    // 增量分析线程，通过inotify监听抓包文件的追加
+    void incrementalAnalysisThreadEntry();
+
+    // 网卡流量采样线程，每秒读取一次/proc/net/dev
+    void adapterFlowTrendSampleThreadEntry();
+
+    // 以两次采样之间的累计字节数之差作为上一秒的流量
+    void sampleAdaptersFlowTrend(long timestamp);
+
+    // 解析行数据，packet会被复用，所有字段都会被重新赋值
+    bool parseLine(std::string line, Packet& packet);
+
+    // 清空已分析的数据包以及由其得到的连接表和各项统计，调用方不持有allPacketsLock
+    void resetAnalysis();
+
+    // 从抓包文件旁的索引文件恢复已分析的数据包
+    bool loadPacketIndex(const std::string& filePath);
+
+    // 打开currentFilePath用于读取数据包原始字节，gzip压缩的文件按访问点随机解压，
+    // 调用方持有allPacketsLock
+    bool openCurrentFile();
+
+    // 读取currentFilePath中[offset, offset + length)的原始字节，调用方持有allPacketsLock
+    bool readCaptureRange(uint64_t offset, uint32_t length, PacketBytes& bytes);
 
     // 存储线程
     void storageThreadEntry();
 
-    // 处理每一个数据包
-    void processPacket(std::shared_ptr<Packet> packet);
+    // 处理每一个数据包，decoded为原生解码的数据包内容，用于统计TCP指标
+    void processPacket(const Packet& packet, const DecodedPacket* decoded = nullptr);
+
+    // 把一个TCP分段计入tcpMetrics，调用方持有allPacketsLock
+    void addTcpMetrics(const CompactPacket& record, uint32_t flowId, uint8_t direction,
+                       const DecodedPacket& decoded);
 
     // 在线采集数据包的工作线程
     void captureWorkThreadEntry(std::string adapterName);
@@ -116,6 +265,11 @@ private:
     std::string editcapPath;
     std::string outputPath;
     std::string currentFilePath;
+    // 映射的currentFilePath，用于读取数据包原始字节；文件被追加后换成新的映射，
+    // 已交出的PacketBytes仍持有旧映射。与currentCompressedFile一起由allPacketsLock保护
+    std::shared_ptr<MappedFile> currentFile;
+    CompressedFile currentCompressedFile; // currentFilePath是gzip压缩文件时代替currentFile
+    CaptureReader currentReader; // currentFilePath的文件头和接口描述，用于确定数据包的链路类型
     std::string ip2RegionDbPath;
 
     // 运行状态
@@ -124,19 +278,41 @@ private:
     pid_t childPid;
     int epollFd;
 
-    // 数据存储
-    std::vector<std::shared_ptr<Packet>> waitInsertPackets;
-    std::mutex waitInsertPacketsLock;
+    // 数据存储，allPackets按分析顺序保存，下标小于storedPacketCount的已经入库
+    std::mutex allPacketsLock;
+    size_t storedPacketCount;
     std::shared_ptr<std::thread> storageThread;
     std::shared_ptr<SQLiteUtil> sqliteUtil;
 
+    // 增量分析
+    std::string incrementalFilePath;
+    CaptureReader incrementalReader;
+    uint64_t incrementalOffset; // 下一条未解析记录的偏移，0表示还未读取文件头
+    uint32_t incrementalFrames; // 已解析的数据包数量
+    std::string incrementalHeader; // 文件头的原始字节，用于发现文件被替换
+    std::atomic<bool> incrementalStop;
+    std::shared_ptr<std::thread> incrementalThread;
+
     // 网卡相关
     std::vector<AdapterInfo> networkAdapters;
-    std::unordered_map<uint32_t, std::shared_ptr<Packet>> allPackets;
+    PacketStore allPackets; // 以紧凑格式保存的已分析数据包
+    FrameIndex frameIndex; // 帧编号到allPackets下标的映射
+    FlowTable flowTable; // 按五元组聚合的连接表，与allPackets共用allPacketsLock
+    LiveTrafficStats liveStats; // 由processPacket逐包更新的实时流量统计
+    EndpointCardinality endpointStats; // 每分钟不同端点数的HyperLogLog
+    TcpMetrics tcpMetrics; // 按连接的TCP性能指标，与allPackets共用allPacketsLock
+    ProtocolHierarchy protocolHierarchy; // 按frame.protocols累计的协议分层统计
+    uint64_t storedHierarchyVersion; // 已写入数据库的协议分层统计版本，由allPacketsLock保护
     std::shared_ptr<std::thread> captureWorkThread;
     std::map<std::string, AdapterMonitorInfo> adapterFlowTrendMonitorMap;
     std::recursive_mutex adapterFlowTrendMapLock;
     long adapterFlowTrendMonitorStartTime;
+    std::atomic<bool> adapterFlowTrendStop;
+    std::shared_ptr<std::thread> adapterFlowTrendSampleThread;
+    std::shared_ptr<std::thread> adapterFlowTrendMonitorThread;
+    std::unique_ptr<ProtocolMonitorContext> protocolMonitor; // 按协议统计流量的tshark输出
+    std::shared_ptr<SQLiteUtil> flowTrendSQLiteUtil;
+    std::mutex flowTrendSQLiteLock;
 };
 
 class MiscUtil
@@ -7,10 +7,13 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "rapidjson/document.h"
 
 struct sqlite3;
+struct sqlite3_stmt;
+class PacketStore;
 
 #include "ip2region/xdb_search.h"
 #include "tsharkDataType.hpp"
@@ -73,6 +76,272 @@ public:
      * @param iterations 迭代次数
      */
     static void compareMapPerformance(int iterations);
+
+    /**
+     * @brief 按SQL LIKE语义匹配字符串（%匹配任意串，_匹配单个字符，ASCII不区分大小写）
+     * @param pattern 匹配模式
+     * @param text 待匹配的文本
+     * @param textLen 文本长度
+     * @return true 匹配
+     * @return false 不匹配
+     */
+    static bool likeMatch(const std::string& pattern, const char* text, size_t textLen);
+
+    /**
+     * @brief 解析十进制无符号整数，不分配内存
+     * @param text 文本，不要求以'\0'结尾
+     * @param length 文本长度
+     * @param value 输出参数，解析结果
+     * @return true 解析成功
+     * @return false 文本为空、包含非数字字符或溢出
+     */
+    static bool parseUint64(const char* text, size_t length, uint64_t& value);
+
+    /**
+     * @brief 严格解析浮点数，整个文本必须是一个有限的数字
+     * @param text 文本
+     * @param value 输出参数，解析结果，失败时不变
+     * @return true 解析成功
+     * @return false 文本为空、前后有多余字符（包括空白）、溢出或不是有限值
+     */
+    static bool parseDouble(const std::string& text, double& value);
+};
+
+/**
+ * @brief 网络地址工具类，在文本地址与定长二进制地址之间转换
+ */
+class NetUtil
+{
+public:
+    /**
+     * @brief 解析IPv4/IPv6地址为16字节二进制形式，IPv4以::ffff:a.b.c.d映射存储
+     * @param text 地址文本
+     * @param ip 输出参数，二进制地址
+     * @return true 解析成功
+     * @return false 解析失败（空地址或格式错误），ip被清零
+     */
+    static bool parseIp(const std::string& text, IpAddress& ip);
+
+    /**
+     * @brief 将二进制地址格式化为文本，全零地址返回空字符串
+     * @param ip 二进制地址
+     * @return 地址文本
+     */
+    static std::string formatIp(const IpAddress& ip);
+
+    /**
+     * @brief 解析xx:xx:xx:xx:xx:xx格式的MAC地址
+     * @param text MAC地址文本
+     * @param mac 输出参数，低48位为MAC地址，解析失败时为kInvalidMac
+     * @return true 解析成功
+     * @return false 解析失败
+     */
+    static bool parseMac(const std::string& text, uint64_t& mac);
+
+    /**
+     * @brief 将MAC地址格式化为小写的xx:xx:xx:xx:xx:xx，kInvalidMac返回空字符串
+     * @param mac MAC地址
+     * @return MAC地址文本
+     */
+    static std::string formatMac(uint64_t mac);
+
+    /**
+     * @brief 解析/proc/net/dev格式的网卡统计
+     * @param content 文件内容
+     * @param counters 输出参数，网卡名到累计收发计数的映射
+     * @return true 解析成功
+     * @return false 内容格式错误
+     */
+    static bool parseNetDev(const std::string& content,
+                            std::map<std::string, InterfaceCounters>& counters);
+
+    /**
+     * @brief 读取所有网卡的累计收发计数，不需要抓包
+     * @param counters 输出参数，网卡名到累计收发计数的映射
+     * @param path 统计文件路径
+     * @return true 读取成功
+     * @return false 文件无法读取或格式错误
+     */
+    static bool readNetDev(std::map<std::string, InterfaceCounters>& counters,
+                           const std::string& path = "/proc/net/dev");
+
+    static const uint64_t kInvalidMac = 0xFFFF000000000000ULL;
+};
+
+/**
+ * @brief 哈希工具类
+ */
+class HashUtil
+{
+public:
+    /**
+     * @brief 计算XXH64哈希
+     * @param data 数据
+     * @param length 数据长度
+     * @param seed 种子
+     * @return 64位哈希值
+     */
+    static uint64_t xxh64(const void* data, size_t length, uint64_t seed = 0);
+};
+
+/**
+ * @brief 十六进制转储工具类，查表将字节转换为十六进制字符，输出到调用方提供的缓冲区
+ */
+class HexDumpUtil
+{
+public:
+    /**
+     * @brief 转储所需的最大缓冲区大小
+     * @param length 数据长度
+     * @return 字节数
+     */
+    static size_t dumpSize(size_t length);
+
+    /**
+     * @brief 按“偏移  十六进制  ASCII”的经典格式转储数据，每行16字节，以换行结尾
+     *
+     * 数据不超过64KB时偏移显示4位十六进制，否则显示8位；不可打印字符显示为'.'
+     *
+     * @param data 数据
+     * @param length 数据长度
+     * @param out 输出缓冲区，大小至少为dumpSize(length)，不以'\0'结尾
+     * @return 写入的字节数
+     */
+    static size_t dump(const unsigned char* data, size_t length, char* out);
+
+    /**
+     * @brief 将数据转换为连续的小写十六进制字符串
+     * @param data 数据
+     * @param length 数据长度
+     * @param out 输出缓冲区，大小至少为length * 2，不以'\0'结尾
+     * @return 写入的字节数
+     */
+    static size_t toHex(const unsigned char* data, size_t length, char* out);
+
+    /**
+     * @brief 转储数据并追加到字符串，便于日志输出
+     * @param data 数据
+     * @param length 数据长度
+     * @param out 输出字符串，已有的容量会被复用
+     */
+    static void dump(const unsigned char* data, size_t length, std::string& out);
+};
+
+/**
+ * @brief 从非阻塞文件描述符（通常是子进程的管道）中读取数据并按行切分
+ *
+ * 数据读入固定大小的缓冲区，行直接指向缓冲区内部，不为每行分配内存；
+ * 一次read可以包含多行或半行，未读完的半行留在缓冲区中等待后续数据。
+ * 超过缓冲区大小的行被丢弃并计数
+ */
+class LineAssembler
+{
+public:
+    enum Status
+    {
+        STATUS_MORE,   // 读到了数据，可能还有更多
+        STATUS_AGAIN,  // 暂时没有数据（EAGAIN）
+        STATUS_CLOSED, // 对端已关闭或读取出错
+    };
+
+    /**
+     * @brief 构造函数
+     * @param capacity 缓冲区大小，即最长的行
+     */
+    explicit LineAssembler(size_t capacity = 65536);
+
+    /**
+     * @brief 从fd读取一次数据追加到缓冲区，调用前应已用nextLine取完之前的所有行
+     * @param fd 文件描述符
+     * @return 读取状态，边缘触发的epoll需反复调用直到不再返回STATUS_MORE
+     */
+    Status fill(int fd);
+
+    /**
+     * @brief 追加数据到缓冲区，放不下的部分被丢弃
+     * @param data 数据
+     * @param length 数据长度
+     * @return 追加的字节数
+     */
+    size_t append(const char* data, size_t length);
+
+    /**
+     * @brief 取出下一个完整的行
+     * @param line 输出参数，行的起始地址（不含换行符），在下一次fill或append之前有效
+     * @param length 输出参数，行的长度
+     * @return true 取到一行
+     * @return false 缓冲区中没有完整的行
+     */
+    bool nextLine(const char*& line, size_t& length);
+
+    /**
+     * @brief 因过长而被丢弃的行数
+     */
+    uint64_t droppedLines() const { return dropped; }
+
+private:
+    void compact();
+
+    std::vector<char> buffer;
+    size_t            begin;      // 未取出数据的起始位置
+    size_t            end;        // 有效数据的结束位置
+    bool              discarding; // 正在丢弃过长行的剩余部分
+    uint64_t          dropped;
+};
+
+/**
+ * @brief 字符串字典，将低基数的字符串（协议、归属地等）映射为小整数ID
+ *
+ * ID 0 固定表示空字符串，新字符串按出现顺序依次分配ID
+ */
+class StringDict
+{
+public:
+    StringDict();
+
+    /**
+     * @brief 获取字符串对应的ID，不存在时分配新ID
+     * @param value 字符串
+     * @return 字符串ID
+     */
+    uint32_t intern(const std::string& value);
+
+    /**
+     * @brief 查找字符串对应的ID，不分配新ID
+     * @param value 字符串
+     * @param id 输出参数，字符串ID
+     * @return true 找到
+     * @return false 未找到
+     */
+    bool find(const std::string& value, uint32_t& id) const;
+
+    /**
+     * @brief 根据ID获取字符串
+     * @param id 字符串ID
+     * @return 对应的字符串，ID不存在时返回空字符串
+     */
+    const std::string& lookup(uint32_t id) const;
+
+    /**
+     * @brief 以指定ID登记字符串，用于从数据库加载已有字典
+     * @param id 字符串ID
+     * @param value 字符串
+     */
+    void assign(uint32_t id, const std::string& value);
+
+    /**
+     * @brief 字典中已分配的ID数量（包含ID 0）
+     */
+    size_t size() const { return values.size(); }
+
+    /**
+     * @brief 清空字典，仅保留ID 0
+     */
+    void clear();
+
+private:
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<std::string>                  values;
 };
 
 /**
@@ -102,6 +371,36 @@ public:
      */
     bool createPacketTable();
 
+    /**
+     * @brief 启用按时间分区存储
+     *
+     * 启用后数据包按时间写入t_packets_p<起始时间>分区表，分区信息记录在t_partitions中，
+     * 带时间范围的查询只扫描相关分区，超出保留数量的旧分区整表删除
+     *
+     * @param partitionSeconds 每个分区覆盖的秒数，默认一小时
+     * @param retentionCount 最多保留的分区数量，0表示不限制
+     * @return true 启用成功
+     * @return false 启用失败
+     */
+    bool enablePartitioning(int partitionSeconds = 3600, int retentionCount = 0);
+
+    /**
+     * @brief 启用info列的FTS5全文索引
+     *
+     * 索引表t_packets_fts以frame_number为rowid，由insertPacket同步写入；
+     * 启用时若已有数据会先补建索引
+     *
+     * @return true 启用成功
+     * @return false 启用失败（如SQLite未编译FTS5）
+     */
+    bool enableFullTextIndex();
+
+    /**
+     * @brief 获取当前所有分区的起始时间，按时间升序
+     * @return 分区起始时间列表
+     */
+    std::vector<long> getPartitions() const;
+
     /**
      * @brief 批量插入数据包
      * @param packets 要插入的数据包列表
@@ -110,6 +409,23 @@ public:
      */
     bool insertPacket(std::vector<std::shared_ptr<Packet>>& packets);
 
+    /**
+     * @brief 批量插入PacketStore中下标[begin, end)的数据包，逐条还原到同一个Packet后写入
+     * @param store 数据包存储
+     * @param begin 起始下标
+     * @param end 结束下标（不含）
+     * @return true 插入成功
+     * @return false 插入失败
+     */
+    bool insertPacket(const PacketStore& store, size_t begin, size_t end);
+
+    /**
+     * @brief 删除所有数据包及连接、TCP指标和协议分层统计，分区表整表删除，字典保留
+     * @return true 删除成功
+     * @return false 删除失败
+     */
+    bool clearPackets();
+
     /**
      * @brief 查询所有数据包
      * @param packetList 用于存储查询结果的列表
@@ -120,7 +436,9 @@ public:
 
     /**
      * @brief 根据条件查询数据包并返回JSON格式结果
-     * @param conditions 查询条件，支持MAC地址、IP地址、端口和地理位置
+     * @param conditions 查询条件，支持MAC地址、IP地址、端口、地理位置、协议，
+     *                   以及start_time、end_time时间范围（秒级时间戳，左闭右开）和
+     *                   keyword信息关键字（启用全文索引时走FTS5，否则退化为LIKE扫描）
      * @param jsonResult 输出参数，存储JSON格式的查询结果
      * @return true 查询成功
      * @return false 查询失败
@@ -128,6 +446,138 @@ public:
     bool queryPackets(const std::map<std::string, std::string>& conditions,
                       std::string&                              jsonResult);
 
+    /**
+     * @brief 按frame_number游标分页查询，结果逐行以JSON流式写入文件描述符
+     *
+     * 输出格式为{"packets":[...],"total":本页条数,"next_cursor":下一页游标}，
+     * 查询结果不在内存中整体构建，内存占用与结果集大小无关
+     *
+     * @param conditions 查询条件，同queryPackets
+     * @param afterFrame 游标，只返回frame_number大于该值的数据包，首页传0
+     * @param pageSize 每页最大条数，0表示不分页
+     * @param fd 输出目标（文件、管道或socket）
+     * @param nextFrame 输出参数，下一页的游标，没有更多数据时为0
+     * @return true 查询成功
+     * @return false 查询或写入失败
+     */
+    bool streamPackets(const std::map<std::string, std::string>& conditions, uint32_t afterFrame,
+                       uint32_t pageSize, int fd, uint32_t& nextFrame);
+
+    /**
+     * @brief 按frame_number游标分页查询，返回一页JSON结果
+     * @param conditions 查询条件，同queryPackets
+     * @param afterFrame 游标，首页传0
+     * @param pageSize 每页最大条数
+     * @param jsonResult 输出参数，本页的JSON结果
+     * @param nextFrame 输出参数，下一页的游标，没有更多数据时为0
+     * @return true 查询成功
+     * @return false 查询失败
+     */
+    bool queryPacketsPage(const std::map<std::string, std::string>& conditions,
+                          uint32_t afterFrame, uint32_t pageSize, std::string& jsonResult,
+                          uint32_t& nextFrame);
+
+    /**
+     * @brief 将全部查询结果流式导出到JSON文件
+     * @param conditions 查询条件，同queryPackets
+     * @param filePath 保存文件的路径
+     * @return true 导出成功
+     * @return false 导出失败
+     */
+    bool exportQueryResult(const std::map<std::string, std::string>& conditions,
+                           const std::string& filePath);
+
+    /**
+     * @brief 写入或更新连接表t_flows中的连接，同一flow_id的记录会被覆盖
+     * @param conversations 连接
+     * @return true 写入成功
+     * @return false 写入失败
+     */
+    bool upsertFlows(const std::vector<Conversation>& conversations);
+
+    /**
+     * @brief 按总字节数降序查询连接
+     * @param ip 只返回一端为该IP的连接，为空时不过滤
+     * @param limit 最多返回的连接数
+     * @param conversations 输出参数
+     * @return true 查询成功
+     * @return false 查询失败
+     */
+    bool queryFlows(const std::string& ip, size_t limit, std::vector<Conversation>& conversations);
+
+    /**
+     * @brief 用新的统计结果整体替换协议分层表t_protocol_hierarchy
+     * @param nodes 按深度优先顺序排列的节点
+     * @return true 写入成功
+     * @return false 写入失败
+     */
+    bool replaceProtocolHierarchy(const std::vector<ProtocolHierarchyNode>& nodes);
+
+    /**
+     * @brief 查询协议分层统计
+     * @param nodes 输出参数，按深度优先顺序
+     * @return true 查询成功
+     * @return false 查询失败
+     */
+    bool queryProtocolHierarchy(std::vector<ProtocolHierarchyNode>& nodes);
+
+    /**
+     * @brief 写入或更新TCP连接指标表t_tcp_metrics，缺失的指标写入NULL
+     * @param metrics 有新数据包的连接的指标
+     * @return true 写入成功
+     * @return false 写入失败
+     */
+    bool upsertTcpMetrics(const std::vector<TcpFlowMetrics>& metrics);
+
+    /**
+     * @brief 按重传次数和平均往返时间降序查询TCP连接指标
+     * @param limit 最多返回的连接数
+     * @param metrics 输出参数，NULL读回为-1
+     * @return true 查询成功
+     * @return false 查询失败
+     */
+    bool queryTcpMetrics(size_t limit, std::vector<TcpFlowMetrics>& metrics);
+
+    /**
+     * @brief 创建流量趋势表t_flow_trend，保存各网卡分钟级和小时级的降采样数据
+     * @return true 创建成功
+     * @return false 创建失败
+     */
+    bool createFlowTrendTable();
+
+    /**
+     * @brief 在一个事务中写入流量趋势桶，同一网卡、层和起始时间的桶会被覆盖
+     * @param adapter 网卡名称
+     * @param tier 层（FlowTrendRollup::Tier）
+     * @param buckets 流量趋势桶
+     * @return true 写入成功
+     * @return false 写入失败
+     */
+    bool insertFlowTrend(const std::string& adapter, int tier,
+                         const std::vector<FlowTrendBucket>& buckets);
+
+    /**
+     * @brief 查询[startTime, endTime)范围内已保存的流量趋势桶，按时间升序
+     * @param adapter 网卡名称
+     * @param tier 层（FlowTrendRollup::Tier）
+     * @param startTime 起始时间戳（秒）
+     * @param endTime 结束时间戳（秒，不包含）
+     * @param buckets 输出参数，只包含已保存的桶
+     * @return true 查询成功
+     * @return false 查询失败
+     */
+    bool queryFlowTrend(const std::string& adapter, int tier, long startTime, long endTime,
+                        std::vector<FlowTrendBucket>& buckets);
+
+    /**
+     * @brief 查询某个网卡已保存的最早的流量趋势桶的起始时间，不区分层
+     * @param adapter 网卡名称
+     * @param startTime 输出参数，起始时间戳（秒），没有保存的数据时为-1
+     * @return true 查询成功
+     * @return false 查询失败
+     */
+    bool queryFlowTrendStart(const std::string& adapter, long& startTime);
+
     /**
      * @brief 将查询结果保存到JSON文件
      * @param jsonResult JSON格式的查询结果字符串
@@ -140,6 +590,125 @@ public:
 private:
     sqlite3* db = nullptr;
 
+    // 协议、归属地字典缓存，与t_protocols、t_locations表保持一致
+    StringDict protocolDict;
+    StringDict locationDict;
+
+    // 分区表名及其在t_partitions中记录的结束时间（不包含）
+    struct Partition
+    {
+        std::string name;
+        long        endTime;
+    };
+
+    // 时间分区配置，partitionSeconds为0表示不分区，所有数据写入t_packets
+    int                       partitionSeconds = 0;
+    int                       retentionCount   = 0;
+    std::map<long, Partition> partitions; // 分区起始时间 -> 分区信息
+
+    // 是否维护info列的全文索引t_packets_fts
+    bool fullTextEnabled = false;
+
+    /**
+     * @brief 将用户输入的关键字转换为FTS5查询表达式
+     *
+     * 以空白分隔的每个关键字作为一个短语，多个关键字之间为AND关系，末尾的*表示前缀匹配
+     *
+     * @param keywords 用户输入的关键字
+     * @return FTS5 MATCH表达式
+     */
+    static std::string buildMatchExpression(const std::string& keywords);
+
+    /**
+     * @brief 生成数据包表及其索引的建表语句
+     * @param tableName 表名
+     * @return 建表SQL
+     */
+    static std::string packetTableSQL(const std::string& tableName);
+
+    /**
+     * @brief 从t_partitions加载分区信息
+     * @return true 加载成功
+     * @return false 加载失败
+     */
+    bool loadPartitions();
+
+    /**
+     * @brief 获取数据包时间所属分区的表名，分区不存在时创建
+     * @param time 数据包时间戳
+     * @return 分区表名，创建失败时返回空字符串
+     */
+    std::string partitionForTime(double time);
+
+    /**
+     * @brief 删除超出保留数量的最旧分区
+     */
+    void applyRetention();
+
+    /**
+     * @brief 构建查询的数据源，分区模式下只包含与时间范围重叠的分区
+     * @param startTime 起始时间（包含）
+     * @param endTime 结束时间（不包含）
+     * @return 可直接用于FROM子句的表名或子查询
+     */
+    std::string packetSource(double startTime, double endTime) const;
+
+    /**
+     * @brief 从数据库加载协议和归属地字典到内存缓存
+     * @return true 加载成功
+     * @return false 加载失败
+     */
+    bool loadDictionaries();
+
+    /**
+     * @brief 将字典中ID不小于fromId的条目写入字典表
+     * @param dict 字典
+     * @param table 字典表名
+     * @param fromId 起始ID
+     * @return true 写入成功
+     * @return false 写入失败
+     */
+    bool insertDictEntries(const StringDict& dict, const std::string& table, uint32_t fromId);
+
+    /**
+     * @brief 根据字典ID解码字符串，缓存未命中时重新加载字典
+     * @param dict 字典
+     * @param id 字典ID
+     * @return 解码后的字符串
+     */
+    const std::string& decodeDict(StringDict& dict, uint32_t id);
+
+    /**
+     * @brief 在一个事务中批量插入数据包
+     * @param count 数据包数量
+     * @param fetch 按序号获取数据包，返回const Packet&
+     * @return true 插入成功
+     * @return false 插入失败
+     */
+    template <typename Fetch>
+    bool insertPackets(size_t count, Fetch fetch);
+
+    /**
+     * @brief 执行游标分页查询并将结果逐行写入JSON Writer
+     * @param conditions 查询条件
+     * @param afterFrame 游标
+     * @param pageSize 每页最大条数，0表示不分页
+     * @param writer JSON输出
+     * @param nextFrame 输出参数，下一页的游标
+     * @return true 查询成功
+     * @return false 查询失败
+     */
+    template <typename Writer>
+    bool writePacketsPage(const std::map<std::string, std::string>& conditions, uint32_t afterFrame,
+                          uint32_t pageSize, Writer& writer, uint32_t& nextFrame);
+
+    /**
+     * @brief 从查询结果的当前行读取数据包
+     * @param stmt 已执行到某一行的查询语句，列顺序与t_packets定义一致
+     * @param packet 输出参数，读取到的数据包
+     */
+    void readPacketRow(sqlite3_stmt* stmt, std::shared_ptr<Packet>& packet);
+
     /**
      * @brief 将数据包列表转换为JSON格式
      * @param packets 数据包列表
@@ -150,7 +719,7 @@ private:
     /**
      * @brief 构建模糊查询SQL语句
      * @param conditions 查询条件
-     * @return SQL查询语句
+     * @return SQL查询语句，start_time或end_time不是数字时为空字符串
      */
     std::string buildFuzzyQuery(const std::map<std::string, std::string>& conditions);
 };
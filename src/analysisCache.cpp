@@ -0,0 +1,257 @@
+#include "analysisCache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <dirent.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <utime.h>
+#include <vector>
+
+#include "loguru.hpp"
+#include "mappedFile.hpp"
+#include "utils.hpp"
+
+namespace
+{
+const uint64_t kHashChunkSize = 4 << 20;
+const char*    kVersionFile   = "version";
+
+bool copyFile(const std::string& from, const std::string& to)
+{
+    std::ifstream in(from, std::ios::binary);
+    if (!in)
+    {
+        return false;
+    }
+
+    // 先写临时文件再改名，目标路径上不会出现不完整的文件
+    std::string   tmpPath = to + ".tmp";
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    char          buffer[64 * 1024];
+    while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0)
+    {
+        out.write(buffer, in.gcount());
+    }
+    out.close();
+    if (!out || rename(tmpPath.c_str(), to.c_str()) != 0)
+    {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// 列出目录下的普通文件或子目录名
+std::vector<std::string> listDir(const std::string& dir)
+{
+    std::vector<std::string> names;
+    DIR*                     d = opendir(dir.c_str());
+    if (!d)
+    {
+        return names;
+    }
+    while (dirent* entry = readdir(d))
+    {
+        std::string name = entry->d_name;
+        if (name != "." && name != "..")
+        {
+            names.push_back(name);
+        }
+    }
+    closedir(d);
+    return names;
+}
+
+void removeDir(const std::string& dir)
+{
+    for (const std::string& name : listDir(dir))
+    {
+        std::remove((dir + "/" + name).c_str());
+    }
+    rmdir(dir.c_str());
+}
+
+// 缓存项写入时的版本，没有版本文件时为0
+uint32_t readVersion(const std::string& entryDir)
+{
+    std::ifstream in(entryDir + "/" + kVersionFile);
+    uint32_t      version = 0;
+    return in >> version ? version : 0;
+}
+} // namespace
+
+const uint32_t AnalysisCache::kVersion;
+
+AnalysisCache::AnalysisCache(const std::string& cacheDir, uint64_t maxBytes)
+    : cacheDir(cacheDir), maxBytes(maxBytes), hits(0), misses(0)
+{
+    mkdir(cacheDir.c_str(), 0755);
+}
+
+bool AnalysisCache::hashFile(const std::string& path, std::string& key)
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        return false;
+    }
+
+    size_t                chunkCount = (file.size() + kHashChunkSize - 1) / kHashChunkSize;
+    std::vector<uint64_t> chunkHashes(chunkCount);
+    size_t                threadCount =
+        std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), chunkCount));
+
+    // 各线程按步长领取分块，结果只与分块划分有关，与线程数无关
+    auto worker = [&](size_t first) {
+        for (size_t i = first; i < chunkCount; i += threadCount)
+        {
+            uint64_t offset = i * kHashChunkSize;
+            uint64_t length = std::min<uint64_t>(kHashChunkSize, file.size() - offset);
+            chunkHashes[i]  = HashUtil::xxh64(file.data() + offset, length);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < threadCount; t++)
+    {
+        threads.push_back(std::thread(worker, t));
+    }
+    worker(0);
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    uint64_t hash =
+        HashUtil::xxh64(chunkHashes.data(), chunkHashes.size() * sizeof(uint64_t), file.size());
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+    key = buffer;
+    return true;
+}
+
+bool AnalysisCache::fetch(const std::string& key,
+                          const std::map<std::string, std::string>& artifacts)
+{
+    std::string entryDir = cacheDir + "/" + key;
+    struct stat st;
+    bool        found = stat(entryDir.c_str(), &st) == 0;
+    if (found && readVersion(entryDir) != kVersion)
+    {
+        // 其他版本写入或未写完的缓存项，产物格式可能不同，直接丢弃
+        LOG_F(INFO, "Discarding analysis cache entry of another version: %s", key.c_str());
+        removeDir(entryDir);
+        found = false;
+    }
+    for (const auto& artifact : artifacts)
+    {
+        found = found && stat((entryDir + "/" + artifact.first).c_str(), &st) == 0;
+    }
+    if (!found)
+    {
+        misses++;
+        LOG_F(INFO, "Analysis cache miss: %s (hits %llu, misses %llu)", key.c_str(),
+              static_cast<unsigned long long>(hits), static_cast<unsigned long long>(misses));
+        return false;
+    }
+
+    for (const auto& artifact : artifacts)
+    {
+        if (!copyFile(entryDir + "/" + artifact.first, artifact.second))
+        {
+            LOG_F(ERROR, "Failed to restore %s from analysis cache", artifact.first.c_str());
+            misses++;
+            return false;
+        }
+    }
+
+    // 更新最近使用时间
+    utime(entryDir.c_str(), nullptr);
+    hits++;
+    LOG_F(INFO, "Analysis cache hit: %s (hits %llu, misses %llu)", key.c_str(),
+          static_cast<unsigned long long>(hits), static_cast<unsigned long long>(misses));
+    return true;
+}
+
+bool AnalysisCache::store(const std::string& key,
+                          const std::map<std::string, std::string>& artifacts)
+{
+    std::string entryDir = cacheDir + "/" + key;
+    mkdir(entryDir.c_str(), 0755);
+    for (const auto& artifact : artifacts)
+    {
+        if (!copyFile(artifact.second, entryDir + "/" + artifact.first))
+        {
+            LOG_F(ERROR, "Failed to store %s into analysis cache", artifact.second.c_str());
+            removeDir(entryDir);
+            return false;
+        }
+    }
+
+    // 版本最后写入，产物没有写完的缓存项不会被当作命中
+    std::ofstream version(entryDir + "/" + kVersionFile, std::ios::trunc);
+    version << kVersion;
+    version.close();
+    if (!version)
+    {
+        LOG_F(ERROR, "Failed to store analysis cache version of %s", key.c_str());
+        removeDir(entryDir);
+        return false;
+    }
+    utime(entryDir.c_str(), nullptr);
+
+    evict(key);
+    return true;
+}
+
+void AnalysisCache::evict(const std::string& keep)
+{
+    struct Entry
+    {
+        std::string key;
+        time_t      lastUsed;
+        uint64_t    size;
+    };
+    std::vector<Entry> entries;
+    uint64_t           total = 0;
+    for (const std::string& key : listDir(cacheDir))
+    {
+        std::string entryDir = cacheDir + "/" + key;
+        struct stat st;
+        if (stat(entryDir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+        {
+            continue;
+        }
+
+        Entry entry = {key, st.st_mtime, 0};
+        for (const std::string& name : listDir(entryDir))
+        {
+            struct stat fileStat;
+            if (stat((entryDir + "/" + name).c_str(), &fileStat) == 0)
+            {
+                entry.size += fileStat.st_size;
+            }
+        }
+        total += entry.size;
+        entries.push_back(entry);
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.lastUsed < b.lastUsed; });
+    for (const Entry& entry : entries)
+    {
+        if (total <= maxBytes)
+        {
+            break;
+        }
+        if (entry.key == keep)
+        {
+            continue;
+        }
+        LOG_F(INFO, "Evicting analysis cache entry: %s", entry.key.c_str());
+        removeDir(cacheDir + "/" + entry.key);
+        total -= entry.size;
+    }
+}
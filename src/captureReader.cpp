@@ -0,0 +1,609 @@
+#include "captureReader.hpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#include "loguru.hpp"
+#include "tsharkDataType.hpp"
+
+namespace
+{
+const uint32_t kPcapMagic            = 0xA1B2C3D4;
+const uint32_t kPcapMagicNano        = 0xA1B23C4D;
+const uint32_t kPcapMagicSwapped     = 0xD4C3B2A1;
+const uint32_t kPcapMagicNanoSwapped = 0x4D3CB2A1;
+// 超过该长度的记录视为文件损坏
+const uint32_t kMaxRecordLength = 256 * 1024 * 1024;
+// 压缩文件每次解压的数据量
+const size_t kWindowSize = 4 * 1024 * 1024;
+
+// pcapng块类型
+const uint32_t kSectionHeaderBlock        = 0x0A0D0D0A;
+const uint32_t kInterfaceDescriptionBlock = 0x00000001;
+const uint32_t kPacketBlock               = 0x00000002;
+const uint32_t kSimplePacketBlock         = 0x00000003;
+const uint32_t kNameResolutionBlock       = 0x00000004;
+const uint32_t kEnhancedPacketBlock       = 0x00000006;
+const uint32_t kByteOrderMagic            = 0x1A2B3C4D;
+const uint32_t kByteOrderMagicSwapped     = 0x4D3C2B1A;
+
+// 块类型、块长度和结尾的块长度
+const uint32_t kBlockOverhead = 12;
+// SHB: 块头8字节 + 字节序魔数4字节 + 版本号4字节 + 节长度8字节 + 结尾块长度4字节
+const uint32_t kMinSectionHeaderLength = 28;
+
+// IDB选项
+const uint16_t kOptEndOfOpt   = 0;
+const uint16_t kOptTsResol    = 9;
+const uint16_t kOptTsOffset   = 14;
+// NRB记录类型
+const uint16_t kNrbRecordEnd  = 0;
+const uint16_t kNrbRecordIpv4 = 1;
+const uint16_t kNrbRecordIpv6 = 2;
+
+inline uint32_t swap32(uint32_t v)
+{
+    return (v >> 24) | ((v >> 8) & 0xFF00) | ((v << 8) & 0xFF0000) | (v << 24);
+}
+
+inline uint16_t swap16(uint16_t v)
+{
+    return static_cast<uint16_t>((v >> 8) | (v << 8));
+}
+
+inline uint32_t padded(uint32_t length)
+{
+    return (length + 3) & ~3u;
+}
+} // namespace
+
+const size_t CaptureReader::kMaxRecordHeader;
+
+CaptureReader::CaptureReader()
+    : swapped(false), nanosecond(false), pcapng(false), headerTruncated(false), fileHeaderSize(0),
+      pcapLinkType(0)
+{
+}
+
+uint16_t CaptureReader::read16(const unsigned char* p) const
+{
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return swapped ? swap16(v) : v;
+}
+
+uint32_t CaptureReader::read32(const unsigned char* p) const
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return swapped ? swap32(v) : v;
+}
+
+bool CaptureReader::readHeader(const unsigned char* data, uint64_t size)
+{
+    headerTruncated = false;
+    if (size < sizeof(uint32_t))
+    {
+        headerTruncated = true;
+        return false;
+    }
+
+    uint32_t magic;
+    memcpy(&magic, data, sizeof(magic));
+    if (magic == kSectionHeaderBlock)
+    {
+        interfaces.clear();
+        metadataBlocks.clear();
+        names.clear();
+        if (!readSectionHeader(data, size, 0))
+        {
+            return false;
+        }
+        pcapng         = true;
+        fileHeaderSize = metadataBlocks.back().second;
+        return true;
+    }
+    return readPcapHeader(data, size);
+}
+
+bool CaptureReader::readPcapHeader(const unsigned char* data, uint64_t size)
+{
+    uint32_t magic;
+    memcpy(&magic, data, sizeof(magic));
+    switch (magic)
+    {
+    case kPcapMagic:
+        swapped = nanosecond = false;
+        break;
+    case kPcapMagicNano:
+        swapped    = false;
+        nanosecond = true;
+        break;
+    case kPcapMagicSwapped:
+        swapped    = true;
+        nanosecond = false;
+        break;
+    case kPcapMagicNanoSwapped:
+        swapped = nanosecond = true;
+        break;
+    default:
+        LOG_F(ERROR, "Unsupported capture file format, magic: 0x%08x", magic);
+        return false;
+    }
+
+    if (size < sizeof(PcapHeader))
+    {
+        headerTruncated = true;
+        return false;
+    }
+
+    // network字段的高位是FCS信息，低16位为链路类型
+    pcapng         = false;
+    pcapLinkType   = static_cast<uint16_t>(read32(data + offsetof(PcapHeader, network)));
+    fileHeaderSize = sizeof(PcapHeader);
+    metadataBlocks.assign(1, std::make_pair(uint64_t(0), fileHeaderSize));
+    return true;
+}
+
+bool CaptureReader::readSectionHeader(const unsigned char* data, uint64_t size, uint64_t offset)
+{
+    if (size - offset < kMinSectionHeaderLength)
+    {
+        headerTruncated = true;
+        return false;
+    }
+
+    // 每个节都有自己的字节序
+    uint32_t byteOrder;
+    memcpy(&byteOrder, data + offset + 8, sizeof(byteOrder));
+    if (byteOrder == kByteOrderMagic)
+    {
+        swapped = false;
+    }
+    else if (byteOrder == kByteOrderMagicSwapped)
+    {
+        swapped = true;
+    }
+    else
+    {
+        LOG_F(ERROR, "Invalid pcapng byte order magic at offset %llu",
+              static_cast<unsigned long long>(offset));
+        return false;
+    }
+
+    uint32_t blockLength = read32(data + offset + 4);
+    if (blockLength < kMinSectionHeaderLength || blockLength % 4 != 0 ||
+        blockLength > kMaxRecordLength)
+    {
+        LOG_F(ERROR, "Corrupted pcapng section header at offset %llu",
+              static_cast<unsigned long long>(offset));
+        return false;
+    }
+    if (size - offset < blockLength)
+    {
+        headerTruncated = true;
+        return false;
+    }
+
+    uint16_t major = read16(data + offset + 12);
+    if (major != 1)
+    {
+        LOG_F(ERROR, "Unsupported pcapng version %u", major);
+        return false;
+    }
+
+    // 新的节重新开始接口编号
+    interfaces.clear();
+    metadataBlocks.assign(1, std::make_pair(offset, offset + blockLength));
+    return true;
+}
+
+bool CaptureReader::readRecords(const unsigned char* data, uint64_t size, uint64_t offset,
+                                std::vector<CaptureRecord>& records, uint64_t& nextOffset,
+                                size_t maxRecords)
+{
+    nextOffset = offset;
+    if (nextOffset > size)
+    {
+        return true;
+    }
+    return pcapng ? readPcapngBlocks(data, size, records, nextOffset, maxRecords)
+                  : readPcapRecords(data, size, records, nextOffset, maxRecords);
+}
+
+bool CaptureReader::readPcapRecords(const unsigned char* data, uint64_t size,
+                                    std::vector<CaptureRecord>& records, uint64_t& nextOffset,
+                                    size_t maxRecords)
+{
+    size_t limit = maxRecords > SIZE_MAX - records.size() ? SIZE_MAX : records.size() + maxRecords;
+    while (records.size() < limit && size - nextOffset >= sizeof(PacketHeader))
+    {
+        const unsigned char* header = data + nextOffset;
+        uint32_t             capLen = read32(header + offsetof(PacketHeader, caplen));
+        if (capLen > kMaxRecordLength)
+        {
+            LOG_F(ERROR, "Corrupted capture record at offset %llu",
+                  static_cast<unsigned long long>(nextOffset));
+            return false;
+        }
+        if (size - nextOffset - sizeof(PacketHeader) < capLen)
+        {
+            // 记录尚未写完
+            break;
+        }
+
+        CaptureRecord record;
+        record.block_offset = nextOffset;
+        record.data_offset  = nextOffset + sizeof(PacketHeader);
+        record.block_end    = record.data_offset + capLen;
+        record.cap_len      = capLen;
+        record.len          = read32(header + offsetof(PacketHeader, len));
+        record.interface_id = 0;
+        record.link_type    = pcapLinkType;
+        record.time         = read32(header + offsetof(PacketHeader, ts_sec)) +
+                      read32(header + offsetof(PacketHeader, ts_usec)) / (nanosecond ? 1e9 : 1e6);
+        records.push_back(record);
+        nextOffset = record.block_end;
+    }
+    return true;
+}
+
+bool CaptureReader::readPcapngBlocks(const unsigned char* data, uint64_t size,
+                                     std::vector<CaptureRecord>& records, uint64_t& nextOffset,
+                                     size_t maxRecords)
+{
+    size_t limit = maxRecords > SIZE_MAX - records.size() ? SIZE_MAX : records.size() + maxRecords;
+    while (records.size() < limit && size - nextOffset >= kBlockOverhead)
+    {
+        const unsigned char* block = data + nextOffset;
+        uint32_t             type;
+        memcpy(&type, block, sizeof(type));
+
+        if (type == kSectionHeaderBlock)
+        {
+            // 字节序由新节的SHB决定，数据不完整时等待下一次读取
+            headerTruncated = false;
+            if (!readSectionHeader(data, size, nextOffset))
+            {
+                return headerTruncated;
+            }
+            nextOffset = metadataBlocks.back().second;
+            continue;
+        }
+
+        type                 = read32(block);
+        uint32_t blockLength = read32(block + 4);
+        if (blockLength < kBlockOverhead || blockLength % 4 != 0 ||
+            blockLength > kMaxRecordLength)
+        {
+            LOG_F(ERROR, "Corrupted pcapng block at offset %llu",
+                  static_cast<unsigned long long>(nextOffset));
+            return false;
+        }
+        if (size - nextOffset < blockLength)
+        {
+            // 块尚未写完
+            break;
+        }
+        if (read32(block + blockLength - 4) != blockLength)
+        {
+            LOG_F(ERROR, "Mismatched pcapng block length at offset %llu",
+                  static_cast<unsigned long long>(nextOffset));
+            return false;
+        }
+
+        const unsigned char* body       = block + 8;
+        uint32_t             bodyLength = blockLength - kBlockOverhead;
+
+        CaptureRecord record;
+        record.block_offset = nextOffset;
+        record.block_end    = nextOffset + blockLength;
+        bool isPacket       = false;
+
+        switch (type)
+        {
+        case kInterfaceDescriptionBlock:
+            if (!readInterface(body, bodyLength))
+            {
+                LOG_F(ERROR, "Corrupted pcapng interface block at offset %llu",
+                      static_cast<unsigned long long>(nextOffset));
+                return false;
+            }
+            metadataBlocks.push_back(std::make_pair(record.block_offset, record.block_end));
+            break;
+
+        case kEnhancedPacketBlock:
+        case kPacketBlock:
+        {
+            // EPB: 接口编号(4) 时间戳高/低(4+4) 捕获长度(4) 原始长度(4)
+            // PB:  接口编号(2) 丢包数(2) 之后与EPB相同
+            if (bodyLength < 20)
+            {
+                LOG_F(ERROR, "Truncated pcapng packet block at offset %llu",
+                      static_cast<unsigned long long>(nextOffset));
+                return false;
+            }
+            record.interface_id =
+                type == kEnhancedPacketBlock ? read32(body) : read16(body);
+            uint64_t timestamp =
+                (static_cast<uint64_t>(read32(body + 4)) << 32) | read32(body + 8);
+            record.cap_len     = read32(body + 12);
+            record.len         = read32(body + 16);
+            record.data_offset = nextOffset + 8 + 20;
+            if (record.interface_id >= interfaces.size() || record.cap_len > bodyLength - 20)
+            {
+                LOG_F(ERROR, "Invalid pcapng packet block at offset %llu",
+                      static_cast<unsigned long long>(nextOffset));
+                return false;
+            }
+            const Interface& iface = interfaces[record.interface_id];
+            record.link_type       = iface.linkType;
+            record.time            = timestamp / iface.unitsPerSecond + iface.tsOffset;
+            isPacket               = true;
+            break;
+        }
+
+        case kSimplePacketBlock:
+        {
+            // SPB只有原始长度，捕获长度由块长度和接口的snaplen决定，没有时间戳
+            if (bodyLength < 4 || interfaces.empty())
+            {
+                LOG_F(ERROR, "Invalid pcapng simple packet block at offset %llu",
+                      static_cast<unsigned long long>(nextOffset));
+                return false;
+            }
+            record.interface_id = 0;
+            record.link_type    = interfaces[0].linkType;
+            record.len          = read32(body);
+            record.cap_len      = std::min(record.len, bodyLength - 4);
+            record.data_offset  = nextOffset + 8 + 4;
+            record.time         = 0;
+            isPacket            = true;
+            break;
+        }
+
+        case kNameResolutionBlock:
+            readNameRecords(body, bodyLength);
+            break;
+
+        default:
+            // 统计、自定义等其他块与数据包偏移无关，直接跳过
+            break;
+        }
+
+        if (isPacket)
+        {
+            records.push_back(record);
+        }
+        nextOffset = record.block_end;
+    }
+    return true;
+}
+
+bool CaptureReader::linkTypeBefore(const unsigned char* header, size_t headerLength,
+                                   uint32_t capLen, uint16_t& linkType) const
+{
+    if (!pcapng)
+    {
+        linkType = pcapLinkType;
+        return true;
+    }
+
+    // EPB/PB的数据之前是块头(8)和20字节的固定字段，捕获长度一致才认为是这条记录
+    uint32_t interfaceId = UINT32_MAX;
+    if (headerLength >= kMaxRecordHeader)
+    {
+        const unsigned char* block = header + headerLength - kMaxRecordHeader;
+        uint32_t             type  = read32(block);
+        if ((type == kEnhancedPacketBlock || type == kPacketBlock) &&
+            read32(block + 8 + 12) == capLen && read32(block + 4) >= kMaxRecordHeader + 4 + capLen)
+        {
+            interfaceId = type == kEnhancedPacketBlock ? read32(block + 8) : read16(block + 8);
+        }
+    }
+
+    // SPB的数据之前只有块头和原始长度，属于第一个接口
+    if (interfaceId == UINT32_MAX && headerLength >= 12)
+    {
+        const unsigned char* block = header + headerLength - 12;
+        if (read32(block) == kSimplePacketBlock && read32(block + 4) >= 16 + capLen)
+        {
+            interfaceId = 0;
+        }
+    }
+
+    if (interfaceId >= interfaces.size())
+    {
+        return false;
+    }
+    linkType = interfaces[interfaceId].linkType;
+    return true;
+}
+
+bool CaptureReader::readInterface(const unsigned char* body, uint32_t bodyLength)
+{
+    // 链路类型(2) 保留(2) snaplen(4)，之后是选项
+    if (bodyLength < 8)
+    {
+        return false;
+    }
+
+    Interface iface;
+    iface.linkType       = read16(body);
+    iface.unitsPerSecond = 1e6;
+    iface.tsOffset       = 0;
+
+    uint32_t pos = 8;
+    while (bodyLength - pos >= 4)
+    {
+        uint16_t code   = read16(body + pos);
+        uint16_t length = read16(body + pos + 2);
+        pos += 4;
+        if (code == kOptEndOfOpt || bodyLength - pos < length)
+        {
+            break;
+        }
+
+        if (code == kOptTsResol && length >= 1)
+        {
+            // 最高位为1表示2的负幂，否则是10的负幂
+            uint8_t resol = body[pos];
+            iface.unitsPerSecond =
+                (resol & 0x80) ? std::ldexp(1.0, resol & 0x7F) : std::pow(10.0, resol);
+        }
+        else if (code == kOptTsOffset && length >= 8)
+        {
+            // 64位整数按文件字节序存储
+            uint64_t value;
+            memcpy(&value, body + pos, sizeof(value));
+            if (swapped)
+            {
+                value = (static_cast<uint64_t>(swap32(static_cast<uint32_t>(value))) << 32) |
+                        swap32(static_cast<uint32_t>(value >> 32));
+            }
+            iface.tsOffset = static_cast<int64_t>(value);
+        }
+        pos += padded(length);
+    }
+
+    interfaces.push_back(iface);
+    return true;
+}
+
+void CaptureReader::readNameRecords(const unsigned char* body, uint32_t bodyLength)
+{
+    uint32_t pos = 0;
+    while (bodyLength - pos >= 4)
+    {
+        uint16_t type   = read16(body + pos);
+        uint16_t length = read16(body + pos + 2);
+        pos += 4;
+        if (type == kNrbRecordEnd || bodyLength - pos < length)
+        {
+            break;
+        }
+
+        const unsigned char* value       = body + pos;
+        int                  family      = type == kNrbRecordIpv4 ? AF_INET : AF_INET6;
+        uint32_t             addressSize = type == kNrbRecordIpv4 ? 4 : 16;
+        if ((type == kNrbRecordIpv4 || type == kNrbRecordIpv6) && length > addressSize)
+        {
+            char address[INET6_ADDRSTRLEN];
+            if (inet_ntop(family, value, address, sizeof(address)))
+            {
+                // 地址之后是一个或多个以'\0'结尾的名称，只保留第一个
+                const char* name    = reinterpret_cast<const char*>(value + addressSize);
+                size_t      nameLen = strnlen(name, length - addressSize);
+                names[address]      = std::string(name, nameLen);
+            }
+        }
+        pos += padded(length);
+    }
+}
+
+CaptureFileScanner::CaptureFileScanner() : windowStart(0), windowEof(false), nextOffset(0)
+{
+}
+
+bool CaptureFileScanner::open(const std::string& path)
+{
+    mapped.close();
+    compressed.close();
+    window.clear();
+    windowStart = 0;
+    windowEof   = false;
+
+    switch (CompressedFile::detect(path))
+    {
+    case CompressedFile::FORMAT_GZIP:
+        if (!compressed.open(path) || !fillWindow() ||
+            !reader.readHeader(window.data(), window.size()))
+        {
+            return false;
+        }
+        break;
+    case CompressedFile::FORMAT_ZSTD:
+        LOG_F(ERROR, "zstd compressed captures are not supported: %s", path.c_str());
+        return false;
+    default:
+        if (!mapped.open(path) || !reader.readHeader(mapped.data(), mapped.size()))
+        {
+            return false;
+        }
+        break;
+    }
+
+    nextOffset = reader.headerSize();
+    return true;
+}
+
+const unsigned char* CaptureFileScanner::recordData(const CaptureRecord& record) const
+{
+    if (!compressed.isOpen())
+    {
+        return mapped.range(record.data_offset, record.cap_len);
+    }
+    if (record.data_offset < windowStart ||
+        record.data_offset + record.cap_len > windowStart + window.size())
+    {
+        return nullptr;
+    }
+    return window.data() + (record.data_offset - windowStart);
+}
+
+bool CaptureFileScanner::fillWindow()
+{
+    // 保留窗口中尚未读取的部分，并在其后追加解压数据
+    uint64_t consumed = std::min<uint64_t>(nextOffset - windowStart, window.size());
+    window.erase(window.begin(), window.begin() + consumed);
+    windowStart += consumed;
+
+    size_t kept = window.size();
+    size_t grow = std::max(kWindowSize, kept);
+    window.resize(kept + grow);
+    size_t got = compressed.read(windowStart + kept, window.data() + kept, grow);
+    window.resize(kept + got);
+    windowEof = got < grow;
+    return got > 0 || kept > 0;
+}
+
+bool CaptureFileScanner::next(std::vector<CaptureRecord>& records, size_t maxRecords)
+{
+    records.clear();
+    if (!compressed.isOpen())
+    {
+        return reader.readRecords(mapped.data(), mapped.size(), nextOffset, records, nextOffset,
+                                  maxRecords);
+    }
+
+    while (true)
+    {
+        uint64_t relative;
+        if (!reader.readRecords(window.data(), window.size(), nextOffset - windowStart, records,
+                                relative, maxRecords))
+        {
+            return false;
+        }
+        nextOffset = windowStart + relative;
+        if (!records.empty() || windowEof)
+        {
+            break;
+        }
+        // 窗口内剩下的数据不足一条记录
+        if (!fillWindow())
+        {
+            break;
+        }
+    }
+
+    for (auto& record : records)
+    {
+        record.block_offset += windowStart;
+        record.block_end += windowStart;
+        record.data_offset += windowStart;
+    }
+    return true;
+}
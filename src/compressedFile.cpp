@@ -0,0 +1,329 @@
+#include "compressedFile.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "loguru.hpp"
+
+namespace
+{
+// 相邻访问点之间的解压数据量
+const uint64_t kSpan = 1024 * 1024;
+// deflate的最大回溯距离
+const size_t kWindowSize = 32768;
+const size_t kInputSize  = 65536;
+// gzip成员结尾的CRC32和长度
+const size_t kGzipTrailerSize = 8;
+// inflateInit2的windowBits：原始deflate流和gzip格式
+const int kRawDeflate = -15;
+const int kGzip       = 31;
+} // namespace
+
+struct CompressedFile::Cursor
+{
+    z_stream                   strm;
+    bool                       active;
+    bool                       raw;      // 从访问点开始的原始deflate流，成员结尾需自行跳过
+    bool                       finished; // 已到达文件末尾
+    uint64_t                   in;       // 下一次从文件读取的位置
+    uint64_t                   out;      // 已解压的数据量
+    uint64_t                   lastPoint;
+    size_t                     skipInput; // 待跳过的gzip成员结尾字节数
+    std::vector<unsigned char> input;
+    std::vector<unsigned char> window; // 最近32KB解压数据的环形缓冲区
+    size_t                     windowPos;
+
+    Cursor()
+        : active(false), raw(false), finished(false), in(0), out(0), lastPoint(0),
+          skipInput(0), input(kInputSize), window(kWindowSize), windowPos(0)
+    {
+        memset(&strm, 0, sizeof(strm));
+    }
+
+    ~Cursor() { reset(); }
+
+    void reset()
+    {
+        if (active)
+        {
+            inflateEnd(&strm);
+            active = false;
+        }
+    }
+
+    void remember(const unsigned char* data, size_t length)
+    {
+        if (length >= kWindowSize)
+        {
+            memcpy(window.data(), data + length - kWindowSize, kWindowSize);
+            windowPos = 0;
+            return;
+        }
+        size_t first = std::min(length, kWindowSize - windowPos);
+        memcpy(window.data() + windowPos, data, first);
+        memcpy(window.data(), data + first, length - first);
+        windowPos = (windowPos + length) % kWindowSize;
+    }
+
+    void copyWindow(std::vector<unsigned char>& dest) const
+    {
+        if (out < kWindowSize)
+        {
+            dest.assign(window.begin(), window.begin() + out);
+            return;
+        }
+        dest.assign(window.begin() + windowPos, window.end());
+        dest.insert(dest.end(), window.begin(), window.begin() + windowPos);
+    }
+};
+
+CompressedFile::CompressedFile() : fd(-1)
+{
+}
+
+CompressedFile::~CompressedFile()
+{
+    close();
+}
+
+CompressedFile::Format CompressedFile::detect(const std::string& path)
+{
+    unsigned char magic[4];
+    int           file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return FORMAT_NONE;
+    }
+    ssize_t n = pread(file, magic, sizeof(magic), 0);
+    ::close(file);
+
+    if (n >= 2 && magic[0] == 0x1F && magic[1] == 0x8B)
+    {
+        return FORMAT_GZIP;
+    }
+    if (n == 4 && magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD)
+    {
+        return FORMAT_ZSTD;
+    }
+    return FORMAT_NONE;
+}
+
+bool CompressedFile::open(const std::string& path)
+{
+    close();
+
+    if (detect(path) != FORMAT_GZIP)
+    {
+        LOG_F(ERROR, "%s is not a gzip file", path.c_str());
+        return false;
+    }
+
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        LOG_F(ERROR, "Failed to open %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    filePath = path;
+    indexCursor.reset(new Cursor());
+    randomCursor.reset(new Cursor());
+    if (!startCursor(*indexCursor, nullptr))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void CompressedFile::close()
+{
+    indexCursor.reset();
+    randomCursor.reset();
+    accessPoints.clear();
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+    filePath.clear();
+}
+
+bool CompressedFile::startCursor(Cursor& cursor, const AccessPoint* point)
+{
+    cursor.reset();
+    cursor.finished       = false;
+    cursor.skipInput      = 0;
+    cursor.strm.next_in   = nullptr;
+    cursor.strm.avail_in  = 0;
+    cursor.strm.zalloc    = Z_NULL;
+    cursor.strm.zfree     = Z_NULL;
+    cursor.strm.opaque    = Z_NULL;
+    cursor.raw            = point != nullptr;
+    if (inflateInit2(&cursor.strm, cursor.raw ? kRawDeflate : kGzip) != Z_OK)
+    {
+        LOG_F(ERROR, "Failed to initialize inflate for %s", filePath.c_str());
+        return false;
+    }
+    cursor.active = true;
+
+    if (!point)
+    {
+        cursor.in  = 0;
+        cursor.out = 0;
+        return true;
+    }
+
+    cursor.in  = point->in - (point->bits ? 1 : 0);
+    cursor.out = point->out;
+    if (point->bits)
+    {
+        // 访问点位于字节中间，先补上该字节剩余的比特
+        unsigned char byte;
+        if (pread(fd, &byte, 1, cursor.in) != 1)
+        {
+            cursor.reset();
+            return false;
+        }
+        cursor.in++;
+        inflatePrime(&cursor.strm, point->bits, byte >> (8 - point->bits));
+    }
+    inflateSetDictionary(&cursor.strm, point->window.data(),
+                         static_cast<uInt>(point->window.size()));
+    return true;
+}
+
+size_t CompressedFile::advance(Cursor& cursor, uint64_t offset, unsigned char* buffer,
+                               size_t length, bool buildIndex)
+{
+    unsigned char scratch[16384];
+    size_t        copied = 0;
+
+    while (copied < length && cursor.active && !cursor.finished)
+    {
+        if (cursor.strm.avail_in == 0)
+        {
+            ssize_t n = pread(fd, cursor.input.data(), cursor.input.size(), cursor.in);
+            if (n < 0)
+            {
+                LOG_F(ERROR, "Failed to read %s: %s", filePath.c_str(), strerror(errno));
+                cursor.reset();
+                break;
+            }
+            if (n == 0)
+            {
+                cursor.finished = true;
+                break;
+            }
+            cursor.in += n;
+            cursor.strm.next_in  = cursor.input.data();
+            cursor.strm.avail_in = static_cast<uInt>(n);
+        }
+
+        if (cursor.skipInput > 0)
+        {
+            // 原始deflate流不处理gzip成员结尾，手动跳过
+            size_t n = std::min<size_t>(cursor.skipInput, cursor.strm.avail_in);
+            cursor.strm.next_in += n;
+            cursor.strm.avail_in -= static_cast<uInt>(n);
+            cursor.skipInput -= n;
+            continue;
+        }
+
+        // 目标区间之前的数据解压到临时缓冲区后丢弃
+        unsigned char* dest;
+        size_t         room;
+        if (cursor.out >= offset)
+        {
+            dest = buffer + copied;
+            room = length - copied;
+        }
+        else
+        {
+            dest = scratch;
+            room = static_cast<size_t>(std::min<uint64_t>(sizeof(scratch), offset - cursor.out));
+        }
+        room                  = std::min<size_t>(room, UINT32_MAX);
+        cursor.strm.next_out  = dest;
+        cursor.strm.avail_out = static_cast<uInt>(room);
+
+        int    ret      = inflate(&cursor.strm, Z_BLOCK);
+        size_t produced = room - cursor.strm.avail_out;
+        if (buildIndex)
+        {
+            cursor.remember(dest, produced);
+        }
+        cursor.out += produced;
+        if (dest != scratch)
+        {
+            copied += produced;
+        }
+
+        if (ret == Z_STREAM_END)
+        {
+            // 一个gzip成员结束，后面可能还拼接了其他成员
+            if (cursor.raw)
+            {
+                cursor.skipInput = kGzipTrailerSize;
+            }
+            inflateReset2(&cursor.strm, kGzip);
+            cursor.raw = false;
+            continue;
+        }
+        if (ret != Z_OK && ret != Z_BUF_ERROR)
+        {
+            LOG_F(ERROR, "Failed to decompress %s at offset %llu: %s", filePath.c_str(),
+                  static_cast<unsigned long long>(cursor.out),
+                  cursor.strm.msg ? cursor.strm.msg : "unknown error");
+            cursor.reset();
+            break;
+        }
+
+        // 在deflate块边界处（不是最后一个块）记录访问点
+        if (buildIndex && (cursor.strm.data_type & 128) && !(cursor.strm.data_type & 64) &&
+            (accessPoints.empty() || cursor.out - cursor.lastPoint >= kSpan))
+        {
+            AccessPoint point;
+            point.out  = cursor.out;
+            point.in   = cursor.in - cursor.strm.avail_in;
+            point.bits = cursor.strm.data_type & 7;
+            cursor.copyWindow(point.window);
+            accessPoints.push_back(std::move(point));
+            cursor.lastPoint = cursor.out;
+        }
+    }
+    return copied;
+}
+
+size_t CompressedFile::read(uint64_t offset, unsigned char* buffer, size_t length)
+{
+    if (!isOpen() || length == 0)
+    {
+        return 0;
+    }
+
+    // 顺序读取沿用建立索引的游标，同时扩展索引
+    if (offset >= indexCursor->out)
+    {
+        return advance(*indexCursor, offset, buffer, length, true);
+    }
+
+    // 随机读取时，游标不在附近就从最近的访问点重新开始
+    Cursor& cursor = *randomCursor;
+    if (!cursor.active || cursor.out > offset || offset - cursor.out > kSpan)
+    {
+        auto it = std::upper_bound(
+            accessPoints.begin(), accessPoints.end(), offset,
+            [](uint64_t value, const AccessPoint& point) { return value < point.out; });
+        const AccessPoint* point = it == accessPoints.begin() ? nullptr : &*(it - 1);
+        if (!startCursor(cursor, point))
+        {
+            return 0;
+        }
+    }
+    return advance(cursor, offset, buffer, length, false);
+}
@@ -0,0 +1,250 @@
+#include "flowTable.hpp"
+
+#include <algorithm>
+
+#include "utils.hpp"
+
+const uint8_t FlowTable::kTcpFin;
+const uint8_t FlowTable::kTcpSyn;
+const uint8_t FlowTable::kTcpRst;
+const uint8_t FlowTable::kTcpAck;
+const uint32_t FlowTable::kNoPacket;
+
+namespace
+{
+const size_t  kInitialSlots = 1024;
+const uint8_t kProtoTcp     = 6;
+} // namespace
+
+FlowTable::FlowTable() : slots(kInitialSlots, 0)
+{
+}
+
+void FlowTable::normalize(const IpAddress& srcIp, uint16_t srcPort, const IpAddress& dstIp,
+                          uint16_t dstPort, uint8_t ipProto, FlowKey& key, uint8_t& direction)
+{
+    memset(&key, 0, sizeof(key));
+    int order = memcmp(srcIp.bytes, dstIp.bytes, sizeof(srcIp.bytes));
+    direction = order > 0 || (order == 0 && srcPort > dstPort) ? 1 : 0;
+
+    key.addr[direction]     = srcIp;
+    key.port[direction]     = srcPort;
+    key.addr[1 - direction] = dstIp;
+    key.port[1 - direction] = dstPort;
+    key.ip_proto            = ipProto;
+}
+
+size_t FlowTable::probe(const FlowKey& key) const
+{
+    // 线性探测，返回键所在的槽位，不存在时返回探测序列中的第一个空槽位
+    size_t mask = slots.size() - 1;
+    size_t slot = HashUtil::xxh64(&key, sizeof(key)) & mask;
+    while (slots[slot] != 0 && !(flows[slots[slot] - 1].key == key))
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void FlowTable::updateTcpState(FlowRecord& flow, uint8_t direction, uint8_t flags)
+{
+    flow.tcp_flags[direction] |= flags;
+    uint8_t& state = flow.tcp_state;
+
+    if (flags & kTcpRst)
+    {
+        state = TCP_RESET;
+    }
+    else if (state == TCP_RESET || state == TCP_CLOSED)
+    {
+        // 连接已结束，同一五元组上的新SYN视为端口复用的新连接
+        if ((flags & kTcpSyn) && !(flags & kTcpAck))
+        {
+            state                         = TCP_SYN_SENT;
+            flow.tcp_flags[direction]     = flags;
+            flow.tcp_flags[1 - direction] = 0;
+        }
+    }
+    else if (flags & kTcpFin)
+    {
+        state = (flow.tcp_flags[0] & kTcpFin) && (flow.tcp_flags[1] & kTcpFin) ? TCP_CLOSED
+                                                                              : TCP_CLOSING;
+    }
+    else if (flags & kTcpSyn)
+    {
+        if (flags & kTcpAck)
+        {
+            state = std::max<uint8_t>(state, TCP_SYN_RECEIVED);
+        }
+        else if (state == TCP_NONE)
+        {
+            state = TCP_SYN_SENT;
+        }
+    }
+    else if ((flags & kTcpAck) && (state == TCP_NONE || state == TCP_SYN_RECEIVED))
+    {
+        state = TCP_ESTABLISHED;
+    }
+}
+
+bool FlowTable::add(const CompactPacket& record, uint32_t index, uint32_t& flowId,
+                    uint8_t& direction)
+{
+    if (record.raw_address_id != 0 || record.src_ip.isEmpty() || record.dst_ip.isEmpty())
+    {
+        return false;
+    }
+
+    FlowKey key;
+    normalize(record.src_ip, record.src_port, record.dst_ip, record.dst_port, record.ip_proto, key,
+              direction);
+
+    // 遇到空槽位说明是新连接
+    size_t slot = probe(key);
+    if (slots[slot] != 0)
+    {
+        flowId = slots[slot] - 1;
+    }
+    else
+    {
+        FlowRecord flow;
+        memset(&flow, 0, sizeof(flow));
+        flow.key          = key;
+        flow.initiator    = direction;
+        flow.first_time   = record.time;
+        flow.last_time    = record.time;
+        flow.first_packet = index;
+        flow.last_packet  = kNoPacket;
+        flows.push_back(flow);
+        dirtyFlags.push_back(false);
+        flowId      = static_cast<uint32_t>(flows.size() - 1);
+        slots[slot] = flowId + 1;
+
+        // 负载超过0.7时扩容，保持探测序列较短
+        if (flows.size() * 10 > slots.size() * 7)
+        {
+            grow();
+        }
+    }
+
+    FlowRecord& flow = flows[flowId];
+    if (nextPacket.size() <= index)
+    {
+        nextPacket.resize(index + 1, kNoPacket);
+    }
+    if (flow.last_packet != kNoPacket)
+    {
+        nextPacket[flow.last_packet] = index;
+    }
+    flow.last_packet = index;
+    flow.packets[direction]++;
+    flow.bytes[direction] += record.len;
+    flow.first_time = std::min(flow.first_time, record.time);
+    flow.last_time  = std::max(flow.last_time, record.time);
+    if (key.ip_proto == kProtoTcp)
+    {
+        updateTcpState(flow, direction, record.tcp_flags);
+    }
+
+    if (!dirtyFlags[flowId])
+    {
+        dirtyFlags[flowId] = true;
+        dirty.push_back(flowId);
+    }
+    return true;
+}
+
+bool FlowTable::find(const IpAddress& srcIp, uint16_t srcPort, const IpAddress& dstIp,
+                     uint16_t dstPort, uint8_t ipProto, uint32_t& flowId,
+                     uint8_t& direction) const
+{
+    FlowKey key;
+    normalize(srcIp, srcPort, dstIp, dstPort, ipProto, key, direction);
+    size_t slot = probe(key);
+    if (slots[slot] == 0)
+    {
+        return false;
+    }
+    flowId = slots[slot] - 1;
+    return true;
+}
+
+void FlowTable::grow()
+{
+    std::vector<uint32_t> bigger(slots.size() * 2, 0);
+    size_t                mask = bigger.size() - 1;
+    for (size_t i = 0; i < flows.size(); i++)
+    {
+        size_t slot = HashUtil::xxh64(&flows[i].key, sizeof(FlowKey)) & mask;
+        while (bigger[slot] != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        bigger[slot] = static_cast<uint32_t>(i + 1);
+    }
+    slots.swap(bigger);
+}
+
+void FlowTable::toConversation(size_t id, Conversation& conversation) const
+{
+    const FlowRecord& flow = flows[id];
+    uint8_t           src  = flow.initiator;
+    uint8_t           dst  = 1 - src;
+
+    conversation.flow_id            = static_cast<uint32_t>(id);
+    conversation.src_ip             = NetUtil::formatIp(flow.key.addr[src]);
+    conversation.src_port           = flow.key.port[src];
+    conversation.dst_ip             = NetUtil::formatIp(flow.key.addr[dst]);
+    conversation.dst_port           = flow.key.port[dst];
+    conversation.ip_proto           = flow.key.ip_proto;
+    conversation.first_time         = flow.first_time;
+    conversation.last_time          = flow.last_time;
+    conversation.packets_sent       = flow.packets[src];
+    conversation.bytes_sent         = flow.bytes[src];
+    conversation.packets_received   = flow.packets[dst];
+    conversation.bytes_received     = flow.bytes[dst];
+    conversation.tcp_flags_sent     = flow.tcp_flags[src];
+    conversation.tcp_flags_received = flow.tcp_flags[dst];
+    conversation.tcp_state          = stateName(flow.tcp_state);
+}
+
+void FlowTable::takeDirty(std::vector<uint32_t>& ids)
+{
+    ids.swap(dirty);
+    dirty.clear();
+    std::sort(ids.begin(), ids.end());
+    for (uint32_t id : ids)
+    {
+        dirtyFlags[id] = false;
+    }
+}
+
+void FlowTable::clear()
+{
+    slots.assign(kInitialSlots, 0);
+    flows.clear();
+    dirty.clear();
+    dirtyFlags.clear();
+    nextPacket.clear();
+}
+
+const char* FlowTable::stateName(uint8_t state)
+{
+    switch (state)
+    {
+    case TCP_SYN_SENT:
+        return "SYN_SENT";
+    case TCP_SYN_RECEIVED:
+        return "SYN_RECEIVED";
+    case TCP_ESTABLISHED:
+        return "ESTABLISHED";
+    case TCP_CLOSING:
+        return "CLOSING";
+    case TCP_CLOSED:
+        return "CLOSED";
+    case TCP_RESET:
+        return "RESET";
+    default:
+        return "";
+    }
+}
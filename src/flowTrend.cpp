@@ -0,0 +1,233 @@
+#include "flowTrend.hpp"
+
+#include <algorithm>
+#include <thread>
+
+const size_t FlowTrendRing::kSlots;
+const size_t FlowTrendRollup::kMaxQueryBuckets;
+
+namespace
+{
+// 空槽位的秒数，不会与真实时间戳冲突
+const long kEmptySecond = -1;
+// 待持久化的桶最多保留的数量，调用方长时间不取出时丢弃最旧的
+const size_t kMaxPending = 1024;
+} // namespace
+
+FlowTrendRing::FlowTrendRing() : sequence(0)
+{
+    for (size_t i = 0; i < kSlots; i++)
+    {
+        seconds[i].store(kEmptySecond, std::memory_order_relaxed);
+        values[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t FlowTrendRing::slotOf(long second)
+{
+    long slot = second % static_cast<long>(kSlots);
+    return static_cast<size_t>(slot < 0 ? slot + static_cast<long>(kSlots) : slot);
+}
+
+void FlowTrendRing::add(long second, long value)
+{
+    size_t   slot = slotOf(second);
+    uint32_t seq  = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // 槽位属于更早的秒时先重置
+    if (seconds[slot].load(std::memory_order_relaxed) != second)
+    {
+        seconds[slot].store(second, std::memory_order_relaxed);
+        values[slot].store(value, std::memory_order_relaxed);
+    }
+    else
+    {
+        values[slot].store(values[slot].load(std::memory_order_relaxed) + value,
+                           std::memory_order_relaxed);
+    }
+
+    sequence.store(seq + 2, std::memory_order_release);
+}
+
+void FlowTrendRing::clear()
+{
+    uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (size_t i = 0; i < kSlots; i++)
+    {
+        seconds[i].store(kEmptySecond, std::memory_order_relaxed);
+        values[i].store(0, std::memory_order_relaxed);
+    }
+
+    sequence.store(seq + 2, std::memory_order_release);
+}
+
+void FlowTrendRing::snapshot(long start, size_t count, long* out) const
+{
+    while (true)
+    {
+        uint32_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            long   second = start + static_cast<long>(i);
+            size_t slot   = slotOf(second);
+            out[i]        = seconds[slot].load(std::memory_order_relaxed) == second
+                                ? values[slot].load(std::memory_order_relaxed)
+                                : 0;
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before)
+        {
+            return;
+        }
+    }
+}
+
+FlowTrendRollup::FlowTrendRollup(size_t secondBuckets, size_t minuteBuckets, size_t hourBuckets)
+{
+    size_t counts[TIER_COUNT] = {secondBuckets, minuteBuckets, hourBuckets};
+    for (int tier = 0; tier < TIER_COUNT; tier++)
+    {
+        FlowTrendBucket empty = {kEmptySecond, 0, 0, 0};
+        levels[tier].width    = tierSeconds(static_cast<Tier>(tier));
+        levels[tier].current  = kEmptySecond;
+        levels[tier].first    = kEmptySecond;
+        levels[tier].buckets.assign(std::max<size_t>(counts[tier], 1), empty);
+    }
+}
+
+long FlowTrendRollup::tierSeconds(Tier tier)
+{
+    switch (tier)
+    {
+    case TIER_MINUTE:
+        return 60;
+    case TIER_HOUR:
+        return 3600;
+    default:
+        return 1;
+    }
+}
+
+long FlowTrendRollup::alignDown(long second, long width)
+{
+    long rem = second % width;
+    return second - (rem < 0 ? rem + width : rem);
+}
+
+FlowTrendRollup::Tier FlowTrendRollup::tierForSpan(long span) const
+{
+    for (int tier = TIER_SECOND; tier < TIER_HOUR; tier++)
+    {
+        const Level& level = levels[tier];
+        if (span <= level.width * static_cast<long>(level.buckets.size()))
+        {
+            return static_cast<Tier>(tier);
+        }
+    }
+    return TIER_HOUR;
+}
+
+void FlowTrendRollup::add(long second, uint64_t bytes, uint64_t packets)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    for (int tier = 0; tier < TIER_COUNT; tier++)
+    {
+        Level& level = levels[tier];
+        long   start = alignDown(second, level.width);
+        if (start < level.current)
+        {
+            continue;
+        }
+
+        FlowTrendBucket& bucket =
+            level.buckets[static_cast<size_t>(start / level.width) % level.buckets.size()];
+        if (start != level.current)
+        {
+            // 上一个桶已经结束
+            if (tier != TIER_SECOND && level.current != kEmptySecond)
+            {
+                const FlowTrendBucket& finished =
+                    level.buckets[static_cast<size_t>(level.current / level.width) %
+                                  level.buckets.size()];
+                if (pending.size() >= kMaxPending)
+                {
+                    pending.erase(pending.begin());
+                }
+                pending.push_back(std::make_pair(static_cast<Tier>(tier), finished));
+            }
+            if (level.current == kEmptySecond)
+            {
+                level.first = start;
+            }
+            level.current = start;
+            bucket.start  = start;
+            bucket.bytes = bucket.max_bytes = bucket.packets = 0;
+        }
+
+        bucket.bytes += bytes;
+        bucket.packets += packets;
+        bucket.max_bytes = std::max(bucket.max_bytes, bytes);
+    }
+}
+
+long FlowTrendRollup::oldestStart(Tier tier) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    const Level&                level = levels[tier];
+    if (level.current == kEmptySecond)
+    {
+        return kEmptySecond;
+    }
+    return std::max(level.first,
+                    level.current - level.width * static_cast<long>(level.buckets.size() - 1));
+}
+
+void FlowTrendRollup::query(Tier tier, long start, long end,
+                            std::vector<FlowTrendBucket>& buckets) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    const Level&                level = levels[tier];
+    buckets.clear();
+    if (level.current == kEmptySecond)
+    {
+        return;
+    }
+
+    long oldest = level.current - level.width * static_cast<long>(level.buckets.size() - 1);
+    start       = std::max(alignDown(start, level.width), std::max(level.first, oldest));
+
+    for (long t = start; t < end; t += level.width)
+    {
+        const FlowTrendBucket& slot =
+            level.buckets[static_cast<size_t>(alignDown(t, level.width) / level.width) %
+                          level.buckets.size()];
+        if (slot.start == t)
+        {
+            buckets.push_back(slot);
+        }
+        else
+        {
+            FlowTrendBucket empty = {t, 0, 0, 0};
+            buckets.push_back(empty);
+        }
+    }
+}
+
+void FlowTrendRollup::takeCompleted(std::vector<std::pair<Tier, FlowTrendBucket>>& completed)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    completed.swap(pending);
+    pending.clear();
+}
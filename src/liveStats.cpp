@@ -0,0 +1,697 @@
+#include "liveStats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "utils.hpp"
+
+namespace
+{
+template <typename T>
+bool writeValue(FILE* file, const T& value)
+{
+    return fwrite(&value, sizeof(T), 1, file) == 1;
+}
+
+// 从内存中按顺序读取定长字段，越界时返回false
+template <typename T>
+bool readValue(const unsigned char*& data, const unsigned char* end, T& value)
+{
+    if (static_cast<size_t>(end - data) < sizeof(T))
+    {
+        return false;
+    }
+    memcpy(&value, data, sizeof(T));
+    data += sizeof(T);
+    return true;
+}
+} // namespace
+
+SpaceSaving::SpaceSaving(size_t capacity) : capacity(std::max<size_t>(capacity, 1))
+{
+}
+
+void SpaceSaving::swapEntries(size_t a, size_t b)
+{
+    std::swap(heap[a], heap[b]);
+    positions[heap[a].key] = a;
+    positions[heap[b].key] = b;
+}
+
+void SpaceSaving::siftUp(size_t pos)
+{
+    while (pos > 0)
+    {
+        size_t parent = (pos - 1) / 2;
+        if (heap[parent].bytes <= heap[pos].bytes)
+        {
+            break;
+        }
+        swapEntries(pos, parent);
+        pos = parent;
+    }
+}
+
+void SpaceSaving::siftDown(size_t pos)
+{
+    while (true)
+    {
+        size_t smallest = pos;
+        size_t left     = pos * 2 + 1;
+        size_t right    = left + 1;
+        if (left < heap.size() && heap[left].bytes < heap[smallest].bytes)
+        {
+            smallest = left;
+        }
+        if (right < heap.size() && heap[right].bytes < heap[smallest].bytes)
+        {
+            smallest = right;
+        }
+        if (smallest == pos)
+        {
+            return;
+        }
+        swapEntries(pos, smallest);
+        pos = smallest;
+    }
+}
+
+void SpaceSaving::add(const std::string& key, uint64_t bytes, uint64_t packets)
+{
+    auto it = positions.find(key);
+    if (it != positions.end())
+    {
+        size_t pos = it->second;
+        heap[pos].bytes += bytes;
+        heap[pos].packets += packets;
+        siftDown(pos);
+        return;
+    }
+
+    if (heap.size() < capacity)
+    {
+        HeavyHitter item = {key, bytes, packets, 0};
+        heap.push_back(item);
+        positions[key] = heap.size() - 1;
+        siftUp(heap.size() - 1);
+        return;
+    }
+
+    // 已满时替换计数最小的键，新键继承其计数作为误差
+    HeavyHitter& victim = heap[0];
+    positions.erase(victim.key);
+    victim.key   = key;
+    victim.error = victim.bytes;
+    victim.bytes += bytes;
+    victim.packets += packets;
+    positions[key] = 0;
+    siftDown(0);
+}
+
+void SpaceSaving::top(size_t n, std::vector<HeavyHitter>& items) const
+{
+    items = heap;
+    n     = std::min(n, items.size());
+    std::partial_sort(items.begin(), items.begin() + n, items.end(),
+                      [](const HeavyHitter& a, const HeavyHitter& b) { return a.bytes > b.bytes; });
+    items.resize(n);
+}
+
+void SpaceSaving::clear()
+{
+    heap.clear();
+    positions.clear();
+}
+
+bool SpaceSaving::save(FILE* file) const
+{
+    // 按堆中的顺序写出，恢复后不需要重新建堆
+    uint32_t size = static_cast<uint32_t>(heap.size());
+    if (!writeValue(file, size))
+    {
+        return false;
+    }
+    for (const HeavyHitter& item : heap)
+    {
+        uint32_t length = static_cast<uint32_t>(item.key.size());
+        bool     ok     = writeValue(file, length) &&
+                  fwrite(item.key.data(), 1, length, file) == length &&
+                  writeValue(file, item.bytes) && writeValue(file, item.packets) &&
+                  writeValue(file, item.error);
+        if (!ok)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SpaceSaving::load(const unsigned char*& data, const unsigned char* end)
+{
+    clear();
+
+    uint32_t size;
+    if (!readValue(data, end, size) || size > capacity)
+    {
+        return false;
+    }
+    heap.resize(size);
+    for (uint32_t i = 0; i < size; i++)
+    {
+        HeavyHitter& item = heap[i];
+        uint32_t     length;
+        if (!readValue(data, end, length) || static_cast<size_t>(end - data) < length)
+        {
+            clear();
+            return false;
+        }
+        item.key.assign(reinterpret_cast<const char*>(data), length);
+        data += length;
+        if (!readValue(data, end, item.bytes) || !readValue(data, end, item.packets) ||
+            !readValue(data, end, item.error) || !positions.insert({item.key, i}).second)
+        {
+            clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+CountMinSketch::CountMinSketch(size_t width, size_t depth)
+    : width(std::max<size_t>(width, 1)), depth(std::max<size_t>(depth, 1)),
+      counters(this->width * this->depth, 0)
+{
+}
+
+void CountMinSketch::add(const std::string& key, uint64_t value)
+{
+    // 双重哈希：由一次64位哈希的高低两半得到每行的位置
+    uint64_t hash = HashUtil::xxh64(key.data(), key.size());
+    uint64_t h1   = hash & 0xFFFFFFFF;
+    uint64_t h2   = (hash >> 32) | 1;
+    for (size_t row = 0; row < depth; row++)
+    {
+        counters[row * width + (h1 + row * h2) % width] += value;
+    }
+}
+
+uint64_t CountMinSketch::estimate(const std::string& key) const
+{
+    uint64_t hash   = HashUtil::xxh64(key.data(), key.size());
+    uint64_t h1     = hash & 0xFFFFFFFF;
+    uint64_t h2     = (hash >> 32) | 1;
+    uint64_t result = UINT64_MAX;
+    for (size_t row = 0; row < depth; row++)
+    {
+        result = std::min(result, counters[row * width + (h1 + row * h2) % width]);
+    }
+    return result;
+}
+
+void CountMinSketch::clear()
+{
+    std::fill(counters.begin(), counters.end(), 0);
+}
+
+bool CountMinSketch::save(FILE* file) const
+{
+    uint32_t shape[2] = {static_cast<uint32_t>(width), static_cast<uint32_t>(depth)};
+    return writeValue(file, shape) &&
+           fwrite(counters.data(), sizeof(uint64_t), counters.size(), file) == counters.size();
+}
+
+bool CountMinSketch::load(const unsigned char*& data, const unsigned char* end)
+{
+    uint32_t shape[2];
+    size_t   size = counters.size() * sizeof(uint64_t);
+    if (!readValue(data, end, shape) || shape[0] != width || shape[1] != depth ||
+        static_cast<size_t>(end - data) < size)
+    {
+        clear();
+        return false;
+    }
+    memcpy(counters.data(), data, size);
+    data += size;
+    return true;
+}
+
+namespace
+{
+// 向下对齐到整分钟
+long alignMinute(long second)
+{
+    long rem = second % 60;
+    return second - (rem < 0 ? rem + 60 : rem);
+}
+} // namespace
+
+HyperLogLog::HyperLogLog(int precision)
+    : bits(std::min(std::max(precision, 4), 16)), registers(static_cast<size_t>(1) << bits, 0)
+{
+}
+
+void HyperLogLog::addHash(uint64_t hash)
+{
+    // 高bits位选择寄存器，其余位的前导零个数加一作为秩
+    size_t   index = static_cast<size_t>(hash >> (64 - bits));
+    uint64_t rest  = hash << bits;
+    uint8_t  rank  = rest == 0 ? static_cast<uint8_t>(64 - bits + 1)
+                               : static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+    registers[index] = std::max(registers[index], rank);
+}
+
+bool HyperLogLog::merge(const HyperLogLog& other)
+{
+    if (other.bits != bits)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < registers.size(); i++)
+    {
+        registers[i] = std::max(registers[i], other.registers[i]);
+    }
+    return true;
+}
+
+double HyperLogLog::estimate() const
+{
+    double m     = static_cast<double>(registers.size());
+    double sum   = 0;
+    size_t zeros = 0;
+    for (uint8_t value : registers)
+    {
+        sum += std::ldexp(1.0, -value);
+        zeros += value == 0;
+    }
+
+    double alpha = 0.7213 / (1 + 1.079 / m);
+    if (registers.size() == 16)
+    {
+        alpha = 0.673;
+    }
+    else if (registers.size() == 32)
+    {
+        alpha = 0.697;
+    }
+    else if (registers.size() == 64)
+    {
+        alpha = 0.709;
+    }
+
+    // 基数较小时改用线性计数；64位哈希不需要大基数修正
+    double estimate = alpha * m * m / sum;
+    if (estimate <= 2.5 * m && zeros > 0)
+    {
+        estimate = m * std::log(m / static_cast<double>(zeros));
+    }
+    return estimate;
+}
+
+void HyperLogLog::clear()
+{
+    std::fill(registers.begin(), registers.end(), 0);
+}
+
+bool HyperLogLog::save(FILE* file) const
+{
+    int32_t precision = bits;
+    return writeValue(file, precision) &&
+           fwrite(registers.data(), 1, registers.size(), file) == registers.size();
+}
+
+bool HyperLogLog::load(const unsigned char*& data, const unsigned char* end)
+{
+    int32_t precision;
+    if (!readValue(data, end, precision) || precision != bits ||
+        static_cast<size_t>(end - data) < registers.size())
+    {
+        clear();
+        return false;
+    }
+    memcpy(registers.data(), data, registers.size());
+    data += registers.size();
+    return true;
+}
+
+EndpointCardinality::EndpointCardinality(int precision, size_t maxMinutes)
+    : precision(precision), maxMinutes(std::max<size_t>(maxMinutes, 1))
+{
+}
+
+EndpointCardinality::Window* EndpointCardinality::windowOf(long minute)
+{
+    auto it = minutes.find(minute);
+    if (it != minutes.end())
+    {
+        return &it->second;
+    }
+
+    // 已满时丢弃最早的一分钟，比保留的都早的分钟直接忽略
+    if (minutes.size() >= maxMinutes)
+    {
+        if (minute < minutes.begin()->first)
+        {
+            return nullptr;
+        }
+        minutes.erase(minutes.begin());
+    }
+    return &minutes.insert(std::make_pair(minute, Window(precision))).first->second;
+}
+
+void EndpointCardinality::add(const Packet& packet)
+{
+    long minute = alignMinute(static_cast<long>(std::floor(packet.time)));
+
+    // 连接由两端地址、端口和协议的哈希链式组合而成，不拼接字符串；
+    // (地址, 端口)较小的一端在前，两个方向的数据包计为同一个连接
+    uint64_t srcHash  = HashUtil::xxh64(packet.src_ip.data(), packet.src_ip.size());
+    uint64_t dstHash  = HashUtil::xxh64(packet.dst_ip.data(), packet.dst_ip.size());
+    int      order    = packet.src_ip.compare(packet.dst_ip);
+    bool     swap     = order > 0 || (order == 0 && packet.src_port > packet.dst_port);
+    uint64_t seed     = swap ? dstHash ^ (srcHash * 31) : srcHash ^ (dstHash * 31);
+    uint16_t key[3]   = {swap ? packet.dst_port : packet.src_port,
+                         swap ? packet.src_port : packet.dst_port, packet.ip_proto};
+    uint64_t flowHash = HashUtil::xxh64(key, sizeof(key), seed);
+
+    std::lock_guard<std::mutex> guard(lock);
+    Window*                     window = windowOf(minute);
+    if (!window)
+    {
+        return;
+    }
+    if (!packet.src_ip.empty())
+    {
+        window->srcIps.addHash(srcHash);
+    }
+    if (!packet.dst_ip.empty())
+    {
+        window->dstIps.addHash(dstHash);
+    }
+    if (!packet.src_ip.empty() || !packet.dst_ip.empty())
+    {
+        window->flows.addHash(flowHash);
+    }
+}
+
+void EndpointCardinality::merge(const EndpointCardinality& other)
+{
+    if (&other == this)
+    {
+        return;
+    }
+    std::unique_lock<std::mutex> first(lock, std::defer_lock);
+    std::unique_lock<std::mutex> second(other.lock, std::defer_lock);
+    std::lock(first, second);
+
+    for (const auto& pair : other.minutes)
+    {
+        Window* window = windowOf(pair.first);
+        if (window)
+        {
+            window->srcIps.merge(pair.second.srcIps);
+            window->dstIps.merge(pair.second.dstIps);
+            window->flows.merge(pair.second.flows);
+        }
+    }
+}
+
+void EndpointCardinality::reset()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    minutes.clear();
+}
+
+bool EndpointCardinality::query(long start, long end, DistinctEndpoints& result) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    Window                      merged(precision);
+    bool                        found = false;
+    for (auto it = minutes.lower_bound(start - 59); it != minutes.end() && it->first < end; ++it)
+    {
+        merged.srcIps.merge(it->second.srcIps);
+        merged.dstIps.merge(it->second.dstIps);
+        merged.flows.merge(it->second.flows);
+        found = true;
+    }
+
+    result.start   = alignMinute(start);
+    result.end     = alignMinute(end + 59);
+    result.src_ips = merged.srcIps.estimate();
+    result.dst_ips = merged.dstIps.estimate();
+    result.flows   = merged.flows.estimate();
+    return found;
+}
+
+void EndpointCardinality::perMinute(long start, long end,
+                                    std::vector<DistinctEndpoints>& result) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    result.clear();
+    for (auto it = minutes.lower_bound(start - 59); it != minutes.end() && it->first < end; ++it)
+    {
+        DistinctEndpoints minute;
+        minute.start   = it->first;
+        minute.end     = it->first + 60;
+        minute.src_ips = it->second.srcIps.estimate();
+        minute.dst_ips = it->second.dstIps.estimate();
+        minute.flows   = it->second.flows.estimate();
+        result.push_back(minute);
+    }
+}
+
+bool EndpointCardinality::save(FILE* file) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    uint32_t                    count = static_cast<uint32_t>(minutes.size());
+    if (!writeValue(file, count))
+    {
+        return false;
+    }
+    for (const auto& pair : minutes)
+    {
+        int64_t minute = pair.first;
+        bool    ok     = writeValue(file, minute) && pair.second.srcIps.save(file) &&
+                  pair.second.dstIps.save(file) && pair.second.flows.save(file);
+        if (!ok)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool EndpointCardinality::load(const unsigned char*& data, const unsigned char* end)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    minutes.clear();
+
+    uint32_t count;
+    if (!readValue(data, end, count))
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        // 按时间升序写出，windowOf在超出maxMinutes时丢弃最早的分钟
+        int64_t minute;
+        Window  window(precision);
+        bool    ok = readValue(data, end, minute) && window.srcIps.load(data, end) &&
+                  window.dstIps.load(data, end) && window.flows.load(data, end);
+        if (!ok)
+        {
+            minutes.clear();
+            return false;
+        }
+        Window* slot = windowOf(static_cast<long>(minute));
+        if (slot)
+        {
+            *slot = window;
+        }
+    }
+    return true;
+}
+
+LiveTrafficStats::LiveTrafficStats(size_t topN, size_t capacity)
+    : topN(topN), currentSecond(-1), secondPackets(0), secondBytes(0), totalPackets(0),
+      totalBytes(0), secondProtocols(capacity), protocols(capacity), published()
+{
+    for (int dim = 0; dim < DIM_COUNT; dim++)
+    {
+        talkers[dim] = SpaceSaving(capacity);
+    }
+    published.second = -1;
+}
+
+void LiveTrafficStats::startSecond(long second)
+{
+    if (currentSecond != -1)
+    {
+        publish();
+    }
+    currentSecond = second;
+    secondPackets = 0;
+    secondBytes   = 0;
+    secondProtocols.clear();
+}
+
+void LiveTrafficStats::add(const Packet& packet)
+{
+    long                        second = static_cast<long>(packet.time);
+    uint64_t                    bytes  = packet.len;
+    std::lock_guard<std::mutex> guard(lock);
+
+    // 乱序到达的旧数据包计入当前这一秒
+    if (second > currentSecond)
+    {
+        startSecond(second);
+    }
+
+    secondPackets++;
+    secondBytes += bytes;
+    totalPackets++;
+    totalBytes += bytes;
+    secondProtocols.add(packet.protocol, bytes);
+    protocols.add(packet.protocol, bytes);
+
+    if (!packet.src_ip.empty())
+    {
+        talkers[DIM_SRC_IP].add(packet.src_ip, bytes);
+        talkerBytes[DIM_SRC_IP].add(packet.src_ip, bytes);
+    }
+    if (!packet.dst_ip.empty())
+    {
+        talkers[DIM_DST_IP].add(packet.dst_ip, bytes);
+        talkerBytes[DIM_DST_IP].add(packet.dst_ip, bytes);
+    }
+
+    uint16_t ports[2] = {packet.src_port, packet.dst_port};
+    for (uint16_t port : ports)
+    {
+        if (port == 0)
+        {
+            continue;
+        }
+        char digits[8];
+        int  length = snprintf(digits, sizeof(digits), "%u", static_cast<unsigned>(port));
+        portKey.assign(digits, length);
+        talkers[DIM_PORT].add(portKey, bytes);
+        talkerBytes[DIM_PORT].add(portKey, bytes);
+    }
+}
+
+void LiveTrafficStats::advance(long second)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (currentSecond != -1 && second > currentSecond)
+    {
+        startSecond(second);
+    }
+}
+
+void LiveTrafficStats::flush()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (currentSecond != -1)
+    {
+        publish();
+    }
+}
+
+void LiveTrafficStats::publish()
+{
+    // 先生成到局部对象，持有publishLock时只做交换，不阻塞读取快照
+    LiveTrafficSnapshot next;
+    next.second        = currentSecond;
+    next.packets       = secondPackets;
+    next.bytes         = secondBytes;
+    next.total_packets = totalPackets;
+    next.total_bytes   = totalBytes;
+    secondProtocols.top(topN, next.protocols);
+    protocols.top(topN, next.total_protocols);
+    talkers[DIM_SRC_IP].top(topN, next.top_src_ips);
+    talkers[DIM_DST_IP].top(topN, next.top_dst_ips);
+    talkers[DIM_PORT].top(topN, next.top_ports);
+
+    std::lock_guard<std::mutex> guard(publishLock);
+    std::swap(published, next);
+}
+
+void LiveTrafficStats::reset()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    currentSecond = -1;
+    secondPackets = 0;
+    secondBytes   = 0;
+    totalPackets  = 0;
+    totalBytes    = 0;
+    secondProtocols.clear();
+    protocols.clear();
+    for (int dim = 0; dim < DIM_COUNT; dim++)
+    {
+        talkers[dim].clear();
+        talkerBytes[dim].clear();
+    }
+
+    std::lock_guard<std::mutex> publishGuard(publishLock);
+    published        = LiveTrafficSnapshot();
+    published.second = -1;
+}
+
+void LiveTrafficStats::snapshot(LiveTrafficSnapshot& snapshot) const
+{
+    std::lock_guard<std::mutex> guard(publishLock);
+    snapshot = published;
+}
+
+bool LiveTrafficStats::save(FILE* file) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    int64_t                     second = currentSecond;
+    bool ok = writeValue(file, second) && writeValue(file, secondPackets) &&
+              writeValue(file, secondBytes) && writeValue(file, totalPackets) &&
+              writeValue(file, totalBytes) && secondProtocols.save(file) && protocols.save(file);
+    for (int dim = 0; ok && dim < DIM_COUNT; dim++)
+    {
+        ok = talkers[dim].save(file) && talkerBytes[dim].save(file);
+    }
+    return ok;
+}
+
+bool LiveTrafficStats::load(const unsigned char*& data, const unsigned char* end)
+{
+    reset();
+
+    bool ok;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        int64_t                     second;
+        ok = readValue(data, end, second) && readValue(data, end, secondPackets) &&
+             readValue(data, end, secondBytes) && readValue(data, end, totalPackets) &&
+             readValue(data, end, totalBytes) && secondProtocols.load(data, end) &&
+             protocols.load(data, end);
+        for (int dim = 0; ok && dim < DIM_COUNT; dim++)
+        {
+            ok = talkers[dim].load(data, end) && talkerBytes[dim].load(data, end);
+        }
+        if (ok && second != -1)
+        {
+            currentSecond = static_cast<long>(second);
+            publish();
+        }
+    }
+
+    // 数据不完整时不保留读到一半的统计
+    if (!ok)
+    {
+        reset();
+    }
+    return ok;
+}
+
+uint64_t LiveTrafficStats::estimateBytes(Dimension dimension, const std::string& key) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return talkerBytes[dimension].estimate(key);
+}
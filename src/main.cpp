@@ -5,8 +5,11 @@
 #include <iostream>
 #include <map>
 #include <thread>
+#include <unistd.h>
 
+#include "analysisCache.hpp"
 #include "loguru.hpp"
+#include "packetIndexFile.hpp"
 #include "tsharkManager.hpp"
 #include "utils.hpp"
 
@@ -117,29 +120,62 @@ int main(int argc, char* argv[])
         return 1;
     }
 
-    std::string dbPath = dataDir + "/packets.db";
-    SQLiteUtil  sqliteUtil(dbPath);
+    std::string dbPath   = dataDir + "/packets.db";
+    std::string jsonFile = dataDir + "/packets.json";
+
+    // 以抓包文件的内容哈希查找分析缓存，命中时直接恢复数据库、JSON和索引文件
+    AnalysisCache                      analysisCache("cache");
+    std::map<std::string, std::string> artifacts = {
+        {"packets.db", dbPath},
+        {"packets.json", jsonFile},
+        {"capture.pcap.idx", PacketIndexFile::pathFor(dataPcapFile)},
+    };
+    std::string cacheKey;
+    bool        cacheHit = AnalysisCache::hashFile(dataPcapFile, cacheKey) &&
+                    analysisCache.fetch(cacheKey, artifacts);
+    if (cacheHit)
+    {
+        // 恢复的索引文件以当前抓包文件的修改时间重新校验
+        PacketIndexFile::restamp(dataPcapFile);
+        std::cout << "命中分析缓存(" << cacheKey << ")，跳过分析" << std::endl;
+    }
+    else
+    {
+        // 数据库只保存当前抓包文件的分析结果
+        std::remove(dbPath.c_str());
+        std::cout << "未命中分析缓存，开始分析" << std::endl;
+    }
+
+    SQLiteUtil sqliteUtil(dbPath);
+    bool       analysisOk = cacheHit;
 
     if (sqliteUtil.createPacketTable())
     {
         std::cout << "成功创建数据表" << std::endl;
 
-        // 解析PCAP文件到db
-        std::vector<std::shared_ptr<Packet>> packets;
-        if (tsharkManager.analysisFile(dataPcapFile, packets))
+        // 为info列建立全文索引，关键字查询不再需要全表扫描
+        if (!sqliteUtil.enableFullTextIndex())
         {
-            std::cout << "成功解析PCAP文件，共 " << packets.size() << " 个数据包" << std::endl;
+            std::cerr << "全文索引不可用，关键字查询将使用模糊匹配" << std::endl;
+        }
 
-            if (sqliteUtil.insertPacket(packets))
+        // 解析PCAP文件到db，数据包直接从tsharkManager的存储中写入数据库
+        if (!cacheHit && tsharkManager.analysisFile(dataPcapFile))
+        {
+            std::cout << "成功解析PCAP文件，共 " << tsharkManager.getPacketCount() << " 个数据包"
+                      << std::endl;
+
+            if (tsharkManager.storePackets(sqliteUtil))
             {
                 std::cout << "成功将数据包导入到数据库" << std::endl;
+                analysisOk = true;
             }
             else
             {
                 std::cerr << "导入数据包到数据库失败" << std::endl;
             }
         }
-        else
+        else if (!cacheHit)
         {
             std::cerr << "解析PCAP文件失败" << std::endl;
         }
@@ -149,127 +185,175 @@ int main(int argc, char* argv[])
         std::cerr << "创建数据表失败" << std::endl;
     }
 
-    // 将PCAP文件转换为XML
-    std::string xmlFile = dataDir + "/packets.xml";
-    if (tsharkManager.convertPcapToXml(dataPcapFile, xmlFile))
+    bool jsonReady = cacheHit;
+    if (!cacheHit)
     {
-        std::cout << "PCAP文件已成功转换为XML文件: " << xmlFile << std::endl;
+        // 将PCAP文件转换为XML
+        std::string xmlFile = dataDir + "/packets.xml";
+        if (tsharkManager.convertPcapToXml(dataPcapFile, xmlFile))
+        {
+            std::cout << "PCAP文件已成功转换为XML文件: " << xmlFile << std::endl;
 
-        // 将XML文件转换为JSON
-        std::string jsonFile = dataDir + "/packets.json";
-        if (tsharkManager.convertXmlToJson(xmlFile, jsonFile))
+            // 将XML文件转换为JSON
+            jsonReady = tsharkManager.convertXmlToJson(xmlFile, jsonFile);
+            if (!jsonReady)
+            {
+                std::cerr << "XML转JSON失败" << std::endl;
+            }
+        }
+        else
+        {
+            std::cerr << "PCAP转XML失败" << std::endl;
+        }
+
+        if (analysisOk && jsonReady && !cacheKey.empty() &&
+            analysisCache.store(cacheKey, artifacts))
         {
-            std::cout << "处理完成！" << std::endl;
+            std::cout << "分析结果已写入缓存(" << cacheKey << ")" << std::endl;
+        }
+    }
+
+    if (jsonReady)
+    {
+        std::cout << "处理完成！" << std::endl;
 
-            char queryChoice;
-            std::cout << "是否要查询数据包？(y/n): ";
-            std::cin >> queryChoice;
+        char queryChoice;
+        std::cout << "是否要查询数据包？(y/n): ";
+        std::cin >> queryChoice;
 
-            if (queryChoice == 'y' || queryChoice == 'Y')
+        if (queryChoice == 'y' || queryChoice == 'Y')
+        {
+            while (true)
             {
-                while (true)
+                std::string macAddr, ipAddr, port, location, protocol, keyword;
+                std::cout << "\n请输入查询条件（直接回车表示不使用该条件）：" << std::endl;
+
+                std::cout << "MAC地址（支持模糊匹配，如: 00:11:22:*）: ";
+                std::cin.ignore();
+                std::getline(std::cin, macAddr);
+
+                std::cout << "IP地址（支持模糊匹配，如: 192.168.*）: ";
+                std::getline(std::cin, ipAddr);
+
+                std::cout << "端口（支持模糊匹配，如: 80*）: ";
+                std::getline(std::cin, port);
+
+                std::cout << "归属地（支持模糊匹配，如: 深圳*）: ";
+                std::getline(std::cin, location);
+
+                std::cout << "协议（支持模糊匹配，如: TCP）: ";
+                std::getline(std::cin, protocol);
+
+                std::cout << "信息关键字（多个关键字用空格分隔，如: example.com GET）: ";
+                std::getline(std::cin, keyword);
+
+                // 构建查询条件
+                std::map<std::string, std::string> conditions;
+                if (!macAddr.empty())
+                    conditions["mac_address"] = macAddr;
+                if (!ipAddr.empty())
+                    conditions["ip_address"] = ipAddr;
+                if (!port.empty())
+                    conditions["port"] = port;
+                if (!location.empty())
+                    conditions["location"] = location;
+                if (!protocol.empty())
+                    conditions["protocol"] = protocol;
+                if (!keyword.empty())
+                    conditions["keyword"] = keyword;
+
+                if (conditions.empty())
+                {
+                    std::cout << "未指定任何查询条件！" << std::endl;
+                }
+                else
                 {
-                    std::string macAddr, ipAddr, port, location;
-                    std::cout << "\n请输入查询条件（直接回车表示不使用该条件）：" << std::endl;
-
-                    std::cout << "MAC地址（支持模糊匹配，如: 00:11:22:*）: ";
-                    std::cin.ignore();
-                    std::getline(std::cin, macAddr);
-
-                    std::cout << "IP地址（支持模糊匹配，如: 192.168.*）: ";
-                    std::getline(std::cin, ipAddr);
-
-                    std::cout << "端口（支持模糊匹配，如: 80*）: ";
-                    std::getline(std::cin, port);
-
-                    std::cout << "归属地（支持模糊匹配，如: 深圳*）: ";
-                    std::getline(std::cin, location);
-
-                    // 构建查询条件
-                    std::map<std::string, std::string> conditions;
-                    if (!macAddr.empty())
-                        conditions["mac_address"] = macAddr;
-                    if (!ipAddr.empty())
-                        conditions["ip_address"] = ipAddr;
-                    if (!port.empty())
-                        conditions["port"] = port;
-                    if (!location.empty())
-                        conditions["location"] = location;
-
-                    if (conditions.empty())
+                    // 按页流式输出查询结果，每页50条
+                    const uint32_t pageSize = 50;
+                    uint32_t       cursor   = 0;
+                    bool           queryOk  = true;
+                    std::cout << "\n查询结果：" << std::endl;
+                    while (true)
                     {
-                        std::cout << "未指定任何查询条件！" << std::endl;
+                        uint32_t nextCursor = 0;
+                        std::cout << std::flush;
+                        if (!sqliteUtil.streamPackets(conditions, cursor, pageSize,
+                                                      STDOUT_FILENO, nextCursor))
+                        {
+                            queryOk = false;
+                            break;
+                        }
+                        std::cout << std::endl;
+
+                        if (nextCursor == 0)
+                        {
+                            break;
+                        }
+
+                        char nextChoice;
+                        std::cout << "\n是否显示下一页？(y/n): ";
+                        std::cin >> nextChoice;
+                        if (nextChoice != 'y' && nextChoice != 'Y')
+                        {
+                            break;
+                        }
+                        cursor = nextCursor;
                     }
-                    else
+
+                    if (queryOk)
                     {
-                        // 执行查询并输出结果
-                        std::string jsonResult;
-                        if (sqliteUtil.queryPackets(conditions, jsonResult))
+                        char saveChoice;
+                        std::cout << "\n是否保存查询结果到文件？(y/n): ";
+                        std::cin >> saveChoice;
+
+                        if (saveChoice == 'y' || saveChoice == 'Y')
                         {
-                            std::cout << "\n查询结果：" << std::endl;
-                            std::cout << jsonResult << std::endl;
+                            // 生成默认文件名（使用时间戳）
+                            std::string timestamp       = CommonUtil::get_timestamp();
+                            std::string defaultFileName = "data/query_" + timestamp + ".json";
 
-                            char saveChoice;
-                            std::cout << "\n是否保存查询结果到文件？(y/n): ";
-                            std::cin >> saveChoice;
+                            std::cout << "默认保存到文件: " << defaultFileName << std::endl;
+                            std::cout << "是否使用默认文件名？(y/n): ";
+                            char useDefault;
+                            std::cin >> useDefault;
 
-                            if (saveChoice == 'y' || saveChoice == 'Y')
+                            std::string saveFilePath;
+                            if (useDefault == 'y' || useDefault == 'Y')
                             {
-                                // 生成默认文件名（使用时间戳）
-                                std::string timestamp       = CommonUtil::get_timestamp();
-                                std::string defaultFileName = "data/query_" + timestamp + ".json";
-
-                                std::cout << "默认保存到文件: " << defaultFileName << std::endl;
-                                std::cout << "是否使用默认文件名？(y/n): ";
-                                char useDefault;
-                                std::cin >> useDefault;
-
-                                std::string saveFilePath;
-                                if (useDefault == 'y' || useDefault == 'Y')
-                                {
-                                    saveFilePath = defaultFileName;
-                                }
-                                else
-                                {
-                                    std::cout << "请输入保存文件路径: ";
-                                    std::cin.ignore();
-                                    std::getline(std::cin, saveFilePath);
-                                }
-
-                                if (sqliteUtil.saveQueryResultToFile(jsonResult, saveFilePath))
-                                {
-                                    std::cout << "查询结果已保存到: " << saveFilePath << std::endl;
-                                }
-                                else
-                                {
-                                    std::cerr << "保存查询结果失败！" << std::endl;
-                                }
+                                saveFilePath = defaultFileName;
+                            }
+                            else
+                            {
+                                std::cout << "请输入保存文件路径: ";
+                                std::cin.ignore();
+                                std::getline(std::cin, saveFilePath);
+                            }
+
+                            if (sqliteUtil.exportQueryResult(conditions, saveFilePath))
+                            {
+                                std::cout << "查询结果已保存到: " << saveFilePath << std::endl;
+                            }
+                            else
+                            {
+                                std::cerr << "保存查询结果失败！" << std::endl;
                             }
-                        }
-                        else
-                        {
-                            std::cerr << "查询失败！" << std::endl;
                         }
                     }
-
-                    char continueQuery;
-                    std::cout << "\n是否继续查询？(y/n): ";
-                    std::cin >> continueQuery;
-                    if (continueQuery != 'y' && continueQuery != 'Y')
+                    else
                     {
-                        break;
+                        std::cerr << "查询失败！" << std::endl;
                     }
                 }
+
+                char continueQuery;
+                std::cout << "\n是否继续查询？(y/n): ";
+                std::cin >> continueQuery;
+                if (continueQuery != 'y' && continueQuery != 'Y')
+                {
+                    break;
+                }
             }
         }
-        else
-        {
-            std::cerr << "XML转JSON失败" << std::endl;
-        }
-    }
-    else
-    {
-        std::cerr << "PCAP转XML失败" << std::endl;
     }
 
     return 0;
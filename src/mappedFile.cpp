@@ -0,0 +1,70 @@
+#include "mappedFile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "loguru.hpp"
+
+MappedFile::MappedFile() : base(nullptr), length(0) {}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        LOG_F(ERROR, "Failed to open %s", path.c_str());
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        LOG_F(ERROR, "Failed to stat %s", path.c_str());
+        ::close(fd);
+        return false;
+    }
+
+    // 空文件无法映射，按长度为0处理
+    if (st.st_size > 0)
+    {
+        void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED)
+        {
+            LOG_F(ERROR, "Failed to mmap %s", path.c_str());
+            ::close(fd);
+            return false;
+        }
+        base   = static_cast<const unsigned char*>(addr);
+        length = st.st_size;
+    }
+    ::close(fd);
+
+    filePath = path;
+    return true;
+}
+
+bool MappedFile::remap()
+{
+    std::string path = filePath;
+    return !path.empty() && open(path);
+}
+
+void MappedFile::close()
+{
+    if (base)
+    {
+        munmap(const_cast<unsigned char*>(base), length);
+    }
+    base   = nullptr;
+    length = 0;
+    filePath.clear();
+}
@@ -0,0 +1,288 @@
+#include "packetDecoder.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+// 链路层类型
+const uint16_t kLinkNull     = 0;
+const uint16_t kLinkEthernet = 1;
+const uint16_t kLinkRaw12    = 12; // 部分系统上的LINKTYPE_RAW
+const uint16_t kLinkRaw14    = 14;
+const uint16_t kLinkRaw      = 101;
+const uint16_t kLinkLoop     = 108;
+const uint16_t kLinkSll      = 113;
+const uint16_t kLinkIpv4     = 228;
+const uint16_t kLinkIpv6     = 229;
+const uint16_t kLinkSll2     = 276;
+
+const uint16_t kEtherIpv4  = 0x0800;
+const uint16_t kEtherIpv6  = 0x86DD;
+const uint16_t kEtherVlan  = 0x8100;
+const uint16_t kEtherQinQ  = 0x88A8;
+const uint16_t kEtherQinQ1 = 0x9100;
+
+const uint8_t kProtoTcp     = 6;
+const uint8_t kProtoUdp     = 17;
+const uint8_t kIpv6HopByHop = 0;
+const uint8_t kIpv6Routing  = 43;
+const uint8_t kIpv6Fragment = 44;
+const uint8_t kIpv6Auth     = 51;
+const uint8_t kIpv6DestOpts = 60;
+
+inline uint16_t be16(const unsigned char* p)
+{
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline uint32_t be32(const unsigned char* p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+// BSD loopback的地址族：NULL按抓包主机字节序，LOOP按网络字节序，两种都尝试
+int loopbackVersion(const unsigned char* p)
+{
+    uint32_t big    = be32(p);
+    uint32_t little = (static_cast<uint32_t>(p[3]) << 24) | (static_cast<uint32_t>(p[2]) << 16) |
+                      (static_cast<uint32_t>(p[1]) << 8) | p[0];
+    for (uint32_t family : {big, little})
+    {
+        if (family == 2)
+        {
+            return 4;
+        }
+        // AF_INET6在各BSD系统上取值不同
+        if (family == 24 || family == 28 || family == 30)
+        {
+            return 6;
+        }
+    }
+    return 0;
+}
+} // namespace
+
+bool PacketDecoder::decode(uint16_t linkType, const unsigned char* data, uint32_t length,
+                           DecodedPacket& packet)
+{
+    memset(&packet, 0, sizeof(packet));
+    if (!data)
+    {
+        return false;
+    }
+
+    uint32_t offset  = 0;
+    int      version = 0;
+    uint16_t etherType;
+    switch (linkType)
+    {
+    case kLinkEthernet:
+        if (length < 14)
+        {
+            return false;
+        }
+        etherType = be16(data + 12);
+        offset    = 14;
+        while (etherType == kEtherVlan || etherType == kEtherQinQ || etherType == kEtherQinQ1)
+        {
+            if (length - offset < 4)
+            {
+                return false;
+            }
+            etherType = be16(data + offset + 2);
+            offset += 4;
+        }
+        version = etherType == kEtherIpv4 ? 4 : etherType == kEtherIpv6 ? 6 : 0;
+        break;
+    case kLinkSll:
+        if (length < 16)
+        {
+            return false;
+        }
+        etherType = be16(data + 14);
+        offset    = 16;
+        version   = etherType == kEtherIpv4 ? 4 : etherType == kEtherIpv6 ? 6 : 0;
+        break;
+    case kLinkSll2:
+        if (length < 20)
+        {
+            return false;
+        }
+        etherType = be16(data);
+        offset    = 20;
+        version   = etherType == kEtherIpv4 ? 4 : etherType == kEtherIpv6 ? 6 : 0;
+        break;
+    case kLinkNull:
+    case kLinkLoop:
+        if (length < 4)
+        {
+            return false;
+        }
+        offset  = 4;
+        version = loopbackVersion(data);
+        break;
+    case kLinkRaw:
+    case kLinkRaw12:
+    case kLinkRaw14:
+        version = length > 0 ? data[0] >> 4 : 0;
+        break;
+    case kLinkIpv4:
+        version = 4;
+        break;
+    case kLinkIpv6:
+        version = 6;
+        break;
+    default:
+        return false;
+    }
+
+    if (version == 4)
+    {
+        return decodeIpv4(data + offset, length - offset, packet);
+    }
+    if (version == 6)
+    {
+        return decodeIpv6(data + offset, length - offset, packet);
+    }
+    return false;
+}
+
+bool PacketDecoder::decodeIpv4(const unsigned char* data, uint32_t length, DecodedPacket& packet)
+{
+    if (length < 20 || (data[0] >> 4) != 4)
+    {
+        return false;
+    }
+    uint32_t headerLength = (data[0] & 0x0F) * 4u;
+    uint32_t totalLength  = be16(data + 2);
+    if (headerLength < 20 || headerLength > length)
+    {
+        return false;
+    }
+    // 总长度为0时通常是网卡分段卸载，按捕获长度处理
+    uint32_t end = totalLength == 0 ? length : std::min(totalLength, length);
+    if (end < headerLength)
+    {
+        return false;
+    }
+
+    packet.src_ip.bytes[10] = packet.src_ip.bytes[11] = 0xFF;
+    packet.dst_ip.bytes[10] = packet.dst_ip.bytes[11] = 0xFF;
+    memcpy(packet.src_ip.bytes + 12, data + 12, 4);
+    memcpy(packet.dst_ip.bytes + 12, data + 16, 4);
+    packet.ip_proto = data[9];
+
+    uint16_t fragment = be16(data + 6);
+    packet.fragment   = (fragment & 0x2000) != 0 || (fragment & 0x1FFF) != 0;
+    if (!packet.fragment)
+    {
+        decodeTransport(data + headerLength, end - headerLength, packet);
+    }
+    return true;
+}
+
+bool PacketDecoder::decodeIpv6(const unsigned char* data, uint32_t length, DecodedPacket& packet)
+{
+    if (length < 40 || (data[0] >> 4) != 6)
+    {
+        return false;
+    }
+    // 负载长度为0时是超大包或分段卸载，按捕获长度处理
+    uint32_t payloadLength = be16(data + 4);
+    uint32_t end = payloadLength == 0 ? length : std::min(40 + payloadLength, length);
+
+    memcpy(packet.src_ip.bytes, data + 8, 16);
+    memcpy(packet.dst_ip.bytes, data + 24, 16);
+
+    // 跳过扩展头
+    uint8_t  next   = data[6];
+    uint32_t offset = 40;
+    while (true)
+    {
+        uint32_t headerLength;
+        if (next == kIpv6HopByHop || next == kIpv6Routing || next == kIpv6DestOpts)
+        {
+            if (end - offset < 2)
+            {
+                break;
+            }
+            headerLength = (data[offset + 1] + 1u) * 8;
+        }
+        else if (next == kIpv6Fragment)
+        {
+            if (end - offset < 8)
+            {
+                break;
+            }
+            uint16_t fragment = be16(data + offset + 2);
+            packet.fragment   = packet.fragment || (fragment & 0xFFF8) != 0 || (fragment & 1) != 0;
+            headerLength      = 8;
+        }
+        else if (next == kIpv6Auth)
+        {
+            if (end - offset < 2)
+            {
+                break;
+            }
+            headerLength = (data[offset + 1] + 2u) * 4;
+        }
+        else
+        {
+            break;
+        }
+
+        if (end - offset < headerLength)
+        {
+            break;
+        }
+        next = data[offset];
+        offset += headerLength;
+    }
+
+    packet.ip_proto = next;
+    if (!packet.fragment)
+    {
+        decodeTransport(data + offset, end - offset, packet);
+    }
+    return true;
+}
+
+void PacketDecoder::decodeTransport(const unsigned char* data, uint32_t length,
+                                    DecodedPacket& packet)
+{
+    if (packet.ip_proto == kProtoTcp)
+    {
+        if (length < 20)
+        {
+            return;
+        }
+        packet.src_port   = be16(data);
+        packet.dst_port   = be16(data + 2);
+        packet.tcp_seq    = be32(data + 4);
+        packet.tcp_ack    = be32(data + 8);
+        packet.tcp_flags  = data[13];
+        packet.tcp_window = be16(data + 14);
+
+        // 头部长度异常时没有负载
+        uint32_t headerLength = (data[12] >> 4) * 4u;
+        if (headerLength < 20 || headerLength > length)
+        {
+            return;
+        }
+        packet.payload        = data + headerLength;
+        packet.payload_length = length - headerLength;
+    }
+    else if (packet.ip_proto == kProtoUdp)
+    {
+        if (length < 8)
+        {
+            return;
+        }
+        packet.src_port       = be16(data);
+        packet.dst_port       = be16(data + 2);
+        packet.payload        = data + 8;
+        packet.payload_length = length - 8;
+    }
+}
@@ -0,0 +1,389 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+#include "packetFilter.hpp"
+
+namespace
+{
+    // 与buildFuzzyQuery一致，用户输入中的*视为%
+    std::string toLikePattern(const std::string& input)
+    {
+        std::string pattern = input;
+        std::replace(pattern.begin(), pattern.end(), '*', '%');
+        return pattern;
+    }
+
+    bool hasWildcard(const std::string& pattern)
+    {
+        return pattern.find_first_of("%_") != std::string::npos;
+    }
+
+    // 解析"a.b.c.%"形式的IPv4按字节前缀，成功时返回前缀字节数
+    int parseIpv4Prefix(const std::string& pattern, uint8_t prefix[4])
+    {
+        if (pattern.size() < 3 || pattern.compare(pattern.size() - 2, 2, ".%") != 0)
+        {
+            return 0;
+        }
+
+        int      count = 0;
+        uint32_t value = 0;
+        bool     digit = false;
+        for (size_t i = 0; i + 1 < pattern.size(); i++)
+        {
+            char c = pattern[i];
+            if (c >= '0' && c <= '9')
+            {
+                value = value * 10 + (c - '0');
+                digit = true;
+                if (value > 255)
+                    return 0;
+            }
+            else if (c == '.' && digit && count < 3)
+            {
+                prefix[count++] = static_cast<uint8_t>(value);
+                value           = 0;
+                digit           = false;
+            }
+            else
+            {
+                return 0;
+            }
+        }
+        return count;
+    }
+
+    // 解析"xx:xx:%"形式的MAC按字节前缀，成功时返回前缀字节数
+    int parseMacPrefix(const std::string& pattern, uint64_t& prefix)
+    {
+        if (pattern.size() < 4 || pattern.compare(pattern.size() - 2, 2, ":%") != 0 ||
+            (pattern.size() - 1) % 3 != 0)
+        {
+            return 0;
+        }
+
+        int count = static_cast<int>((pattern.size() - 1) / 3);
+        if (count > 5)
+        {
+            return 0;
+        }
+
+        // 补齐成完整MAC后复用parseMac
+        std::string full = pattern.substr(0, pattern.size() - 1);
+        for (int i = count; i < 6; i++)
+        {
+            full += i == 5 ? "00" : "00:";
+        }
+        uint64_t mac;
+        if (!NetUtil::parseMac(full, mac))
+        {
+            return 0;
+        }
+        prefix = mac;
+        return count;
+    }
+
+    // 只对字典中的不同取值做一次匹配，扫描时按ID查表
+    std::vector<uint8_t> matchDict(const std::string& pattern, const StringDict& dict)
+    {
+        std::vector<uint8_t> table(dict.size(), 0);
+        for (uint32_t id = 0; id < dict.size(); id++)
+        {
+            const std::string& value = dict.lookup(id);
+            table[id] = CommonUtil::likeMatch(pattern, value.c_str(), value.size()) ? 1 : 0;
+        }
+        return table;
+    }
+
+    // IP地址的高低两个64位半部分，用作匹配结果缓存的键
+    typedef std::pair<uint64_t, uint64_t> IpKey;
+
+    struct IpKeyHash
+    {
+        size_t operator()(const IpKey& key) const
+        {
+            // IPv4映射地址的高半部分都相同，区分度来自低半部分
+            return static_cast<size_t>(key.second * 0x9E3779B97F4A7C15ULL ^ key.first);
+        }
+    };
+} // namespace
+
+PacketFilter::PacketFilter(const PacketStore& store) : store(store) {}
+
+template <typename Match>
+void PacketFilter::scan(Match match, Selection& sel, bool first) const
+{
+    // 无分支地写入下标，只有匹配时游标才前进
+    size_t n = 0;
+    if (first)
+    {
+        uint32_t rows = static_cast<uint32_t>(store.size());
+        sel.resize(rows);
+        for (uint32_t i = 0; i < rows; i++)
+        {
+            sel[n] = i;
+            n += match(store.at(i)) ? 1 : 0;
+        }
+    }
+    else
+    {
+        for (size_t k = 0; k < sel.size(); k++)
+        {
+            uint32_t i = sel[k];
+            sel[n]     = i;
+            n += match(store.at(i)) ? 1 : 0;
+        }
+    }
+    sel.resize(n);
+}
+
+void PacketFilter::filterTime(double startTime, double endTime, Selection& sel, bool first) const
+{
+    scan(
+        [startTime, endTime](const CompactPacket& r) {
+            return r.time >= startTime && r.time < endTime;
+        },
+        sel, first);
+}
+
+void PacketFilter::filterPort(const std::string& pattern, Selection& sel, bool first) const
+{
+    // 预先计算65536个端口是否匹配，扫描时只需查表
+    std::vector<uint8_t> table(65536, 0);
+    if (!hasWildcard(pattern))
+    {
+        uint64_t value;
+        if (CommonUtil::parseUint64(pattern.data(), pattern.size(), value) && value < table.size())
+        {
+            table[value] = 1;
+        }
+    }
+    else
+    {
+        for (uint32_t port = 0; port < table.size(); port++)
+        {
+            std::string text = std::to_string(port);
+            table[port]      = CommonUtil::likeMatch(pattern, text.c_str(), text.size()) ? 1 : 0;
+        }
+    }
+
+    const uint8_t* tbl = table.data();
+    scan([tbl](const CompactPacket& r) { return (tbl[r.src_port] | tbl[r.dst_port]) != 0; }, sel,
+         first);
+}
+
+void PacketFilter::filterProtocol(const std::string& pattern, Selection& sel, bool first) const
+{
+    std::vector<uint8_t> table = matchDict(pattern, store.protocols());
+    const uint8_t*       tbl   = table.data();
+    scan([tbl](const CompactPacket& r) { return tbl[r.protocol_id] != 0; }, sel, first);
+}
+
+void PacketFilter::filterLocation(const std::string& pattern, Selection& sel, bool first) const
+{
+    std::vector<uint8_t> table = matchDict(pattern, store.locations());
+    const uint8_t*       tbl   = table.data();
+    scan(
+        [tbl](const CompactPacket& r) {
+            return (tbl[r.src_location_id] | tbl[r.dst_location_id]) != 0;
+        },
+        sel, first);
+}
+
+void PacketFilter::filterIp(const std::string& pattern, Selection& sel, bool first) const
+{
+    // 精确地址：直接比较16字节
+    if (!hasWildcard(pattern))
+    {
+        IpAddress target;
+        if (!NetUtil::parseIp(pattern, target))
+        {
+            sel.clear();
+            return;
+        }
+        scan(
+            [&target](const CompactPacket& r) {
+                return r.src_ip == target || r.dst_ip == target;
+            },
+            sel, first);
+        return;
+    }
+
+    // IPv4按字节前缀：比较映射前缀和前几个字节
+    uint8_t prefix[16] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF};
+    int     count      = parseIpv4Prefix(pattern, prefix + 12);
+    if (count > 0)
+    {
+        size_t prefixLen = 12 + count;
+        scan(
+            [&prefix, prefixLen](const CompactPacket& r) {
+                return memcmp(r.src_ip.bytes, prefix, prefixLen) == 0 ||
+                       memcmp(r.dst_ip.bytes, prefix, prefixLen) == 0;
+            },
+            sel, first);
+        return;
+    }
+
+    // 其他模式：每个不同地址只做一次文本匹配，按地址的两个64位半部分查找，不分配内存
+    std::unordered_map<IpKey, bool, IpKeyHash> memo;
+    auto matchIp = [&memo, &pattern](const IpAddress& ip) {
+        IpKey key;
+        memcpy(&key.first, ip.bytes, sizeof(key.first));
+        memcpy(&key.second, ip.bytes + sizeof(key.first), sizeof(key.second));
+        auto it = memo.find(key);
+        if (it != memo.end())
+        {
+            return it->second;
+        }
+        std::string text    = NetUtil::formatIp(ip);
+        bool        matched = CommonUtil::likeMatch(pattern, text.c_str(), text.size());
+        memo[key]           = matched;
+        return matched;
+    };
+    scan([&matchIp](const CompactPacket& r) { return matchIp(r.src_ip) || matchIp(r.dst_ip); },
+         sel, first);
+}
+
+void PacketFilter::filterMac(const std::string& pattern, Selection& sel, bool first) const
+{
+    if (!hasWildcard(pattern))
+    {
+        uint64_t target;
+        if (!NetUtil::parseMac(pattern, target))
+        {
+            sel.clear();
+            return;
+        }
+        scan(
+            [target](const CompactPacket& r) {
+                return r.src_mac == target || r.dst_mac == target;
+            },
+            sel, first);
+        return;
+    }
+
+    uint64_t prefix = 0;
+    int      count  = parseMacPrefix(pattern, prefix);
+    if (count > 0)
+    {
+        uint64_t mask = (0xFFFFFFFFFFFFULL << (8 * (6 - count))) & 0xFFFFFFFFFFFFULL;
+        prefix &= mask;
+        // kInvalidMac的高16位非零，不会与任何前缀相等
+        auto matchPrefix = [mask, prefix](uint64_t mac) {
+            return (mac & ~0xFFFFFFFFFFFFULL) == 0 && (mac & mask) == prefix;
+        };
+        scan([&matchPrefix](const CompactPacket& r) {
+            return matchPrefix(r.src_mac) || matchPrefix(r.dst_mac);
+        }, sel, first);
+        return;
+    }
+
+    std::unordered_map<uint64_t, bool> memo;
+    auto matchMac = [&memo, &pattern](uint64_t mac) {
+        auto it = memo.find(mac);
+        if (it != memo.end())
+        {
+            return it->second;
+        }
+        std::string text    = NetUtil::formatMac(mac);
+        bool        matched = CommonUtil::likeMatch(pattern, text.c_str(), text.size());
+        memo[mac]           = matched;
+        return matched;
+    };
+    scan([&matchMac](const CompactPacket& r) { return matchMac(r.src_mac) || matchMac(r.dst_mac); },
+         sel, first);
+}
+
+void PacketFilter::filterInfo(const std::string& pattern, Selection& sel, bool first) const
+{
+    const PacketStore& packets = store;
+    scan(
+        [&packets, &pattern](const CompactPacket& r) {
+            return CommonUtil::likeMatch(pattern, packets.info(r), r.info_length);
+        },
+        sel, first);
+}
+
+bool PacketFilter::filter(const std::map<std::string, std::string>& conditions,
+                          std::vector<uint32_t>&                    indexes) const
+{
+    indexes.clear();
+
+    // 与buildFuzzyQuery相同的严格解析，不是完整数字的时间条件被拒绝
+    double      startTime = -INFINITY;
+    double      endTime   = INFINITY;
+    const char* names[]   = {"start_time", "end_time"};
+    double*     values[]  = {&startTime, &endTime};
+    for (int i = 0; i < 2; i++)
+    {
+        auto it = conditions.find(names[i]);
+        if (it != conditions.end() && !it->second.empty() &&
+            !CommonUtil::parseDouble(it->second, *values[i]))
+        {
+            return false;
+        }
+    }
+
+    Selection sel;
+    bool      first = true;
+
+    // 先执行代价低、选择性高的条件，后续条件只扫描剩余的行
+    if (startTime != -INFINITY || endTime != INFINITY)
+    {
+        filterTime(startTime, endTime, sel, first);
+        first = false;
+    }
+
+    const char* order[] = {"protocol", "port", "location", "ip_address", "mac_address", "keyword"};
+    for (const char* key : order)
+    {
+        auto it = conditions.find(key);
+        if (it == conditions.end())
+        {
+            continue;
+        }
+
+        std::string pattern = toLikePattern(it->second);
+        std::string name    = key;
+        if (name == "protocol")
+        {
+            filterProtocol(pattern, sel, first);
+        }
+        else if (name == "port")
+        {
+            filterPort(pattern, sel, first);
+        }
+        else if (name == "location")
+        {
+            if (pattern.find('%') == std::string::npos)
+            {
+                pattern = "%" + pattern + "%";
+            }
+            filterLocation(pattern, sel, first);
+        }
+        else if (name == "ip_address")
+        {
+            filterIp(pattern, sel, first);
+        }
+        else if (name == "mac_address")
+        {
+            filterMac(pattern, sel, first);
+        }
+        else if (name == "keyword")
+        {
+            filterInfo("%" + pattern + "%", sel, first);
+        }
+        first = false;
+    }
+
+    if (first)
+    {
+        // 没有任何条件时返回全部数据包
+        scan([](const CompactPacket&) { return true; }, sel, first);
+    }
+    indexes.swap(sel);
+    return true;
+}
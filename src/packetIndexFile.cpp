@@ -0,0 +1,165 @@
+#include "packetIndexFile.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "loguru.hpp"
+#include "mappedFile.hpp"
+#include "utils.hpp"
+
+namespace
+{
+const char     kIndexMagic[8] = {'E', 'T', 'S', 'K', 'I', 'D', 'X', '\0'};
+const uint32_t kIndexVersion  = 6;
+// 参与哈希的首尾内容大小
+const uint64_t kSampleSize = 1 << 20;
+} // namespace
+
+std::string PacketIndexFile::pathFor(const std::string& capturePath)
+{
+    return capturePath + ".idx";
+}
+
+bool PacketIndexFile::fingerprint(const std::string& capturePath, Header& header)
+{
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kIndexMagic, sizeof(header.magic));
+    header.version    = kIndexVersion;
+    header.recordSize = sizeof(CompactPacket);
+
+    struct stat st;
+    if (stat(capturePath.c_str(), &st) != 0)
+    {
+        return false;
+    }
+    header.fileSize  = st.st_size;
+    header.mtimeSec  = st.st_mtim.tv_sec;
+    header.mtimeNsec = st.st_mtim.tv_nsec;
+
+    MappedFile file;
+    if (!file.open(capturePath))
+    {
+        return false;
+    }
+    uint64_t headSize = std::min<uint64_t>(file.size(), kSampleSize);
+    uint64_t tailSize = std::min<uint64_t>(file.size() - headSize, kSampleSize);
+    header.sampleHash = HashUtil::xxh64(file.data(), headSize, file.size());
+    header.sampleHash =
+        HashUtil::xxh64(file.data() + file.size() - tailSize, tailSize, header.sampleHash);
+    return true;
+}
+
+bool PacketIndexFile::save(const std::string& capturePath, const PacketStore& store,
+                           const TcpMetrics* metrics, const LiveTrafficStats* liveStats,
+                           const EndpointCardinality* endpoints)
+{
+    Header header;
+    if (!fingerprint(capturePath, header))
+    {
+        LOG_F(ERROR, "Failed to fingerprint %s", capturePath.c_str());
+        return false;
+    }
+
+    std::string indexPath = pathFor(capturePath);
+    std::string tmpPath   = indexPath + ".tmp";
+    FILE*       file      = fopen(tmpPath.c_str(), "wb");
+    if (!file)
+    {
+        LOG_F(ERROR, "Failed to create %s", tmpPath.c_str());
+        return false;
+    }
+
+    TcpMetrics          emptyMetrics;
+    LiveTrafficStats    emptyStats;
+    EndpointCardinality emptyEndpoints;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && store.save(file) &&
+              (metrics ? metrics : &emptyMetrics)->save(file) &&
+              (liveStats ? liveStats : &emptyStats)->save(file) &&
+              (endpoints ? endpoints : &emptyEndpoints)->save(file);
+    ok      = fclose(file) == 0 && ok;
+    if (!ok || rename(tmpPath.c_str(), indexPath.c_str()) != 0)
+    {
+        LOG_F(ERROR, "Failed to write %s", indexPath.c_str());
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+
+    LOG_F(INFO, "Packet index saved: %s, %zu packets", indexPath.c_str(), store.size());
+    return true;
+}
+
+bool PacketIndexFile::load(const std::string& capturePath, PacketStore& store,
+                           TcpMetrics* metrics, LiveTrafficStats* liveStats,
+                           EndpointCardinality* endpoints)
+{
+    MappedFile indexFile;
+    if (access(pathFor(capturePath).c_str(), R_OK) != 0 || !indexFile.open(pathFor(capturePath)))
+    {
+        return false;
+    }
+
+    Header expected;
+    if (indexFile.size() < sizeof(Header) || !fingerprint(capturePath, expected))
+    {
+        return false;
+    }
+    if (memcmp(indexFile.data(), &expected, sizeof(Header)) != 0)
+    {
+        LOG_F(INFO, "Packet index for %s is stale", capturePath.c_str());
+        return false;
+    }
+
+    const unsigned char* data = indexFile.data() + sizeof(Header);
+    const unsigned char* end  = indexFile.data() + indexFile.size();
+    TcpMetrics          ignoredMetrics;
+    LiveTrafficStats    ignoredStats;
+    EndpointCardinality ignoredEndpoints;
+    if (!store.load(data, end) || !(metrics ? metrics : &ignoredMetrics)->load(data, end) ||
+        !(liveStats ? liveStats : &ignoredStats)->load(data, end) ||
+        !(endpoints ? endpoints : &ignoredEndpoints)->load(data, end) || data != end)
+    {
+        LOG_F(ERROR, "Packet index for %s is corrupted", capturePath.c_str());
+        store.clear();
+        if (metrics)
+        {
+            metrics->clear();
+        }
+        if (liveStats)
+        {
+            liveStats->reset();
+        }
+        if (endpoints)
+        {
+            endpoints->reset();
+        }
+        return false;
+    }
+    return true;
+}
+
+bool PacketIndexFile::restamp(const std::string& capturePath)
+{
+    Header current;
+    if (!fingerprint(capturePath, current))
+    {
+        return false;
+    }
+
+    FILE* file = fopen(pathFor(capturePath).c_str(), "r+b");
+    if (!file)
+    {
+        return false;
+    }
+
+    // 只更新版本一致的索引
+    Header header;
+    bool   ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, current.magic, sizeof(header.magic)) == 0 &&
+              header.version == current.version && header.recordSize == current.recordSize;
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&current, sizeof(current), 1, file) == 1;
+    ok = fclose(file) == 0 && ok;
+    return ok;
+}
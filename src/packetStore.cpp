@@ -0,0 +1,434 @@
+#include "packetStore.hpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cstring>
+
+namespace
+{
+// 解析IP地址，返回二进制形式能否原样还原出文本，不产生堆分配
+bool storeIp(const std::string& text, IpAddress& ip)
+{
+    if (!NetUtil::parseIp(text, ip))
+    {
+        // tshark对隧道报文可能输出多个以逗号分隔的地址，二进制形式保存第一个，供过滤使用
+        size_t comma = text.find(',');
+        if (comma != std::string::npos)
+        {
+            NetUtil::parseIp(text.substr(0, comma), ip);
+        }
+        return text.empty();
+    }
+
+    static const uint8_t v4Prefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF};
+    char                 buffer[INET6_ADDRSTRLEN] = {0};
+    if (memcmp(ip.bytes, v4Prefix, sizeof(v4Prefix)) == 0)
+    {
+        inet_ntop(AF_INET, ip.bytes + 12, buffer, sizeof(buffer));
+    }
+    else
+    {
+        inet_ntop(AF_INET6, ip.bytes, buffer, sizeof(buffer));
+    }
+    return text == buffer;
+}
+
+// 解析MAC地址，formatMac输出小写，含大写字母的文本无法原样还原
+bool storeMac(const std::string& text, uint64_t& mac)
+{
+    if (!NetUtil::parseMac(text, mac))
+    {
+        return text.empty();
+    }
+
+    for (char c : text)
+    {
+        if (c >= 'A' && c <= 'F')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+// 从内存中按顺序读取定长字段，越界时返回false
+template <typename T>
+bool readValue(const unsigned char*& data, const unsigned char* end, T& value)
+{
+    if (static_cast<size_t>(end - data) < sizeof(T))
+    {
+        return false;
+    }
+    memcpy(&value, data, sizeof(T));
+    data += sizeof(T);
+    return true;
+}
+
+template <typename T>
+bool writeValue(FILE* file, const T& value)
+{
+    return fwrite(&value, sizeof(T), 1, file) == 1;
+}
+
+bool saveDict(FILE* file, const StringDict& dict)
+{
+    uint32_t size = static_cast<uint32_t>(dict.size());
+    if (!writeValue(file, size))
+    {
+        return false;
+    }
+    for (uint32_t id = 1; id < size; id++)
+    {
+        const std::string& value  = dict.lookup(id);
+        uint32_t           length = static_cast<uint32_t>(value.size());
+        if (!writeValue(file, length) || fwrite(value.data(), 1, length, file) != length)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool loadDict(const unsigned char*& data, const unsigned char* end, StringDict& dict)
+{
+    uint32_t size;
+    if (!readValue(data, end, size))
+    {
+        return false;
+    }
+    dict.clear();
+    for (uint32_t id = 1; id < size; id++)
+    {
+        uint32_t length;
+        if (!readValue(data, end, length) || static_cast<size_t>(end - data) < length)
+        {
+            return false;
+        }
+        dict.assign(id, std::string(reinterpret_cast<const char*>(data), length));
+        data += length;
+    }
+    return true;
+}
+} // namespace
+
+const uint32_t StringArena::kBlockSize;
+const size_t   PacketStore::kChunkSize;
+const uint16_t PacketStore::kMaxStackId;
+const uint32_t FrameIndex::kNone;
+
+uint64_t StringArena::append(const char* data, uint32_t length)
+{
+    if (blocks.empty() || blocks.back().capacity - blocks.back().used < length)
+    {
+        // 超过块大小的字符串独占一个块
+        Block block;
+        block.capacity = length > kBlockSize ? length : kBlockSize;
+        block.used     = 0;
+        block.data.reset(new char[block.capacity]);
+        blocks.push_back(std::move(block));
+    }
+
+    Block&   block = blocks.back();
+    uint64_t ref   = (static_cast<uint64_t>(blocks.size() - 1) << 32) | block.used;
+    if (length > 0)
+    {
+        memcpy(block.data.get() + block.used, data, length);
+    }
+    block.used += length;
+    return ref;
+}
+
+void StringArena::clear()
+{
+    blocks.clear();
+}
+
+size_t StringArena::memoryUsage() const
+{
+    size_t total = 0;
+    for (const Block& block : blocks)
+    {
+        total += block.capacity;
+    }
+    return total;
+}
+
+bool StringArena::save(FILE* file) const
+{
+    uint32_t blockCount = static_cast<uint32_t>(blocks.size());
+    if (!writeValue(file, blockCount))
+    {
+        return false;
+    }
+    for (const Block& block : blocks)
+    {
+        if (!writeValue(file, block.used) ||
+            fwrite(block.data.get(), 1, block.used, file) != block.used)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool StringArena::load(const unsigned char*& data, const unsigned char* end)
+{
+    clear();
+
+    uint32_t blockCount;
+    if (!readValue(data, end, blockCount))
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < blockCount; i++)
+    {
+        // 恢复的块大小与写出时的已用大小一致，之后追加的字符串写入新块，已有位置不变
+        uint32_t used;
+        if (!readValue(data, end, used) || static_cast<size_t>(end - data) < used)
+        {
+            clear();
+            return false;
+        }
+        Block block;
+        block.capacity = used;
+        block.used     = used;
+        block.data.reset(new char[used > 0 ? used : 1]);
+        memcpy(block.data.get(), data, used);
+        blocks.push_back(std::move(block));
+        data += used;
+    }
+    return true;
+}
+
+PacketStore::PacketStore() : count(0) {}
+
+uint32_t PacketStore::append(const Packet& packet)
+{
+    if (count == chunks.size() * kChunkSize)
+    {
+        chunks.push_back(std::unique_ptr<CompactPacket[]>(new CompactPacket[kChunkSize]));
+    }
+
+    CompactPacket& record  = chunks[count / kChunkSize][count % kChunkSize];
+    record.frame_number    = packet.frame_number;
+    record.cap_len         = packet.cap_len;
+    record.len             = packet.len;
+    record.src_port        = packet.src_port;
+    record.dst_port        = packet.dst_port;
+    record.ip_proto        = packet.ip_proto;
+    record.tcp_flags       = packet.tcp_flags;
+    record.stack_id        = stackIdOf(packet.frame_protocols);
+    record.time            = packet.time;
+    record.file_offset     = packet.file_offset;
+    record.protocol_id     = protocolDict.intern(packet.protocol);
+    record.src_location_id = locationDict.intern(packet.src_location);
+    record.dst_location_id = locationDict.intern(packet.dst_location);
+    record.info_length     = static_cast<uint32_t>(packet.info.size());
+    record.info_ref        = infoArena.append(packet.info.data(), record.info_length);
+
+    // 地址通常能无损地转为二进制形式；少数情况（如隧道报文的多值字段、大写MAC）
+    // 无法原样还原，此时把原始文本整体存入地址字典
+    bool exact = storeIp(packet.src_ip, record.src_ip);
+    exact      = storeIp(packet.dst_ip, record.dst_ip) && exact;
+    exact      = storeMac(packet.src_mac, record.src_mac) && exact;
+    exact      = storeMac(packet.dst_mac, record.dst_mac) && exact;
+
+    record.raw_address_id = 0;
+    if (!exact)
+    {
+        record.raw_address_id = addressDict.intern(packet.src_ip + '\n' + packet.dst_ip + '\n' +
+                                                   packet.src_mac + '\n' + packet.dst_mac);
+    }
+
+    return static_cast<uint32_t>(count++);
+}
+
+void PacketStore::toPacket(const CompactPacket& record, Packet& packet) const
+{
+    packet.frame_number    = record.frame_number;
+    packet.time            = record.time;
+    packet.cap_len         = record.cap_len;
+    packet.len             = record.len;
+    packet.src_port        = record.src_port;
+    packet.dst_port        = record.dst_port;
+    packet.ip_proto        = record.ip_proto;
+    packet.tcp_flags       = record.tcp_flags;
+    packet.file_offset     = record.file_offset;
+    packet.frame_protocols = stackDict.lookup(record.stack_id);
+    packet.protocol        = protocolDict.lookup(record.protocol_id);
+    packet.src_location    = locationDict.lookup(record.src_location_id);
+    packet.dst_location    = locationDict.lookup(record.dst_location_id);
+    packet.info.assign(infoArena.get(record.info_ref), record.info_length);
+
+    if (record.raw_address_id == 0)
+    {
+        packet.src_ip  = NetUtil::formatIp(record.src_ip);
+        packet.dst_ip  = NetUtil::formatIp(record.dst_ip);
+        packet.src_mac = NetUtil::formatMac(record.src_mac);
+        packet.dst_mac = NetUtil::formatMac(record.dst_mac);
+        return;
+    }
+
+    // 原始文本按 src_ip \n dst_ip \n src_mac \n dst_mac 保存
+    const std::string& raw    = addressDict.lookup(record.raw_address_id);
+    std::string*       out[4] = {&packet.src_ip, &packet.dst_ip, &packet.src_mac, &packet.dst_mac};
+    size_t             start  = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        size_t end = i < 3 ? raw.find('\n', start) : raw.size();
+        out[i]->assign(raw, start, end - start);
+        start = end + 1;
+    }
+}
+
+std::shared_ptr<Packet> PacketStore::materialize(size_t index) const
+{
+    std::shared_ptr<Packet> packet = std::make_shared<Packet>();
+    toPacket(at(index), *packet);
+    return packet;
+}
+
+void PacketStore::clear()
+{
+    chunks.clear();
+    count = 0;
+    infoArena.clear();
+    protocolDict.clear();
+    locationDict.clear();
+    addressDict.clear();
+    stackDict.clear();
+}
+
+uint16_t PacketStore::stackIdOf(const std::string& stack)
+{
+    uint32_t id;
+    if (stackDict.find(stack, id))
+    {
+        return static_cast<uint16_t>(id);
+    }
+    // 不同的协议栈通常只有几百种，超出16位ID范围的按未知处理
+    if (stackDict.size() > kMaxStackId)
+    {
+        return 0;
+    }
+    return static_cast<uint16_t>(stackDict.intern(stack));
+}
+
+size_t PacketStore::memoryUsage() const
+{
+    return chunks.size() * kChunkSize * sizeof(CompactPacket) + infoArena.memoryUsage();
+}
+
+bool PacketStore::save(FILE* file) const
+{
+    uint64_t recordCount = count;
+    if (!saveDict(file, protocolDict) || !saveDict(file, locationDict) ||
+        !saveDict(file, addressDict) || !saveDict(file, stackDict) ||
+        !writeValue(file, recordCount))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < count; i += kChunkSize)
+    {
+        size_t n = std::min(kChunkSize, count - i);
+        if (fwrite(chunks[i / kChunkSize].get(), sizeof(CompactPacket), n, file) != n)
+        {
+            return false;
+        }
+    }
+    return infoArena.save(file);
+}
+
+bool PacketStore::load(const unsigned char*& data, const unsigned char* end)
+{
+    clear();
+
+    uint64_t recordCount;
+    if (!loadDict(data, end, protocolDict) || !loadDict(data, end, locationDict) ||
+        !loadDict(data, end, addressDict) || !loadDict(data, end, stackDict) ||
+        !readValue(data, end, recordCount) ||
+        static_cast<uint64_t>(end - data) / sizeof(CompactPacket) < recordCount)
+    {
+        clear();
+        return false;
+    }
+
+    for (size_t i = 0; i < recordCount; i += kChunkSize)
+    {
+        size_t n = std::min<size_t>(kChunkSize, recordCount - i);
+        chunks.push_back(std::unique_ptr<CompactPacket[]>(new CompactPacket[kChunkSize]));
+        memcpy(chunks.back().get(), data, n * sizeof(CompactPacket));
+        data += n * sizeof(CompactPacket);
+    }
+    count = recordCount;
+
+    if (!infoArena.load(data, end))
+    {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+FrameIndex::FrameIndex() : count(0) {}
+
+void FrameIndex::insert(uint32_t frame, uint32_t index)
+{
+    size_t chunk = frame / kChunkSize;
+    if (chunk >= chunks.size() + kMaxGapChunks)
+    {
+        auto result = sparse.insert(std::make_pair(frame, index));
+        if (result.second)
+        {
+            count++;
+        }
+        else
+        {
+            result.first->second = index;
+        }
+        return;
+    }
+
+    if (chunk >= chunks.size())
+    {
+        chunks.resize(chunk + 1);
+    }
+    if (!chunks[chunk])
+    {
+        chunks[chunk].reset(new uint32_t[kChunkSize]);
+        std::fill(chunks[chunk].get(), chunks[chunk].get() + kChunkSize, kNone);
+    }
+
+    uint32_t& slot = chunks[chunk][frame % kChunkSize];
+    if (slot == kNone)
+    {
+        // 稠密数组扩展后可能覆盖到之前记在稀疏表中的编号
+        auto it = sparse.find(frame);
+        if (it == sparse.end())
+        {
+            count++;
+        }
+        else
+        {
+            sparse.erase(it);
+        }
+    }
+    slot = index;
+}
+
+bool FrameIndex::findSparse(uint32_t frame, uint32_t& index) const
+{
+    auto it = sparse.find(frame);
+    if (it == sparse.end())
+    {
+        return false;
+    }
+    index = it->second;
+    return true;
+}
+
+void FrameIndex::clear()
+{
+    chunks.clear();
+    sparse.clear();
+    count = 0;
+}
@@ -0,0 +1,115 @@
+#include "protocolHierarchy.hpp"
+
+#include <utility>
+
+namespace
+{
+const char* const kRootName = "frame";
+} // namespace
+
+ProtocolHierarchy::ProtocolHierarchy() : changes(0)
+{
+    clear();
+}
+
+uint32_t ProtocolHierarchy::child(uint32_t parent, const std::string& stack, size_t start,
+                                  size_t length)
+{
+    // 每层的子节点很少，顺序查找即可
+    for (uint32_t id : nodes[parent].children)
+    {
+        const std::string& name = nodes[id].name;
+        if (name.size() == length && stack.compare(start, length, name) == 0)
+        {
+            return id;
+        }
+    }
+
+    Node node;
+    node.name.assign(stack, start, length);
+    node.packets = 0;
+    node.bytes   = 0;
+    nodes.push_back(node);
+    uint32_t id = static_cast<uint32_t>(nodes.size() - 1);
+    nodes[parent].children.push_back(id);
+    return id;
+}
+
+void ProtocolHierarchy::add(const std::string& stack, uint64_t bytes, uint64_t packets)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    nodes[0].packets += packets;
+    nodes[0].bytes += bytes;
+    changes++;
+
+    uint32_t current = 0;
+    size_t   start   = 0;
+    while (start < stack.size())
+    {
+        size_t end = stack.find(':', start);
+        if (end == std::string::npos)
+        {
+            end = stack.size();
+        }
+        size_t length = end - start;
+
+        bool root = start == 0 && stack.compare(0, length, kRootName) == 0;
+        if (length > 0 && !root)
+        {
+            current = child(current, stack, start, length);
+            nodes[current].packets += packets;
+            nodes[current].bytes += bytes;
+        }
+        start = end + 1;
+    }
+}
+
+void ProtocolHierarchy::snapshot(std::vector<ProtocolHierarchyNode>& result) const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    result.clear();
+    if (nodes[0].packets == 0)
+    {
+        return;
+    }
+
+    // 显式栈做深度优先遍历，子节点逆序入栈以保持首次出现的顺序
+    std::vector<std::pair<uint32_t, size_t>> pending(1, std::make_pair(0u, size_t(0)));
+    while (!pending.empty())
+    {
+        uint32_t id     = pending.back().first;
+        size_t   parent = pending.back().second;
+        pending.pop_back();
+
+        const Node&           node = nodes[id];
+        ProtocolHierarchyNode item;
+        item.protocol = node.name;
+        item.path     = id == 0 ? node.name : result[parent].path + ":" + node.name;
+        item.depth    = id == 0 ? 0 : result[parent].depth + 1;
+        item.packets  = node.packets;
+        item.bytes    = node.bytes;
+        result.push_back(item);
+
+        for (auto it = node.children.rbegin(); it != node.children.rend(); ++it)
+        {
+            pending.push_back(std::make_pair(*it, result.size() - 1));
+        }
+    }
+}
+
+uint64_t ProtocolHierarchy::version() const
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return changes;
+}
+
+void ProtocolHierarchy::clear()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    Node root;
+    root.name    = kRootName;
+    root.packets = 0;
+    root.bytes   = 0;
+    nodes.assign(1, root);
+    changes++;
+}
@@ -0,0 +1,339 @@
+#include "tcpMetrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+const size_t TcpMetrics::kMaxOutstanding;
+
+namespace
+{
+const uint8_t kProtoTcp = 6;
+const uint8_t kTcpFin   = 0x01;
+const uint8_t kTcpSyn   = 0x02;
+const uint8_t kTcpRst   = 0x04;
+const uint8_t kTcpAck   = 0x10;
+
+// 没有往返时间样本时区分乱序和重传的时间阈值
+const double kReorderWindow = 0.003;
+// 直方图每个2的幂区间分4个桶，相对误差约12%，超过2^40字节/秒的值计入最后一个桶
+const size_t kBuckets = 160;
+
+// 序列号比较，差值按有符号32位计算，可跨越回绕
+inline int32_t seqDiff(uint32_t a, uint32_t b)
+{
+    return static_cast<int32_t>(a - b);
+}
+
+template <typename T>
+bool writeValue(FILE* file, const T& value)
+{
+    return fwrite(&value, sizeof(T), 1, file) == 1;
+}
+
+// 从内存中按顺序读取定长字段，越界时返回false
+template <typename T>
+bool readValue(const unsigned char*& data, const unsigned char* end, T& value)
+{
+    if (static_cast<size_t>(end - data) < sizeof(T))
+    {
+        return false;
+    }
+    memcpy(&value, data, sizeof(T));
+    data += sizeof(T);
+    return true;
+}
+} // namespace
+
+TcpMetrics::Flow::Flow()
+    : synTime(-1), handshakeRtt(-1), rttMin(-1), rttMax(-1), rttSum(0), rttSamples(0),
+      retransmissions(0), outOfOrder(0), zeroWindows(0), second(0), secondBytes(0),
+      maxSecondBytes(0)
+{
+    memset(directions, 0, sizeof(directions));
+}
+
+size_t TcpMetrics::bucketOf(uint64_t value)
+{
+    if (value < 4)
+    {
+        return static_cast<size_t>(value);
+    }
+    size_t exponent = 63 - __builtin_clzll(value);
+    size_t sub      = static_cast<size_t>(value >> (exponent - 2)) & 3;
+    return std::min((exponent - 1) * 4 + sub, kBuckets - 1);
+}
+
+double TcpMetrics::bucketValue(size_t bucket)
+{
+    if (bucket < 4)
+    {
+        return static_cast<double>(bucket);
+    }
+    // 桶的范围是[(4 + sub) << (exponent - 2), (5 + sub) << (exponent - 2))，取中点
+    size_t exponent = bucket / 4 + 1;
+    double width    = std::ldexp(1.0, static_cast<int>(exponent - 2));
+    return (4 + bucket % 4) * width + (width - 1) / 2;
+}
+
+double TcpMetrics::percentile(const std::vector<uint32_t>& histogram, double quantile)
+{
+    uint64_t total = 0;
+    for (uint32_t count : histogram)
+    {
+        total += count;
+    }
+    if (total == 0)
+    {
+        return -1;
+    }
+
+    uint64_t rank       = static_cast<uint64_t>(std::ceil(quantile * total));
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < histogram.size(); i++)
+    {
+        cumulative += histogram[i];
+        if (cumulative >= rank)
+        {
+            return bucketValue(i);
+        }
+    }
+    return bucketValue(histogram.size() - 1);
+}
+
+void TcpMetrics::sampleRtt(Flow& flow, Direction& sender, double time, uint32_t ack)
+{
+    // 找到被这个确认覆盖的最新分段，它之前的分段一并出队
+    int newest = -1;
+    for (int i = 0; i < sender.count; i++)
+    {
+        const Segment& segment = sender.outstanding[(sender.head + i) % kMaxOutstanding];
+        if (seqDiff(ack, segment.seqEnd) < 0)
+        {
+            break;
+        }
+        newest = i;
+    }
+    if (newest < 0)
+    {
+        return;
+    }
+
+    double rtt = time - sender.outstanding[(sender.head + newest) % kMaxOutstanding].time;
+    sender.head  = static_cast<uint8_t>((sender.head + newest + 1) % kMaxOutstanding);
+    sender.count = static_cast<uint8_t>(sender.count - newest - 1);
+    if (rtt < 0)
+    {
+        return;
+    }
+
+    flow.rttMin = flow.rttSamples == 0 ? rtt : std::min(flow.rttMin, rtt);
+    flow.rttMax = std::max(flow.rttMax, rtt);
+    flow.rttSum += rtt;
+    flow.rttSamples++;
+}
+
+void TcpMetrics::add(uint32_t flowId, uint8_t direction, double time, uint32_t bytes,
+                     const DecodedPacket& packet)
+{
+    if (packet.ip_proto != kProtoTcp || packet.fragment || direction > 1)
+    {
+        return;
+    }
+
+    Flow&      flow  = flows[flowId];
+    Direction& self  = flow.directions[direction];
+    Direction& peer  = flow.directions[1 - direction];
+    uint8_t    flags = packet.tcp_flags;
+
+    // 按秒累计字节数，进入新的一秒时把上一秒计入直方图
+    long second = static_cast<long>(std::floor(time));
+    if (flow.secondBytes > 0 && second != flow.second)
+    {
+        if (flow.histogram.empty())
+        {
+            flow.histogram.assign(kBuckets, 0);
+        }
+        flow.histogram[bucketOf(flow.secondBytes)]++;
+        flow.secondBytes = 0;
+    }
+    flow.second = second;
+    flow.secondBytes += bytes;
+    flow.maxSecondBytes = std::max(flow.maxSecondBytes, flow.secondBytes);
+
+    // 握手时延
+    if ((flags & kTcpSyn) && !(flags & kTcpAck) && flow.synTime < 0)
+    {
+        flow.synTime = time;
+    }
+    else if ((flags & kTcpSyn) && (flags & kTcpAck) && flow.synTime >= 0 &&
+             flow.handshakeRtt < 0)
+    {
+        flow.handshakeRtt = time - flow.synTime;
+    }
+
+    if ((flags & kTcpAck) && !(flags & kTcpRst))
+    {
+        sampleRtt(flow, peer, time, packet.tcp_ack);
+    }
+
+    // RST通常携带零窗口，不计入
+    if (packet.tcp_window == 0 && !(flags & (kTcpSyn | kTcpFin | kTcpRst)))
+    {
+        flow.zeroWindows++;
+    }
+
+    // SYN和FIN各占用一个序列号
+    uint32_t length = packet.payload_length + ((flags & kTcpSyn) ? 1 : 0) +
+                      ((flags & kTcpFin) ? 1 : 0);
+    if (length == 0 || (flags & kTcpRst))
+    {
+        return;
+    }
+
+    uint32_t seqEnd = packet.tcp_seq + length;
+    if (self.started && seqDiff(packet.tcp_seq, self.highestEnd) < 0)
+    {
+        double window = flow.rttSamples > 0 ? flow.rttMin : kReorderWindow;
+        if (time - self.highestTime < window)
+        {
+            flow.outOfOrder++;
+        }
+        else
+        {
+            flow.retransmissions++;
+        }
+        // 之后的确认无法区分对应哪一次发送，不再取样
+        self.count = 0;
+        if (seqDiff(seqEnd, self.highestEnd) > 0)
+        {
+            self.highestEnd  = seqEnd;
+            self.highestTime = time;
+        }
+        return;
+    }
+
+    self.started     = true;
+    self.highestEnd  = seqEnd;
+    self.highestTime = time;
+    if (self.count == kMaxOutstanding)
+    {
+        // 队列已满时丢弃最早的分段
+        self.head = static_cast<uint8_t>((self.head + 1) % kMaxOutstanding);
+        self.count--;
+    }
+    Segment& segment = self.outstanding[(self.head + self.count) % kMaxOutstanding];
+    segment.seqEnd   = seqEnd;
+    segment.time     = time;
+    self.count++;
+}
+
+bool TcpMetrics::get(uint32_t flowId, TcpFlowMetrics& metrics) const
+{
+    auto it = flows.find(flowId);
+    if (it == flows.end())
+    {
+        return false;
+    }
+
+    const Flow& flow        = it->second;
+    metrics.flow_id         = flowId;
+    metrics.handshake_rtt   = flow.handshakeRtt;
+    metrics.rtt_min         = flow.rttMin;
+    metrics.rtt_avg         = flow.rttSamples > 0 ? flow.rttSum / flow.rttSamples : -1;
+    metrics.rtt_max         = flow.rttMax;
+    metrics.rtt_samples     = flow.rttSamples;
+    metrics.retransmissions = flow.retransmissions;
+    metrics.out_of_order    = flow.outOfOrder;
+    metrics.zero_windows    = flow.zeroWindows;
+
+    // 正在累计的一秒也计入
+    std::vector<uint32_t> histogram = flow.histogram;
+    if (flow.secondBytes > 0)
+    {
+        histogram.resize(kBuckets, 0);
+        histogram[bucketOf(flow.secondBytes)]++;
+    }
+    double maxBytes        = static_cast<double>(flow.maxSecondBytes);
+    metrics.throughput_p50 = std::min(percentile(histogram, 0.5), maxBytes);
+    metrics.throughput_p95 = std::min(percentile(histogram, 0.95), maxBytes);
+    metrics.throughput_max = histogram.empty() ? -1 : maxBytes;
+    return true;
+}
+
+void TcpMetrics::clear()
+{
+    flows.clear();
+}
+
+bool TcpMetrics::save(FILE* file) const
+{
+    uint64_t flowCount = flows.size();
+    if (!writeValue(file, flowCount))
+    {
+        return false;
+    }
+    for (const auto& item : flows)
+    {
+        const Flow& flow   = item.second;
+        int64_t     second = flow.second;
+        uint32_t    size   = static_cast<uint32_t>(flow.histogram.size());
+        bool ok = writeValue(file, item.first) && writeValue(file, flow.directions) &&
+                  writeValue(file, flow.synTime) && writeValue(file, flow.handshakeRtt) &&
+                  writeValue(file, flow.rttMin) && writeValue(file, flow.rttMax) &&
+                  writeValue(file, flow.rttSum) && writeValue(file, flow.rttSamples) &&
+                  writeValue(file, flow.retransmissions) && writeValue(file, flow.outOfOrder) &&
+                  writeValue(file, flow.zeroWindows) && writeValue(file, second) &&
+                  writeValue(file, flow.secondBytes) && writeValue(file, flow.maxSecondBytes) &&
+                  writeValue(file, size) &&
+                  fwrite(flow.histogram.data(), sizeof(uint32_t), size, file) == size;
+        if (!ok)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TcpMetrics::load(const unsigned char*& data, const unsigned char* end)
+{
+    clear();
+
+    uint64_t flowCount;
+    if (!readValue(data, end, flowCount))
+    {
+        return false;
+    }
+    for (uint64_t i = 0; i < flowCount; i++)
+    {
+        uint32_t flowId;
+        Flow     flow;
+        int64_t  second;
+        uint32_t size;
+        bool ok = readValue(data, end, flowId) && readValue(data, end, flow.directions) &&
+                  readValue(data, end, flow.synTime) && readValue(data, end, flow.handshakeRtt) &&
+                  readValue(data, end, flow.rttMin) && readValue(data, end, flow.rttMax) &&
+                  readValue(data, end, flow.rttSum) && readValue(data, end, flow.rttSamples) &&
+                  readValue(data, end, flow.retransmissions) &&
+                  readValue(data, end, flow.outOfOrder) && readValue(data, end, flow.zeroWindows) &&
+                  readValue(data, end, second) && readValue(data, end, flow.secondBytes) &&
+                  readValue(data, end, flow.maxSecondBytes) && readValue(data, end, size) &&
+                  (size == 0 || size == kBuckets) &&
+                  static_cast<size_t>(end - data) >= size * sizeof(uint32_t);
+        if (!ok)
+        {
+            clear();
+            return false;
+        }
+        flow.second = static_cast<long>(second);
+        flow.histogram.resize(size);
+        if (size > 0)
+        {
+            memcpy(flow.histogram.data(), data, size * sizeof(uint32_t));
+            data += size * sizeof(uint32_t);
+        }
+        flows[flowId] = std::move(flow);
+    }
+    return true;
+}
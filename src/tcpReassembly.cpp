@@ -0,0 +1,180 @@
+#include "tcpReassembly.hpp"
+
+#include <algorithm>
+
+namespace
+{
+const uint8_t kProtoTcp = 6;
+const uint8_t kTcpSyn   = 0x02;
+} // namespace
+
+TcpReassembler::Half::Half() : started(false), base(0), next(0), pendingBytes(0)
+{
+    result.total_bytes     = 0;
+    result.gap_bytes       = 0;
+    result.gaps            = 0;
+    result.retransmissions = 0;
+    result.out_of_order    = 0;
+    result.truncated       = false;
+}
+
+TcpReassembler::TcpReassembler(size_t maxStreamBytes, size_t maxPendingBytes)
+    : maxStreamBytes(maxStreamBytes), maxPendingBytes(maxPendingBytes)
+{
+}
+
+void TcpReassembler::add(uint32_t flowId, uint8_t direction, const DecodedPacket& packet)
+{
+    if (packet.ip_proto != kProtoTcp || packet.fragment || direction > 1)
+    {
+        return;
+    }
+
+    Half&    half = streams[flowId].halves[direction];
+    uint32_t seq  = packet.tcp_seq;
+    if (packet.tcp_flags & kTcpSyn)
+    {
+        // SYN占用一个序列号，负载从下一个序列号开始
+        seq++;
+        if (!half.started)
+        {
+            half.started = true;
+            half.base    = seq;
+        }
+    }
+    if (packet.payload_length == 0)
+    {
+        return;
+    }
+    if (!half.started)
+    {
+        // 从连接中途开始抓包，以第一个带负载的分段为起点
+        half.started = true;
+        half.base    = seq;
+    }
+
+    // 相对于期望序列号的差值按有符号32位计算，可跨越回绕
+    int32_t delta  = static_cast<int32_t>(seq - (half.base + static_cast<uint32_t>(half.next)));
+    int64_t offset = static_cast<int64_t>(half.next) + delta;
+    int64_t end    = offset + packet.payload_length;
+
+    const unsigned char* data   = packet.payload;
+    uint64_t             length = packet.payload_length;
+
+    if (end <= static_cast<int64_t>(half.next))
+    {
+        half.result.retransmissions++;
+        return;
+    }
+    if (offset < static_cast<int64_t>(half.next))
+    {
+        // 部分重传，只保留新的数据
+        uint64_t overlap = static_cast<uint64_t>(static_cast<int64_t>(half.next) - offset);
+        data += overlap;
+        length -= overlap;
+        offset = static_cast<int64_t>(half.next);
+        half.result.retransmissions++;
+    }
+
+    if (static_cast<uint64_t>(offset) > half.next)
+    {
+        half.result.out_of_order++;
+        std::vector<unsigned char>& segment = half.pending[static_cast<uint64_t>(offset)];
+        if (segment.size() >= length)
+        {
+            // 同一位置的超前分段又到达了一次
+            half.result.retransmissions++;
+            return;
+        }
+        half.pendingBytes += length - segment.size();
+        segment.assign(data, data + length);
+
+        // 等待太多数据时不再等待缺失的部分
+        while (half.pendingBytes > maxPendingBytes)
+        {
+            skipGap(half);
+        }
+        return;
+    }
+
+    deliver(half, data, length);
+    drain(half);
+}
+
+void TcpReassembler::deliver(Half& half, const unsigned char* data, uint64_t length)
+{
+    TcpStreamData& result = half.result;
+    size_t         room   = maxStreamBytes - std::min(maxStreamBytes, result.data.size());
+    size_t         keep   = static_cast<size_t>(std::min<uint64_t>(length, room));
+    result.data.insert(result.data.end(), data, data + keep);
+    result.truncated = result.truncated || keep < length;
+    result.total_bytes += length;
+    half.next += length;
+}
+
+void TcpReassembler::drain(Half& half)
+{
+    while (!half.pending.empty())
+    {
+        auto it = half.pending.begin();
+        if (it->first > half.next)
+        {
+            break;
+        }
+
+        uint64_t end = it->first + it->second.size();
+        if (end > half.next)
+        {
+            deliver(half, it->second.data() + (half.next - it->first), end - half.next);
+        }
+        half.pendingBytes -= it->second.size();
+        half.pending.erase(it);
+    }
+}
+
+void TcpReassembler::skipGap(Half& half)
+{
+    if (half.pending.empty())
+    {
+        return;
+    }
+
+    uint64_t first = half.pending.begin()->first;
+    if (first > half.next)
+    {
+        half.result.gaps++;
+        half.result.gap_bytes += first - half.next;
+        half.next = first;
+    }
+    drain(half);
+}
+
+void TcpReassembler::finish()
+{
+    for (auto& item : streams)
+    {
+        for (Half& half : item.second.halves)
+        {
+            while (!half.pending.empty())
+            {
+                skipGap(half);
+            }
+        }
+    }
+}
+
+bool TcpReassembler::stream(uint32_t flowId, uint8_t direction, TcpStreamData& data) const
+{
+    auto it = streams.find(flowId);
+    if (it == streams.end() || direction > 1)
+    {
+        return false;
+    }
+    data = it->second.halves[direction].result;
+    return true;
+}
+
+void TcpReassembler::clear()
+{
+    streams.clear();
+}
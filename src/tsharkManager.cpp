@@ -1,51 +1,65 @@
 #include <csignal>
 #include <fcntl.h>
 #include <iomanip>
+#include <netinet/in.h>
 #include <set>
 #include <stdexcept>
+#include <poll.h>
 #include <sys/epoll.h>
+#include <sys/inotify.h>
 #include <unistd.h>
 
 #include "loguru.hpp"
 #include "tsharkManager.hpp"
 #include "utils.hpp"
+#include "packetIndexFile.hpp"
 #include "processUtil.hpp"
 
 TsharkManager::TsharkManager(const std::string& outputPath)
     : outputPath(outputPath), isRunning(false), stopFlag(false), childPid(-1), epollFd(-1),
-      adapterFlowTrendMonitorStartTime(0)
+      storedPacketCount(0), incrementalOffset(0), incrementalFrames(0), incrementalStop(false),
+      storedHierarchyVersion(0), adapterFlowTrendMonitorStartTime(0), adapterFlowTrendStop(false)
 {
     tsharkPath = "/usr/bin/tshark";
     editcapPath = "/usr/bin/editcap";
     ip2RegionDbPath = "resources/ip2region.xdb";
 }
 
-TsharkManager::~TsharkManager() {}
+TsharkManager::~TsharkManager()
+{
+    stopIncrementalAnalysis();
+    stopMonitorAdaptersFlowTrend();
+}
 
 void TsharkManager::stopMonitorAdaptersFlowTrend()
 {
+    // 先停止采样和读取线程
+    adapterFlowTrendStop = true;
+    if (adapterFlowTrendSampleThread && adapterFlowTrendSampleThread->joinable())
+    {
+        adapterFlowTrendSampleThread->join();
+    }
+    adapterFlowTrendSampleThread.reset();
+    if (adapterFlowTrendMonitorThread && adapterFlowTrendMonitorThread->joinable())
+    {
+        adapterFlowTrendMonitorThread->join();
+    }
+    adapterFlowTrendMonitorThread.reset();
+
     std::unique_lock<std::recursive_mutex> lock(adapterFlowTrendMapLock);
 
-    // 先杀死对应的tshark进程
-    for (auto adapterPipePair : adapterFlowTrendMonitorMap)
+    // 然后杀死按协议统计的tshark进程并关闭管道
+    if (protocolMonitor)
     {
-        ProcessUtil::Kill(adapterPipePair.second.tsharkPid);
+        ProcessUtil::Kill(protocolMonitor->pid);
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fileno(protocolMonitor->pipe), nullptr);
+        pclose(protocolMonitor->pipe);
+        protocolMonitor.reset();
     }
 
-    // 然后关闭管道并从 epoll 中移除
-    for (auto& adapterPipePair : adapterFlowTrendMonitorMap)
+    for (auto& adapterPair : adapterFlowTrendMonitorMap)
     {
-        if (adapterPipePair.second.monitorTsharkPipe)
-        {
-            int pipeFd = fileno(adapterPipePair.second.monitorTsharkPipe);
-            if (pipeFd != -1)
-            {
-                epoll_ctl(epollFd, EPOLL_CTL_DEL, pipeFd, nullptr);
-                // 关闭管道
-                pclose(adapterPipePair.second.monitorTsharkPipe);
-            }
-        }
-        LOG_F(INFO, "网卡：%s 流量监控已停止", adapterPipePair.first.c_str());
+        LOG_F(INFO, "网卡：%s 流量监控已停止", adapterPair.first.c_str());
     }
     adapterFlowTrendMonitorMap.clear();
 
@@ -73,35 +87,102 @@ void TsharkManager::getAdaptersFlowTrendData(
                          ? timeNow
                          : adapterFlowTrendMonitorStartTime + 300;
 
-    std::unique_lock<std::recursive_mutex> lock(adapterFlowTrendMapLock);
-    for (const auto& adapterPipePair : adapterFlowTrendMonitorMap)
+    std::map<std::string, std::vector<long>> snapshot;
+    getAdaptersFlowTrendSnapshot(startWindow, endWindow - startWindow + 1, snapshot);
+    for (const auto& adapterPair : snapshot)
     {
-        flowTrendData.insert(std::make_pair(adapterPipePair.first, std::map<long, long>()));
-
-        // 从当前时间戳向前倒推300秒
-        for (long t = startWindow; t <= endWindow; t++)
+        std::map<long, long>& adapterData = flowTrendData[adapterPair.first];
+        for (size_t i = 0; i < adapterPair.second.size(); i++)
         {
-            if (adapterPipePair.second.flowTrendData.find(t) !=
-                adapterPipePair.second.flowTrendData.end())
-            {
-                flowTrendData[adapterPipePair.first][t] =
-                    adapterPipePair.second.flowTrendData.at(t);
-            }
-            else
-            {
-                flowTrendData[adapterPipePair.first][t] = 0;
-            }
+            adapterData.emplace_hint(adapterData.end(), startWindow + static_cast<long>(i),
+                                     adapterPair.second[i]);
         }
     }
 }
 
-void TsharkManager::startMonitorAdaptersFlowTrend()
+void TsharkManager::getAdaptersFlowTrendSnapshot(long startTime, size_t count,
+                                                 std::map<std::string, std::vector<long>>& snapshot)
+{
+    // 锁只防止监控被启动或停止，采样线程写入环形缓冲区时不持有该锁
+    std::unique_lock<std::recursive_mutex> lock(adapterFlowTrendMapLock);
+    for (const auto& adapterPair : adapterFlowTrendMonitorMap)
+    {
+        std::vector<long>& values = snapshot[adapterPair.first];
+        values.resize(count);
+        adapterPair.second.flowTrend.snapshot(startTime, count, values.data());
+    }
+}
+
+void TsharkManager::getAdaptersProtocolFlowData(
+    std::map<std::string, std::map<std::string, long>>& protocolFlowData)
+{
+    std::unique_lock<std::recursive_mutex> lock(adapterFlowTrendMapLock);
+    for (auto& adapterPair : adapterFlowTrendMonitorMap)
+    {
+        std::lock_guard<std::mutex> protocolLock(adapterPair.second.protocolLock);
+        protocolFlowData[adapterPair.first] = adapterPair.second.protocolFlowData;
+    }
+}
+
+void TsharkManager::getLiveTrafficStats(LiveTrafficSnapshot& snapshot)
+{
+    liveStats.snapshot(snapshot);
+}
+
+uint64_t TsharkManager::estimateTalkerBytes(LiveTrafficStats::Dimension dimension,
+                                            const std::string&          key)
+{
+    return liveStats.estimateBytes(dimension, key);
+}
+
+bool TsharkManager::getDistinctEndpoints(long startTime, long endTime, DistinctEndpoints& result)
+{
+    return endpointStats.query(startTime, endTime, result);
+}
+
+void TsharkManager::getDistinctEndpointsPerMinute(long startTime, long endTime,
+                                                  std::vector<DistinctEndpoints>& minutes)
 {
+    endpointStats.perMinute(startTime, endTime, minutes);
+}
+
+void TsharkManager::startMonitorAdaptersFlowTrend(bool protocolBreakdown)
+{
+    stopMonitorAdaptersFlowTrend();
+
     // 开始监控所有网卡流量统计数据
     std::unique_lock<std::recursive_mutex> lock(adapterFlowTrendMapLock);
 
     adapterFlowTrendMonitorStartTime = time(nullptr);
+    adapterFlowTrendStop             = false;
 
+    // 第一步：获取网卡列表，只有出现在/proc/net/dev中的网卡才能采样
+    std::vector<AdapterInfo>                 adapterList = getNetworkAdapterInfo();
+    std::map<std::string, InterfaceCounters> counters;
+    NetUtil::readNetDev(counters);
+
+    std::string interfaceArgs;
+    for (const auto& adapter : adapterList)
+    {
+        adapterFlowTrendMonitorMap[adapter.name].adapterName = adapter.name;
+        if (counters.find(adapter.name) == counters.end())
+        {
+            LOG_F(WARNING, "网卡：%s 没有内核统计数据，流量将显示为0", adapter.name.c_str());
+            continue;
+        }
+        interfaceArgs += " -i \"" + adapter.name + "\"";
+    }
+
+    // 第二步：所有网卡共用一个采样线程，每秒读取一次内核统计
+    adapterFlowTrendSampleThread =
+        std::make_shared<std::thread>(&TsharkManager::adapterFlowTrendSampleThreadEntry, this);
+
+    if (!protocolBreakdown || interfaceArgs.empty())
+    {
+        return;
+    }
+
+    // 第三步（可选）：一个tshark同时抓取所有网卡，按协议统计流量
     epollFd = epoll_create1(0);
     if (epollFd == -1)
     {
@@ -109,52 +190,221 @@ void TsharkManager::startMonitorAdaptersFlowTrend()
         return;
     }
 
-    // 第一步：获取网卡列表
-    std::vector<AdapterInfo> adapterList = getNetworkAdapterInfo();
+    std::string tsharkCmd = tsharkPath + interfaceArgs +
+                            " -l -T fields -e frame.interface_name -e frame.len -e "
+                            "_ws.col.Protocol";
+    LOG_F(INFO, "Starting tshark for protocol breakdown: %s", tsharkCmd.c_str());
 
-    // 第二步：每个网卡启动一个线程，统计对应网卡的数据
-    for (const auto& adapter : adapterList)
+    pid_t tsharkPid = 0;
+    FILE* pipe      = ProcessUtil::PopenEx(tsharkCmd.c_str(), &tsharkPid, "r");
+    if (!pipe)
     {
-        adapterFlowTrendMonitorMap.insert(std::make_pair(adapter.name, AdapterMonitorInfo()));
-        AdapterMonitorInfo& monitorInfo = adapterFlowTrendMonitorMap[adapter.name];
+        LOG_F(ERROR, "Failed to start tshark for protocol breakdown");
+        return;
+    }
 
-        // 启动 tshark 命令
-        std::string tsharkCmd =
-            tsharkPath + " -i \"" + adapter.name + "\" -T fields -e frame.time_epoch -e frame.len";
-        LOG_F(INFO, "Starting tshark for adapter: %s", adapter.name.c_str());
+    // 获取管道的文件描述符并设置为非阻塞模式
+    int pipeFd = fileno(pipe);
+    int flags  = fcntl(pipeFd, F_GETFL, 0);
+    fcntl(pipeFd, F_SETFL, flags | O_NONBLOCK);
 
-        pid_t tsharkPid = 0;
-        FILE* pipe      = ProcessUtil::PopenEx(tsharkCmd.c_str(), &tsharkPid, "r");
-        if (!pipe)
+    std::unique_ptr<ProtocolMonitorContext> context(new ProtocolMonitorContext());
+    context->pipe = pipe;
+    context->pid  = tsharkPid;
+    for (auto& adapterPair : adapterFlowTrendMonitorMap)
+    {
+        context->adapters[adapterPair.first] = &adapterPair.second;
+    }
+
+    // 注册到 epoll，事件直接携带管道的上下文
+    epoll_event ev;
+    ev.events   = EPOLLIN | EPOLLET; // 边缘触发
+    ev.data.ptr = context.get();
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, pipeFd, &ev) == -1)
+    {
+        LOG_F(ERROR, "Failed to add pipe to epoll for protocol breakdown");
+        ProcessUtil::Kill(tsharkPid);
+        pclose(pipe);
+        return;
+    }
+    protocolMonitor = std::move(context);
+
+    // 启动一个线程来处理 epoll 事件
+    adapterFlowTrendMonitorThread =
+        std::make_shared<std::thread>(&TsharkManager::adapterFlowTrendMonitorThreadEntry, this);
+}
+
+void TsharkManager::adapterFlowTrendSampleThreadEntry()
+{
+    long lastSecond = 0;
+    while (!adapterFlowTrendStop)
+    {
+        long timeNow = time(nullptr);
+        if (timeNow != lastSecond)
         {
-            LOG_F(ERROR, "Failed to start tshark for adapter: %s", adapter.name.c_str());
-            continue;
+            lastSecond = timeNow;
+            sampleAdaptersFlowTrend(timeNow);
         }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
 
-        // 获取管道的文件描述符并设置为非阻塞模式
-        int pipeFd = fileno(pipe);
-        int flags  = fcntl(pipeFd, F_GETFL, 0);
-        fcntl(pipeFd, F_SETFL, flags | O_NONBLOCK);
+    LOG_F(INFO, "adapterFlowTrendSampleThreadEntry has ended.");
+}
 
-        // 注册到 epoll
-        epoll_event ev;
-        ev.events  = EPOLLIN | EPOLLET; // 边缘触发
-        ev.data.fd = pipeFd;
-        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, pipeFd, &ev) == -1)
+void TsharkManager::sampleAdaptersFlowTrend(long timestamp)
+{
+    std::map<std::string, InterfaceCounters> counters;
+    if (!NetUtil::readNetDev(counters))
+    {
+        return;
+    }
+
+    // 网卡表只在采样线程启动前和停止后修改，这里不需要加锁
+    for (auto& pair : adapterFlowTrendMonitorMap)
+    {
+        auto it = counters.find(pair.first);
+        if (it == counters.end())
         {
-            LOG_F(ERROR, "Failed to add pipe to epoll for adapter: %s", adapter.name.c_str());
-            close(pipeFd);
             continue;
         }
 
-        // 保存管道和进程 ID
-        monitorInfo.monitorTsharkPipe = pipe;
-        monitorInfo.tsharkPid         = tsharkPid;
+        AdapterMonitorInfo& monitorInfo  = pair.second;
+        uint64_t            totalBytes   = it->second.rx_bytes + it->second.tx_bytes;
+        uint64_t            totalPackets = it->second.rx_packets + it->second.tx_packets;
+
+        // 首次采样只记录基准；计数变小说明网卡被重置，重新记录基准
+        if (monitorInfo.sampled && totalBytes >= monitorInfo.lastBytes &&
+            totalPackets >= monitorInfo.lastPackets)
+        {
+            uint64_t bytes = totalBytes - monitorInfo.lastBytes;
+            monitorInfo.flowTrend.add(timestamp - 1, static_cast<long>(bytes));
+            monitorInfo.flowRollup.add(timestamp - 1, bytes,
+                                       totalPackets - monitorInfo.lastPackets);
+        }
+        monitorInfo.lastBytes   = totalBytes;
+        monitorInfo.lastPackets = totalPackets;
+        monitorInfo.sampled     = true;
+
+        // 已结束的分钟和小时桶写入数据库
+        std::lock_guard<std::mutex> dbLock(flowTrendSQLiteLock);
+        if (flowTrendSQLiteUtil)
+        {
+            std::vector<std::pair<FlowTrendRollup::Tier, FlowTrendBucket>> completed;
+            monitorInfo.flowRollup.takeCompleted(completed);
+            for (int tier = FlowTrendRollup::TIER_MINUTE; tier < FlowTrendRollup::TIER_COUNT;
+                 tier++)
+            {
+                std::vector<FlowTrendBucket> buckets;
+                for (const auto& entry : completed)
+                {
+                    if (entry.first == tier)
+                    {
+                        buckets.push_back(entry.second);
+                    }
+                }
+                flowTrendSQLiteUtil->insertFlowTrend(pair.first, tier, buckets);
+            }
+        }
     }
+}
 
-    // 启动一个线程来处理 epoll 事件
-    std::thread epollThread(&TsharkManager::adapterFlowTrendMonitorThreadEntry, this);
-    epollThread.detach(); // 分离线程
+bool TsharkManager::setFlowTrendSQLiteUtil(std::shared_ptr<SQLiteUtil> sqliteUtil)
+{
+    std::lock_guard<std::mutex> dbLock(flowTrendSQLiteLock);
+    if (sqliteUtil && !sqliteUtil->createFlowTrendTable())
+    {
+        return false;
+    }
+    flowTrendSQLiteUtil = sqliteUtil;
+    return true;
+}
+
+bool TsharkManager::queryAdapterFlowTrend(const std::string& adapterName, long startTime,
+                                          long endTime, std::vector<FlowTrendBucket>& buckets,
+                                          int& tier)
+{
+    buckets.clear();
+
+    std::unique_lock<std::recursive_mutex> lock(adapterFlowTrendMapLock);
+    auto it = adapterFlowTrendMonitorMap.find(adapterName);
+    if (it == adapterFlowTrendMonitorMap.end() || endTime <= startTime)
+    {
+        return false;
+    }
+
+    // 起始时间截到最早的数据（小时层保留的时间最长，数据库中可能有重启前的数据），
+    // 避免为没有数据的时间段生成大量空桶
+    const FlowTrendRollup&      rollup = it->second.flowRollup;
+    long                        first  = rollup.oldestStart(FlowTrendRollup::TIER_HOUR);
+    std::lock_guard<std::mutex> dbLock(flowTrendSQLiteLock);
+    if (flowTrendSQLiteUtil)
+    {
+        long stored;
+        if (!flowTrendSQLiteUtil->queryFlowTrendStart(adapterName, stored))
+        {
+            return false;
+        }
+        if (stored >= 0 && (first < 0 || stored < first))
+        {
+            first = stored;
+        }
+    }
+    startTime = std::max(startTime, first);
+    if (first < 0 || endTime <= startTime)
+    {
+        tier = FlowTrendRollup::TIER_SECOND;
+        return true;
+    }
+
+    FlowTrendRollup::Tier selected = rollup.tierForSpan(endTime - startTime);
+    long                  width    = FlowTrendRollup::tierSeconds(selected);
+    long                  aligned  = startTime - ((startTime % width) + width) % width;
+    long                  oldest   = rollup.oldestStart(selected);
+    tier                           = selected;
+
+    // 最粗的层仍超过上限时拒绝查询
+    long count = (endTime - aligned - 1) / width + 1;
+    if (count > static_cast<long>(FlowTrendRollup::kMaxQueryBuckets))
+    {
+        LOG_F(WARNING, "Flow trend range of %s is too long: [%ld, %ld)", adapterName.c_str(),
+              startTime, endTime);
+        return false;
+    }
+
+    // 内存中已淘汰或重启前的部分从数据库补齐，秒级数据不持久化
+    long memoryStart = aligned;
+    if (flowTrendSQLiteUtil && selected != FlowTrendRollup::TIER_SECOND)
+    {
+        memoryStart = oldest < 0 ? endTime : std::max(aligned, oldest);
+    }
+    if (aligned < memoryStart)
+    {
+        std::vector<FlowTrendBucket> stored;
+        if (!flowTrendSQLiteUtil->queryFlowTrend(adapterName, selected, aligned, memoryStart,
+                                                 stored))
+        {
+            return false;
+        }
+
+        size_t next = 0;
+        for (long t = aligned; t < memoryStart; t += width)
+        {
+            if (next < stored.size() && stored[next].start == t)
+            {
+                buckets.push_back(stored[next++]);
+            }
+            else
+            {
+                FlowTrendBucket empty = {t, 0, 0, 0};
+                buckets.push_back(empty);
+            }
+        }
+    }
+
+    std::vector<FlowTrendBucket> recent;
+    rollup.query(selected, memoryStart, endTime, recent);
+    buckets.insert(buckets.end(), recent.begin(), recent.end());
+    return true;
 }
 
 void TsharkManager::adapterFlowTrendMonitorThreadEntry()
@@ -162,80 +412,42 @@ void TsharkManager::adapterFlowTrendMonitorThreadEntry()
     epoll_event events[10]; // 事件缓冲区
     int         numEvents;
 
-    while (true)
+    while (!adapterFlowTrendStop)
     {
-        numEvents = epoll_wait(epollFd, events, 10, -1); // 等待事件
+        numEvents = epoll_wait(epollFd, events, 10, 500); // 等待事件
         if (numEvents == -1)
         {
+            if (errno == EINTR)
+            {
+                continue;
+            }
             LOG_F(ERROR, "epoll_wait failed.");
             break;
         }
 
         for (int i = 0; i < numEvents; ++i)
         {
-            int     pipeFd      = events[i].data.fd;
-            char    buffer[256] = {0};
-            ssize_t bytesRead;
-
-            while ((bytesRead = read(pipeFd, buffer, sizeof(buffer) - 1)) > 0)
+            ProtocolMonitorContext& context =
+                *static_cast<ProtocolMonitorContext*>(events[i].data.ptr);
+            int pipeFd = fileno(context.pipe);
+
+            // 边缘触发，一直读到没有数据为止；一次读取可能包含多行或半行
+            LineAssembler::Status status;
+            const char*           line;
+            size_t                length;
+            do
             {
-                buffer[bytesRead] = '\0'; // 确保字符串结尾
-                std::string        line(buffer);
-                std::istringstream iss(line);
-                std::string        timestampStr, lengthStr;
-
-                if (line.find("Capturing") != std::string::npos ||
-                    line.find("captured") != std::string::npos)
-                {
-                    continue;
-                }
-
-                // 解析时间戳和数据包长度
-                if (!(iss >> timestampStr >> lengthStr))
-                {
-                    LOG_F(ERROR, "Failed to parse tshark output: %s", line.c_str());
-                    continue;
-                }
-
-                try
-                {
-                    long timestamp    = static_cast<long>(std::stod(timestampStr));
-                    long packetLength = std::stol(lengthStr);
-
-                    // 更新流量趋势数据
-                    std::unique_lock<std::recursive_mutex> lock(adapterFlowTrendMapLock);
-                    for (auto& pair : adapterFlowTrendMonitorMap)
-                    {
-                        const std::string&  adapterName = pair.first;
-                        AdapterMonitorInfo& monitorInfo = pair.second;
-
-                        if (fileno(monitorInfo.monitorTsharkPipe) == pipeFd)
-                        {
-                            monitorInfo.flowTrendData[timestamp] += packetLength;
-
-                            // 保留最近 300 秒的数据
-                            while (monitorInfo.flowTrendData.size() > 300)
-                            {
-                                auto it = monitorInfo.flowTrendData.begin();
-                                LOG_F(INFO, "Removing old data for second: %ld, Traffic: %ld bytes",
-                                      it->first, it->second);
-                                monitorInfo.flowTrendData.erase(it);
-                            }
-                            break;
-                        }
-                    }
-                }
-                catch (const std::exception& e)
+                status = context.lines.fill(pipeFd);
+                while (context.lines.nextLine(line, length))
                 {
-                    LOG_F(ERROR, "Error parsing tshark output: %s", e.what());
+                    handleProtocolMonitorLine(context, line, length);
                 }
-            }
+            } while (status == LineAssembler::STATUS_MORE);
 
             // 检查管道是否关闭
-            if (bytesRead == 0 || (bytesRead == -1 && errno != EAGAIN))
+            if (status == LineAssembler::STATUS_CLOSED)
             {
                 LOG_F(INFO, "Pipe closed or error occurred for fd: %d", pipeFd);
-                close(pipeFd);                                      // 关闭文件描述符
                 epoll_ctl(epollFd, EPOLL_CTL_DEL, pipeFd, nullptr); // 从 epoll 中移除
             }
         }
@@ -244,43 +456,269 @@ void TsharkManager::adapterFlowTrendMonitorThreadEntry()
     LOG_F(INFO, "adapterFlowTrendMonitorThreadEntry has ended.");
 }
 
+void TsharkManager::handleProtocolMonitorLine(ProtocolMonitorContext& context, const char* line,
+                                              size_t length)
+{
+    const char* end       = line + length;
+    const char* firstTab  = static_cast<const char*>(memchr(line, '\t', length));
+    const char* secondTab = firstTab ? static_cast<const char*>(
+                                           memchr(firstTab + 1, '\t', end - firstTab - 1))
+                                     : nullptr;
+    uint64_t    packetLength;
+    if (!secondTab ||
+        !CommonUtil::parseUint64(firstTab + 1, secondTab - firstTab - 1, packetLength))
+    {
+        LOG_F(ERROR, "Failed to parse tshark output: %.*s", static_cast<int>(length), line);
+        return;
+    }
+
+    // 连续的行大多来自同一个网卡，先和上一行比较
+    size_t              nameLength = firstTab - line;
+    AdapterMonitorInfo* adapter    = context.lastAdapter;
+    if (!adapter || adapter->adapterName.size() != nameLength ||
+        memcmp(adapter->adapterName.data(), line, nameLength) != 0)
+    {
+        context.adapterKey.assign(line, nameLength);
+        auto it = context.adapters.find(context.adapterKey);
+        if (it == context.adapters.end())
+        {
+            return;
+        }
+        adapter             = it->second;
+        context.lastAdapter = adapter;
+    }
+
+    // 只锁所属网卡的统计数据，已出现过的协议不需要分配内存
+    context.protocolKey.assign(secondTab + 1, end - secondTab - 1);
+    std::lock_guard<std::mutex> protocolLock(adapter->protocolLock);
+    auto it = adapter->protocolFlowData.find(context.protocolKey);
+    if (it == adapter->protocolFlowData.end())
+    {
+        adapter->protocolFlowData.insert(
+            std::make_pair(context.protocolKey, static_cast<long>(packetLength)));
+    }
+    else
+    {
+        it->second += static_cast<long>(packetLength);
+    }
+}
+
 bool TsharkManager::getPacketHexData(uint32_t frameNumber, std::vector<unsigned char>& buffer)
 {
-    if (frameNumber >= allPackets.size())
+    PacketBytes bytes;
+    if (!getPacketBytes(frameNumber, bytes))
     {
         return false;
     }
-    std::ifstream file(currentFilePath, std::ios::binary);
-    if (!file)
+    buffer.assign(bytes.data, bytes.data + bytes.length);
+    return true;
+}
+
+bool TsharkManager::getPacketBytes(uint32_t frameNumber, PacketBytes& bytes)
+{
+    bytes.frame_number = frameNumber;
+    bytes.data         = nullptr;
+    bytes.length       = 0;
+    bytes.storage.reset();
+    bytes.mapping.reset();
+
+    // 分析线程追加数据包时会扩展allPackets和frameIndex，读取期间持有锁
+    std::lock_guard<std::mutex> lock(allPacketsLock);
+    uint32_t                    index;
+    if (!frameIndex.find(frameNumber, index))
+    {
+        return false;
+    }
+
+    const CompactPacket& record = allPackets.at(index);
+    if (!readCaptureRange(record.file_offset, record.cap_len, bytes))
     {
-        LOG_F(ERROR, "packet_file open failed");
+        LOG_F(ERROR, "Packet %u is out of range of %s", frameNumber, currentFilePath.c_str());
+        return false;
     }
-    if (file.fail())
+    return true;
+}
+
+bool TsharkManager::readCaptureRange(uint64_t offset, uint32_t length, PacketBytes& bytes)
+{
+    if (currentFilePath.empty())
     {
-        LOG_F(ERROR, "not found location");
+        return false;
     }
-    if (allPackets.find(frameNumber) != allPackets.end())
+    if ((!currentFile || currentFile->path() != currentFilePath) &&
+        (!currentCompressedFile.isOpen() || currentCompressedFile.path() != currentFilePath))
     {
-        std::shared_ptr<Packet> packet  = allPackets[frameNumber];
-        uint32_t                cap_len = packet->cap_len;
-        buffer.resize(cap_len);
-        file.read(reinterpret_cast<char*>(buffer.data()), cap_len);
+        if (!openCurrentFile())
+        {
+            return false;
+        }
+    }
+
+    if (currentCompressedFile.isOpen())
+    {
+        // 压缩文件只解压包含该区间的部分
+        bytes.storage = std::make_shared<std::vector<unsigned char>>(length);
+        if (currentCompressedFile.read(offset, bytes.storage->data(), length) != length)
+        {
+            bytes.storage.reset();
+            return false;
+        }
+        bytes.data   = bytes.storage->data();
+        bytes.length = length;
         return true;
     }
-    LOG_F(ERROR, "ERROR!");
-    return false;
+
+    const unsigned char* data = currentFile->range(offset, length);
+    if (!data)
+    {
+        // 抓包文件在映射之后又被追加了数据，换用新的映射，旧映射在交出的数据释放后解除
+        std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+        if (file->open(currentFilePath))
+        {
+            currentFile = file;
+            data        = currentFile->range(offset, length);
+        }
+    }
+    if (!data)
+    {
+        return false;
+    }
+
+    bytes.data    = data;
+    bytes.length  = length;
+    bytes.mapping = currentFile;
+    return true;
 }
 
-bool TsharkManager::analysisFile(std::string filePath)
+bool TsharkManager::openCurrentFile()
+{
+    currentFile.reset();
+    currentCompressedFile.close();
+    currentReader = CaptureReader();
+    switch (CompressedFile::detect(currentFilePath))
+    {
+    case CompressedFile::FORMAT_GZIP:
+        if (!currentCompressedFile.open(currentFilePath))
+        {
+            return false;
+        }
+        break;
+    case CompressedFile::FORMAT_ZSTD:
+        LOG_F(ERROR, "zstd compressed captures are not supported: %s", currentFilePath.c_str());
+        return false;
+    default:
+        currentFile = std::make_shared<MappedFile>();
+        if (!currentFile->open(currentFilePath))
+        {
+            currentFile.reset();
+            return false;
+        }
+        break;
+    }
+
+    // 读取文件头和第一个数据包之前的接口描述，随机读取数据包时据此确定链路类型
+    std::vector<unsigned char> head(64 * 1024);
+    if (currentCompressedFile.isOpen())
+    {
+        head.resize(currentCompressedFile.read(0, head.data(), head.size()));
+    }
+    else
+    {
+        head.assign(currentFile->data(),
+                    currentFile->data() + std::min<uint64_t>(currentFile->size(), head.size()));
+    }
+    std::vector<CaptureRecord> records;
+    uint64_t                   nextOffset;
+    if (currentReader.readHeader(head.data(), head.size()))
+    {
+        currentReader.readRecords(head.data(), head.size(), currentReader.headerSize(), records,
+                                  nextOffset, 1);
+    }
+    return true;
+}
+
+bool TsharkManager::getPacketHexDump(uint32_t frameNumber, std::string& dump)
+{
+    PacketBytes bytes;
+    if (!getPacketBytes(frameNumber, bytes))
+    {
+        return false;
+    }
+    dump.clear();
+    HexDumpUtil::dump(bytes.data, bytes.length, dump);
+    return true;
+}
+
+void TsharkManager::getPacketsBytes(const std::vector<uint32_t>& frameNumbers,
+                                    std::vector<PacketBytes>&    bytes)
+{
+    bytes.resize(frameNumbers.size());
+    for (size_t i = 0; i < frameNumbers.size(); i++)
+    {
+        getPacketBytes(frameNumbers[i], bytes[i]);
+    }
+}
+
+void TsharkManager::resetAnalysis()
+{
+    {
+        std::lock_guard<std::mutex> lock(allPacketsLock);
+        allPackets.clear();
+        frameIndex.clear();
+        flowTable.clear();
+        tcpMetrics.clear();
+        protocolHierarchy.clear();
+        storedPacketCount = 0;
+    }
+    liveStats.reset();
+    endpointStats.reset();
+}
+
+bool TsharkManager::loadPacketIndex(const std::string& filePath)
+{
+    std::lock_guard<std::mutex> lock(allPacketsLock);
+    if (!PacketIndexFile::load(filePath, allPackets, &tcpMetrics, &liveStats, &endpointStats))
+    {
+        return false;
+    }
+
+    // 连接表和协议分层不保存在索引文件中，由紧凑记录重建，协议栈先按ID汇总；
+    // 连接编号按记录顺序分配，与保存的TCP指标一致
+    frameIndex.clear();
+    flowTable.clear();
+    protocolHierarchy.clear();
+    std::map<uint16_t, std::pair<uint64_t, uint64_t>> stacks;
+    for (size_t i = 0; i < allPackets.size(); i++)
+    {
+        const CompactPacket& record = allPackets.at(i);
+        uint32_t             flowId;
+        frameIndex.insert(record.frame_number, static_cast<uint32_t>(i));
+        flowTable.add(record, static_cast<uint32_t>(i), flowId);
+        std::pair<uint64_t, uint64_t>& stack = stacks[record.stack_id];
+        stack.first += record.len;
+        stack.second++;
+    }
+    for (const auto& item : stacks)
+    {
+        protocolHierarchy.add(allPackets.protocolStack(item.first), item.second.first,
+                              item.second.second);
+    }
+    storedPacketCount = 0;
+    return true;
+}
+
+bool TsharkManager::readTsharkFields(const std::string&                  filePath,
+                                     const std::function<void(Packet&)>& onPacket)
 {
     std::vector<std::string> tsharkArgs = {
-        tsharkPath,      "-r", filePath,           "-T", "fields",           "-e",
-        "frame.number",  "-e", "frame.time_epoch", "-e", "frame.len",        "-e",
-        "frame.cap_len", "-e", "eth.src",          "-e", "eth.dst",          "-e",
-        "ip.src",        "-e", "ipv6.src",         "-e", "ip.dst",           "-e",
-        "ipv6.dst",      "-e", "tcp.srcport",      "-e", "udp.srcport",      "-e",
-        "tcp.dstport",   "-e", "udp.dstport",      "-e", "_ws.col.Protocol", "-e",
-        "_ws.col.Info",
+        tsharkPath,         "-r", filePath,           "-T", "fields",          "-e",
+        "frame.number",     "-e", "frame.time_epoch", "-e", "frame.len",       "-e",
+        "frame.cap_len",    "-e", "eth.src",          "-e", "eth.dst",         "-e",
+        "ip.src",           "-e", "ipv6.src",         "-e", "ip.dst",          "-e",
+        "ipv6.dst",         "-e", "tcp.srcport",      "-e", "udp.srcport",     "-e",
+        "tcp.dstport",      "-e", "udp.dstport",      "-e", "ip.proto",        "-e",
+        "ipv6.nxt",         "-e", "tcp.flags",        "-e", "frame.protocols", "-e",
+        "_ws.col.Protocol", "-e", "_ws.col.Info",
     };
 
     std::string cmd;
@@ -298,70 +736,542 @@ bool TsharkManager::analysisFile(std::string filePath)
 
     char buffer[4096];
 
-    // 当前处理的报文在文件中的偏移，第一个报文的偏移就是全局文件头24(也就是sizeof(PcapHeader))字节
-    uint32_t file_offset = sizeof(PcapHeader);
+    // 解析结果写入同一个Packet，入库时转为紧凑记录，逐包不再分配内存
+    Packet packet;
     while (fgets(buffer, sizeof(buffer), pipe) != nullptr)
     {
-        std::shared_ptr<Packet> packet = std::make_shared<Packet>();
         if (!parseLine(buffer, packet))
         {
             LOG_F(ERROR, "%s", buffer);
             assert(false);
         }
 
-        // 计算当前报文的偏移，然后记录在Packet对象中
-        packet->file_offset = file_offset + sizeof(PacketHeader);
-
-        // 更新偏移游标
-        file_offset = file_offset + sizeof(PacketHeader) + packet->cap_len;
-
         // 获取IP地理位置
         if (!IP2RegionUtil::init(ip2RegionDbPath)) {
             LOG_F(WARNING, "无法初始化IP2Region数据库，IP地理位置信息将不可用");
         } else {
-            packet->src_location = IP2RegionUtil::getIpLocation(packet->src_ip);
-            packet->dst_location = IP2RegionUtil::getIpLocation(packet->dst_ip);
+            packet.src_location = IP2RegionUtil::getIpLocation(packet.src_ip);
+            packet.dst_location = IP2RegionUtil::getIpLocation(packet.dst_ip);
         }
 
-        processPacket(packet);
+        onPacket(packet);
     }
     pclose(pipe);
+    return true;
+}
+
+bool TsharkManager::analysisFile(std::string filePath)
+{
+    // 从头分析整个文件时，先尝试直接加载上次分析留下的索引文件
+    bool fullAnalysis = getPacketCount() == 0;
+    if (fullAnalysis)
+    {
+        liveStats.reset();
+        endpointStats.reset();
+    }
+    if (fullAnalysis && loadPacketIndex(filePath))
+    {
+        LOG_F(INFO, "Loaded %zu packets from index of %s", getPacketCount(), filePath.c_str());
+        std::lock_guard<std::mutex> lock(allPacketsLock);
+        currentFilePath = filePath;
+        openCurrentFile();
+        return true;
+    }
+
+    // 报文在文件中的偏移由记录读取器得到，pcap和pcapng文件都适用，
+    // gzip压缩的文件边解压边读取，偏移是解压后数据中的偏移（tshark可直接读取压缩文件）
+    CaptureFileScanner scanner;
+    if (!scanner.open(filePath))
+    {
+        LOG_F(ERROR, "Failed to read capture file header of %s", filePath.c_str());
+        return false;
+    }
 
+    // 记录按批读取，不为整个文件保存记录头
+    const size_t               batchSize = 4096;
+    std::vector<CaptureRecord> records;
+    size_t                     cursor    = 0;
+    bool                       recordsOk = true;
+    bool ok = readTsharkFields(filePath, [&](Packet& packet) {
+        if (cursor == records.size())
+        {
+            cursor    = 0;
+            recordsOk = recordsOk && scanner.next(records, batchSize);
+        }
+        if (cursor == records.size())
+        {
+            LOG_F(ERROR, "No capture record for packet %u", packet.frame_number);
+            return;
+        }
+
+        const CaptureRecord& record = records[cursor++];
+        if (record.cap_len != packet.cap_len)
+        {
+            LOG_F(WARNING, "Capture length mismatch of packet %u: %u vs %u", packet.frame_number,
+                  record.cap_len, packet.cap_len);
+        }
+        packet.file_offset = record.data_offset;
+
+        DecodedPacket decoded;
+        bool          native = PacketDecoder::decode(record.link_type, scanner.recordData(record),
+                                                     record.cap_len, decoded);
+        processPacket(packet, native ? &decoded : nullptr);
+    });
+    ok = ok && recordsOk;
+    liveStats.flush();
+    if (!ok)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(allPacketsLock);
     currentFilePath = filePath;
+    openCurrentFile();
+    if (fullAnalysis)
+    {
+        PacketIndexFile::save(filePath, allPackets, &tcpMetrics, &liveStats, &endpointStats);
+    }
+    return true;
+}
 
+bool TsharkManager::startIncrementalAnalysis(const std::string& filePath)
+{
+    stopIncrementalAnalysis();
+
+    resetAnalysis();
+    {
+        std::lock_guard<std::mutex> lock(allPacketsLock);
+        currentFilePath = filePath;
+    }
+    incrementalFilePath = filePath;
+    incrementalOffset   = 0;
+    incrementalFrames   = 0;
+    incrementalReader   = CaptureReader();
+    incrementalStop     = false;
+    incrementalHeader.clear();
+
+    incrementalThread =
+        std::make_shared<std::thread>(&TsharkManager::incrementalAnalysisThreadEntry, this);
     return true;
 }
 
+void TsharkManager::stopIncrementalAnalysis()
+{
+    if (incrementalThread && incrementalThread->joinable())
+    {
+        incrementalStop = true;
+        incrementalThread->join();
+        incrementalThread.reset();
+    }
+}
+
+bool TsharkManager::analyzeAppendedPackets()
+{
+    // 文件可能还没有被创建
+    if (access(incrementalFilePath.c_str(), R_OK) != 0)
+    {
+        return true;
+    }
+
+    MappedFile file;
+    if (!file.open(incrementalFilePath))
+    {
+        return false;
+    }
+
+    // 文件被截断或被替换（变短或文件头不同）时，已解析的偏移不再有效，从头重新分析
+    if (incrementalOffset > 0 &&
+        (file.size() < incrementalOffset ||
+         memcmp(file.data(), incrementalHeader.data(), incrementalHeader.size()) != 0))
+    {
+        LOG_F(WARNING, "%s was truncated or replaced, analyzing it again",
+              incrementalFilePath.c_str());
+        resetAnalysis();
+        if (sqliteUtil && !sqliteUtil->clearPackets())
+        {
+            LOG_F(ERROR, "Failed to clear stored packets");
+        }
+        incrementalOffset = 0;
+        incrementalFrames = 0;
+        incrementalReader = CaptureReader();
+        incrementalHeader.clear();
+    }
+
+    if (incrementalOffset == 0)
+    {
+        if (!incrementalReader.readHeader(file.data(), file.size()))
+        {
+            // 文件头还没有写完时等待下一次追加
+            return incrementalReader.truncated();
+        }
+        incrementalOffset = incrementalReader.headerSize();
+        incrementalHeader.assign(reinterpret_cast<const char*>(file.data()), incrementalOffset);
+    }
+
+    // pcapng的接口描述块可能在任意位置出现，先记下已读取的节头和接口描述块
+    std::vector<std::pair<uint64_t, uint64_t>> headerBlocks = incrementalReader.sectionBlocks();
+    std::vector<CaptureRecord>                 records;
+    uint64_t                                   nextOffset;
+    if (!incrementalReader.readRecords(file.data(), file.size(), incrementalOffset, records,
+                                       nextOffset))
+    {
+        return false;
+    }
+    if (records.empty())
+    {
+        // 新增的可能只有接口描述等元数据块
+        incrementalOffset = nextOffset;
+        return true;
+    }
+
+    // 文件头（pcapng为节头和接口描述块）加上新增的块组成一个临时抓包文件，tshark只解析这一部分
+    std::string tmpPath = incrementalFilePath + ".part";
+    FILE*       tmp     = fopen(tmpPath.c_str(), "wb");
+    if (!tmp)
+    {
+        LOG_F(ERROR, "Failed to create %s", tmpPath.c_str());
+        return false;
+    }
+    bool written = true;
+    for (const auto& block : headerBlocks)
+    {
+        uint64_t blockSize = block.second - block.first;
+        written = written && fwrite(file.data() + block.first, 1, blockSize, tmp) == blockSize;
+    }
+    uint64_t bodySize = nextOffset - incrementalOffset;
+    written = written && fwrite(file.data() + incrementalOffset, 1, bodySize, tmp) == bodySize;
+    written = fclose(tmp) == 0 && written;
+
+    // tshark输出的帧编号从1开始，偏移取自原文件中的记录位置
+    size_t index    = 0;
+    auto   onPacket = [&](Packet& packet) {
+        if (index >= records.size())
+        {
+            return;
+        }
+        const CaptureRecord& record = records[index++];
+        packet.frame_number += incrementalFrames;
+        packet.file_offset = record.data_offset;
+
+        const unsigned char* data = file.range(record.data_offset, record.cap_len);
+        DecodedPacket        decoded;
+        bool                 native =
+            PacketDecoder::decode(record.link_type, data, record.cap_len, decoded);
+        processPacket(packet, native ? &decoded : nullptr);
+    };
+    bool ok = written && readTsharkFields(tmpPath, onPacket);
+    std::remove(tmpPath.c_str());
+    if (!ok)
+    {
+        LOG_F(ERROR, "Failed to analyze appended packets of %s", incrementalFilePath.c_str());
+        return false;
+    }
+
+    incrementalFrames += records.size();
+    incrementalOffset = nextOffset;
+    LOG_F(INFO, "Analyzed %zu appended packets of %s", records.size(),
+          incrementalFilePath.c_str());
+
+    if (sqliteUtil && !storePackets(*sqliteUtil))
+    {
+        LOG_F(ERROR, "Failed to store packets");
+    }
+    return true;
+}
+
+void TsharkManager::incrementalAnalysisThreadEntry()
+{
+    // 监听文件所在目录，文件尚未创建或被替换时也能收到事件
+    size_t      slash    = incrementalFilePath.rfind('/');
+    std::string dir      = slash == std::string::npos ? "." : incrementalFilePath.substr(0, slash);
+    std::string fileName = incrementalFilePath.substr(slash == std::string::npos ? 0 : slash + 1);
+
+    int inotifyFd = inotify_init1(IN_NONBLOCK);
+    if (inotifyFd < 0 ||
+        inotify_add_watch(inotifyFd, dir.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE) < 0)
+    {
+        LOG_F(ERROR, "Failed to watch %s", incrementalFilePath.c_str());
+        if (inotifyFd >= 0)
+        {
+            close(inotifyFd);
+        }
+        return;
+    }
+
+    alignas(struct inotify_event) char buffer[4096];
+    while (!incrementalStop)
+    {
+        pollfd pfd = {inotifyFd, POLLIN, 0};
+        if (poll(&pfd, 1, 500) <= 0)
+        {
+            continue;
+        }
+
+        bool    changed = false;
+        ssize_t length;
+        while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* p = buffer; p < buffer + length;)
+            {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+                if (event->len > 0 && fileName == event->name)
+                {
+                    changed = true;
+                }
+                p += sizeof(inotify_event) + event->len;
+            }
+        }
+
+        if (changed)
+        {
+            analyzeAppendedPackets();
+        }
+    }
+
+    // 处理停止前最后写入的数据包
+    analyzeAppendedPackets();
+    close(inotifyFd);
+}
+
 bool TsharkManager::analysisFile(std::string filePath, std::vector<std::shared_ptr<Packet>>& packets)
 {
-    allPackets.clear();
-    
+    resetAnalysis();
+
     // 调用原有的analysisFile方法
     if (!analysisFile(filePath)) {
         return false;
     }
-    
-    // 将allPackets中的数据复制到packets中
+
+    // 按分析顺序（即帧编号顺序）还原数据包
     packets.clear();
-    for (const auto& pair : allPackets) {
-        packets.push_back(pair.second);
+    packets.reserve(allPackets.size());
+    for (size_t i = 0; i < allPackets.size(); i++) {
+        packets.push_back(allPackets.materialize(i));
     }
-    
+
+    return true;
+}
+
+bool TsharkManager::storePackets(SQLiteUtil& sqliteUtil)
+{
+    std::lock_guard<std::mutex> lock(allPacketsLock);
+    if (storedPacketCount == allPackets.size())
+    {
+        return true;
+    }
+
+    if (!sqliteUtil.insertPacket(allPackets, storedPacketCount, allPackets.size()))
+    {
+        return false;
+    }
+    storedPacketCount = allPackets.size();
+
+    // 只写入有新数据包的连接
+    std::vector<uint32_t> flowIds;
+    flowTable.takeDirty(flowIds);
+    std::vector<Conversation> conversations(flowIds.size());
+    for (size_t i = 0; i < flowIds.size(); i++)
+    {
+        flowTable.toConversation(flowIds[i], conversations[i]);
+    }
+    if (!sqliteUtil.upsertFlows(conversations))
+    {
+        return false;
+    }
+
+    std::vector<TcpFlowMetrics> metrics;
+    for (uint32_t flowId : flowIds)
+    {
+        TcpFlowMetrics flowMetrics;
+        if (tcpMetrics.get(flowId, flowMetrics))
+        {
+            metrics.push_back(flowMetrics);
+        }
+    }
+    if (!sqliteUtil.upsertTcpMetrics(metrics))
+    {
+        return false;
+    }
+
+    // 协议分层统计只有几十个节点，有变化时整体替换
+    uint64_t version = protocolHierarchy.version();
+    if (version == storedHierarchyVersion)
+    {
+        return true;
+    }
+    std::vector<ProtocolHierarchyNode> nodes;
+    protocolHierarchy.snapshot(nodes);
+    if (!sqliteUtil.replaceProtocolHierarchy(nodes))
+    {
+        return false;
+    }
+    storedHierarchyVersion = version;
     return true;
 }
 
-void TsharkManager::processPacket(std::shared_ptr<Packet> packet)
+bool TsharkManager::getTcpMetrics(uint32_t flowId, TcpFlowMetrics& metrics)
 {
-    // 将分析的数据包插入保存起来
-    allPackets.insert(std::make_pair<>(packet->frame_number, packet));
+    std::lock_guard<std::mutex> lock(allPacketsLock);
+    return tcpMetrics.get(flowId, metrics);
+}
 
-    // 等待入库
-    waitInsertPacketsLock.lock();
-    waitInsertPackets.push_back(packet);
-    waitInsertPacketsLock.unlock();
+void TsharkManager::getProtocolHierarchy(std::vector<ProtocolHierarchyNode>& nodes)
+{
+    protocolHierarchy.snapshot(nodes);
 }
 
-bool TsharkManager::parseLine(std::string line, std::shared_ptr<Packet> packet)
+void TsharkManager::getConversations(std::vector<Conversation>& conversations)
+{
+    std::lock_guard<std::mutex> lock(allPacketsLock);
+    conversations.resize(flowTable.size());
+    for (size_t i = 0; i < flowTable.size(); i++)
+    {
+        flowTable.toConversation(i, conversations[i]);
+    }
+}
+
+bool TsharkManager::getTcpStream(uint32_t flowId, TcpStream& stream)
+{
+    struct PacketLocation
+    {
+        uint64_t offset;
+        uint32_t length;
+    };
+
+    // 在锁内取出该连接各数据包的位置，只重组这一个连接
+    FlowRecord                  flow;
+    std::vector<PacketLocation> locations;
+    {
+        std::lock_guard<std::mutex> lock(allPacketsLock);
+        if (flowId >= flowTable.size() || flowTable.at(flowId).key.ip_proto != IPPROTO_TCP)
+        {
+            return false;
+        }
+        flow = flowTable.at(flowId);
+        flowTable.forEachPacket(flowId, [&](uint32_t index) {
+            const CompactPacket& record = allPackets.at(index);
+            locations.push_back(PacketLocation{record.file_offset, record.cap_len});
+        });
+    }
+
+    // 逐个读取数据包，读取时短暂持有锁，解码和重组不阻塞分析线程
+    TcpReassembler reassembler;
+    for (const PacketLocation& location : locations)
+    {
+        PacketBytes bytes;
+        uint16_t    linkType;
+        size_t      header = static_cast<size_t>(
+            std::min<uint64_t>(location.offset, CaptureReader::kMaxRecordHeader));
+        {
+            std::lock_guard<std::mutex> lock(allPacketsLock);
+            if (!readCaptureRange(location.offset - header, location.length + header, bytes) ||
+                !currentReader.linkTypeBefore(bytes.data, header, location.length, linkType))
+            {
+                LOG_F(WARNING, "Failed to read packet at offset %llu of %s",
+                      static_cast<unsigned long long>(location.offset), currentFilePath.c_str());
+                continue;
+            }
+        }
+
+        // 隧道等情况下解码得到的可能是外层头部，不属于该连接的不参与重组
+        DecodedPacket segment;
+        if (!PacketDecoder::decode(linkType, bytes.data + header, location.length, segment) ||
+            segment.ip_proto != IPPROTO_TCP || segment.fragment)
+        {
+            continue;
+        }
+        for (uint8_t direction = 0; direction < 2; direction++)
+        {
+            if (segment.src_ip == flow.key.addr[direction] &&
+                segment.src_port == flow.key.port[direction] &&
+                segment.dst_ip == flow.key.addr[1 - direction] &&
+                segment.dst_port == flow.key.port[1 - direction])
+            {
+                reassembler.add(flowId, direction, segment);
+                break;
+            }
+        }
+    }
+    reassembler.finish();
+
+    uint8_t client     = flow.initiator;
+    stream.flow_id     = flowId;
+    stream.client_ip   = NetUtil::formatIp(flow.key.addr[client]);
+    stream.client_port = flow.key.port[client];
+    stream.server_ip   = NetUtil::formatIp(flow.key.addr[1 - client]);
+    stream.server_port = flow.key.port[1 - client];
+    return reassembler.stream(flowId, client, stream.client) &&
+           reassembler.stream(flowId, 1 - client, stream.server);
+}
+
+size_t TsharkManager::getPacketCount()
+{
+    std::lock_guard<std::mutex> lock(allPacketsLock);
+    return allPackets.size();
+}
+
+void TsharkManager::getPackets(uint32_t firstFrame, uint32_t lastFrame,
+                               std::vector<std::shared_ptr<Packet>>& packets)
+{
+    std::lock_guard<std::mutex> lock(allPacketsLock);
+    packets.clear();
+    frameIndex.forEachInRange(firstFrame, lastFrame, [&](uint32_t, uint32_t index) {
+        packets.push_back(allPackets.materialize(index));
+    });
+}
+
+bool TsharkManager::filterPackets(const std::map<std::string, std::string>& conditions,
+                                  std::vector<std::shared_ptr<Packet>>&     packets)
+{
+    // 直接扫描allPackets中的紧凑记录，不另外保存一份用于过滤的数据
+    std::lock_guard<std::mutex> lock(allPacketsLock);
+    std::vector<uint32_t>       indexes;
+    if (!PacketFilter(allPackets).filter(conditions, indexes))
+    {
+        LOG_F(ERROR, "Invalid filter conditions");
+        return false;
+    }
+
+    packets.clear();
+    packets.reserve(indexes.size());
+    for (uint32_t index : indexes)
+    {
+        packets.push_back(allPackets.materialize(index));
+    }
+    return true;
+}
+
+void TsharkManager::processPacket(const Packet& packet, const DecodedPacket* decoded)
+{
+    liveStats.add(packet);
+    endpointStats.add(packet);
+    protocolHierarchy.add(packet.frame_protocols, packet.len);
+
+    // 将分析的数据包插入保存起来，存储线程从allPackets中读取尚未入库的部分
+    std::lock_guard<std::mutex> lock(allPacketsLock);
+    uint32_t index = allPackets.append(packet);
+    uint32_t flowId;
+    uint8_t  direction;
+    frameIndex.insert(packet.frame_number, index);
+    if (flowTable.add(allPackets.at(index), index, flowId, direction) && decoded)
+    {
+        addTcpMetrics(allPackets.at(index), flowId, direction, *decoded);
+    }
+}
+
+void TsharkManager::addTcpMetrics(const CompactPacket& record, uint32_t flowId, uint8_t direction,
+                                  const DecodedPacket& decoded)
+{
+    // 隧道等情况下原生解码得到的可能是外层头部，与tshark给出的端口不一致时不计入
+    if (record.ip_proto != IPPROTO_TCP || decoded.ip_proto != IPPROTO_TCP ||
+        decoded.src_port != record.src_port || decoded.dst_port != record.dst_port)
+    {
+        return;
+    }
+    tcpMetrics.add(flowId, direction, record.time, record.len, decoded);
+}
+
+bool TsharkManager::parseLine(std::string line, Packet& packet)
 {
     // line = UTF8ToANSIString(line);
     if (line.back() == '\n')
@@ -395,26 +1305,41 @@ bool TsharkManager::parseLine(std::string line, std::shared_ptr<Packet> packet)
     IP2RegionUtil ip2RegionUtil;
     ip2RegionUtil.init("resources/ip2region.xdb");
 
-    if (fields.size() >= 16)
+    if (fields.size() >= 20)
     {
-        packet->frame_number = std::stoi(fields[0]);
-        packet->time         = std::stod(fields[1]);
-        packet->len          = std::stoi(fields[2]);
-        packet->cap_len      = std::stoi(fields[3]);
-        packet->src_mac      = fields[4];
-        packet->dst_mac      = fields[5];
-        packet->src_ip       = fields[6].empty() ? fields[7] : fields[6];
-        packet->dst_ip       = fields[8].empty() ? fields[9] : fields[8];
+        packet.frame_number = std::stoi(fields[0]);
+        packet.time         = std::stod(fields[1]);
+        packet.len          = std::stoi(fields[2]);
+        packet.cap_len      = std::stoi(fields[3]);
+        packet.src_mac      = fields[4];
+        packet.dst_mac      = fields[5];
+        packet.src_ip       = fields[6].empty() ? fields[7] : fields[6];
+        packet.dst_ip       = fields[8].empty() ? fields[9] : fields[8];
+        packet.src_port     = 0;
+        packet.dst_port     = 0;
         if (!fields[10].empty() || !fields[11].empty())
         {
-            packet->src_port = std::stoi(fields[10].empty() ? fields[11] : fields[10]);
+            packet.src_port = std::stoi(fields[10].empty() ? fields[11] : fields[10]);
         }
         if (!fields[12].empty() || !fields[13].empty())
         {
-            packet->dst_port = std::stoi(fields[12].empty() ? fields[13] : fields[12]);
+            packet.dst_port = std::stoi(fields[12].empty() ? fields[13] : fields[12]);
+        }
+        packet.ip_proto  = 0;
+        packet.tcp_flags = 0;
+        if (!fields[14].empty() || !fields[15].empty())
+        {
+            packet.ip_proto = std::stoi(fields[14].empty() ? fields[15] : fields[14]);
         }
-        packet->protocol = fields[14];
-        packet->info     = fields[15];
+        if (!fields[16].empty())
+        {
+            packet.tcp_flags = std::stoul(fields[16], nullptr, 16);
+        }
+        packet.frame_protocols = fields[17];
+        packet.protocol        = fields[18];
+        packet.info            = fields[19];
+        packet.src_location.clear();
+        packet.dst_location.clear();
         return true;
     }
     else
@@ -511,9 +1436,10 @@ void TsharkManager::printAllPackets()
 {
     uint32_t count = allPackets.size();
     LOG_F(INFO, "Number of packets: %u", count);
-    for (auto pair : allPackets)
+    std::string hexDump; // 各数据包复用同一块缓冲区
+    for (size_t i = 0; i < allPackets.size(); i++)
     {
-        std::shared_ptr<Packet> packet = pair.second;
+        std::shared_ptr<Packet> packet = allPackets.materialize(i);
         count++;
         // 构建JSON对象
         rapidjson::Document                 pktObj;
@@ -565,14 +1491,13 @@ void TsharkManager::printAllPackets()
         // LOG_F(INFO, "网卡[%d]: name[%s] remark[%s]", adapterId, adapterName.c_str(),
         // adapterRemark.c_str());
 
-        std::vector<unsigned char> buffer2(packet->cap_len);
-        getPacketHexData(packet->frame_number, buffer2);
-        std::stringstream hex_str;
-        hex_str << "Packet Hex: ";
-        for (unsigned char byte : buffer2)
-            hex_str << std::hex << std::setfill('0') << std::setw(2) << static_cast<int>(byte)
-                    << " ";
-        LOG_F(INFO, "%s\n", hex_str.str().c_str());
+        PacketBytes bytes;
+        if (getPacketBytes(packet->frame_number, bytes))
+        {
+            hexDump = "Packet Hex:\n";
+            HexDumpUtil::dump(bytes.data, bytes.length, hexDump);
+            LOG_F(INFO, "%s", hexDump.c_str());
+        }
     }
     LOG_F(INFO, "Number of packets: %zu", count);
 }
@@ -583,6 +1508,9 @@ bool TsharkManager::startCapture(std::string adapterName)
     stopFlag = false;
     storageThread = std::make_shared<std::thread>(&TsharkManager::storageThreadEntry, this);
     captureWorkThread = std::make_shared<std::thread>(&TsharkManager::captureWorkThreadEntry, this, "\"" + adapterName + "\"");
+
+    // 边抓包边解析写入capture.pcap的数据包
+    startIncrementalAnalysis("capture.pcap");
     return true;
 }
 
@@ -597,6 +1525,9 @@ bool TsharkManager::stopCapture()
         captureWorkThread.reset();
     }
 
+    // 等待增量分析处理完剩余的数据包
+    stopIncrementalAnalysis();
+
     // 等待存储线程退出
     if (storageThread && storageThread->joinable()) {
         storageThread->join();
@@ -699,7 +1630,7 @@ void TsharkManager::captureWorkThreadEntry(std::string adapterName)
         }
 
         char     buffer[4096];
-        uint32_t file_offset = sizeof(PcapHeader);
+        uint64_t file_offset = sizeof(PcapHeader);
 
         while (!stopFlag)
         {
@@ -997,19 +1928,16 @@ bool TsharkManager::convertXmlToJson(const std::string& xmlFile, const std::stri
 void TsharkManager::storageThreadEntry()
 {
     auto storageWork = [this]() {
-        waitInsertPacketsLock.lock();
-
         // 检查数据包列表是否有新的数据可供存储
-        if (!waitInsertPackets.empty()) {
-            sqliteUtil->insertPacket(waitInsertPackets);
-            waitInsertPackets.clear();
+        if (sqliteUtil && !storePackets(*sqliteUtil)) {
+            LOG_F(ERROR, "Failed to store packets");
         }
-
-        waitInsertPacketsLock.unlock();
     };
 
     while (!stopFlag) {
         storageWork();
+        // 没有新数据包时也按秒发布实时统计，留1秒给还在路上的数据包
+        liveStats.advance(time(nullptr) - 1);
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
 
@@ -1,6 +1,12 @@
 #include <algorithm>
+#include <arpa/inet.h>
+#include <cctype>
+#include <cerrno>
 #include <chrono>
+#include <cmath>
+#include <cstring>
 #include <ctime>
+#include <fcntl.h>
 #include <fstream>
 #include <iconv.h>
 #include <iomanip>
@@ -8,6 +14,7 @@
 #include <map>
 #include <sstream>
 #include <stdexcept>
+#include <unistd.h>
 #include <vector>
 
 #include "loguru.hpp"
@@ -16,11 +23,62 @@
 #include "rapidjson/writer.h"
 
 #include "ip2region/xdb_search.h"
+#include "packetStore.hpp"
 #include "tsharkDataType.hpp"
 #include "utils.hpp"
 #include <sqlite3.h>
 
 
+namespace
+{
+    // 基于文件描述符的rapidjson输出流，带固定大小的缓冲区
+    class FdWriteStream
+    {
+    public:
+        typedef char Ch;
+
+        explicit FdWriteStream(int fd) : fd(fd), used(0), failed(false) {}
+        ~FdWriteStream() { Flush(); }
+
+        void Put(Ch c)
+        {
+            if (used == sizeof(buffer))
+            {
+                Flush();
+            }
+            buffer[used++] = c;
+        }
+
+        void Flush()
+        {
+            size_t written = 0;
+            while (written < used && !failed)
+            {
+                ssize_t n = write(fd, buffer + written, used - written);
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (n <= 0)
+                {
+                    failed = true;
+                    break;
+                }
+                written += n;
+            }
+            used = 0;
+        }
+
+        bool Failed() const { return failed; }
+
+    private:
+        int    fd;
+        char   buffer[64 * 1024];
+        size_t used;
+        bool   failed;
+    };
+} // namespace
+
 std::unordered_map<std::string, std::string> translationMap = {
     {"General information", "常规信息"},
     {"Frame Number", "帧编号"},
@@ -417,312 +475,2040 @@ void CommonUtil::compareMapPerformance(int iterations)
     }
 }
 
-SQLiteUtil::SQLiteUtil(const std::string& dbname)
+StringDict::StringDict()
 {
-    // 打开数据库连接
-    int rc = sqlite3_open(dbname.c_str(), &db);
-    if (rc != SQLITE_OK)
-    {
-        LOG_F(ERROR, "Failed to open database: %s", sqlite3_errmsg(db));
-        sqlite3_close(db);
-        throw std::runtime_error("Failed to open database");
-    }
+    clear();
 }
 
-SQLiteUtil::~SQLiteUtil()
+void StringDict::clear()
 {
-    if (db)
+    ids.clear();
+    values.clear();
+    values.push_back("");
+    ids[""] = 0;
+}
+
+uint32_t StringDict::intern(const std::string& value)
+{
+    auto it = ids.find(value);
+    if (it != ids.end())
     {
-        sqlite3_close(db);
-        db = nullptr;
+        return it->second;
     }
+
+    uint32_t id = static_cast<uint32_t>(values.size());
+    values.push_back(value);
+    ids.insert(std::make_pair(value, id));
+    return id;
 }
 
-bool SQLiteUtil::createPacketTable()
+bool StringDict::find(const std::string& value, uint32_t& id) const
 {
-    // 检查表是否存在，若不存在则创建
-    std::string createTableSQL = R"(
-        CREATE TABLE IF NOT EXISTS t_packets (
-            frame_number INTEGER PRIMARY KEY,
-            time REAL,
-            cap_len INTEGER,
-            len INTEGER,
-            src_mac TEXT,
-            dst_mac TEXT,
-            src_ip TEXT,
-            src_location TEXT,
-            src_port INTEGER,
-            dst_ip TEXT,
-            dst_location TEXT,
-            dst_port INTEGER,
-            protocol TEXT,
-            info TEXT,
-            file_offset INTEGER
-        );
-    )";
-
-    if (db == nullptr)
+    auto it = ids.find(value);
+    if (it == ids.end())
     {
-        LOG_F(ERROR, "Database connection is not initialized");
         return false;
     }
+    id = it->second;
+    return true;
+}
 
-    if (sqlite3_exec(db, createTableSQL.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+const std::string& StringDict::lookup(uint32_t id) const
+{
+    if (id >= values.size())
     {
-        LOG_F(ERROR, "Failed to create table t_packets: %s", sqlite3_errmsg(db));
-        return false;
+        return values[0];
     }
-
-    return true;
+    return values[id];
 }
 
-bool SQLiteUtil::insertPacket(std::vector<std::shared_ptr<Packet>>& packets)
+void StringDict::assign(uint32_t id, const std::string& value)
 {
-    // 实现插入数据的逻辑
-    // 开启事务
-    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    if (id == 0)
+    {
+        return;
+    }
+    if (id >= values.size())
+    {
+        values.resize(id + 1);
+    }
+    values[id] = value;
+    ids[value] = id;
+}
 
-    // SQL 插入语句
-    std::string insertSQL = R"(
-        INSERT INTO t_packets (
-            frame_number, time, cap_len, len, src_mac, dst_mac, src_ip, src_location, src_port,
-            dst_ip, dst_location, dst_port, protocol, info, file_offset
-        ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);
-    )";
+bool CommonUtil::likeMatch(const std::string& pattern, const char* text, size_t textLen)
+{
+    // 通配符匹配，遇到%时记录回溯点
+    size_t p = 0, t = 0;
+    size_t starP = std::string::npos, starT = 0;
+    while (t < textLen)
+    {
+        if (p < pattern.size() && pattern[p] == '%')
+        {
+            starP = ++p;
+            starT = t;
+            continue;
+        }
+        if (p < pattern.size())
+        {
+            unsigned char pc = pattern[p];
+            unsigned char tc = text[t];
+            if (pc == '_')
+            {
+                // 与SQLite一致，_匹配一个完整的UTF-8字符
+                p++;
+                t++;
+                while (t < textLen && (static_cast<unsigned char>(text[t]) & 0xC0) == 0x80)
+                {
+                    t++;
+                }
+                continue;
+            }
+            if (pc == tc || (pc < 0x80 && tc < 0x80 && tolower(pc) == tolower(tc)))
+            {
+                p++;
+                t++;
+                continue;
+            }
+        }
+        if (starP == std::string::npos)
+        {
+            return false;
+        }
+        p = starP;
+        t = ++starT;
+    }
+    while (p < pattern.size() && pattern[p] == '%')
+    {
+        p++;
+    }
+    return p == pattern.size();
+}
 
-    sqlite3_stmt* stmt;
-    if (sqlite3_prepare_v2(db, insertSQL.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+bool CommonUtil::parseUint64(const char* text, size_t length, uint64_t& value)
+{
+    if (length == 0)
     {
-        LOG_F(ERROR, "Failed to prepare insert statement: %s", sqlite3_errmsg(db));
         return false;
     }
-
-    // 遍历列表并插入数据
-    bool hasError = false;
-    for (const auto& packet : packets)
+    uint64_t result = 0;
+    for (size_t i = 0; i < length; i++)
     {
-        sqlite3_bind_int(stmt, 1, packet->frame_number);
-        sqlite3_bind_double(stmt, 2, packet->time);
-        sqlite3_bind_int(stmt, 3, packet->cap_len);
-        sqlite3_bind_int(stmt, 4, packet->len);
-        sqlite3_bind_text(stmt, 5, packet->src_mac.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 6, packet->dst_mac.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 7, packet->src_ip.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 8, packet->src_location.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_int(stmt, 9, packet->src_port);
-        sqlite3_bind_text(stmt, 10, packet->dst_ip.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 11, packet->dst_location.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_int(stmt, 12, packet->dst_port);
-        sqlite3_bind_text(stmt, 13, packet->protocol.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_text(stmt, 14, packet->info.c_str(), -1, SQLITE_STATIC);
-        sqlite3_bind_int(stmt, 15, packet->file_offset);
-
-        if (sqlite3_step(stmt) != SQLITE_DONE)
+        unsigned digit = static_cast<unsigned char>(text[i]) - '0';
+        if (digit > 9 || result > (UINT64_MAX - digit) / 10)
         {
-            LOG_F(ERROR, "Failed to execute insert statement: %s", sqlite3_errmsg(db));
-            hasError = true;
-            break;
+            return false;
         }
+        result = result * 10 + digit;
+    }
+    value = result;
+    return true;
+}
 
-        sqlite3_reset(stmt); // 重置语句以便下一次绑定
+bool CommonUtil::parseDouble(const std::string& text, double& value)
+{
+    // strtod会跳过前导空白，这里不接受
+    if (text.empty() || isspace(static_cast<unsigned char>(text[0])))
+    {
+        return false;
+    }
+    char* end     = nullptr;
+    errno         = 0;
+    double parsed = strtod(text.c_str(), &end);
+    if (end != text.c_str() + text.size() || errno == ERANGE || !std::isfinite(parsed))
+    {
+        return false;
     }
+    value = parsed;
+    return true;
+}
 
-    // 释放语句
-    sqlite3_finalize(stmt);
+const uint64_t NetUtil::kInvalidMac;
 
-    if (!hasError)
+bool NetUtil::parseIp(const std::string& text, IpAddress& ip)
+{
+    memset(ip.bytes, 0, sizeof(ip.bytes));
+    if (text.empty())
     {
-        // 结束事务
-        if (sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK)
+        return false;
+    }
+
+    if (text.find(':') != std::string::npos)
+    {
+        if (inet_pton(AF_INET6, text.c_str(), ip.bytes) == 1)
         {
-            LOG_F(ERROR, "Failed to commit transaction: %s", sqlite3_errmsg(db));
-            hasError = true;
+            return true;
         }
     }
-    else
+    else if (inet_pton(AF_INET, text.c_str(), ip.bytes + 12) == 1)
     {
-        // 如果有错误，回滚事务
-        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        ip.bytes[10] = 0xFF;
+        ip.bytes[11] = 0xFF;
+        return true;
     }
 
-    return !hasError;
+    memset(ip.bytes, 0, sizeof(ip.bytes));
+    return false;
 }
 
-bool SQLiteUtil::queryPacket(std::vector<std::shared_ptr<Packet>>& packetList)
+std::string NetUtil::formatIp(const IpAddress& ip)
 {
-    sqlite3_stmt *stmt = nullptr, *countStmt = nullptr;
-    std::string   sql = "select * from t_packets";
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+    if (ip.isEmpty())
     {
-        LOG_F(ERROR, "Failed to prepare statement: ");
-        return false;
+        return "";
     }
 
-    while (sqlite3_step(stmt) == SQLITE_ROW)
+    static const uint8_t v4Prefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF};
+    char                 buffer[INET6_ADDRSTRLEN] = {0};
+    if (memcmp(ip.bytes, v4Prefix, sizeof(v4Prefix)) == 0)
     {
-        std::shared_ptr<Packet> packet = std::make_shared<Packet>();
-        packet->frame_number           = sqlite3_column_int(stmt, 0);
-        packet->time                   = sqlite3_column_double(stmt, 1);
-        packet->cap_len                = sqlite3_column_int(stmt, 2);
-        packet->len                    = sqlite3_column_int(stmt, 3);
-        packet->src_mac      = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-        packet->dst_mac      = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-        packet->src_ip       = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
-        packet->src_location = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 7));
-        packet->src_port     = sqlite3_column_int(stmt, 8);
-        packet->dst_ip       = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
-        packet->dst_location = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 10));
-        packet->dst_port     = sqlite3_column_int(stmt, 11);
-        packet->protocol     = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 12));
-        packet->info         = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 13));
-        packet->file_offset  = sqlite3_column_int(stmt, 14);
-        packetList.push_back(packet);
+        inet_ntop(AF_INET, ip.bytes + 12, buffer, sizeof(buffer));
     }
-
-    sqlite3_finalize(stmt);
-
-    return true;
+    else
+    {
+        inet_ntop(AF_INET6, ip.bytes, buffer, sizeof(buffer));
+    }
+    return buffer;
 }
 
-std::string SQLiteUtil::buildFuzzyQuery(const std::map<std::string, std::string>& conditions)
+bool NetUtil::parseMac(const std::string& text, uint64_t& mac)
 {
-    std::string sql = "SELECT * FROM t_packets WHERE 1=1";
+    mac = kInvalidMac;
+    if (text.size() != 17)
+    {
+        return false;
+    }
 
-    for (const auto& condition : conditions)
+    uint64_t value = 0;
+    for (int i = 0; i < 6; i++)
     {
-        if (condition.first == "mac_address")
-        {
-            std::string pattern = condition.second;
-            std::replace(pattern.begin(), pattern.end(), '*', '%');
-            sql += " AND (src_mac LIKE '" + pattern + "' OR dst_mac LIKE '" + pattern + "')";
-        }
-        else if (condition.first == "ip_address")
+        if (i > 0 && text[i * 3 - 1] != ':')
         {
-            std::string pattern = condition.second;
-            std::replace(pattern.begin(), pattern.end(), '*', '%');
-            sql += " AND (src_ip LIKE '" + pattern + "' OR dst_ip LIKE '" + pattern + "')";
+            return false;
         }
-        else if (condition.first == "port")
+        for (int j = 0; j < 2; j++)
         {
-            std::string pattern = condition.second;
-            std::replace(pattern.begin(), pattern.end(), '*', '%');
-            // 将字符串转换为数字进行比较
-            if (pattern.find('%') == std::string::npos)
-            {
-                sql += " AND (src_port = " + pattern + " OR dst_port = " + pattern + ")";
-            }
+            char c = text[i * 3 + j];
+            int  nibble;
+            if (c >= '0' && c <= '9')
+                nibble = c - '0';
+            else if (c >= 'a' && c <= 'f')
+                nibble = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                nibble = c - 'A' + 10;
             else
-            {
-                sql += " AND (CAST(src_port AS TEXT) LIKE '" + pattern +
-                       "' OR CAST(dst_port AS TEXT) LIKE '" + pattern + "')";
-            }
-        }
-        else if (condition.first == "location")
-        {
-            std::string pattern = condition.second;
-            std::replace(pattern.begin(), pattern.end(), '*', '%');
-            // pattern前后都添加%，实现任意位置匹配
-            if (pattern.find('%') == std::string::npos)
-            {
-                pattern = "%" + pattern + "%";
-            }
-            sql +=
-                " AND (src_location LIKE '" + pattern + "' OR dst_location LIKE '" + pattern + "')";
+                return false;
+            value = (value << 4) | nibble;
         }
     }
-
-    // sql += " ORDER BY frame_number ASC LIMIT 1000"; // 限制返回结果数量
-    return sql;
+    mac = value;
+    return true;
 }
 
-std::string SQLiteUtil::packetsToJson(std::vector<std::shared_ptr<Packet>>& packets)
+std::string NetUtil::formatMac(uint64_t mac)
 {
-    rapidjson::Document document;
-    document.SetObject();
-    rapidjson::Document::AllocatorType& allocator = document.GetAllocator();
-
-    document.AddMember("total", rapidjson::Value((int)packets.size()), allocator);
+    if (mac == kInvalidMac)
+    {
+        return "";
+    }
 
-    rapidjson::Value packetsArray(rapidjson::kArrayType);
+    char buffer[18];
+    snprintf(buffer, sizeof(buffer), "%02x:%02x:%02x:%02x:%02x:%02x",
+             static_cast<unsigned>((mac >> 40) & 0xFF), static_cast<unsigned>((mac >> 32) & 0xFF),
+             static_cast<unsigned>((mac >> 24) & 0xFF), static_cast<unsigned>((mac >> 16) & 0xFF),
+             static_cast<unsigned>((mac >> 8) & 0xFF), static_cast<unsigned>(mac & 0xFF));
+    return buffer;
+}
 
-    for (const auto& packet : packets)
+bool NetUtil::parseNetDev(const std::string&                        content,
+                          std::map<std::string, InterfaceCounters>& counters)
+{
+    // 前两行是表头，之后每行为"网卡名: 接收8列 发送8列"
+    counters.clear();
+    size_t lineStart = 0;
+    while (lineStart < content.size())
     {
-        rapidjson::Value packetObj(rapidjson::kObjectType);
+        size_t lineEnd = content.find('\n', lineStart);
+        if (lineEnd == std::string::npos)
+        {
+            lineEnd = content.size();
+        }
+        size_t colon = content.find(':', lineStart);
+        if (colon != std::string::npos && colon < lineEnd)
+        {
+            size_t nameStart = content.find_first_not_of(' ', lineStart);
+            std::string name = content.substr(nameStart, colon - nameStart);
 
-        packetObj.AddMember("frame_number", rapidjson::Value(packet->frame_number), allocator);
-        packetObj.AddMember("time", rapidjson::Value(packet->time), allocator);
-        packetObj.AddMember("cap_len", rapidjson::Value(packet->cap_len), allocator);
-        packetObj.AddMember("len", rapidjson::Value(packet->len), allocator);
-        packetObj.AddMember("src_mac", rapidjson::Value(packet->src_mac.c_str(), allocator),
-                            allocator);
-        packetObj.AddMember("dst_mac", rapidjson::Value(packet->dst_mac.c_str(), allocator),
-                            allocator);
-        packetObj.AddMember("src_ip", rapidjson::Value(packet->src_ip.c_str(), allocator),
-                            allocator);
-        packetObj.AddMember("src_location",
-                            rapidjson::Value(packet->src_location.c_str(), allocator), allocator);
-        packetObj.AddMember("src_port", rapidjson::Value(packet->src_port), allocator);
-        packetObj.AddMember("dst_ip", rapidjson::Value(packet->dst_ip.c_str(), allocator),
-                            allocator);
-        packetObj.AddMember("dst_location",
-                            rapidjson::Value(packet->dst_location.c_str(), allocator), allocator);
-        packetObj.AddMember("dst_port", rapidjson::Value(packet->dst_port), allocator);
-        packetObj.AddMember("protocol", rapidjson::Value(packet->protocol.c_str(), allocator),
-                            allocator);
-        packetObj.AddMember("info", rapidjson::Value(packet->info.c_str(), allocator), allocator);
-        packetObj.AddMember("file_offset", rapidjson::Value(packet->file_offset), allocator);
+            uint64_t    fields[10];
+            const char* p = content.c_str() + colon + 1;
+            for (int i = 0; i < 10; i++)
+            {
+                char* end;
+                errno     = 0;
+                fields[i] = strtoull(p, &end, 10);
+                if (end == p || errno != 0 || end > content.c_str() + lineEnd)
+                {
+                    LOG_F(ERROR, "Malformed net dev line for %s", name.c_str());
+                    return false;
+                }
+                p = end;
+            }
 
-        packetsArray.PushBack(packetObj, allocator);
+            InterfaceCounters& entry = counters[name];
+            entry.rx_bytes           = fields[0];
+            entry.rx_packets         = fields[1];
+            entry.tx_bytes           = fields[8];
+            entry.tx_packets         = fields[9];
+        }
+        lineStart = lineEnd + 1;
     }
-
-    document.AddMember("packets", packetsArray, allocator);
-
-    rapidjson::StringBuffer                    buffer;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-    document.Accept(writer);
-
-    return buffer.GetString();
+    return true;
 }
 
-bool SQLiteUtil::queryPackets(const std::map<std::string, std::string>& conditions,
-                              std::string&                              jsonResult)
+bool NetUtil::readNetDev(std::map<std::string, InterfaceCounters>& counters,
+                         const std::string&                        path)
 {
-    std::string sql = buildFuzzyQuery(conditions);
-
-    sqlite3_stmt* stmt = nullptr;
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+    // procfs文件的大小为0，只能读到文件末尾
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
     {
-        LOG_F(ERROR, "Failed to prepare query statement: %s", sqlite3_errmsg(db));
+        LOG_F(ERROR, "Failed to open %s: %s", path.c_str(), strerror(errno));
         return false;
     }
 
-    std::vector<std::shared_ptr<Packet>> packets;
-    while (sqlite3_step(stmt) == SQLITE_ROW)
+    std::string content;
+    char        buffer[4096];
+    ssize_t     n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0)
     {
-        std::shared_ptr<Packet> packet = std::make_shared<Packet>();
-        packet->frame_number           = sqlite3_column_int(stmt, 0);
-        packet->time                   = sqlite3_column_double(stmt, 1);
-        packet->cap_len                = sqlite3_column_int(stmt, 2);
-        packet->len                    = sqlite3_column_int(stmt, 3);
-        packet->src_mac      = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-        packet->dst_mac      = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-        packet->src_ip       = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
-        packet->src_location = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 7));
-        packet->src_port     = sqlite3_column_int(stmt, 8);
-        packet->dst_ip       = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
-        packet->dst_location = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 10));
-        packet->dst_port     = sqlite3_column_int(stmt, 11);
-        packet->protocol     = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 12));
-        packet->info         = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 13));
-        packet->file_offset  = sqlite3_column_int(stmt, 14);
-        packets.push_back(packet);
+        content.append(buffer, n);
+    }
+    close(fd);
+    if (n < 0)
+    {
+        LOG_F(ERROR, "Failed to read %s: %s", path.c_str(), strerror(errno));
+        return false;
     }
+    return parseNetDev(content, counters);
+}
 
-    sqlite3_finalize(stmt);
+namespace
+{
+const uint64_t kPrime64_1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kPrime64_2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t kPrime64_3 = 0x165667B19E3779F9ULL;
+const uint64_t kPrime64_4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t kPrime64_5 = 0x27D4EB2F165667C5ULL;
 
-    jsonResult = packetsToJson(packets);
+inline uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
 
-    return true;
+inline uint64_t read64(const unsigned char* p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t read32(const unsigned char* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t xxhRound(uint64_t acc, uint64_t input)
+{
+    acc += input * kPrime64_2;
+    acc = rotl64(acc, 31);
+    return acc * kPrime64_1;
+}
+
+inline uint64_t xxhMergeRound(uint64_t acc, uint64_t val)
+{
+    acc ^= xxhRound(0, val);
+    return acc * kPrime64_1 + kPrime64_4;
+}
+} // namespace
+
+// 按XXH64规范实现，假定运行在小端机器上
+uint64_t HashUtil::xxh64(const void* data, size_t length, uint64_t seed)
+{
+    const unsigned char* p   = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + length;
+    uint64_t             h;
+
+    if (length >= 32)
+    {
+        uint64_t             v1    = seed + kPrime64_1 + kPrime64_2;
+        uint64_t             v2    = seed + kPrime64_2;
+        uint64_t             v3    = seed;
+        uint64_t             v4    = seed - kPrime64_1;
+        const unsigned char* limit = end - 32;
+        do
+        {
+            v1 = xxhRound(v1, read64(p));
+            v2 = xxhRound(v2, read64(p + 8));
+            v3 = xxhRound(v3, read64(p + 16));
+            v4 = xxhRound(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxhMergeRound(h, v1);
+        h = xxhMergeRound(h, v2);
+        h = xxhMergeRound(h, v3);
+        h = xxhMergeRound(h, v4);
+    }
+    else
+    {
+        h = seed + kPrime64_5;
+    }
+
+    h += static_cast<uint64_t>(length);
+
+    while (p + 8 <= end)
+    {
+        h ^= xxhRound(0, read64(p));
+        h = rotl64(h, 27) * kPrime64_1 + kPrime64_4;
+        p += 8;
+    }
+    if (p + 4 <= end)
+    {
+        h ^= static_cast<uint64_t>(read32(p)) * kPrime64_1;
+        h = rotl64(h, 23) * kPrime64_2 + kPrime64_3;
+        p += 4;
+    }
+    while (p < end)
+    {
+        h ^= (*p) * kPrime64_5;
+        h = rotl64(h, 11) * kPrime64_1;
+        p++;
+    }
+
+    h ^= h >> 33;
+    h *= kPrime64_2;
+    h ^= h >> 29;
+    h *= kPrime64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+namespace
+{
+// 字节到两位小写十六进制字符的查找表
+const char kHexTable[513] =
+    "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+inline void writeHex(unsigned char byte, char* out)
+{
+    memcpy(out, kHexTable + byte * 2, 2);
+}
+
+inline char printableChar(unsigned char byte)
+{
+    return (byte >= 0x20 && byte < 0x7F) ? static_cast<char>(byte) : '.';
+}
+
+const size_t kDumpBytesPerRow = 16;
+// 两个空格 + 16组“xx ” + 第8字节后的额外空格 + 一个空格 + 16个ASCII字符 + 换行
+const size_t kDumpRowTail = 2 + kDumpBytesPerRow * 3 + 1 + 1 + kDumpBytesPerRow + 1;
+} // namespace
+
+size_t HexDumpUtil::dumpSize(size_t length)
+{
+    size_t offsetWidth = length <= 0x10000 ? 4 : 8;
+    size_t rows        = (length + kDumpBytesPerRow - 1) / kDumpBytesPerRow;
+    return rows * (offsetWidth + kDumpRowTail);
+}
+
+size_t HexDumpUtil::dump(const unsigned char* data, size_t length, char* out)
+{
+    int   offsetWidth = length <= 0x10000 ? 4 : 8;
+    char* p           = out;
+    for (size_t offset = 0; offset < length; offset += kDumpBytesPerRow)
+    {
+        // 偏移，按大端逐字节查表
+        for (int shift = (offsetWidth - 2) * 4; shift >= 0; shift -= 8)
+        {
+            writeHex(static_cast<unsigned char>(offset >> shift), p);
+            p += 2;
+        }
+        *p++ = ' ';
+        *p++ = ' ';
+
+        size_t               count = std::min(length - offset, kDumpBytesPerRow);
+        const unsigned char* row   = data + offset;
+        char*                ascii = p + kDumpBytesPerRow * 3 + 2;
+        for (size_t i = 0; i < kDumpBytesPerRow; i++)
+        {
+            if (i < count)
+            {
+                writeHex(row[i], p);
+                ascii[i] = printableChar(row[i]);
+            }
+            else
+            {
+                p[0] = ' ';
+                p[1] = ' ';
+            }
+            p[2] = ' ';
+            p += 3;
+            if (i == 7)
+            {
+                *p++ = ' ';
+            }
+        }
+        *p++ = ' ';
+        p += count;
+        *p++ = '\n';
+    }
+    return p - out;
+}
+
+size_t HexDumpUtil::toHex(const unsigned char* data, size_t length, char* out)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        writeHex(data[i], out + i * 2);
+    }
+    return length * 2;
+}
+
+void HexDumpUtil::dump(const unsigned char* data, size_t length, std::string& out)
+{
+    size_t start = out.size();
+    out.resize(start + dumpSize(length));
+    out.resize(start + dump(data, length, &out[start]));
+}
+
+LineAssembler::LineAssembler(size_t capacity)
+    : buffer(std::max<size_t>(capacity, 1)), begin(0), end(0), discarding(false), dropped(0)
+{
+}
+
+void LineAssembler::compact()
+{
+    if (begin == 0)
+    {
+        return;
+    }
+    memmove(buffer.data(), buffer.data() + begin, end - begin);
+    end -= begin;
+    begin = 0;
+}
+
+LineAssembler::Status LineAssembler::fill(int fd)
+{
+    compact();
+    if (end == buffer.size())
+    {
+        // 缓冲区已满仍没有换行，丢弃这一行直到下一个换行符
+        if (!discarding)
+        {
+            dropped++;
+        }
+        discarding = true;
+        end        = 0;
+    }
+
+    ssize_t n;
+    do
+    {
+        n = read(fd, buffer.data() + end, buffer.size() - end);
+    } while (n < 0 && errno == EINTR);
+    if (n > 0)
+    {
+        end += static_cast<size_t>(n);
+        return STATUS_MORE;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+        return STATUS_AGAIN;
+    }
+    return STATUS_CLOSED;
+}
+
+size_t LineAssembler::append(const char* data, size_t length)
+{
+    compact();
+    length = std::min(length, buffer.size() - end);
+    memcpy(buffer.data() + end, data, length);
+    end += length;
+    return length;
+}
+
+bool LineAssembler::nextLine(const char*& line, size_t& length)
+{
+    while (begin < end)
+    {
+        const char* start   = buffer.data() + begin;
+        const char* newline = static_cast<const char*>(memchr(start, '\n', end - begin));
+        if (!newline)
+        {
+            return false;
+        }
+        begin += static_cast<size_t>(newline - start) + 1;
+        if (discarding)
+        {
+            discarding = false;
+            continue;
+        }
+
+        line   = start;
+        length = static_cast<size_t>(newline - start);
+        if (length > 0 && line[length - 1] == '\r')
+        {
+            length--;
+        }
+        return true;
+    }
+    return false;
+}
+
+SQLiteUtil::SQLiteUtil(const std::string& dbname)
+{
+    // 打开数据库连接
+    int rc = sqlite3_open(dbname.c_str(), &db);
+    if (rc != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to open database: %s", sqlite3_errmsg(db));
+        sqlite3_close(db);
+        throw std::runtime_error("Failed to open database");
+    }
+}
+
+SQLiteUtil::~SQLiteUtil()
+{
+    if (db)
+    {
+        sqlite3_close(db);
+        db = nullptr;
+    }
+}
+
+bool SQLiteUtil::createPacketTable()
+{
+    // 检查表是否存在，若不存在则创建
+    // 协议和归属地只有几百种取值，单独存入字典表，t_packets中只保存字典ID
+    std::string createTableSQL = R"(
+        CREATE TABLE IF NOT EXISTS t_protocols (
+            id INTEGER PRIMARY KEY,
+            name TEXT NOT NULL UNIQUE
+        );
+        CREATE TABLE IF NOT EXISTS t_locations (
+            id INTEGER PRIMARY KEY,
+            name TEXT NOT NULL UNIQUE
+        );
+        INSERT OR IGNORE INTO t_protocols (id, name) VALUES (0, '');
+        INSERT OR IGNORE INTO t_locations (id, name) VALUES (0, '');
+        CREATE TABLE IF NOT EXISTS t_flows (
+            flow_id INTEGER PRIMARY KEY,
+            src_ip TEXT,
+            src_port INTEGER,
+            dst_ip TEXT,
+            dst_port INTEGER,
+            ip_proto INTEGER,
+            first_time REAL,
+            last_time REAL,
+            packets_sent INTEGER,
+            bytes_sent INTEGER,
+            packets_received INTEGER,
+            bytes_received INTEGER,
+            tcp_flags_sent INTEGER,
+            tcp_flags_received INTEGER,
+            tcp_state TEXT
+        );
+        CREATE INDEX IF NOT EXISTS idx_flows_src_ip ON t_flows (src_ip);
+        CREATE INDEX IF NOT EXISTS idx_flows_dst_ip ON t_flows (dst_ip);
+        CREATE TABLE IF NOT EXISTS t_protocol_hierarchy (
+            seq INTEGER PRIMARY KEY,
+            path TEXT NOT NULL,
+            protocol TEXT NOT NULL,
+            depth INTEGER,
+            packets INTEGER,
+            bytes INTEGER
+        );
+        CREATE TABLE IF NOT EXISTS t_tcp_metrics (
+            flow_id INTEGER PRIMARY KEY,
+            handshake_rtt REAL,
+            rtt_min REAL,
+            rtt_avg REAL,
+            rtt_max REAL,
+            rtt_samples INTEGER,
+            retransmissions INTEGER,
+            out_of_order INTEGER,
+            zero_windows INTEGER,
+            throughput_p50 REAL,
+            throughput_p95 REAL,
+            throughput_max REAL
+        );
+    )" + packetTableSQL("t_packets");
+
+    if (db == nullptr)
+    {
+        LOG_F(ERROR, "Database connection is not initialized");
+        return false;
+    }
+
+    if (sqlite3_exec(db, createTableSQL.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to create table t_packets: %s", sqlite3_errmsg(db));
+        return false;
+    }
+
+    return loadDictionaries();
+}
+
+std::string SQLiteUtil::packetTableSQL(const std::string& tableName)
+{
+    std::string sql = "CREATE TABLE IF NOT EXISTS " + tableName + R"( (
+            frame_number INTEGER PRIMARY KEY,
+            time REAL,
+            cap_len INTEGER,
+            len INTEGER,
+            src_mac TEXT,
+            dst_mac TEXT,
+            src_ip TEXT,
+            src_location_id INTEGER,
+            src_port INTEGER,
+            dst_ip TEXT,
+            dst_location_id INTEGER,
+            dst_port INTEGER,
+            protocol_id INTEGER,
+            info TEXT,
+            file_offset INTEGER
+        );)";
+
+    const char* indexColumns[] = {"protocol_id", "src_location_id", "dst_location_id"};
+    for (const char* column : indexColumns)
+    {
+        sql += "CREATE INDEX IF NOT EXISTS idx_" + tableName + "_" + column + " ON " + tableName +
+               " (" + column + ");";
+    }
+    return sql;
+}
+
+bool SQLiteUtil::enablePartitioning(int partitionSeconds, int retentionCount)
+{
+    if (db == nullptr || partitionSeconds <= 0)
+    {
+        LOG_F(ERROR, "Invalid partition settings");
+        return false;
+    }
+
+    // 删除分区后释放的页面可以被增量回收（仅对尚未建表的新数据库生效，否则由后续分区复用）
+    std::string sql = R"(
+        PRAGMA auto_vacuum = INCREMENTAL;
+        CREATE TABLE IF NOT EXISTS t_partitions (
+            start_time INTEGER PRIMARY KEY,
+            name TEXT NOT NULL,
+            end_time INTEGER NOT NULL
+        );
+    )";
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to create table t_partitions: %s", sqlite3_errmsg(db));
+        return false;
+    }
+
+    this->partitionSeconds = partitionSeconds;
+    this->retentionCount   = retentionCount;
+    return loadPartitions();
+}
+
+bool SQLiteUtil::enableFullTextIndex()
+{
+    if (db == nullptr)
+    {
+        LOG_F(ERROR, "Database connection is not initialized");
+        return false;
+    }
+
+    // 判断索引表是否已存在，新建时需要为已有数据补建索引
+    bool          exists = false;
+    sqlite3_stmt* stmt   = nullptr;
+    std::string   sql = "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 't_packets_fts'";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        exists = sqlite3_step(stmt) == SQLITE_ROW;
+        sqlite3_finalize(stmt);
+    }
+
+    sql = "CREATE VIRTUAL TABLE IF NOT EXISTS t_packets_fts USING fts5(info);";
+    if (!exists)
+    {
+        sql += "INSERT INTO t_packets_fts (rowid, info) SELECT frame_number, info FROM " +
+               packetSource(-INFINITY, INFINITY) + ";";
+    }
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to create full text index: %s", sqlite3_errmsg(db));
+        return false;
+    }
+
+    fullTextEnabled = true;
+    return true;
+}
+
+std::string SQLiteUtil::buildMatchExpression(const std::string& keywords)
+{
+    std::string        expression;
+    std::istringstream iss(keywords);
+    std::string        term;
+    while (iss >> term)
+    {
+        bool prefix = term.size() > 1 && term.back() == '*';
+        if (prefix)
+        {
+            term.pop_back();
+        }
+
+        // 关键字整体作为短语，避免'.'、'/'等字符被当作FTS5语法
+        std::string phrase = "\"";
+        for (char c : term)
+        {
+            phrase += c;
+            if (c == '"')
+            {
+                phrase += '"';
+            }
+        }
+        phrase += "\"";
+
+        if (!expression.empty())
+        {
+            expression += " ";
+        }
+        expression += phrase + (prefix ? "*" : "");
+    }
+    return expression;
+}
+
+std::vector<long> SQLiteUtil::getPartitions() const
+{
+    std::vector<long> result;
+    for (const auto& partition : partitions)
+    {
+        result.push_back(partition.first);
+    }
+    return result;
+}
+
+bool SQLiteUtil::loadPartitions()
+{
+    partitions.clear();
+
+    sqlite3_stmt* stmt = nullptr;
+    std::string   sql  = "SELECT start_time, name, end_time FROM t_partitions";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to load partitions: %s", sqlite3_errmsg(db));
+        return false;
+    }
+
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        Partition partition;
+        partition.name    = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        partition.endTime = static_cast<long>(sqlite3_column_int64(stmt, 2));
+        partitions[static_cast<long>(sqlite3_column_int64(stmt, 0))] = partition;
+    }
+    sqlite3_finalize(stmt);
+
+    return true;
+}
+
+std::string SQLiteUtil::partitionForTime(double time)
+{
+    long startTime = static_cast<long>(std::floor(time / partitionSeconds)) * partitionSeconds;
+
+    auto it = partitions.find(startTime);
+    if (it != partitions.end())
+    {
+        return it->second.name;
+    }
+
+    std::string name = "t_packets_p" + std::to_string(startTime);
+    std::string sql  = packetTableSQL(name) +
+                      "INSERT OR REPLACE INTO t_partitions (start_time, name, end_time) VALUES (" +
+                      std::to_string(startTime) + ", '" + name + "', " +
+                      std::to_string(startTime + partitionSeconds) + ");";
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to create partition %s: %s", name.c_str(), sqlite3_errmsg(db));
+        return "";
+    }
+
+    Partition partition;
+    partition.name        = name;
+    partition.endTime     = startTime + partitionSeconds;
+    partitions[startTime] = partition;
+    return name;
+}
+
+void SQLiteUtil::applyRetention()
+{
+    if (retentionCount <= 0 || (int)partitions.size() <= retentionCount)
+    {
+        return;
+    }
+
+    bool dropped = false;
+    while ((int)partitions.size() > retentionCount)
+    {
+        // 整表删除最旧的分区，代价与分区内的数据量无关
+        auto        oldest = partitions.begin();
+        std::string sql;
+        if (fullTextEnabled)
+        {
+            sql += "DELETE FROM t_packets_fts WHERE rowid IN (SELECT frame_number FROM " +
+                   oldest->second.name + ");";
+        }
+        sql += "DROP TABLE IF EXISTS " + oldest->second.name +
+               "; DELETE FROM t_partitions WHERE start_time = " + std::to_string(oldest->first) +
+               ";";
+        if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+        {
+            LOG_F(ERROR, "Failed to drop partition %s: %s", oldest->second.name.c_str(),
+                  sqlite3_errmsg(db));
+            break;
+        }
+        LOG_F(INFO, "Dropped expired partition %s", oldest->second.name.c_str());
+        partitions.erase(oldest);
+        dropped = true;
+    }
+
+    if (dropped)
+    {
+        sqlite3_exec(db, "PRAGMA incremental_vacuum;", nullptr, nullptr, nullptr);
+    }
+}
+
+bool SQLiteUtil::clearPackets()
+{
+    std::string sql = "BEGIN TRANSACTION; DELETE FROM t_packets; DELETE FROM t_flows; "
+                      "DELETE FROM t_tcp_metrics; DELETE FROM t_protocol_hierarchy;";
+    if (fullTextEnabled)
+    {
+        sql += "DELETE FROM t_packets_fts;";
+    }
+    if (partitionSeconds > 0)
+    {
+        for (const auto& partition : partitions)
+        {
+            sql += "DROP TABLE IF EXISTS " + partition.second.name + ";";
+        }
+        sql += "DELETE FROM t_partitions;";
+    }
+    sql += "COMMIT;";
+
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to clear packets: %s", sqlite3_errmsg(db));
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        return false;
+    }
+    partitions.clear();
+    return true;
+}
+
+std::string SQLiteUtil::packetSource(double startTime, double endTime) const
+{
+    if (partitionSeconds <= 0)
+    {
+        return "t_packets";
+    }
+
+    // 只保留与[startTime, endTime)重叠的分区，按t_partitions中记录的结束时间判断
+    std::vector<std::string> tables;
+    for (const auto& partition : partitions)
+    {
+        if (partition.second.endTime <= startTime || partition.first >= endTime)
+        {
+            continue;
+        }
+        tables.push_back(partition.second.name);
+    }
+
+    // 单个复合SELECT的项数受SQLITE_LIMIT_COMPOUND_SELECT限制（默认500），
+    // 分区较多时按上限分组，每组作为子查询再合并，逐层嵌套直到只剩一组
+    int limit = db != nullptr ? sqlite3_limit(db, SQLITE_LIMIT_COMPOUND_SELECT, -1) : 0;
+    if (limit < 2)
+    {
+        limit = 500;
+    }
+    std::vector<std::string> terms;
+    for (const auto& table : tables)
+    {
+        terms.push_back("SELECT * FROM " + table);
+    }
+    while (terms.size() > (size_t)limit)
+    {
+        std::vector<std::string> groups;
+        for (size_t i = 0; i < terms.size(); i += limit)
+        {
+            std::string group;
+            for (size_t j = i; j < terms.size() && j < i + limit; j++)
+            {
+                group += (j == i ? "" : " UNION ALL ") + terms[j];
+            }
+            groups.push_back("SELECT * FROM (" + group + ")");
+        }
+        terms.swap(groups);
+    }
+
+    std::string source;
+    for (const auto& term : terms)
+    {
+        if (!source.empty())
+        {
+            source += " UNION ALL ";
+        }
+        source += term;
+    }
+
+    // 没有命中任何分区时退回到空的t_packets
+    return source.empty() ? "t_packets" : "(" + source + ")";
+}
+
+bool SQLiteUtil::loadDictionaries()
+{
+    protocolDict.clear();
+    locationDict.clear();
+
+    const char* tables[] = {"t_protocols", "t_locations"};
+    StringDict* dicts[]  = {&protocolDict, &locationDict};
+    for (int i = 0; i < 2; i++)
+    {
+        std::string   sql  = std::string("SELECT id, name FROM ") + tables[i];
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        {
+            LOG_F(ERROR, "Failed to load dictionary %s: %s", tables[i], sqlite3_errmsg(db));
+            return false;
+        }
+
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            const char* name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+            dicts[i]->assign(sqlite3_column_int(stmt, 0), name ? name : "");
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    return true;
+}
+
+bool SQLiteUtil::insertDictEntries(const StringDict& dict, const std::string& table,
+                                   uint32_t fromId)
+{
+    if (fromId >= dict.size())
+    {
+        return true;
+    }
+
+    std::string   sql  = "INSERT OR IGNORE INTO " + table + " (id, name) VALUES (?, ?);";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to prepare dictionary insert: %s", sqlite3_errmsg(db));
+        return false;
+    }
+
+    bool ok = true;
+    for (uint32_t id = fromId; id < dict.size(); id++)
+    {
+        sqlite3_bind_int(stmt, 1, id);
+        sqlite3_bind_text(stmt, 2, dict.lookup(id).c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) != SQLITE_DONE)
+        {
+            LOG_F(ERROR, "Failed to insert into %s: %s", table.c_str(), sqlite3_errmsg(db));
+            ok = false;
+            break;
+        }
+        sqlite3_reset(stmt);
+    }
+
+    sqlite3_finalize(stmt);
+    return ok;
+}
+
+const std::string& SQLiteUtil::decodeDict(StringDict& dict, uint32_t id)
+{
+    // 其他连接可能写入了新的字典条目，缓存未命中时重新加载一次
+    if (id >= dict.size())
+    {
+        loadDictionaries();
+    }
+    return dict.lookup(id);
+}
+
+bool SQLiteUtil::insertPacket(std::vector<std::shared_ptr<Packet>>& packets)
+{
+    return insertPackets(packets.size(),
+                         [&packets](size_t i) -> const Packet& { return *packets[i]; });
+}
+
+bool SQLiteUtil::insertPacket(const PacketStore& store, size_t begin, size_t end)
+{
+    Packet packet;
+    return insertPackets(end - begin, [&](size_t i) -> const Packet& {
+        store.toPacket(store.at(begin + i), packet);
+        return packet;
+    });
+}
+
+template <typename Fetch>
+bool SQLiteUtil::insertPackets(size_t count, Fetch fetch)
+{
+    // 实现插入数据的逻辑
+    // 开启事务
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+    // SQL 插入语句，分区模式下每个分区表各准备一条
+    std::map<std::string, sqlite3_stmt*> stmts;
+    auto prepareInsert = [this, &stmts](const std::string& tableName) -> sqlite3_stmt* {
+        auto it = stmts.find(tableName);
+        if (it != stmts.end())
+        {
+            return it->second;
+        }
+
+        std::string insertSQL = "INSERT INTO " + tableName + R"( (
+            frame_number, time, cap_len, len, src_mac, dst_mac, src_ip, src_location_id, src_port,
+            dst_ip, dst_location_id, dst_port, protocol_id, info, file_offset
+        ) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);)";
+
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db, insertSQL.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        {
+            LOG_F(ERROR, "Failed to prepare insert statement: %s", sqlite3_errmsg(db));
+            return nullptr;
+        }
+        stmts[tableName] = stmt;
+        return stmt;
+    };
+
+    // 记录本批次之前的字典大小，新出现的字符串在提交前写入字典表
+    uint32_t protocolDictSize = protocolDict.size();
+    uint32_t locationDictSize = locationDict.size();
+
+    // 全文索引与数据包在同一事务中写入
+    sqlite3_stmt* ftsStmt = nullptr;
+    if (fullTextEnabled &&
+        sqlite3_prepare_v2(db, "INSERT INTO t_packets_fts (rowid, info) VALUES (?, ?);", -1,
+                           &ftsStmt, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to prepare full text insert: %s", sqlite3_errmsg(db));
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        return false;
+    }
+
+    // 遍历列表并插入数据
+    bool hasError = false;
+    for (size_t i = 0; i < count; i++)
+    {
+        const Packet& packet = fetch(i);
+        std::string tableName =
+            partitionSeconds > 0 ? partitionForTime(packet.time) : std::string("t_packets");
+        sqlite3_stmt* stmt = tableName.empty() ? nullptr : prepareInsert(tableName);
+        if (stmt == nullptr)
+        {
+            hasError = true;
+            break;
+        }
+
+        sqlite3_bind_int(stmt, 1, packet.frame_number);
+        sqlite3_bind_double(stmt, 2, packet.time);
+        sqlite3_bind_int(stmt, 3, packet.cap_len);
+        sqlite3_bind_int(stmt, 4, packet.len);
+        sqlite3_bind_text(stmt, 5, packet.src_mac.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 6, packet.dst_mac.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 7, packet.src_ip.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 8, locationDict.intern(packet.src_location));
+        sqlite3_bind_int(stmt, 9, packet.src_port);
+        sqlite3_bind_text(stmt, 10, packet.dst_ip.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 11, locationDict.intern(packet.dst_location));
+        sqlite3_bind_int(stmt, 12, packet.dst_port);
+        sqlite3_bind_int(stmt, 13, protocolDict.intern(packet.protocol));
+        sqlite3_bind_text(stmt, 14, packet.info.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 15, packet.file_offset);
+
+        if (sqlite3_step(stmt) != SQLITE_DONE)
+        {
+            LOG_F(ERROR, "Failed to execute insert statement: %s", sqlite3_errmsg(db));
+            hasError = true;
+            break;
+        }
+
+        sqlite3_reset(stmt); // 重置语句以便下一次绑定
+
+        if (ftsStmt)
+        {
+            sqlite3_bind_int(ftsStmt, 1, packet.frame_number);
+            sqlite3_bind_text(ftsStmt, 2, packet.info.c_str(), -1, SQLITE_STATIC);
+            if (sqlite3_step(ftsStmt) != SQLITE_DONE)
+            {
+                LOG_F(ERROR, "Failed to update full text index: %s", sqlite3_errmsg(db));
+                hasError = true;
+                break;
+            }
+            sqlite3_reset(ftsStmt);
+        }
+    }
+
+    // 释放语句
+    for (auto& stmt : stmts)
+    {
+        sqlite3_finalize(stmt.second);
+    }
+    sqlite3_finalize(ftsStmt);
+
+    if (!hasError)
+    {
+        hasError = !insertDictEntries(protocolDict, "t_protocols", protocolDictSize) ||
+                   !insertDictEntries(locationDict, "t_locations", locationDictSize);
+    }
+
+    if (!hasError)
+    {
+        // 结束事务
+        if (sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK)
+        {
+            LOG_F(ERROR, "Failed to commit transaction: %s", sqlite3_errmsg(db));
+            hasError = true;
+        }
+    }
+    else
+    {
+        // 如果有错误，回滚事务，字典和分区缓存也恢复为数据库中的内容
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        loadDictionaries();
+        if (partitionSeconds > 0)
+        {
+            loadPartitions();
+        }
+    }
+
+    if (!hasError && partitionSeconds > 0)
+    {
+        applyRetention();
+    }
+
+    return !hasError;
+}
+
+void SQLiteUtil::readPacketRow(sqlite3_stmt* stmt, std::shared_ptr<Packet>& packet)
+{
+    packet->frame_number = sqlite3_column_int(stmt, 0);
+    packet->time         = sqlite3_column_double(stmt, 1);
+    packet->cap_len      = sqlite3_column_int(stmt, 2);
+    packet->len          = sqlite3_column_int(stmt, 3);
+    packet->src_mac      = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
+    packet->dst_mac      = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
+    packet->src_ip       = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
+    packet->src_location = decodeDict(locationDict, sqlite3_column_int(stmt, 7));
+    packet->src_port     = sqlite3_column_int(stmt, 8);
+    packet->dst_ip       = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 9));
+    packet->dst_location = decodeDict(locationDict, sqlite3_column_int(stmt, 10));
+    packet->dst_port     = sqlite3_column_int(stmt, 11);
+    packet->protocol     = decodeDict(protocolDict, sqlite3_column_int(stmt, 12));
+    packet->info         = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 13));
+    packet->file_offset  = sqlite3_column_int64(stmt, 14);
+}
+
+bool SQLiteUtil::queryPacket(std::vector<std::shared_ptr<Packet>>& packetList)
+{
+    sqlite3_stmt* stmt = nullptr;
+    std::string   sql  = "select * from " + packetSource(-INFINITY, INFINITY);
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to prepare statement: ");
+        return false;
+    }
+
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        std::shared_ptr<Packet> packet = std::make_shared<Packet>();
+        readPacketRow(stmt, packet);
+        packetList.push_back(packet);
+    }
+
+    sqlite3_finalize(stmt);
+
+    return true;
+}
+
+namespace
+{
+// 读取一个时间条件，条件不存在时value不变；不是完整的数字时返回false
+bool parseTimeCondition(const std::map<std::string, std::string>& conditions,
+                        const std::string& name, double& value)
+{
+    auto it = conditions.find(name);
+    if (it == conditions.end() || it->second.empty())
+    {
+        return true;
+    }
+    return CommonUtil::parseDouble(it->second, value);
+}
+
+// 把用户输入作为SQL字符串字面量嵌入，单引号加倍转义
+std::string quoteLiteral(const std::string& value)
+{
+    std::string quoted = "'";
+    for (char c : value)
+    {
+        quoted += c;
+        if (c == '\'')
+        {
+            quoted += '\'';
+        }
+    }
+    return quoted + "'";
+}
+
+// 用户输入的*通配符转换为LIKE的%，并转为字符串字面量
+std::string likePattern(std::string pattern)
+{
+    std::replace(pattern.begin(), pattern.end(), '*', '%');
+    return quoteLiteral(pattern);
+}
+} // namespace
+
+std::string SQLiteUtil::buildFuzzyQuery(const std::map<std::string, std::string>& conditions)
+{
+    // 先确定时间范围，用于裁剪需要扫描的分区
+    double startTime = -INFINITY;
+    double endTime   = INFINITY;
+    if (!parseTimeCondition(conditions, "start_time", startTime) ||
+        !parseTimeCondition(conditions, "end_time", endTime))
+    {
+        LOG_F(ERROR, "Invalid time range in query conditions");
+        return "";
+    }
+
+    std::string sql = "SELECT * FROM " + packetSource(startTime, endTime) + " WHERE 1=1";
+    if (startTime != -INFINITY)
+    {
+        sql += " AND time >= " + std::to_string(startTime);
+    }
+    if (endTime != INFINITY)
+    {
+        sql += " AND time < " + std::to_string(endTime);
+    }
+
+    for (const auto& condition : conditions)
+    {
+        if (condition.first == "mac_address")
+        {
+            std::string pattern = likePattern(condition.second);
+            sql += " AND (src_mac LIKE " + pattern + " OR dst_mac LIKE " + pattern + ")";
+        }
+        else if (condition.first == "ip_address")
+        {
+            std::string pattern = likePattern(condition.second);
+            sql += " AND (src_ip LIKE " + pattern + " OR dst_ip LIKE " + pattern + ")";
+        }
+        else if (condition.first == "port")
+        {
+            const std::string& port = condition.second;
+            // 纯数字的端口直接按数字比较，其他输入按文本模糊匹配
+            if (!port.empty() && port.size() <= 5 &&
+                port.find_first_not_of("0123456789") == std::string::npos)
+            {
+                sql += " AND (src_port = " + port + " OR dst_port = " + port + ")";
+            }
+            else
+            {
+                std::string pattern = likePattern(port);
+                sql += " AND (CAST(src_port AS TEXT) LIKE " + pattern +
+                       " OR CAST(dst_port AS TEXT) LIKE " + pattern + ")";
+            }
+        }
+        else if (condition.first == "location")
+        {
+            std::string pattern = condition.second;
+            // pattern前后都添加%，实现任意位置匹配
+            if (pattern.find('*') == std::string::npos)
+            {
+                pattern = "*" + pattern + "*";
+            }
+            // 先在字典表中匹配归属地，再按字典ID过滤
+            std::string locationIds =
+                "(SELECT id FROM t_locations WHERE name LIKE " + likePattern(pattern) + ")";
+            sql += " AND (src_location_id IN " + locationIds + " OR dst_location_id IN " +
+                   locationIds + ")";
+        }
+        else if (condition.first == "protocol")
+        {
+            sql += " AND protocol_id IN (SELECT id FROM t_protocols WHERE name LIKE " +
+                   likePattern(condition.second) + ")";
+        }
+        else if (condition.first == "keyword")
+        {
+            if (fullTextEnabled)
+            {
+                std::string expression = buildMatchExpression(condition.second);
+                if (expression.empty())
+                {
+                    continue;
+                }
+                sql += " AND frame_number IN (SELECT rowid FROM t_packets_fts WHERE "
+                       "t_packets_fts MATCH " + quoteLiteral(expression) + ")";
+            }
+            else
+            {
+                sql += " AND info LIKE " + likePattern("*" + condition.second + "*");
+            }
+        }
+    }
+
+    // sql += " ORDER BY frame_number ASC LIMIT 1000"; // 限制返回结果数量
+    return sql;
+}
+
+std::string SQLiteUtil::packetsToJson(std::vector<std::shared_ptr<Packet>>& packets)
+{
+    rapidjson::Document document;
+    document.SetObject();
+    rapidjson::Document::AllocatorType& allocator = document.GetAllocator();
+
+    document.AddMember("total", rapidjson::Value((int)packets.size()), allocator);
+
+    rapidjson::Value packetsArray(rapidjson::kArrayType);
+
+    for (const auto& packet : packets)
+    {
+        rapidjson::Value packetObj(rapidjson::kObjectType);
+
+        packetObj.AddMember("frame_number", rapidjson::Value(packet->frame_number), allocator);
+        packetObj.AddMember("time", rapidjson::Value(packet->time), allocator);
+        packetObj.AddMember("cap_len", rapidjson::Value(packet->cap_len), allocator);
+        packetObj.AddMember("len", rapidjson::Value(packet->len), allocator);
+        packetObj.AddMember("src_mac", rapidjson::Value(packet->src_mac.c_str(), allocator),
+                            allocator);
+        packetObj.AddMember("dst_mac", rapidjson::Value(packet->dst_mac.c_str(), allocator),
+                            allocator);
+        packetObj.AddMember("src_ip", rapidjson::Value(packet->src_ip.c_str(), allocator),
+                            allocator);
+        packetObj.AddMember("src_location",
+                            rapidjson::Value(packet->src_location.c_str(), allocator), allocator);
+        packetObj.AddMember("src_port", rapidjson::Value(packet->src_port), allocator);
+        packetObj.AddMember("dst_ip", rapidjson::Value(packet->dst_ip.c_str(), allocator),
+                            allocator);
+        packetObj.AddMember("dst_location",
+                            rapidjson::Value(packet->dst_location.c_str(), allocator), allocator);
+        packetObj.AddMember("dst_port", rapidjson::Value(packet->dst_port), allocator);
+        packetObj.AddMember("protocol", rapidjson::Value(packet->protocol.c_str(), allocator),
+                            allocator);
+        packetObj.AddMember("info", rapidjson::Value(packet->info.c_str(), allocator), allocator);
+        packetObj.AddMember("file_offset", rapidjson::Value(packet->file_offset), allocator);
+
+        packetsArray.PushBack(packetObj, allocator);
+    }
+
+    document.AddMember("packets", packetsArray, allocator);
+
+    rapidjson::StringBuffer                    buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    document.Accept(writer);
+
+    return buffer.GetString();
+}
+
+bool SQLiteUtil::queryPackets(const std::map<std::string, std::string>& conditions,
+                              std::string&                              jsonResult)
+{
+    std::string sql = buildFuzzyQuery(conditions);
+    if (sql.empty())
+    {
+        return false;
+    }
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to prepare query statement: %s", sqlite3_errmsg(db));
+        return false;
+    }
+
+    std::vector<std::shared_ptr<Packet>> packets;
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        std::shared_ptr<Packet> packet = std::make_shared<Packet>();
+        readPacketRow(stmt, packet);
+        packets.push_back(packet);
+    }
+
+    sqlite3_finalize(stmt);
+
+    jsonResult = packetsToJson(packets);
+
+    return true;
+}
+
+template <typename Writer>
+bool SQLiteUtil::writePacketsPage(const std::map<std::string, std::string>& conditions,
+                                  uint32_t afterFrame, uint32_t pageSize, Writer& writer,
+                                  uint32_t& nextFrame)
+{
+    // 基于frame_number的键集分页，多取一条用于判断是否还有下一页
+    std::string sql = buildFuzzyQuery(conditions);
+    if (sql.empty())
+    {
+        return false;
+    }
+    sql += " AND frame_number > " + std::to_string(afterFrame) + " ORDER BY frame_number";
+    if (pageSize > 0)
+    {
+        sql += " LIMIT " + std::to_string(pageSize + 1);
+    }
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to prepare query statement: %s", sqlite3_errmsg(db));
+        return false;
+    }
+
+    auto writeText = [&writer, stmt](const char* key, int column) {
+        const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+        writer.Key(key);
+        writer.String(text ? text : "", text ? sqlite3_column_bytes(stmt, column) : 0);
+    };
+    auto writeDict = [this, &writer](const char* key, StringDict& dict, uint32_t id) {
+        const std::string& value = decodeDict(dict, id);
+        writer.Key(key);
+        writer.String(value.c_str(), static_cast<rapidjson::SizeType>(value.size()));
+    };
+
+    uint32_t count     = 0;
+    uint32_t lastFrame = 0;
+    nextFrame          = 0;
+
+    writer.StartObject();
+    writer.Key("packets");
+    writer.StartArray();
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        if (pageSize > 0 && count == pageSize)
+        {
+            nextFrame = lastFrame;
+            break;
+        }
+
+        // 直接从结果行输出JSON，不构造中间的Packet对象
+        lastFrame = sqlite3_column_int(stmt, 0);
+        writer.StartObject();
+        writer.Key("frame_number");
+        writer.Int(sqlite3_column_int(stmt, 0));
+        writer.Key("time");
+        writer.Double(sqlite3_column_double(stmt, 1));
+        writer.Key("cap_len");
+        writer.Uint(sqlite3_column_int(stmt, 2));
+        writer.Key("len");
+        writer.Uint(sqlite3_column_int(stmt, 3));
+        writeText("src_mac", 4);
+        writeText("dst_mac", 5);
+        writeText("src_ip", 6);
+        writeDict("src_location", locationDict, sqlite3_column_int(stmt, 7));
+        writer.Key("src_port");
+        writer.Uint(sqlite3_column_int(stmt, 8));
+        writeText("dst_ip", 9);
+        writeDict("dst_location", locationDict, sqlite3_column_int(stmt, 10));
+        writer.Key("dst_port");
+        writer.Uint(sqlite3_column_int(stmt, 11));
+        writeDict("protocol", protocolDict, sqlite3_column_int(stmt, 12));
+        writeText("info", 13);
+        writer.Key("file_offset");
+        writer.Uint64(sqlite3_column_int64(stmt, 14));
+        writer.EndObject();
+        count++;
+    }
+    if (rc != SQLITE_ROW && rc != SQLITE_DONE)
+    {
+        // 读取中途出错，已输出的部分不是完整的一页
+        LOG_F(ERROR, "Failed to read query result: %s", sqlite3_errmsg(db));
+        sqlite3_finalize(stmt);
+        return false;
+    }
+    writer.EndArray();
+    writer.Key("total");
+    writer.Uint(count);
+    writer.Key("next_cursor");
+    writer.Uint(nextFrame);
+    writer.EndObject();
+
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+bool SQLiteUtil::streamPackets(const std::map<std::string, std::string>& conditions,
+                               uint32_t afterFrame, uint32_t pageSize, int fd,
+                               uint32_t& nextFrame)
+{
+    FdWriteStream                    stream(fd);
+    rapidjson::Writer<FdWriteStream> writer(stream);
+    if (!writePacketsPage(conditions, afterFrame, pageSize, writer, nextFrame))
+    {
+        return false;
+    }
+
+    stream.Flush();
+    if (stream.Failed())
+    {
+        LOG_F(ERROR, "Failed to write query result: %s", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool SQLiteUtil::queryPacketsPage(const std::map<std::string, std::string>& conditions,
+                                  uint32_t afterFrame, uint32_t pageSize, std::string& jsonResult,
+                                  uint32_t& nextFrame)
+{
+    rapidjson::StringBuffer                    buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    if (!writePacketsPage(conditions, afterFrame, pageSize, writer, nextFrame))
+    {
+        return false;
+    }
+
+    jsonResult.assign(buffer.GetString(), buffer.GetSize());
+    return true;
+}
+
+bool SQLiteUtil::exportQueryResult(const std::map<std::string, std::string>& conditions,
+                                   const std::string&                        filePath)
+{
+    int fd = open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        LOG_F(ERROR, "无法打开文件进行写入: %s", filePath.c_str());
+        return false;
+    }
+
+    uint32_t nextFrame = 0;
+    bool     ok        = streamPackets(conditions, 0, 0, fd, nextFrame);
+    if (close(fd) != 0)
+    {
+        ok = false;
+    }
+
+    if (ok)
+    {
+        LOG_F(INFO, "查询结果已成功保存到文件: %s", filePath.c_str());
+    }
+    return ok;
+}
+
+bool SQLiteUtil::upsertFlows(const std::vector<Conversation>& conversations)
+{
+    if (conversations.empty())
+    {
+        return true;
+    }
+
+    std::string sql = "INSERT OR REPLACE INTO t_flows "
+                      "(flow_id, src_ip, src_port, dst_ip, dst_port, ip_proto, first_time, "
+                      "last_time, packets_sent, bytes_sent, packets_received, bytes_received, "
+                      "tcp_flags_sent, tcp_flags_received, tcp_state) "
+                      "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to prepare flow insert: %s", sqlite3_errmsg(db));
+        return false;
+    }
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    bool ok = true;
+    for (const auto& flow : conversations)
+    {
+        sqlite3_bind_int64(stmt, 1, flow.flow_id);
+        sqlite3_bind_text(stmt, 2, flow.src_ip.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 3, flow.src_port);
+        sqlite3_bind_text(stmt, 4, flow.dst_ip.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 5, flow.dst_port);
+        sqlite3_bind_int(stmt, 6, flow.ip_proto);
+        sqlite3_bind_double(stmt, 7, flow.first_time);
+        sqlite3_bind_double(stmt, 8, flow.last_time);
+        sqlite3_bind_int64(stmt, 9, static_cast<sqlite3_int64>(flow.packets_sent));
+        sqlite3_bind_int64(stmt, 10, static_cast<sqlite3_int64>(flow.bytes_sent));
+        sqlite3_bind_int64(stmt, 11, static_cast<sqlite3_int64>(flow.packets_received));
+        sqlite3_bind_int64(stmt, 12, static_cast<sqlite3_int64>(flow.bytes_received));
+        sqlite3_bind_int(stmt, 13, flow.tcp_flags_sent);
+        sqlite3_bind_int(stmt, 14, flow.tcp_flags_received);
+        sqlite3_bind_text(stmt, 15, flow.tcp_state.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) != SQLITE_DONE)
+        {
+            LOG_F(ERROR, "Failed to insert into t_flows: %s", sqlite3_errmsg(db));
+            ok = false;
+            break;
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_exec(db, ok ? "COMMIT;" : "ROLLBACK;", nullptr, nullptr, nullptr);
+    return ok;
+}
+
+bool SQLiteUtil::queryFlows(const std::string& ip, size_t limit,
+                            std::vector<Conversation>& conversations)
+{
+    conversations.clear();
+
+    std::string sql = "SELECT flow_id, src_ip, src_port, dst_ip, dst_port, ip_proto, first_time, "
+                      "last_time, packets_sent, bytes_sent, packets_received, bytes_received, "
+                      "tcp_flags_sent, tcp_flags_received, tcp_state FROM t_flows ";
+    if (!ip.empty())
+    {
+        sql += "WHERE src_ip = ?1 OR dst_ip = ?1 ";
+    }
+    sql += "ORDER BY bytes_sent + bytes_received DESC LIMIT ?2;";
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to query t_flows: %s", sqlite3_errmsg(db));
+        return false;
+    }
+
+    if (!ip.empty())
+    {
+        sqlite3_bind_text(stmt, 1, ip.c_str(), -1, SQLITE_STATIC);
+    }
+    sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(std::min<size_t>(limit, INT64_MAX)));
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        Conversation flow;
+        flow.flow_id            = static_cast<uint32_t>(sqlite3_column_int64(stmt, 0));
+        flow.src_ip             = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        flow.src_port           = static_cast<uint16_t>(sqlite3_column_int(stmt, 2));
+        flow.dst_ip             = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+        flow.dst_port           = static_cast<uint16_t>(sqlite3_column_int(stmt, 4));
+        flow.ip_proto           = static_cast<uint8_t>(sqlite3_column_int(stmt, 5));
+        flow.first_time         = sqlite3_column_double(stmt, 6);
+        flow.last_time          = sqlite3_column_double(stmt, 7);
+        flow.packets_sent       = static_cast<uint64_t>(sqlite3_column_int64(stmt, 8));
+        flow.bytes_sent         = static_cast<uint64_t>(sqlite3_column_int64(stmt, 9));
+        flow.packets_received   = static_cast<uint64_t>(sqlite3_column_int64(stmt, 10));
+        flow.bytes_received     = static_cast<uint64_t>(sqlite3_column_int64(stmt, 11));
+        flow.tcp_flags_sent     = static_cast<uint8_t>(sqlite3_column_int(stmt, 12));
+        flow.tcp_flags_received = static_cast<uint8_t>(sqlite3_column_int(stmt, 13));
+        flow.tcp_state          = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 14));
+        conversations.push_back(flow);
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+bool SQLiteUtil::replaceProtocolHierarchy(const std::vector<ProtocolHierarchyNode>& nodes)
+{
+    std::string   sql  = "INSERT INTO t_protocol_hierarchy (seq, path, protocol, depth, packets, "
+                         "bytes) VALUES (?, ?, ?, ?, ?, ?);";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to prepare protocol hierarchy insert: %s", sqlite3_errmsg(db));
+        return false;
+    }
+
+    // 节点很少，整体替换
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    bool ok = sqlite3_exec(db, "DELETE FROM t_protocol_hierarchy;", nullptr, nullptr, nullptr) ==
+              SQLITE_OK;
+    for (size_t i = 0; ok && i < nodes.size(); i++)
+    {
+        const ProtocolHierarchyNode& node = nodes[i];
+        sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(i));
+        sqlite3_bind_text(stmt, 2, node.path.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 3, node.protocol.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 4, static_cast<int>(node.depth));
+        sqlite3_bind_int64(stmt, 5, static_cast<sqlite3_int64>(node.packets));
+        sqlite3_bind_int64(stmt, 6, static_cast<sqlite3_int64>(node.bytes));
+        if (sqlite3_step(stmt) != SQLITE_DONE)
+        {
+            LOG_F(ERROR, "Failed to insert into t_protocol_hierarchy: %s", sqlite3_errmsg(db));
+            ok = false;
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_exec(db, ok ? "COMMIT;" : "ROLLBACK;", nullptr, nullptr, nullptr);
+    return ok;
+}
+
+bool SQLiteUtil::queryProtocolHierarchy(std::vector<ProtocolHierarchyNode>& nodes)
+{
+    nodes.clear();
+
+    std::string   sql  = "SELECT path, protocol, depth, packets, bytes FROM t_protocol_hierarchy "
+                         "ORDER BY seq;";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to query t_protocol_hierarchy: %s", sqlite3_errmsg(db));
+        return false;
+    }
+
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        ProtocolHierarchyNode node;
+        node.path     = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        node.protocol = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+        node.depth    = static_cast<uint32_t>(sqlite3_column_int(stmt, 2));
+        node.packets  = static_cast<uint64_t>(sqlite3_column_int64(stmt, 3));
+        node.bytes    = static_cast<uint64_t>(sqlite3_column_int64(stmt, 4));
+        nodes.push_back(node);
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+namespace
+{
+// 指标缺失时为负数，写入NULL
+void bindMetric(sqlite3_stmt* stmt, int index, double value)
+{
+    if (value < 0)
+    {
+        sqlite3_bind_null(stmt, index);
+    }
+    else
+    {
+        sqlite3_bind_double(stmt, index, value);
+    }
+}
+
+double columnMetric(sqlite3_stmt* stmt, int index)
+{
+    if (sqlite3_column_type(stmt, index) == SQLITE_NULL)
+    {
+        return -1;
+    }
+    return sqlite3_column_double(stmt, index);
+}
+} // namespace
+
+bool SQLiteUtil::upsertTcpMetrics(const std::vector<TcpFlowMetrics>& metrics)
+{
+    if (metrics.empty())
+    {
+        return true;
+    }
+
+    std::string sql = "INSERT OR REPLACE INTO t_tcp_metrics "
+                      "(flow_id, handshake_rtt, rtt_min, rtt_avg, rtt_max, rtt_samples, "
+                      "retransmissions, out_of_order, zero_windows, throughput_p50, "
+                      "throughput_p95, throughput_max) "
+                      "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to prepare tcp metrics insert: %s", sqlite3_errmsg(db));
+        return false;
+    }
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    bool ok = true;
+    for (const auto& flow : metrics)
+    {
+        sqlite3_bind_int64(stmt, 1, flow.flow_id);
+        bindMetric(stmt, 2, flow.handshake_rtt);
+        bindMetric(stmt, 3, flow.rtt_min);
+        bindMetric(stmt, 4, flow.rtt_avg);
+        bindMetric(stmt, 5, flow.rtt_max);
+        sqlite3_bind_int64(stmt, 6, flow.rtt_samples);
+        sqlite3_bind_int64(stmt, 7, flow.retransmissions);
+        sqlite3_bind_int64(stmt, 8, flow.out_of_order);
+        sqlite3_bind_int64(stmt, 9, flow.zero_windows);
+        bindMetric(stmt, 10, flow.throughput_p50);
+        bindMetric(stmt, 11, flow.throughput_p95);
+        bindMetric(stmt, 12, flow.throughput_max);
+        if (sqlite3_step(stmt) != SQLITE_DONE)
+        {
+            LOG_F(ERROR, "Failed to insert into t_tcp_metrics: %s", sqlite3_errmsg(db));
+            ok = false;
+            break;
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_exec(db, ok ? "COMMIT;" : "ROLLBACK;", nullptr, nullptr, nullptr);
+    return ok;
+}
+
+bool SQLiteUtil::queryTcpMetrics(size_t limit, std::vector<TcpFlowMetrics>& metrics)
+{
+    metrics.clear();
+
+    std::string   sql  = "SELECT flow_id, handshake_rtt, rtt_min, rtt_avg, rtt_max, rtt_samples, "
+                         "retransmissions, out_of_order, zero_windows, throughput_p50, "
+                         "throughput_p95, throughput_max FROM t_tcp_metrics "
+                         "ORDER BY retransmissions DESC, rtt_avg DESC LIMIT ?;";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to query t_tcp_metrics: %s", sqlite3_errmsg(db));
+        return false;
+    }
+    sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(limit));
+
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        TcpFlowMetrics flow;
+        flow.flow_id         = static_cast<uint32_t>(sqlite3_column_int64(stmt, 0));
+        flow.handshake_rtt   = columnMetric(stmt, 1);
+        flow.rtt_min         = columnMetric(stmt, 2);
+        flow.rtt_avg         = columnMetric(stmt, 3);
+        flow.rtt_max         = columnMetric(stmt, 4);
+        flow.rtt_samples     = static_cast<uint32_t>(sqlite3_column_int64(stmt, 5));
+        flow.retransmissions = static_cast<uint32_t>(sqlite3_column_int64(stmt, 6));
+        flow.out_of_order    = static_cast<uint32_t>(sqlite3_column_int64(stmt, 7));
+        flow.zero_windows    = static_cast<uint32_t>(sqlite3_column_int64(stmt, 8));
+        flow.throughput_p50  = columnMetric(stmt, 9);
+        flow.throughput_p95  = columnMetric(stmt, 10);
+        flow.throughput_max  = columnMetric(stmt, 11);
+        metrics.push_back(flow);
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+bool SQLiteUtil::createFlowTrendTable()
+{
+    std::string sql = R"(
+        CREATE TABLE IF NOT EXISTS t_flow_trend (
+            adapter TEXT NOT NULL,
+            tier INTEGER NOT NULL,
+            start_time INTEGER NOT NULL,
+            bytes INTEGER NOT NULL,
+            max_bytes INTEGER NOT NULL,
+            packets INTEGER NOT NULL,
+            PRIMARY KEY (adapter, tier, start_time)
+        ) WITHOUT ROWID;
+    )";
+
+    if (db == nullptr)
+    {
+        LOG_F(ERROR, "Database connection is not initialized");
+        return false;
+    }
+
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to create table t_flow_trend: %s", sqlite3_errmsg(db));
+        return false;
+    }
+    return true;
+}
+
+bool SQLiteUtil::insertFlowTrend(const std::string& adapter, int tier,
+                                 const std::vector<FlowTrendBucket>& buckets)
+{
+    if (buckets.empty())
+    {
+        return true;
+    }
+
+    std::string sql = "INSERT OR REPLACE INTO t_flow_trend "
+                      "(adapter, tier, start_time, bytes, max_bytes, packets) "
+                      "VALUES (?, ?, ?, ?, ?, ?);";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to prepare flow trend insert: %s", sqlite3_errmsg(db));
+        return false;
+    }
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    bool ok = true;
+    for (const auto& bucket : buckets)
+    {
+        sqlite3_bind_text(stmt, 1, adapter.c_str(), -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, 2, tier);
+        sqlite3_bind_int64(stmt, 3, bucket.start);
+        sqlite3_bind_int64(stmt, 4, static_cast<sqlite3_int64>(bucket.bytes));
+        sqlite3_bind_int64(stmt, 5, static_cast<sqlite3_int64>(bucket.max_bytes));
+        sqlite3_bind_int64(stmt, 6, static_cast<sqlite3_int64>(bucket.packets));
+        if (sqlite3_step(stmt) != SQLITE_DONE)
+        {
+            LOG_F(ERROR, "Failed to insert into t_flow_trend: %s", sqlite3_errmsg(db));
+            ok = false;
+            break;
+        }
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_exec(db, ok ? "COMMIT;" : "ROLLBACK;", nullptr, nullptr, nullptr);
+    return ok;
+}
+
+bool SQLiteUtil::queryFlowTrend(const std::string& adapter, int tier, long startTime,
+                                long endTime, std::vector<FlowTrendBucket>& buckets)
+{
+    buckets.clear();
+
+    std::string sql = "SELECT start_time, bytes, max_bytes, packets FROM t_flow_trend "
+                      "WHERE adapter = ? AND tier = ? AND start_time >= ? AND start_time < ? "
+                      "ORDER BY start_time;";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to query t_flow_trend: %s", sqlite3_errmsg(db));
+        return false;
+    }
+
+    sqlite3_bind_text(stmt, 1, adapter.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 2, tier);
+    sqlite3_bind_int64(stmt, 3, startTime);
+    sqlite3_bind_int64(stmt, 4, endTime);
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        FlowTrendBucket bucket;
+        bucket.start     = static_cast<long>(sqlite3_column_int64(stmt, 0));
+        bucket.bytes     = static_cast<uint64_t>(sqlite3_column_int64(stmt, 1));
+        bucket.max_bytes = static_cast<uint64_t>(sqlite3_column_int64(stmt, 2));
+        bucket.packets   = static_cast<uint64_t>(sqlite3_column_int64(stmt, 3));
+        buckets.push_back(bucket);
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+bool SQLiteUtil::queryFlowTrendStart(const std::string& adapter, long& startTime)
+{
+    startTime = -1;
+
+    std::string   sql  = "SELECT MIN(start_time) FROM t_flow_trend WHERE adapter = ?;";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        LOG_F(ERROR, "Failed to query t_flow_trend: %s", sqlite3_errmsg(db));
+        return false;
+    }
+
+    sqlite3_bind_text(stmt, 1, adapter.c_str(), -1, SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
+    if (rc == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL)
+    {
+        startTime = static_cast<long>(sqlite3_column_int64(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_ROW;
 }
 
 /**
@@ -0,0 +1,391 @@
+#include <cstdio>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include <zlib.h>
+
+#include "captureReader.hpp"
+#include "tsharkDataType.hpp"
+
+// 测试辅助函数
+namespace
+{
+    void put32(std::string& out, uint32_t value, bool swapped = false)
+    {
+        if (swapped)
+        {
+            value = (value >> 24) | ((value >> 8) & 0xFF00) | ((value << 8) & 0xFF0000) |
+                    (value << 24);
+        }
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void put16(std::string& out, uint16_t value, bool swapped = false)
+    {
+        if (swapped)
+        {
+            value = static_cast<uint16_t>((value >> 8) | (value << 8));
+        }
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    std::string pcapHeader(uint32_t magic, bool swapped = false)
+    {
+        std::string out;
+        put32(out, magic, swapped);
+        put16(out, 2, swapped);
+        put16(out, 4, swapped);
+        put32(out, 0, swapped);
+        put32(out, 0, swapped);
+        put32(out, 65535, swapped);
+        put32(out, 1, swapped);
+        return out;
+    }
+
+    void pcapRecord(std::string& out, uint32_t sec, uint32_t frac, const std::string& data,
+                    bool swapped = false)
+    {
+        put32(out, sec, swapped);
+        put32(out, frac, swapped);
+        put32(out, data.size(), swapped);
+        put32(out, data.size() + 10, swapped);
+        out += data;
+    }
+
+    const unsigned char* bytes(const std::string& s)
+    {
+        return reinterpret_cast<const unsigned char*>(s.data());
+    }
+} // namespace
+
+// 经典pcap格式，末尾不完整的记录留到下一次读取
+TEST(CaptureReaderTest, ClassicPcapIncremental)
+{
+    std::string file = pcapHeader(0xA1B2C3D4);
+    pcapRecord(file, 100, 500000, "abcd");
+    pcapRecord(file, 101, 250000, "efghij");
+
+    CaptureReader reader;
+    ASSERT_FALSE(reader.readHeader(bytes(file), 10));
+    ASSERT_TRUE(reader.readHeader(bytes(file), file.size()));
+    EXPECT_EQ(reader.headerSize(), sizeof(PcapHeader));
+
+    // 第二条记录只写入了一部分
+    std::vector<CaptureRecord> records;
+    uint64_t                   next;
+    ASSERT_TRUE(reader.readRecords(bytes(file), file.size() - 3, reader.headerSize(), records,
+                                   next));
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_EQ(records[0].block_offset, 24u);
+    EXPECT_EQ(records[0].data_offset, 40u);
+    EXPECT_EQ(records[0].cap_len, 4u);
+    EXPECT_EQ(records[0].len, 14u);
+    EXPECT_DOUBLE_EQ(records[0].time, 100.5);
+    EXPECT_EQ(next, 44u);
+    EXPECT_EQ(file.substr(records[0].data_offset, records[0].cap_len), "abcd");
+
+    ASSERT_TRUE(reader.readRecords(bytes(file), file.size(), next, records, next));
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(file.substr(records[1].data_offset, records[1].cap_len), "efghij");
+    EXPECT_DOUBLE_EQ(records[1].time, 101.25);
+    EXPECT_EQ(next, file.size());
+
+    // 没有新数据
+    ASSERT_TRUE(reader.readRecords(bytes(file), file.size(), next, records, next));
+    EXPECT_EQ(records.size(), 2u);
+}
+
+// 纳秒精度和相反字节序的pcap文件
+TEST(CaptureReaderTest, NanosecondAndSwappedPcap)
+{
+    std::string file = pcapHeader(0xA1B23C4D, true);
+    pcapRecord(file, 7, 250000000, "xyz", true);
+
+    CaptureReader reader;
+    ASSERT_TRUE(reader.readHeader(bytes(file), file.size()));
+
+    std::vector<CaptureRecord> records;
+    uint64_t                   next;
+    ASSERT_TRUE(reader.readRecords(bytes(file), file.size(), reader.headerSize(), records, next));
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_EQ(records[0].cap_len, 3u);
+    EXPECT_EQ(records[0].len, 13u);
+    EXPECT_DOUBLE_EQ(records[0].time, 7.25);
+
+    EXPECT_FALSE(reader.readHeader(bytes(std::string(24, 'x')), 24));
+}
+
+namespace
+{
+    // 按pcapng块格式补齐4字节并加上首尾块长度
+    std::string pcapngBlock(uint32_t type, const std::string& body, bool swapped = false)
+    {
+        std::string padded = body;
+        padded.append((4 - body.size() % 4) % 4, '\0');
+        uint32_t    length = padded.size() + 12;
+        std::string out;
+        put32(out, type, swapped);
+        put32(out, length, swapped);
+        out += padded;
+        put32(out, length, swapped);
+        return out;
+    }
+
+    std::string sectionHeader(bool swapped = false)
+    {
+        std::string body;
+        put32(body, 0x1A2B3C4D, swapped);
+        put16(body, 1, swapped);
+        put16(body, 0, swapped);
+        put32(body, 0xFFFFFFFF, swapped);
+        put32(body, 0xFFFFFFFF, swapped);
+        std::string out = pcapngBlock(0, body, swapped);
+        // 块类型0x0A0D0D0A是回文，与字节序无关
+        uint32_t type = 0x0A0D0D0A;
+        memcpy(&out[0], &type, sizeof(type));
+        return out;
+    }
+
+    std::string interfaceBlock(int tsresol, bool swapped = false)
+    {
+        std::string body;
+        put16(body, 1, swapped);
+        put16(body, 0, swapped);
+        put32(body, 65535, swapped);
+        if (tsresol >= 0)
+        {
+            put16(body, 9, swapped);
+            put16(body, 1, swapped);
+            body += static_cast<char>(tsresol);
+            body.append(3, '\0');
+        }
+        put16(body, 0, swapped);
+        put16(body, 0, swapped);
+        return pcapngBlock(1, body, swapped);
+    }
+
+    std::string enhancedPacket(uint32_t interfaceId, uint64_t timestamp, const std::string& data,
+                               bool swapped = false)
+    {
+        std::string body;
+        put32(body, interfaceId, swapped);
+        put32(body, timestamp >> 32, swapped);
+        put32(body, static_cast<uint32_t>(timestamp), swapped);
+        put32(body, data.size(), swapped);
+        put32(body, data.size(), swapped);
+        body += data;
+        return pcapngBlock(6, body, swapped);
+    }
+} // namespace
+
+// pcapng：多个接口的时间戳精度、简单数据包块、名称解析块和增量读取
+TEST(CaptureReaderTest, PcapngBlocks)
+{
+    std::string file = sectionHeader();
+    file += interfaceBlock(-1);
+    file += interfaceBlock(9);
+
+    std::string nrb;
+    put16(nrb, 1);
+    put16(nrb, 16);
+    nrb += std::string("\x0a\x00\x00\x01", 4) + "gateway" + std::string(5, '\0');
+    put16(nrb, 0);
+    put16(nrb, 0);
+    file += pcapngBlock(4, nrb);
+
+    size_t firstPacket = file.size();
+    file += enhancedPacket(0, 3500000, "abc");
+    file += enhancedPacket(1, 2250000000ULL, "defgh");
+    std::string spb;
+    put32(spb, 2);
+    spb += "ij";
+    size_t simplePacket = file.size();
+    file += pcapngBlock(3, spb);
+    // 追加一个纳秒以外精度（2^-10秒）的接口
+    file += interfaceBlock(0x80 | 10);
+    file += enhancedPacket(2, 1536, "k");
+
+    CaptureReader reader;
+    ASSERT_FALSE(reader.readHeader(bytes(file), 20));
+    EXPECT_TRUE(reader.truncated());
+    ASSERT_TRUE(reader.readHeader(bytes(file), file.size()));
+    EXPECT_TRUE(reader.isPcapng());
+    EXPECT_EQ(reader.headerSize(), 28u);
+
+    // 第一次只能读到第一个数据包
+    std::vector<CaptureRecord> records;
+    uint64_t                   next;
+    ASSERT_TRUE(reader.readRecords(bytes(file), firstPacket + 40, reader.headerSize(), records,
+                                   next));
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_EQ(reader.interfaceCount(), 2u);
+    EXPECT_EQ(reader.sectionBlocks().size(), 3u);
+    EXPECT_EQ(reader.resolvedNames().at("10.0.0.1"), "gateway");
+    EXPECT_EQ(records[0].block_offset, firstPacket);
+    EXPECT_EQ(file.substr(records[0].data_offset, records[0].cap_len), "abc");
+    EXPECT_DOUBLE_EQ(records[0].time, 3.5);
+
+    ASSERT_TRUE(reader.readRecords(bytes(file), file.size(), next, records, next));
+    ASSERT_EQ(records.size(), 4u);
+    EXPECT_EQ(records[1].interface_id, 1u);
+    EXPECT_EQ(file.substr(records[1].data_offset, records[1].cap_len), "defgh");
+    EXPECT_DOUBLE_EQ(records[1].time, 2.25);
+    EXPECT_EQ(records[2].block_offset, simplePacket);
+    EXPECT_EQ(file.substr(records[2].data_offset, records[2].cap_len), "ij");
+    EXPECT_EQ(records[3].interface_id, 2u);
+    EXPECT_DOUBLE_EQ(records[3].time, 1.5);
+    EXPECT_EQ(reader.interfaceCount(), 3u);
+    EXPECT_EQ(next, file.size());
+
+    // 按偏移随机读取时由记录头得到链路类型，偏移不在数据包开头时拒绝
+    for (const CaptureRecord& record : records)
+    {
+        uint16_t linkType = 0;
+        EXPECT_TRUE(reader.linkTypeBefore(bytes(file) + record.data_offset - 28, 28,
+                                          record.cap_len, linkType));
+        EXPECT_EQ(linkType, record.link_type);
+    }
+    uint16_t linkType;
+    EXPECT_FALSE(reader.linkTypeBefore(bytes(file) + records[1].data_offset - 24, 28,
+                                       records[1].cap_len, linkType));
+    EXPECT_FALSE(reader.linkTypeBefore(bytes(file) + records[1].data_offset - 28, 28, 4, linkType));
+}
+
+// 相反字节序的pcapng文件和数量限制
+TEST(CaptureReaderTest, SwappedPcapngWithLimit)
+{
+    std::string file = sectionHeader(true);
+    file += interfaceBlock(6, true);
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        file += enhancedPacket(0, (i + 1) * 1000000ULL, std::string(i + 1, 'a' + i), true);
+    }
+
+    CaptureReader reader;
+    ASSERT_TRUE(reader.readHeader(bytes(file), file.size()));
+
+    std::vector<CaptureRecord> records;
+    uint64_t                   next = reader.headerSize();
+    while (reader.readRecords(bytes(file), file.size(), next, records, next, 2) &&
+           next < file.size())
+    {
+    }
+    ASSERT_EQ(records.size(), 5u);
+    for (uint32_t i = 0; i < 5; i++)
+    {
+        EXPECT_EQ(records[i].cap_len, i + 1);
+        EXPECT_DOUBLE_EQ(records[i].time, i + 1.0);
+        EXPECT_EQ(file[records[i].data_offset], static_cast<char>('a' + i));
+    }
+
+    // 损坏的块长度
+    file[reader.headerSize() + 7] = 0x05;
+    CaptureReader corrupted;
+    ASSERT_TRUE(corrupted.readHeader(bytes(file), file.size()));
+    EXPECT_FALSE(corrupted.readRecords(bytes(file), file.size(), corrupted.headerSize(), records,
+                                       next));
+}
+
+namespace
+{
+    // 压缩为一个gzip成员
+    std::string gzipMember(const std::string& data)
+    {
+        z_stream strm;
+        memset(&strm, 0, sizeof(strm));
+        deflateInit2(&strm, 6, Z_DEFLATED, 31, 8, Z_DEFAULT_STRATEGY);
+        std::string out(deflateBound(&strm, data.size()) + 32, '\0');
+        strm.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        strm.avail_in  = data.size();
+        strm.next_out  = reinterpret_cast<Bytef*>(&out[0]);
+        strm.avail_out = out.size();
+        deflate(&strm, Z_FINISH);
+        out.resize(strm.total_out);
+        deflateEnd(&strm);
+        return out;
+    }
+
+    std::string writeTempFile(const std::string& content)
+    {
+        char path[] = "/tmp/easytshark_capture_XXXXXX";
+        int  fd     = mkstemp(path);
+        EXPECT_GE(fd, 0);
+        EXPECT_EQ(write(fd, content.data(), content.size()),
+                  static_cast<ssize_t>(content.size()));
+        close(fd);
+        return path;
+    }
+} // namespace
+
+// gzip压缩的抓包文件：分批扫描记录，并按偏移随机读取数据包
+TEST(CaptureReaderTest, GzipCaptureScanAndRandomAccess)
+{
+    // 内容不易压缩的数据包，使解压数据跨越多个访问点
+    std::string    pcap = pcapHeader(0xA1B2C3D4);
+    std::mt19937   rng(7);
+    const uint32_t count = 3000;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        std::string data(1000 + i % 500, '\0');
+        for (auto& c : data)
+        {
+            c = static_cast<char>(rng());
+        }
+        pcapRecord(pcap, i, 0, data);
+    }
+
+    // 两个gzip成员拼接
+    size_t      half = pcap.size() / 2;
+    std::string path =
+        writeTempFile(gzipMember(pcap.substr(0, half)) + gzipMember(pcap.substr(half)));
+    EXPECT_EQ(CompressedFile::detect(path), CompressedFile::FORMAT_GZIP);
+
+    CaptureFileScanner scanner;
+    ASSERT_TRUE(scanner.open(path));
+    EXPECT_TRUE(scanner.isCompressed());
+
+    std::vector<CaptureRecord> all;
+    std::vector<CaptureRecord> batch;
+    while (scanner.next(batch, 100) && !batch.empty())
+    {
+        all.insert(all.end(), batch.begin(), batch.end());
+    }
+    ASSERT_EQ(all.size(), count);
+    EXPECT_EQ(all.back().block_end, pcap.size());
+
+    CompressedFile file;
+    ASSERT_TRUE(file.open(path));
+    std::vector<unsigned char> buffer(2000);
+    // 第一次顺序读取到末尾建立索引，之后倒序随机读取
+    EXPECT_EQ(file.read(all.back().data_offset, buffer.data(), all.back().cap_len),
+              all.back().cap_len);
+    EXPECT_GT(file.accessPointCount(), 2u);
+    for (uint32_t i = count; i-- > 0;)
+    {
+        if (i % 97 != 0 && i != count - 1)
+        {
+            continue;
+        }
+        const CaptureRecord& record = all[i];
+        ASSERT_EQ(file.read(record.data_offset, buffer.data(), record.cap_len), record.cap_len);
+        EXPECT_EQ(memcmp(buffer.data(), pcap.data() + record.data_offset, record.cap_len), 0)
+            << "packet " << i;
+    }
+
+    // 跨越两个gzip成员的区间
+    ASSERT_EQ(file.read(half - 1000, buffer.data(), 2000), 2000u);
+    EXPECT_EQ(memcmp(buffer.data(), pcap.data() + half - 1000, 2000), 0);
+
+    // 读取超出文件末尾的部分
+    EXPECT_EQ(file.read(pcap.size() - 10, buffer.data(), 100), 10u);
+    std::remove(path.c_str());
+
+    // zstd魔数
+    std::string zstdPath = writeTempFile(std::string("\x28\xb5\x2f\xfd", 4) + "data");
+    EXPECT_EQ(CompressedFile::detect(zstdPath), CompressedFile::FORMAT_ZSTD);
+    EXPECT_FALSE(scanner.open(zstdPath));
+    std::remove(zstdPath.c_str());
+}
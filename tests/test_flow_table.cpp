@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "flowTable.hpp"
+#include "packetStore.hpp"
+#include "utils.hpp"
+
+namespace
+{
+// 追加一个TCP数据包并计入连接表
+uint32_t addTcp(PacketStore& store, FlowTable& table, double time, const std::string& src,
+                uint16_t srcPort, const std::string& dst, uint16_t dstPort, uint8_t flags,
+                uint32_t len)
+{
+    Packet packet    = {};
+    packet.time      = time;
+    packet.len       = len;
+    packet.cap_len   = len;
+    packet.src_ip    = src;
+    packet.dst_ip    = dst;
+    packet.src_port  = srcPort;
+    packet.dst_port  = dstPort;
+    packet.ip_proto  = 6;
+    packet.tcp_flags = flags;
+    packet.protocol  = "TCP";
+
+    uint32_t index  = store.append(packet);
+    uint32_t flowId = UINT32_MAX;
+    EXPECT_TRUE(table.add(store.at(index), index, flowId));
+    return flowId;
+}
+} // namespace
+
+// 两个方向的数据包归入同一个连接，并跟踪TCP握手和挥手
+TEST(FlowTableTest, BidirectionalTcpConversation)
+{
+    PacketStore store;
+    FlowTable   table;
+    const uint8_t syn = FlowTable::kTcpSyn, ack = FlowTable::kTcpAck, fin = FlowTable::kTcpFin;
+
+    // 发起端的地址更大，检查src取自第一个数据包而不是归一化后的顺序
+    uint32_t id = addTcp(store, table, 10.0, "192.168.1.20", 50000, "10.0.0.1", 443, syn, 74);
+    EXPECT_EQ(table.at(id).tcp_state, FlowTable::TCP_SYN_SENT);
+    EXPECT_EQ(addTcp(store, table, 10.1, "10.0.0.1", 443, "192.168.1.20", 50000, syn | ack, 74),
+              id);
+    EXPECT_EQ(table.at(id).tcp_state, FlowTable::TCP_SYN_RECEIVED);
+    addTcp(store, table, 10.2, "192.168.1.20", 50000, "10.0.0.1", 443, ack, 66);
+    EXPECT_EQ(table.at(id).tcp_state, FlowTable::TCP_ESTABLISHED);
+    addTcp(store, table, 10.3, "10.0.0.1", 443, "192.168.1.20", 50000, ack, 1500);
+    addTcp(store, table, 11.0, "192.168.1.20", 50000, "10.0.0.1", 443, fin | ack, 66);
+    EXPECT_EQ(table.at(id).tcp_state, FlowTable::TCP_CLOSING);
+    addTcp(store, table, 11.1, "10.0.0.1", 443, "192.168.1.20", 50000, fin | ack, 66);
+    EXPECT_EQ(table.at(id).tcp_state, FlowTable::TCP_CLOSED);
+
+    // 另一个源端口是另一个连接，RST直接结束
+    uint32_t other = addTcp(store, table, 12.0, "192.168.1.20", 50001, "10.0.0.1", 443, syn, 74);
+    EXPECT_NE(other, id);
+    addTcp(store, table, 12.1, "10.0.0.1", 443, "192.168.1.20", 50001, FlowTable::kTcpRst, 60);
+    EXPECT_EQ(table.at(other).tcp_state, FlowTable::TCP_RESET);
+    ASSERT_EQ(table.size(), 2u);
+
+    Conversation conversation;
+    table.toConversation(id, conversation);
+    EXPECT_EQ(conversation.src_ip, "192.168.1.20");
+    EXPECT_EQ(conversation.src_port, 50000);
+    EXPECT_EQ(conversation.dst_ip, "10.0.0.1");
+    EXPECT_EQ(conversation.dst_port, 443);
+    EXPECT_EQ(conversation.ip_proto, 6);
+    EXPECT_EQ(conversation.packets_sent, 3u);
+    EXPECT_EQ(conversation.bytes_sent, 74u + 66u + 66u);
+    EXPECT_EQ(conversation.packets_received, 3u);
+    EXPECT_EQ(conversation.bytes_received, 74u + 1500u + 66u);
+    EXPECT_DOUBLE_EQ(conversation.first_time, 10.0);
+    EXPECT_DOUBLE_EQ(conversation.last_time, 11.1);
+    EXPECT_EQ(conversation.tcp_flags_sent, syn | ack | fin);
+    EXPECT_EQ(conversation.tcp_state, "CLOSED");
+
+    // 按连接遍历只得到该连接的数据包，顺序与加入时一致
+    std::vector<uint32_t> indexes;
+    table.forEachPacket(other, [&](uint32_t index) { indexes.push_back(index); });
+    EXPECT_EQ(indexes, (std::vector<uint32_t>{6, 7}));
+    indexes.clear();
+    table.forEachPacket(id, [&](uint32_t index) { indexes.push_back(index); });
+    EXPECT_EQ(indexes, (std::vector<uint32_t>{0, 1, 2, 3, 4, 5}));
+
+    std::vector<uint32_t> dirty;
+    table.takeDirty(dirty);
+    EXPECT_EQ(dirty, (std::vector<uint32_t>{id, other}));
+    table.takeDirty(dirty);
+    EXPECT_TRUE(dirty.empty());
+    addTcp(store, table, 13.0, "10.0.0.1", 443, "192.168.1.20", 50001, ack, 60);
+    table.takeDirty(dirty);
+    EXPECT_EQ(dirty, (std::vector<uint32_t>{other}));
+
+    // 没有IP地址的数据包不计入
+    Packet arp   = {};
+    arp.protocol = "ARP";
+    uint32_t unused;
+    uint32_t arpIndex = store.append(arp);
+    EXPECT_FALSE(table.add(store.at(arpIndex), arpIndex, unused));
+}
+
+// 大量连接触发哈希表扩容后仍能找到已有连接
+TEST(FlowTableTest, GrowAndPersist)
+{
+    PacketStore store;
+    FlowTable   table;
+    for (int i = 0; i < 5000; i++)
+    {
+        addTcp(store, table, i, "10.1." + std::to_string(i / 250) + "." + std::to_string(i % 250),
+               static_cast<uint16_t>(1024 + i), "10.0.0.1", 80, FlowTable::kTcpAck, 100);
+    }
+    ASSERT_EQ(table.size(), 5000u);
+    EXPECT_EQ(addTcp(store, table, 6000, "10.0.0.1", 80, "10.1.0.7", 1031, FlowTable::kTcpAck, 40),
+              7u);
+
+    std::vector<uint32_t> dirty;
+    table.takeDirty(dirty);
+    std::vector<Conversation> conversations(dirty.size());
+    for (size_t i = 0; i < dirty.size(); i++)
+    {
+        table.toConversation(dirty[i], conversations[i]);
+    }
+
+    SQLiteUtil sqliteUtil(":memory:");
+    ASSERT_TRUE(sqliteUtil.createPacketTable());
+    ASSERT_TRUE(sqliteUtil.upsertFlows(conversations));
+
+    // 再次写入同一连接时覆盖
+    conversations.resize(1);
+    table.toConversation(7, conversations[0]);
+    conversations[0].bytes_received = 100000;
+    ASSERT_TRUE(sqliteUtil.upsertFlows(conversations));
+
+    std::vector<Conversation> stored;
+    ASSERT_TRUE(sqliteUtil.queryFlows("", 3, stored));
+    ASSERT_EQ(stored.size(), 3u);
+    EXPECT_EQ(stored[0].flow_id, 7u);
+    EXPECT_EQ(stored[0].src_ip, "10.1.0.7");
+    EXPECT_EQ(stored[0].bytes_sent, 100u);
+    EXPECT_EQ(stored[0].packets_received, 1u);
+    EXPECT_EQ(stored[0].tcp_state, "ESTABLISHED");
+
+    ASSERT_TRUE(sqliteUtil.queryFlows("10.1.3.4", 10, stored));
+    ASSERT_EQ(stored.size(), 1u);
+    EXPECT_EQ(stored[0].src_port, 1024 + 754);
+}
@@ -0,0 +1,163 @@
+#include <atomic>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "flowTrend.hpp"
+#include "utils.hpp"
+
+// 环形缓冲区按秒累加，超出窗口的数据被覆盖
+TEST(FlowTrendRingTest, AddAndSnapshot)
+{
+    FlowTrendRing ring;
+    ring.add(1000, 10);
+    ring.add(1000, 5);
+    ring.add(1002, 7);
+
+    std::vector<long> values(4);
+    ring.snapshot(999, values.size(), values.data());
+    EXPECT_EQ(values, (std::vector<long>{0, 15, 0, 7}));
+
+    // 1300与1000共用一个槽位，1000的数据被覆盖
+    ring.add(1000 + FlowTrendRing::kSlots, 3);
+    ring.snapshot(1000, 1, values.data());
+    EXPECT_EQ(values[0], 0);
+    ring.snapshot(1000 + FlowTrendRing::kSlots, 1, values.data());
+    EXPECT_EQ(values[0], 3);
+
+    ring.clear();
+    ring.snapshot(1002, 1, values.data());
+    EXPECT_EQ(values[0], 0);
+}
+
+// 读取线程不会读到写入中途的槽位
+TEST(FlowTrendRingTest, ConcurrentSnapshot)
+{
+    FlowTrendRing     ring;
+    std::atomic<bool> done(false);
+    const long        last = 20000;
+
+    // 每一秒分两次写入，总和为秒数
+    std::thread writer([&]() {
+        for (long second = 1; second <= last; second++)
+        {
+            ring.add(second, second / 2);
+            ring.add(second, second - second / 2);
+        }
+        done = true;
+    });
+
+    std::vector<long> values(FlowTrendRing::kSlots);
+    bool              consistent = true;
+    while (!done)
+    {
+        for (long start = 1; start <= last && !done; start += FlowTrendRing::kSlots)
+        {
+            ring.snapshot(start, values.size(), values.data());
+            for (size_t i = 0; i < values.size(); i++)
+            {
+                long second = start + static_cast<long>(i);
+                long half   = second / 2;
+                if (values[i] != 0 && values[i] != half && values[i] != second)
+                {
+                    consistent = false;
+                }
+            }
+        }
+    }
+    writer.join();
+    EXPECT_TRUE(consistent);
+
+    ring.snapshot(last - 1, 2, values.data());
+    EXPECT_EQ(values[0], last - 1);
+    EXPECT_EQ(values[1], last);
+}
+
+// 三层降采样：秒级、分钟级、小时级的总量、最大值和包数
+TEST(FlowTrendRollupTest, TiersAndCompletedBuckets)
+{
+    FlowTrendRollup rollup(120, 10, 4);
+    const long      base = 36000; // 整点
+
+    // 还没有数据时不生成空桶
+    std::vector<FlowTrendBucket> buckets;
+    rollup.query(FlowTrendRollup::TIER_HOUR, 0, base, buckets);
+    EXPECT_TRUE(buckets.empty());
+
+    // 两个半小时，每秒字节数为秒内偏移对100取模
+    for (long t = base; t < base + 2 * 3600 + 1800; t++)
+    {
+        rollup.add(t, (t - base) % 100, 1);
+    }
+
+    rollup.query(FlowTrendRollup::TIER_HOUR, 0, base + 3 * 3600, buckets);
+    ASSERT_EQ(buckets.size(), 3u);
+    EXPECT_EQ(buckets[0].start, base);
+    EXPECT_EQ(buckets[0].packets, 3600u);
+    EXPECT_EQ(buckets[0].bytes, 36u * 4950u);
+    EXPECT_EQ(buckets[0].max_bytes, 99u);
+    EXPECT_EQ(buckets[2].packets, 1800u);
+
+    // 分钟层只保留最近10个桶，更早的部分被截掉
+    rollup.query(FlowTrendRollup::TIER_MINUTE, base, base + 2 * 3600 + 1800, buckets);
+    ASSERT_EQ(buckets.size(), 10u);
+    EXPECT_EQ(buckets.front().start, base + 2 * 3600 + 1800 - 600);
+    EXPECT_EQ(buckets.back().packets, 60u);
+    EXPECT_EQ(rollup.oldestStart(FlowTrendRollup::TIER_MINUTE), buckets.front().start);
+
+    rollup.query(FlowTrendRollup::TIER_SECOND, base + 2 * 3600 + 1799, base + 2 * 3600 + 1801,
+                 buckets);
+    ASSERT_EQ(buckets.size(), 2u);
+    EXPECT_EQ(buckets[0].bytes, 99u);
+    EXPECT_EQ(buckets[1].bytes, 0u);
+
+    // 按时间跨度选择层
+    EXPECT_EQ(rollup.tierForSpan(100), FlowTrendRollup::TIER_SECOND);
+    EXPECT_EQ(rollup.tierForSpan(600), FlowTrendRollup::TIER_MINUTE);
+    EXPECT_EQ(rollup.tierForSpan(86400), FlowTrendRollup::TIER_HOUR);
+
+    // 结束的分钟桶和小时桶等待持久化
+    std::vector<std::pair<FlowTrendRollup::Tier, FlowTrendBucket>> completed;
+    rollup.takeCompleted(completed);
+    size_t hours = 0;
+    for (const auto& entry : completed)
+    {
+        hours += entry.first == FlowTrendRollup::TIER_HOUR;
+        EXPECT_NE(entry.first, FlowTrendRollup::TIER_SECOND);
+    }
+    EXPECT_EQ(hours, 2u);
+    EXPECT_EQ(completed.size(), 2u + 149u);
+    rollup.takeCompleted(completed);
+    EXPECT_TRUE(completed.empty());
+}
+
+// 流量趋势桶的持久化
+TEST(FlowTrendRollupTest, SQLitePersistence)
+{
+    SQLiteUtil sqliteUtil(":memory:");
+    ASSERT_TRUE(sqliteUtil.createFlowTrendTable());
+
+    std::vector<FlowTrendBucket> buckets = {{60, 100, 10, 2}, {120, 200, 20, 4}, {180, 1, 1, 1}};
+    ASSERT_TRUE(sqliteUtil.insertFlowTrend("eth0", FlowTrendRollup::TIER_MINUTE, buckets));
+    buckets[1].bytes = 300;
+    ASSERT_TRUE(sqliteUtil.insertFlowTrend("eth0", FlowTrendRollup::TIER_MINUTE, buckets));
+
+    std::vector<FlowTrendBucket> stored;
+    ASSERT_TRUE(
+        sqliteUtil.queryFlowTrend("eth0", FlowTrendRollup::TIER_MINUTE, 100, 180, stored));
+    ASSERT_EQ(stored.size(), 1u);
+    EXPECT_EQ(stored[0].start, 120);
+    EXPECT_EQ(stored[0].bytes, 300u);
+    EXPECT_EQ(stored[0].max_bytes, 20u);
+    EXPECT_EQ(stored[0].packets, 4u);
+
+    ASSERT_TRUE(sqliteUtil.queryFlowTrend("eth1", FlowTrendRollup::TIER_MINUTE, 0, 1000, stored));
+    EXPECT_TRUE(stored.empty());
+
+    // 最早保存的桶
+    long start = 0;
+    ASSERT_TRUE(sqliteUtil.queryFlowTrendStart("eth0", start));
+    EXPECT_EQ(start, 60);
+    ASSERT_TRUE(sqliteUtil.queryFlowTrendStart("eth1", start));
+    EXPECT_EQ(start, -1);
+}
@@ -0,0 +1,359 @@
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "liveStats.hpp"
+#include "utils.hpp"
+
+// 少量重的键混在大量只出现一次的键中，Space-Saving应当找出重的键
+TEST(LiveStatsTest, SpaceSavingHeavyHitters)
+{
+    SpaceSaving summary(16);
+    for (int i = 0; i < 10000; i++)
+    {
+        summary.add("light" + std::to_string(i), 10);
+        if (i % 10 == 0)
+        {
+            summary.add("heavy-a", 100);
+        }
+        if (i % 20 == 0)
+        {
+            summary.add("heavy-b", 100);
+        }
+    }
+    EXPECT_EQ(summary.size(), 16u);
+
+    std::vector<HeavyHitter> items;
+    summary.top(2, items);
+    ASSERT_EQ(items.size(), 2u);
+    EXPECT_EQ(items[0].key, "heavy-a");
+    EXPECT_EQ(items[1].key, "heavy-b");
+    // 计数是上界，减去误差后不超过真实值
+    EXPECT_GE(items[0].bytes, 100000u);
+    EXPECT_LE(items[0].bytes - items[0].error, 100000u);
+    EXPECT_GE(items[1].bytes, 50000u);
+    EXPECT_LE(items[1].bytes - items[1].error, 50000u);
+}
+
+TEST(LiveStatsTest, CountMinEstimate)
+{
+    CountMinSketch sketch(64, 4);
+    for (int i = 0; i < 1000; i++)
+    {
+        sketch.add("host" + std::to_string(i), 1);
+    }
+    sketch.add("10.0.0.1", 5000);
+    EXPECT_GE(sketch.estimate("10.0.0.1"), 5000u);
+    EXPECT_LT(sketch.estimate("10.0.0.1"), 5000u + 100u);
+    EXPECT_GE(sketch.estimate("host7"), 1u);
+
+    sketch.clear();
+    EXPECT_EQ(sketch.estimate("10.0.0.1"), 0u);
+}
+
+// 每进入新的一秒发布上一秒的快照
+TEST(LiveStatsTest, PerSecondSnapshot)
+{
+    LiveTrafficStats    stats(3, 32);
+    LiveTrafficSnapshot snapshot;
+    stats.snapshot(snapshot);
+    EXPECT_EQ(snapshot.second, -1);
+
+    Packet packet   = {};
+    packet.time     = 100.2;
+    packet.len      = 1000;
+    packet.src_ip   = "192.168.1.2";
+    packet.dst_ip   = "8.8.8.8";
+    packet.src_port = 50000;
+    packet.dst_port = 443;
+    packet.protocol = "TLSv1.2";
+    stats.add(packet);
+    packet.len      = 60;
+    packet.protocol = "TCP";
+    stats.add(packet);
+
+    // 还在当前这一秒，没有发布
+    stats.snapshot(snapshot);
+    EXPECT_EQ(snapshot.second, -1);
+
+    packet.time     = 101.5;
+    packet.len      = 80;
+    packet.dst_ip   = "1.1.1.1";
+    packet.src_port = 0;
+    packet.dst_port = 53;
+    packet.protocol = "DNS";
+    stats.add(packet);
+
+    stats.snapshot(snapshot);
+    EXPECT_EQ(snapshot.second, 100);
+    EXPECT_EQ(snapshot.packets, 2u);
+    EXPECT_EQ(snapshot.bytes, 1060u);
+    ASSERT_EQ(snapshot.protocols.size(), 2u);
+    EXPECT_EQ(snapshot.protocols[0].key, "TLSv1.2");
+    EXPECT_EQ(snapshot.protocols[0].packets, 1u);
+    EXPECT_EQ(snapshot.protocols[1].key, "TCP");
+    ASSERT_EQ(snapshot.top_ports.size(), 2u);
+    EXPECT_EQ(snapshot.top_ports[0].bytes, 1060u);
+
+    // 空闲时推进时间，发布最后一秒
+    stats.advance(103);
+    stats.snapshot(snapshot);
+    EXPECT_EQ(snapshot.second, 101);
+    EXPECT_EQ(snapshot.packets, 1u);
+    EXPECT_EQ(snapshot.total_packets, 3u);
+    EXPECT_EQ(snapshot.total_bytes, 1140u);
+    ASSERT_EQ(snapshot.total_protocols.size(), 3u);
+    ASSERT_EQ(snapshot.top_src_ips.size(), 1u);
+    EXPECT_EQ(snapshot.top_src_ips[0].key, "192.168.1.2");
+    EXPECT_EQ(snapshot.top_src_ips[0].packets, 3u);
+    ASSERT_EQ(snapshot.top_dst_ips.size(), 2u);
+    EXPECT_EQ(snapshot.top_dst_ips[0].key, "8.8.8.8");
+    ASSERT_EQ(snapshot.top_ports.size(), 3u);
+    EXPECT_EQ(snapshot.top_ports[2].key, "53");
+    EXPECT_EQ(stats.estimateBytes(LiveTrafficStats::DIM_PORT, "443"), 1060u);
+
+    stats.advance(104);
+    stats.snapshot(snapshot);
+    EXPECT_EQ(snapshot.second, 103);
+    EXPECT_EQ(snapshot.packets, 0u);
+    EXPECT_TRUE(snapshot.protocols.empty());
+
+    stats.reset();
+    stats.snapshot(snapshot);
+    EXPECT_EQ(snapshot.second, -1);
+    EXPECT_EQ(snapshot.total_packets, 0u);
+}
+
+// 保存后恢复的统计与原统计一致，恢复时立即发布快照
+TEST(LiveStatsTest, SaveAndLoad)
+{
+    LiveTrafficStats stats(3, 32);
+    Packet           packet = {};
+    for (int i = 0; i < 100; i++)
+    {
+        packet.time     = 100 + i * 0.05;
+        packet.len      = 100 + i;
+        packet.src_ip   = "10.0.0." + std::to_string(i % 7);
+        packet.dst_ip   = "10.0.1." + std::to_string(i % 3);
+        packet.src_port = static_cast<uint16_t>(40000 + i % 5);
+        packet.dst_port = 443;
+        packet.protocol = i % 2 ? "TCP" : "TLSv1.3";
+        stats.add(packet);
+    }
+    stats.flush();
+
+    FILE* file = tmpfile();
+    ASSERT_TRUE(file != nullptr);
+    ASSERT_TRUE(stats.save(file));
+    std::vector<unsigned char> content(ftell(file));
+    rewind(file);
+    ASSERT_EQ(fread(content.data(), 1, content.size(), file), content.size());
+    fclose(file);
+
+    LiveTrafficStats     loaded(3, 32);
+    const unsigned char* data = content.data();
+    ASSERT_TRUE(loaded.load(data, data + content.size()));
+    EXPECT_EQ(data, content.data() + content.size());
+
+    LiveTrafficSnapshot expected;
+    LiveTrafficSnapshot actual;
+    stats.snapshot(expected);
+    loaded.snapshot(actual);
+    EXPECT_EQ(actual.second, expected.second);
+    EXPECT_EQ(actual.packets, expected.packets);
+    EXPECT_EQ(actual.total_bytes, expected.total_bytes);
+    ASSERT_EQ(actual.top_src_ips.size(), expected.top_src_ips.size());
+    for (size_t i = 0; i < expected.top_src_ips.size(); i++)
+    {
+        EXPECT_EQ(actual.top_src_ips[i].key, expected.top_src_ips[i].key);
+        EXPECT_EQ(actual.top_src_ips[i].bytes, expected.top_src_ips[i].bytes);
+    }
+    EXPECT_EQ(loaded.estimateBytes(LiveTrafficStats::DIM_PORT, "443"),
+              stats.estimateBytes(LiveTrafficStats::DIM_PORT, "443"));
+
+    // 恢复后继续统计新的数据包
+    packet.time = 200;
+    loaded.add(packet);
+    loaded.flush();
+    loaded.snapshot(actual);
+    EXPECT_EQ(actual.total_packets, 101u);
+
+    // 数据不完整时统计被清空
+    data = content.data();
+    EXPECT_FALSE(loaded.load(data, data + content.size() - 1));
+    loaded.snapshot(actual);
+    EXPECT_EQ(actual.second, -1);
+    EXPECT_EQ(actual.total_packets, 0u);
+}
+
+// HyperLogLog的误差在理论范围内，合并等于对并集估计
+TEST(LiveStatsTest, HyperLogLogEstimateAndMerge)
+{
+    HyperLogLog first(12);
+    HyperLogLog second(12);
+    for (uint64_t i = 0; i < 50000; i++)
+    {
+        uint64_t hash = HashUtil::xxh64(&i, sizeof(i));
+        first.addHash(hash);
+        first.addHash(hash); // 重复元素不影响估计
+        if (i >= 25000)
+        {
+            second.addHash(hash);
+        }
+    }
+    for (uint64_t i = 50000; i < 75000; i++)
+    {
+        second.addHash(HashUtil::xxh64(&i, sizeof(i)));
+    }
+
+    // 精度12的标准误差约1.6%，允许5%
+    EXPECT_NEAR(first.estimate(), 50000, 2500);
+    EXPECT_NEAR(second.estimate(), 50000, 2500);
+    ASSERT_TRUE(first.merge(second));
+    EXPECT_NEAR(first.estimate(), 75000, 3750);
+    EXPECT_FALSE(first.merge(HyperLogLog(10)));
+
+    HyperLogLog small;
+    for (uint64_t i = 0; i < 10; i++)
+    {
+        small.addHash(HashUtil::xxh64(&i, sizeof(i)));
+    }
+    EXPECT_NEAR(small.estimate(), 10, 1);
+    small.clear();
+    EXPECT_EQ(small.estimate(), 0);
+}
+
+// 按分钟统计不同端点，查询时合并多个分钟
+TEST(LiveStatsTest, EndpointCardinalityPerMinute)
+{
+    EndpointCardinality stats(12, 3);
+    Packet              packet = {};
+    packet.dst_ip              = "10.0.0.1";
+    packet.dst_port            = 80;
+
+    // 第一分钟100个源IP扫描同一个目标，第二分钟其中50个再次出现
+    for (int i = 0; i < 100; i++)
+    {
+        packet.time     = 600 + i * 0.1;
+        packet.src_ip   = "192.168.0." + std::to_string(i);
+        packet.src_port = static_cast<uint16_t>(40000 + i);
+        stats.add(packet);
+    }
+    for (int i = 50; i < 100; i++)
+    {
+        packet.time     = 660 + i * 0.1;
+        packet.src_ip   = "192.168.0." + std::to_string(i);
+        packet.src_port = static_cast<uint16_t>(40000 + i);
+        stats.add(packet);
+    }
+
+    std::vector<DistinctEndpoints> minutes;
+    stats.perMinute(600, 720, minutes);
+    ASSERT_EQ(minutes.size(), 2u);
+    EXPECT_EQ(minutes[0].start, 600);
+    EXPECT_NEAR(minutes[0].src_ips, 100, 3);
+    EXPECT_NEAR(minutes[0].dst_ips, 1, 0.1);
+    EXPECT_NEAR(minutes[0].flows, 100, 3);
+    EXPECT_NEAR(minutes[1].src_ips, 50, 2);
+
+    DistinctEndpoints total;
+    ASSERT_TRUE(stats.query(610, 700, total));
+    EXPECT_EQ(total.start, 600);
+    EXPECT_EQ(total.end, 720);
+    EXPECT_NEAR(total.src_ips, 100, 3);
+    EXPECT_FALSE(stats.query(0, 600, total));
+
+    // 合并另一个线程的统计
+    EndpointCardinality other(12, 3);
+    packet.time   = 700;
+    packet.src_ip = "172.16.0.1";
+    other.add(packet);
+    stats.merge(other);
+    ASSERT_TRUE(stats.query(600, 720, total));
+    EXPECT_NEAR(total.src_ips, 101, 3);
+
+    // 超出保留的分钟数时丢弃最早的
+    packet.time = 720;
+    stats.add(packet);
+    packet.time = 780;
+    stats.add(packet);
+    stats.perMinute(0, 1000, minutes);
+    ASSERT_EQ(minutes.size(), 3u);
+    EXPECT_EQ(minutes[0].start, 660);
+
+    // 连接不区分方向，协议不同的是不同连接
+    EndpointCardinality flows(12, 3);
+    Packet              reply = packet;
+    std::swap(reply.src_ip, reply.dst_ip);
+    std::swap(reply.src_port, reply.dst_port);
+    packet.ip_proto = 6;
+    reply.ip_proto  = 6;
+    flows.add(packet);
+    flows.add(reply);
+    ASSERT_TRUE(flows.query(780, 840, total));
+    EXPECT_NEAR(total.flows, 1, 0.1);
+    reply.ip_proto = 17;
+    flows.add(reply);
+    ASSERT_TRUE(flows.query(780, 840, total));
+    EXPECT_NEAR(total.flows, 2, 0.1);
+}
+
+// 保存后恢复的端点统计与原统计一致
+TEST(LiveStatsTest, EndpointCardinalitySaveAndLoad)
+{
+    EndpointCardinality stats(12, 10);
+    Packet              packet = {};
+    packet.dst_ip              = "10.0.0.1";
+    packet.dst_port            = 80;
+    for (int i = 0; i < 300; i++)
+    {
+        packet.time     = 600 + i * 0.5;
+        packet.src_ip   = "192.168.0." + std::to_string(i % 200);
+        packet.src_port = static_cast<uint16_t>(40000 + i);
+        stats.add(packet);
+    }
+
+    FILE* file = tmpfile();
+    ASSERT_TRUE(file != nullptr);
+    ASSERT_TRUE(stats.save(file));
+    std::vector<unsigned char> content(ftell(file));
+    rewind(file);
+    ASSERT_EQ(fread(content.data(), 1, content.size(), file), content.size());
+    fclose(file);
+
+    EndpointCardinality  loaded(12, 10);
+    const unsigned char* data = content.data();
+    ASSERT_TRUE(loaded.load(data, data + content.size()));
+    EXPECT_EQ(data, content.data() + content.size());
+
+    std::vector<DistinctEndpoints> expected;
+    std::vector<DistinctEndpoints> actual;
+    stats.perMinute(0, 1000, expected);
+    loaded.perMinute(0, 1000, actual);
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        EXPECT_EQ(actual[i].start, expected[i].start);
+        EXPECT_EQ(actual[i].src_ips, expected[i].src_ips);
+        EXPECT_EQ(actual[i].flows, expected[i].flows);
+    }
+
+    // 保留的分钟数较少时只恢复最近的分钟
+    EndpointCardinality recent(12, 1);
+    data = content.data();
+    ASSERT_TRUE(recent.load(data, data + content.size()));
+    recent.perMinute(0, 1000, actual);
+    ASSERT_EQ(actual.size(), 1u);
+    EXPECT_EQ(actual[0].start, expected.back().start);
+
+    // 精度不同或数据不完整时失败
+    EndpointCardinality other(10, 10);
+    data = content.data();
+    EXPECT_FALSE(other.load(data, data + content.size()));
+    data = content.data();
+    EXPECT_FALSE(loaded.load(data, data + content.size() - 1));
+    loaded.perMinute(0, 1000, actual);
+    EXPECT_TRUE(actual.empty());
+}
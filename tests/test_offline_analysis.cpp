@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
 #include "tsharkManager.hpp"
 #include "utils.hpp"
+#include "analysisCache.hpp"
+#include <sys/stat.h>
+#include <utime.h>
 #include <memory>
 #include <fstream>
 #include <cstdio>
@@ -262,4 +265,70 @@ TEST_F(IntegrationTest, OfflineAnalysisWorkflow) {
     std::ifstream jsonFile(testJsonPath);
     EXPECT_TRUE(jsonFile.good()) << "JSON文件应该已创建";
     jsonFile.close();
-}
\ No newline at end of file
+}
+
+// 分析缓存：内容哈希、命中/未命中统计以及按大小上限淘汰
+TEST(AnalysisCacheTest, HashFetchStoreEvict) {
+    system("rm -rf test_cache && mkdir -p test_data");
+    const std::string capture = "test_data/cache_capture.pcap";
+    const std::string artifact = "test_data/cache_artifact.db";
+    {
+        std::ofstream out(capture, std::ios::binary);
+        out << std::string((9 << 20) + 5, 'c');
+        std::ofstream art(artifact, std::ios::binary);
+        art << std::string(1000, 'a');
+    }
+
+    // 相同内容哈希一致，内容变化后哈希不同
+    std::string key1, key2;
+    ASSERT_TRUE(AnalysisCache::hashFile(capture, key1));
+    ASSERT_TRUE(AnalysisCache::hashFile(capture, key2));
+    EXPECT_EQ(key1, key2);
+    EXPECT_EQ(key1.size(), 16u);
+    {
+        std::fstream out(capture, std::ios::binary | std::ios::in | std::ios::out);
+        out.seekp(5 << 20);
+        out << 'x';
+    }
+    ASSERT_TRUE(AnalysisCache::hashFile(capture, key2));
+    EXPECT_NE(key1, key2);
+    EXPECT_FALSE(AnalysisCache::hashFile("test_data/no_such_file.pcap", key2));
+
+    AnalysisCache cache("test_cache", 2500);
+    std::map<std::string, std::string> restore = {{"packets.db", "test_data/restored.db"}};
+    EXPECT_FALSE(cache.fetch(key1, restore));
+    EXPECT_EQ(cache.getMisses(), 1u);
+
+    ASSERT_TRUE(cache.store(key1, {{"packets.db", artifact}}));
+    ASSERT_TRUE(cache.fetch(key1, restore));
+    EXPECT_EQ(cache.getHits(), 1u);
+    std::ifstream restored("test_data/restored.db", std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(restored)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(content, std::string(1000, 'a'));
+
+    // 其他版本写入的缓存项视为未命中并被删除
+    {
+        std::ofstream version("test_cache/" + key1 + "/version", std::ios::trunc);
+        version << AnalysisCache::kVersion + 1;
+    }
+    EXPECT_FALSE(cache.fetch(key1, restore));
+    EXPECT_EQ(cache.getMisses(), 2u);
+    struct stat entryStat;
+    EXPECT_NE(stat(("test_cache/" + key1).c_str(), &entryStat), 0);
+    ASSERT_TRUE(cache.store(key1, {{"packets.db", artifact}}));
+    ASSERT_TRUE(cache.fetch(key1, restore));
+
+    // 把key1标记为较早使用，写入第三项超出上限后应被淘汰
+    ASSERT_TRUE(cache.store("bbbbbbbbbbbbbbbb", {{"packets.db", artifact}}));
+    struct utimbuf old = {1000, 1000};
+    utime(("test_cache/" + key1).c_str(), &old);
+    ASSERT_TRUE(cache.store("cccccccccccccccc", {{"packets.db", artifact}}));
+    EXPECT_FALSE(cache.fetch(key1, restore));
+    EXPECT_TRUE(cache.fetch("bbbbbbbbbbbbbbbb", restore));
+    EXPECT_TRUE(cache.fetch("cccccccccccccccc", restore));
+
+    system("rm -rf test_cache");
+    std::remove(capture.c_str());
+    std::remove(artifact.c_str());
+    std::remove("test_data/restored.db");
+}
@@ -0,0 +1,401 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "mappedFile.hpp"
+#include "packetFilter.hpp"
+#include "packetIndexFile.hpp"
+#include "packetStore.hpp"
+#include "rapidjson/document.h"
+#include "utils.hpp"
+
+// 测试辅助函数
+namespace
+{
+    std::shared_ptr<Packet> makePacket(int frame, double time, const std::string& srcMac,
+                                       const std::string& srcIp, uint16_t srcPort,
+                                       const std::string& dstIp, uint16_t dstPort,
+                                       const std::string& protocol, const std::string& location,
+                                       const std::string& info)
+    {
+        auto packet          = std::make_shared<Packet>();
+        packet->frame_number = frame;
+        packet->time         = time;
+        packet->cap_len      = 60 + frame;
+        packet->len          = 60 + frame;
+        packet->src_mac      = srcMac;
+        packet->dst_mac      = "ff:ff:ff:ff:ff:ff";
+        packet->src_ip       = srcIp;
+        packet->src_port     = srcPort;
+        packet->dst_ip       = dstIp;
+        packet->dst_port     = dstPort;
+        packet->protocol     = protocol;
+        packet->src_location = location;
+        packet->info         = info;
+        return packet;
+    }
+
+    // 从queryPackets的JSON结果中取出frame_number列表
+    std::vector<uint32_t> framesFromJson(const std::string& json)
+    {
+        std::vector<uint32_t> frames;
+        rapidjson::Document   doc;
+        doc.Parse(json.c_str());
+        for (auto& packet : doc["packets"].GetArray())
+        {
+            frames.push_back(packet["frame_number"].GetUint());
+        }
+        return frames;
+    }
+} // namespace
+
+class PacketFilterTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        dbPath = "test_packet_filter.db";
+        std::remove(dbPath.c_str());
+
+        packets.push_back(makePacket(1, 100.0, "00:11:22:33:44:55", "192.168.1.10", 51000,
+                                     "8.8.8.8", 53, "DNS", "内网", "Standard query A example.com"));
+        packets.push_back(makePacket(2, 101.5, "00:11:22:33:44:66", "192.168.10.2", 8080,
+                                     "10.0.0.1", 80, "HTTP", "中国-湖南省-长沙市",
+                                     "GET /index.html HTTP/1.1"));
+        packets.push_back(makePacket(3, 102.0, "aa:bb:cc:dd:ee:ff", "fe80::1", 443, "fe80::2",
+                                     50123, "TLSv1.3", "", "Client Hello"));
+        packets.push_back(makePacket(4, 103.0, "00:11:22:77:88:99", "10.0.0.1", 80,
+                                     "192.168.1.10", 51001, "TCP", "中国-广东省-深圳市",
+                                     "80 → 51001 [ACK]"));
+
+        for (const auto& packet : packets)
+        {
+            store.append(*packet);
+        }
+    }
+
+    void TearDown() override { std::remove(dbPath.c_str()); }
+
+    // 过滤并把下标换成帧编号，便于与数据库查询结果对比
+    bool filterFrames(const std::map<std::string, std::string>& conditions,
+                      std::vector<uint32_t>&                    frames)
+    {
+        std::vector<uint32_t> indexes;
+        frames.clear();
+        if (!PacketFilter(store).filter(conditions, indexes))
+        {
+            return false;
+        }
+        for (uint32_t index : indexes)
+        {
+            frames.push_back(store.at(index).frame_number);
+        }
+        return true;
+    }
+
+    std::string                          dbPath;
+    std::vector<std::shared_ptr<Packet>> packets;
+    PacketStore                          store;
+};
+
+// 与SQLite查询结果逐条对比
+TEST_F(PacketFilterTest, MatchesSQLiteQuery)
+{
+    SQLiteUtil sqliteUtil(dbPath);
+    ASSERT_TRUE(sqliteUtil.createPacketTable());
+    ASSERT_TRUE(sqliteUtil.insertPacket(packets));
+
+    std::vector<std::map<std::string, std::string>> cases = {
+        {{"ip_address", "192.168.1.*"}},
+        {{"ip_address", "192.168.1*"}},
+        {{"ip_address", "10.0.0.1"}},
+        {{"ip_address", "fe80::*"}},
+        {{"mac_address", "00:11:22:*"}},
+        {{"mac_address", "AA:BB:CC:DD:EE:FF"}},
+        {{"port", "80"}},
+        {{"port", "80*"}},
+        {{"location", "湖南"}},
+        {{"protocol", "tcp"}},
+        {{"protocol", "TLS*"}},
+        {{"keyword", "index"}},
+        {{"start_time", "101"}, {"end_time", "103"}},
+        {{"ip_address", "192.168.*"}, {"port", "8*"}},
+        {{"port", "080"}},
+        {{"port", " 80"}},
+        {{"protocol", "x' OR '1'='1"}},
+        {{"start_time", "1.01e2"}},
+    };
+
+    for (const auto& conditions : cases)
+    {
+        std::string jsonResult;
+        ASSERT_TRUE(sqliteUtil.queryPackets(conditions, jsonResult));
+        std::vector<uint32_t> expected = framesFromJson(jsonResult);
+
+        std::vector<uint32_t> frames;
+        ASSERT_TRUE(filterFrames(conditions, frames));
+        EXPECT_EQ(frames, expected) << conditions.begin()->first << "=" << conditions.begin()->second;
+    }
+
+    // 不是完整数字的时间条件两种方式都拒绝
+    const char* malformed[] = {"123abc", " 5", "5 ", "", "inf", "nan", "1e999", "0x"};
+    for (const char* time : malformed)
+    {
+        std::map<std::string, std::string> conditions = {{"start_time", time}};
+        std::string                        jsonResult;
+        std::vector<uint32_t>              frames;
+        bool                               empty = *time == '\0';
+        EXPECT_EQ(sqliteUtil.queryPackets(conditions, jsonResult), empty) << time;
+        EXPECT_EQ(filterFrames(conditions, frames), empty) << time;
+    }
+}
+
+TEST_F(PacketFilterTest, EmptyConditionsReturnAll)
+{
+    std::vector<uint32_t> frames;
+    ASSERT_TRUE(filterFrames({}, frames));
+    EXPECT_EQ(frames, std::vector<uint32_t>({1, 2, 3, 4}));
+    EXPECT_FALSE(filterFrames({{"start_time", "soon"}}, frames));
+
+    store.clear();
+    ASSERT_TRUE(filterFrames({{"port", "80"}}, frames));
+    EXPECT_TRUE(frames.empty());
+}
+
+// 紧凑记录还原后应与原始数据包完全一致
+TEST(PacketStoreTest, RoundTrip)
+{
+    std::vector<std::shared_ptr<Packet>> packets;
+    packets.push_back(makePacket(1, 100.25, "00:11:22:33:44:55", "192.168.1.10", 51000,
+                                 "8.8.8.8", 53, "DNS", "内网", "Standard query A example.com"));
+    packets.push_back(makePacket(2, 101.5, "aa:bb:cc:dd:ee:ff", "fe80::1", 443, "2001:db8::2",
+                                 50123, "TLSv1.3", "", ""));
+    // ARP等报文没有IP地址
+    packets.push_back(makePacket(3, 102.0, "00:11:22:77:88:99", "", 0, "", 0, "ARP", "",
+                                 "Who has 192.168.1.1? Tell 192.168.1.10"));
+    // 无法由二进制形式原样还原的地址
+    packets.push_back(makePacket(4, 103.0, "AA:BB:CC:DD:EE:FF", "10.0.0.1,10.0.0.2", 80,
+                                 "::ffff:10.0.0.3", 51001, "TCP", "中国-广东省-深圳市",
+                                 std::string(3 << 20, 'x')));
+    packets[0]->dst_location = "美国";
+    packets[0]->file_offset  = 40;
+
+    PacketStore store;
+    for (size_t i = 0; i < packets.size(); i++)
+    {
+        EXPECT_EQ(store.append(*packets[i]), i);
+    }
+    ASSERT_EQ(store.size(), packets.size());
+
+    for (size_t i = 0; i < packets.size(); i++)
+    {
+        std::shared_ptr<Packet> packet = store.materialize(i);
+        EXPECT_EQ(packet->frame_number, packets[i]->frame_number);
+        EXPECT_DOUBLE_EQ(packet->time, packets[i]->time);
+        EXPECT_EQ(packet->cap_len, packets[i]->cap_len);
+        EXPECT_EQ(packet->len, packets[i]->len);
+        EXPECT_EQ(packet->src_mac, packets[i]->src_mac);
+        EXPECT_EQ(packet->dst_mac, packets[i]->dst_mac);
+        EXPECT_EQ(packet->src_ip, packets[i]->src_ip);
+        EXPECT_EQ(packet->dst_ip, packets[i]->dst_ip);
+        EXPECT_EQ(packet->src_port, packets[i]->src_port);
+        EXPECT_EQ(packet->dst_port, packets[i]->dst_port);
+        EXPECT_EQ(packet->src_location, packets[i]->src_location);
+        EXPECT_EQ(packet->dst_location, packets[i]->dst_location);
+        EXPECT_EQ(packet->protocol, packets[i]->protocol);
+        EXPECT_EQ(packet->info, packets[i]->info);
+        EXPECT_EQ(packet->file_offset, packets[i]->file_offset);
+    }
+
+    // 地址可还原的记录不占用地址字典
+    EXPECT_EQ(store.at(0).raw_address_id, 0u);
+    EXPECT_EQ(store.at(2).raw_address_id, 0u);
+    EXPECT_NE(store.at(3).raw_address_id, 0u);
+
+    // 多值地址的二进制形式取第一个，按地址过滤时可以命中
+    EXPECT_EQ(NetUtil::formatIp(store.at(3).src_ip), "10.0.0.1");
+    std::vector<uint32_t> indexes;
+    ASSERT_TRUE(PacketFilter(store).filter({{"ip_address", "10.0.0.1"}}, indexes));
+    EXPECT_EQ(indexes, std::vector<uint32_t>({3}));
+
+    store.clear();
+    EXPECT_EQ(store.size(), 0u);
+    EXPECT_EQ(store.memoryUsage(), 0u);
+}
+
+// 按下标区间从PacketStore入库，结果与原始数据包一致且按帧编号有序
+TEST_F(PacketFilterTest, InsertFromPacketStore)
+{
+    // 超过4GB的文件偏移
+    packets[3]->file_offset = 5000000000ULL;
+
+    PacketStore packetStore;
+    for (const auto& packet : packets)
+    {
+        packetStore.append(*packet);
+    }
+
+    SQLiteUtil sqliteUtil(dbPath);
+    ASSERT_TRUE(sqliteUtil.createPacketTable());
+    ASSERT_TRUE(sqliteUtil.insertPacket(packetStore, 0, 2));
+    ASSERT_TRUE(sqliteUtil.insertPacket(packetStore, 2, packetStore.size()));
+
+    std::vector<std::shared_ptr<Packet>> stored;
+    ASSERT_TRUE(sqliteUtil.queryPacket(stored));
+    ASSERT_EQ(stored.size(), packets.size());
+    for (size_t i = 0; i < packets.size(); i++)
+    {
+        EXPECT_EQ(stored[i]->frame_number, packets[i]->frame_number);
+        EXPECT_EQ(stored[i]->src_ip, packets[i]->src_ip);
+        EXPECT_EQ(stored[i]->src_location, packets[i]->src_location);
+        EXPECT_EQ(stored[i]->protocol, packets[i]->protocol);
+        EXPECT_EQ(stored[i]->info, packets[i]->info);
+        EXPECT_EQ(stored[i]->file_offset, packets[i]->file_offset);
+    }
+}
+
+// 稠密与稀疏编号混合时查找正确，区间遍历按帧编号升序
+TEST(FrameIndexTest, DenseAndSparseFrames)
+{
+    FrameIndex index;
+    for (uint32_t frame = 1; frame <= 10000; frame++)
+    {
+        index.insert(frame, frame - 1);
+    }
+    // 远超稠密范围的编号进入稀疏表
+    index.insert(4000000000u, 10000);
+    index.insert(50000000u, 10001);
+    EXPECT_EQ(index.size(), 10002u);
+
+    uint32_t value;
+    ASSERT_TRUE(index.find(1, value));
+    EXPECT_EQ(value, 0u);
+    ASSERT_TRUE(index.find(4097, value));
+    EXPECT_EQ(value, 4096u);
+    ASSERT_TRUE(index.find(4000000000u, value));
+    EXPECT_EQ(value, 10000u);
+    EXPECT_FALSE(index.find(0, value));
+    EXPECT_FALSE(index.find(10001, value));
+    EXPECT_FALSE(index.find(50000001u, value));
+
+    // 覆盖已有编号不改变数量
+    index.insert(5, 42);
+    ASSERT_TRUE(index.find(5, value));
+    EXPECT_EQ(value, 42u);
+    EXPECT_EQ(index.size(), 10002u);
+
+    std::vector<uint32_t> frames;
+    auto                  collect = [&](uint32_t frame, uint32_t) { frames.push_back(frame); };
+    index.forEachInRange(9998, 0xFFFFFFFFu, collect);
+    EXPECT_EQ(frames, std::vector<uint32_t>({9998, 9999, 10000, 50000000u, 4000000000u}));
+
+    frames.clear();
+    index.forEachInRange(0, 0xFFFFFFFFu, collect);
+    EXPECT_EQ(frames.size(), 10002u);
+    EXPECT_TRUE(std::is_sorted(frames.begin(), frames.end()));
+
+    index.clear();
+    EXPECT_EQ(index.size(), 0u);
+    EXPECT_FALSE(index.find(1, value));
+}
+
+// 映射文件按偏移取数据，越界返回nullptr，文件追加后可重新映射
+TEST(MappedFileTest, RangeAndRemap)
+{
+    const std::string path = "test_mapped_file.bin";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "0123456789";
+    }
+
+    MappedFile file;
+    ASSERT_TRUE(file.open(path));
+    EXPECT_EQ(file.size(), 10u);
+    const unsigned char* data = file.range(4, 3);
+    ASSERT_NE(data, nullptr);
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(data), 3), "456");
+    EXPECT_NE(file.range(0, 10), nullptr);
+    EXPECT_EQ(file.range(8, 3), nullptr);
+    EXPECT_EQ(file.range(11, 0), nullptr);
+
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out << "abc";
+    }
+    EXPECT_EQ(file.range(10, 3), nullptr);
+    ASSERT_TRUE(file.remap());
+    data = file.range(10, 3);
+    ASSERT_NE(data, nullptr);
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(data), 3), "abc");
+
+    file.close();
+    EXPECT_FALSE(file.isOpen());
+    EXPECT_FALSE(file.open("test_mapped_file_missing.bin"));
+    std::remove(path.c_str());
+}
+
+// 索引文件可恢复全部数据包，抓包文件变化或索引损坏时失效
+TEST_F(PacketFilterTest, SidecarIndexFile)
+{
+    const std::string capturePath = "test_sidecar.pcap";
+    const std::string indexPath   = PacketIndexFile::pathFor(capturePath);
+    {
+        std::ofstream out(capturePath, std::ios::binary);
+        out << std::string(3 << 20, 'p');
+    }
+
+    PacketStore packetStore;
+    for (const auto& packet : packets)
+    {
+        packetStore.append(*packet);
+    }
+    ASSERT_TRUE(PacketIndexFile::save(capturePath, packetStore));
+
+    PacketStore loaded;
+    ASSERT_TRUE(PacketIndexFile::load(capturePath, loaded));
+    ASSERT_EQ(loaded.size(), packets.size());
+    for (size_t i = 0; i < packets.size(); i++)
+    {
+        std::shared_ptr<Packet> packet = loaded.materialize(i);
+        EXPECT_EQ(packet->frame_number, packets[i]->frame_number);
+        EXPECT_EQ(packet->src_mac, packets[i]->src_mac);
+        EXPECT_EQ(packet->src_ip, packets[i]->src_ip);
+        EXPECT_EQ(packet->src_location, packets[i]->src_location);
+        EXPECT_EQ(packet->protocol, packets[i]->protocol);
+        EXPECT_EQ(packet->info, packets[i]->info);
+    }
+
+    // 加载后继续追加的数据包不影响已有记录
+    loaded.append(*packets[0]);
+    EXPECT_EQ(loaded.materialize(1)->info, packets[1]->info);
+    EXPECT_EQ(loaded.materialize(4)->info, packets[0]->info);
+
+    // 索引被截断
+    {
+        std::string content;
+        std::ifstream in(indexPath, std::ios::binary);
+        content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        in.close();
+        std::ofstream out(indexPath, std::ios::binary | std::ios::trunc);
+        out << content.substr(0, content.size() - 1);
+    }
+    EXPECT_FALSE(PacketIndexFile::load(capturePath, loaded));
+    EXPECT_EQ(loaded.size(), 0u);
+
+    // 抓包文件内容变化
+    ASSERT_TRUE(PacketIndexFile::save(capturePath, packetStore));
+    {
+        std::fstream out(capturePath, std::ios::binary | std::ios::in | std::ios::out);
+        out.seekp((3 << 20) - 1);
+        out << 'q';
+    }
+    EXPECT_FALSE(PacketIndexFile::load(capturePath, loaded));
+
+    std::remove(capturePath.c_str());
+    std::remove(indexPath.c_str());
+    EXPECT_FALSE(PacketIndexFile::load(capturePath, loaded));
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "packetStore.hpp"
+#include "protocolHierarchy.hpp"
+#include "utils.hpp"
+
+TEST(ProtocolHierarchyTest, TreeFromFrameProtocols)
+{
+    ProtocolHierarchy                  hierarchy;
+    std::vector<ProtocolHierarchyNode> nodes;
+    hierarchy.snapshot(nodes);
+    EXPECT_TRUE(nodes.empty());
+
+    hierarchy.add("eth:ethertype:ip:tcp", 60);
+    hierarchy.add("eth:ethertype:ip:tcp:http", 500);
+    hierarchy.add("eth:ethertype:ip:udp:dns", 80);
+    hierarchy.add("frame:eth:ethertype:arp", 42); // 开头的frame与根节点合并
+    hierarchy.add("eth:ethertype:ip:tcp:http", 700, 2);
+
+    hierarchy.snapshot(nodes);
+    std::vector<std::string> paths;
+    for (const auto& node : nodes)
+    {
+        paths.push_back(node.path);
+    }
+    EXPECT_EQ(paths, (std::vector<std::string>{"frame", "frame:eth", "frame:eth:ethertype",
+                                               "frame:eth:ethertype:ip",
+                                               "frame:eth:ethertype:ip:tcp",
+                                               "frame:eth:ethertype:ip:tcp:http",
+                                               "frame:eth:ethertype:ip:udp",
+                                               "frame:eth:ethertype:ip:udp:dns",
+                                               "frame:eth:ethertype:arp"}));
+    EXPECT_EQ(nodes[0].packets, 6u);
+    EXPECT_EQ(nodes[0].bytes, 1382u);
+    EXPECT_EQ(nodes[3].packets, 5u);
+    EXPECT_EQ(nodes[4].protocol, "tcp");
+    EXPECT_EQ(nodes[4].depth, 4u);
+    EXPECT_EQ(nodes[4].packets, 4u);
+    EXPECT_EQ(nodes[5].packets, 3u);
+    EXPECT_EQ(nodes[5].bytes, 1200u);
+    EXPECT_EQ(nodes[8].bytes, 42u);
+
+    uint64_t version = hierarchy.version();
+    hierarchy.clear();
+    EXPECT_NE(hierarchy.version(), version);
+    hierarchy.snapshot(nodes);
+    EXPECT_TRUE(nodes.empty());
+}
+
+// 协议栈随紧凑记录保存，可由索引恢复后重建统计；统计结果整体写入数据库
+TEST(ProtocolHierarchyTest, StoreAndPersist)
+{
+    Packet packet          = {};
+    packet.protocol        = "DNS";
+    packet.frame_protocols = "eth:ethertype:ip:udp:dns";
+
+    PacketStore          store;
+    const CompactPacket& record = store.at(store.append(packet));
+    EXPECT_EQ(store.protocolStack(record.stack_id), "eth:ethertype:ip:udp:dns");
+    EXPECT_EQ(store.materialize(0)->frame_protocols, "eth:ethertype:ip:udp:dns");
+
+    ProtocolHierarchy                  hierarchy;
+    std::vector<ProtocolHierarchyNode> nodes;
+    hierarchy.add(store.protocolStack(record.stack_id), 90, 3);
+    hierarchy.snapshot(nodes);
+
+    SQLiteUtil sqliteUtil(":memory:");
+    ASSERT_TRUE(sqliteUtil.createPacketTable());
+    ASSERT_TRUE(sqliteUtil.replaceProtocolHierarchy(nodes));
+    ASSERT_TRUE(sqliteUtil.replaceProtocolHierarchy(nodes));
+
+    std::vector<ProtocolHierarchyNode> stored;
+    ASSERT_TRUE(sqliteUtil.queryProtocolHierarchy(stored));
+    ASSERT_EQ(stored.size(), 6u);
+    EXPECT_EQ(stored[5].path, "frame:eth:ethertype:ip:udp:dns");
+    EXPECT_EQ(stored[5].protocol, "dns");
+    EXPECT_EQ(stored[5].depth, 5u);
+    EXPECT_EQ(stored[5].packets, 3u);
+    EXPECT_EQ(stored[5].bytes, 90u);
+}
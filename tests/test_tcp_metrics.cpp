@@ -0,0 +1,167 @@
+#include <fstream>
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "packetIndexFile.hpp"
+#include "tcpMetrics.hpp"
+#include "utils.hpp"
+
+namespace
+{
+const uint8_t kTcpFin = 0x01;
+const uint8_t kTcpSyn = 0x02;
+const uint8_t kTcpRst = 0x04;
+const uint8_t kTcpAck = 0x10;
+
+// 指标只使用TCP头字段，直接构造解码结果
+DecodedPacket segment(uint32_t seq, uint32_t ack, uint8_t flags, uint32_t length,
+                      uint16_t window = 65535)
+{
+    DecodedPacket packet  = {};
+    packet.ip_proto       = 6;
+    packet.tcp_seq        = seq;
+    packet.tcp_ack        = ack;
+    packet.tcp_flags      = flags;
+    packet.tcp_window     = window;
+    packet.payload_length = length;
+    return packet;
+}
+} // namespace
+
+TEST(TcpMetricsTest, HandshakeAndDataRtt)
+{
+    // 方向0为客户端，方向1为服务端
+    TcpMetrics metrics;
+    metrics.add(1, 0, 0.000, 74, segment(1000, 0, kTcpSyn, 0));
+    metrics.add(1, 1, 0.010, 74, segment(5000, 1001, kTcpSyn | kTcpAck, 0));
+    metrics.add(1, 0, 0.012, 66, segment(1001, 5001, kTcpAck, 0));
+    metrics.add(1, 0, 0.020, 166, segment(1001, 5001, kTcpAck, 100));
+    metrics.add(1, 1, 0.050, 66, segment(5001, 1101, kTcpAck, 0));
+    metrics.add(1, 0, 0.060, 66, segment(1101, 5001, kTcpFin | kTcpAck, 0));
+
+    TcpFlowMetrics result;
+    ASSERT_TRUE(metrics.get(1, result));
+    EXPECT_EQ(result.flow_id, 1u);
+    EXPECT_NEAR(result.handshake_rtt, 0.010, 1e-9);
+    // SYN→SYN/ACK、SYN/ACK→ACK、数据→确认各一个样本，FIN尚未确认
+    EXPECT_EQ(result.rtt_samples, 3u);
+    EXPECT_NEAR(result.rtt_min, 0.002, 1e-9);
+    EXPECT_NEAR(result.rtt_max, 0.030, 1e-9);
+    EXPECT_NEAR(result.rtt_avg, 0.014, 1e-9);
+    EXPECT_EQ(result.retransmissions, 0u);
+    EXPECT_EQ(result.out_of_order, 0u);
+    EXPECT_EQ(result.zero_windows, 0u);
+    EXPECT_EQ(metrics.size(), 1u);
+    EXPECT_FALSE(metrics.get(2, result));
+}
+
+TEST(TcpMetricsTest, RetransmissionOutOfOrderAndZeroWindow)
+{
+    TcpMetrics metrics;
+    metrics.add(1, 0, 0.000, 166, segment(1, 0, kTcpAck, 100));
+    metrics.add(1, 0, 0.001, 166, segment(201, 0, kTcpAck, 100)); // 超前
+    metrics.add(1, 0, 0.002, 166, segment(101, 0, kTcpAck, 100)); // 紧随其后到达，乱序
+    metrics.add(1, 0, 1.000, 166, segment(1, 0, kTcpAck, 100));   // 一秒后再次发送，重传
+    metrics.add(1, 1, 1.010, 66, segment(0, 301, kTcpAck, 0, 0)); // 重传后的确认不取样
+    metrics.add(1, 1, 1.020, 66, segment(0, 301, kTcpRst, 0, 0)); // RST的零窗口不计入
+
+    TcpFlowMetrics result;
+    ASSERT_TRUE(metrics.get(1, result));
+    EXPECT_EQ(result.out_of_order, 1u);
+    EXPECT_EQ(result.retransmissions, 1u);
+    EXPECT_EQ(result.zero_windows, 1u);
+    EXPECT_EQ(result.rtt_samples, 0u);
+    EXPECT_LT(result.rtt_avg, 0);
+    EXPECT_LT(result.handshake_rtt, 0);
+
+    // 非TCP和分片不统计
+    DecodedPacket udp = segment(0, 0, 0, 10);
+    udp.ip_proto      = 17;
+    metrics.add(2, 0, 0, 60, udp);
+    EXPECT_FALSE(metrics.get(2, result));
+    metrics.clear();
+    EXPECT_EQ(metrics.size(), 0u);
+}
+
+// 空闲的秒不计入分位数；指标写入数据库，缺失值读回为-1
+TEST(TcpMetricsTest, ThroughputAndPersist)
+{
+    TcpMetrics metrics;
+    metrics.add(7, 0, 10.1, 1000, segment(1, 0, kTcpAck, 0));
+    metrics.add(7, 0, 11.2, 1500, segment(1, 0, kTcpAck, 0));
+    metrics.add(7, 0, 11.8, 1500, segment(1, 0, kTcpAck, 0));
+    metrics.add(7, 0, 13.5, 2000, segment(1, 0, kTcpAck, 0));
+
+    TcpFlowMetrics result;
+    ASSERT_TRUE(metrics.get(7, result));
+    EXPECT_DOUBLE_EQ(result.throughput_max, 3000);
+    EXPECT_NEAR(result.throughput_p50, 2000, 2000 * 0.125);
+    EXPECT_NEAR(result.throughput_p95, 3000, 3000 * 0.125);
+    EXPECT_LE(result.throughput_p95, result.throughput_max);
+
+    TcpFlowMetrics other;
+    metrics.add(8, 0, 0.0, 74, segment(1, 0, kTcpSyn, 0));
+    metrics.add(8, 1, 0.2, 74, segment(9, 2, kTcpSyn | kTcpAck, 0));
+    metrics.add(8, 0, 0.3, 66, segment(2, 10, kTcpAck, 0));
+    metrics.add(8, 0, 0.4, 166, segment(2, 10, kTcpAck, 100));
+    metrics.add(8, 0, 2.0, 166, segment(2, 10, kTcpAck, 100));
+    ASSERT_TRUE(metrics.get(8, other));
+    EXPECT_EQ(other.retransmissions, 1u);
+
+    SQLiteUtil sqliteUtil(":memory:");
+    ASSERT_TRUE(sqliteUtil.createPacketTable());
+    ASSERT_TRUE(sqliteUtil.upsertTcpMetrics({result, other}));
+    ASSERT_TRUE(sqliteUtil.upsertTcpMetrics({result}));
+
+    std::vector<TcpFlowMetrics> stored;
+    ASSERT_TRUE(sqliteUtil.queryTcpMetrics(10, stored));
+    ASSERT_EQ(stored.size(), 2u);
+    EXPECT_EQ(stored[0].flow_id, 8u); // 按重传次数降序
+    EXPECT_NEAR(stored[0].handshake_rtt, 0.2, 1e-9);
+    EXPECT_EQ(stored[1].flow_id, 7u);
+    EXPECT_EQ(stored[1].handshake_rtt, -1);
+    EXPECT_EQ(stored[1].rtt_avg, -1);
+    EXPECT_DOUBLE_EQ(stored[1].throughput_p50, result.throughput_p50);
+    EXPECT_DOUBLE_EQ(stored[1].throughput_max, 3000);
+}
+
+// 指标随索引文件保存，重新打开抓包文件时不必再读取一遍
+TEST(TcpMetricsTest, SavedWithPacketIndex)
+{
+    const std::string capturePath = "test_tcp_metrics.pcap";
+    {
+        std::ofstream out(capturePath, std::ios::binary);
+        out << std::string(4096, 'p');
+    }
+
+    TcpMetrics metrics;
+    metrics.add(3, 0, 0.0, 74, segment(1, 0, kTcpSyn, 0));
+    metrics.add(3, 1, 0.1, 74, segment(9, 2, kTcpSyn | kTcpAck, 0));
+    metrics.add(3, 0, 0.5, 166, segment(2, 10, kTcpAck, 100));
+    metrics.add(3, 0, 1.5, 166, segment(102, 10, kTcpAck, 100));
+    metrics.add(4, 0, 2.0, 66, segment(1, 0, kTcpAck, 0, 0));
+
+    PacketStore store;
+    ASSERT_TRUE(PacketIndexFile::save(capturePath, store, &metrics));
+    TcpMetrics loaded;
+    ASSERT_TRUE(PacketIndexFile::load(capturePath, store, &loaded));
+    ASSERT_EQ(loaded.size(), 2u);
+
+    TcpFlowMetrics expected;
+    TcpFlowMetrics actual;
+    ASSERT_TRUE(metrics.get(3, expected));
+    ASSERT_TRUE(loaded.get(3, actual));
+    EXPECT_DOUBLE_EQ(actual.handshake_rtt, expected.handshake_rtt);
+    EXPECT_EQ(actual.rtt_samples, expected.rtt_samples);
+    EXPECT_DOUBLE_EQ(actual.throughput_p50, expected.throughput_p50);
+    ASSERT_TRUE(loaded.get(4, actual));
+    EXPECT_EQ(actual.zero_windows, 1u);
+
+    // 恢复的未确认分段仍可取样
+    loaded.add(3, 1, 1.6, 66, segment(10, 202, kTcpAck, 0));
+    ASSERT_TRUE(loaded.get(3, actual));
+    EXPECT_EQ(actual.rtt_samples, expected.rtt_samples + 1);
+
+    std::remove(capturePath.c_str());
+    std::remove(PacketIndexFile::pathFor(capturePath).c_str());
+}
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "packetDecoder.hpp"
+#include "tcpReassembly.hpp"
+#include "utils.hpp"
+
+namespace
+{
+const uint16_t kLinkEthernet = 1;
+const uint8_t  kTcpSyn       = 0x02;
+const uint8_t  kTcpAck       = 0x10;
+
+void put16(std::vector<unsigned char>& frame, size_t offset, uint16_t value)
+{
+    frame[offset]     = static_cast<unsigned char>(value >> 8);
+    frame[offset + 1] = static_cast<unsigned char>(value);
+}
+
+void put32(std::vector<unsigned char>& frame, size_t offset, uint32_t value)
+{
+    put16(frame, offset, static_cast<uint16_t>(value >> 16));
+    put16(frame, offset + 2, static_cast<uint16_t>(value));
+}
+
+// 构造以太网+IPv4+TCP帧，末尾附加4字节以太网填充，应按IP总长度忽略
+std::vector<unsigned char> tcpFrame(uint16_t srcPort, uint16_t dstPort, uint32_t seq,
+                                    uint8_t flags, const std::string& payload)
+{
+    std::vector<unsigned char> frame(14 + 20 + 20 + payload.size() + 4, 0);
+    put16(frame, 12, 0x0800);
+
+    frame[14] = 0x45;
+    put16(frame, 16, static_cast<uint16_t>(40 + payload.size()));
+    frame[14 + 8] = 64;
+    frame[14 + 9] = 6;
+    put32(frame, 14 + 12, 0x0A000001);
+    put32(frame, 14 + 16, 0x0A000002);
+
+    put16(frame, 34, srcPort);
+    put16(frame, 36, dstPort);
+    put32(frame, 38, seq);
+    frame[46] = 5 << 4;
+    frame[47] = flags;
+    put16(frame, 48, 65535);
+    std::copy(payload.begin(), payload.end(), frame.begin() + 54);
+    return frame;
+}
+
+// 解码后加入重组器，方向0
+void addSegment(TcpReassembler& reassembler, uint32_t seq, uint8_t flags,
+                const std::string& payload)
+{
+    std::vector<unsigned char> frame = tcpFrame(40000, 80, seq, flags, payload);
+    DecodedPacket              packet;
+    ASSERT_TRUE(PacketDecoder::decode(kLinkEthernet, frame.data(),
+                                      static_cast<uint32_t>(frame.size()), packet));
+    reassembler.add(1, 0, packet);
+}
+
+std::string text(const TcpStreamData& data)
+{
+    return std::string(data.data.begin(), data.data.end());
+}
+} // namespace
+
+TEST(TcpReassemblyTest, DecodeEthernetVlanAndIpv6)
+{
+    std::vector<unsigned char> frame = tcpFrame(40000, 80, 1000, kTcpAck, "GET /");
+    DecodedPacket              packet;
+    ASSERT_TRUE(PacketDecoder::decode(kLinkEthernet, frame.data(),
+                                      static_cast<uint32_t>(frame.size()), packet));
+    EXPECT_EQ(NetUtil::formatIp(packet.src_ip), "10.0.0.1");
+    EXPECT_EQ(NetUtil::formatIp(packet.dst_ip), "10.0.0.2");
+    EXPECT_EQ(packet.ip_proto, 6);
+    EXPECT_EQ(packet.src_port, 40000);
+    EXPECT_EQ(packet.dst_port, 80);
+    EXPECT_EQ(packet.tcp_seq, 1000u);
+    EXPECT_EQ(packet.tcp_flags, kTcpAck);
+    EXPECT_EQ(packet.tcp_window, 65535);
+    ASSERT_EQ(packet.payload_length, 5u);
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(packet.payload), 5), "GET /");
+
+    // 插入一层VLAN标签
+    std::vector<unsigned char> tagged(frame.begin(), frame.begin() + 12);
+    unsigned char              tag[] = {0x81, 0x00, 0x00, 0x0A};
+    tagged.insert(tagged.end(), tag, tag + sizeof(tag));
+    tagged.insert(tagged.end(), frame.begin() + 12, frame.end());
+    DecodedPacket vlan;
+    ASSERT_TRUE(PacketDecoder::decode(kLinkEthernet, tagged.data(),
+                                      static_cast<uint32_t>(tagged.size()), vlan));
+    EXPECT_EQ(vlan.src_port, 40000);
+    EXPECT_EQ(vlan.payload_length, 5u);
+
+    // RAW链路的IPv6，带一个逐跳选项扩展头
+    std::vector<unsigned char> ipv6(40 + 8 + 8, 0);
+    ipv6[0] = 0x60;
+    put16(ipv6, 4, 16);
+    ipv6[6]  = 0;  // 逐跳选项
+    ipv6[23] = 1;  // ::1
+    ipv6[39] = 2;  // ::2
+    ipv6[40] = 17; // 下一个头为UDP
+    put16(ipv6, 48, 5353);
+    put16(ipv6, 50, 53);
+    DecodedPacket udp;
+    ASSERT_TRUE(PacketDecoder::decode(101, ipv6.data(), static_cast<uint32_t>(ipv6.size()), udp));
+    EXPECT_EQ(NetUtil::formatIp(udp.src_ip), "::1");
+    EXPECT_EQ(udp.ip_proto, 17);
+    EXPECT_EQ(udp.src_port, 5353);
+    EXPECT_EQ(udp.dst_port, 53);
+}
+
+TEST(TcpReassemblyTest, OutOfOrderRetransmitAndWrap)
+{
+    // 初始序列号靠近32位上限，数据跨越回绕
+    TcpReassembler reassembler;
+    uint32_t       isn = 0xFFFFFFF0;
+    addSegment(reassembler, isn, kTcpSyn, "");
+    addSegment(reassembler, isn + 1, kTcpAck, "0123456789");
+    addSegment(reassembler, isn + 21, kTcpAck, "KLMNOPQRST");     // 超前
+    addSegment(reassembler, isn + 1, kTcpAck, "0123456789");      // 完全重传
+    addSegment(reassembler, isn + 6, kTcpAck, "56789ABCDEFGHIJ"); // 部分重传并填补空洞
+    reassembler.finish();
+
+    TcpStreamData data;
+    ASSERT_TRUE(reassembler.stream(1, 0, data));
+    EXPECT_EQ(text(data), "0123456789ABCDEFGHIJKLMNOPQRST");
+    EXPECT_EQ(data.total_bytes, 30u);
+    EXPECT_EQ(data.out_of_order, 1u);
+    EXPECT_EQ(data.retransmissions, 2u);
+    EXPECT_EQ(data.gaps, 0u);
+    EXPECT_FALSE(data.truncated);
+    ASSERT_TRUE(reassembler.stream(1, 1, data));
+    EXPECT_TRUE(data.data.empty());
+    EXPECT_FALSE(reassembler.stream(2, 0, data));
+}
+
+TEST(TcpReassemblyTest, GapsAndBoundedBuffers)
+{
+    // 每个方向只保存16字节，等待队列只能暂存8字节
+    TcpReassembler reassembler(16, 8);
+    addSegment(reassembler, 100, kTcpSyn, "");
+    addSegment(reassembler, 101, kTcpAck, "abcd");
+    addSegment(reassembler, 109, kTcpAck, "ijkl");  // 缺少efgh
+    addSegment(reassembler, 117, kTcpAck, "qrstu"); // 等待队列超出上限，跳过efgh
+    addSegment(reassembler, 113, kTcpAck, "mnop");
+    addSegment(reassembler, 200, kTcpAck, "zz"); // 之后的空洞在finish时跳过
+    reassembler.finish();
+
+    TcpStreamData data;
+    ASSERT_TRUE(reassembler.stream(1, 0, data));
+    EXPECT_EQ(text(data), "abcdijklmnopqrst");
+    EXPECT_TRUE(data.truncated);
+    EXPECT_EQ(data.total_bytes, 19u);
+    EXPECT_EQ(data.gaps, 2u);
+    EXPECT_EQ(data.gap_bytes, 4u + 78u);
+    EXPECT_EQ(data.out_of_order, 3u);
+}
@@ -1,9 +1,12 @@
 #include <chrono>
+#include <fcntl.h>
 #include <fstream>
 #include <gtest/gtest.h>
 #include <regex>
 #include <string>
 #include <thread>
+#include <unistd.h>
+#include <vector>
 
 #include "utils.hpp"
 #include "processUtil.hpp"
@@ -46,6 +49,126 @@ TEST_F(CommonUtilTest, GetCurrentTime)
     EXPECT_TRUE(std::regex_match(currentTime, timeRegex));
 }
 
+// 测试XXH64哈希（参考值来自xxHash官方实现）
+TEST_F(CommonUtilTest, Xxh64)
+{
+    EXPECT_EQ(HashUtil::xxh64("", 0), 0xEF46DB3751D8E999ULL);
+    EXPECT_EQ(HashUtil::xxh64("abc", 3), 0x44BC2CF5AD770999ULL);
+
+    std::string text = "Nobody inspects the spammish repetition";
+    EXPECT_EQ(HashUtil::xxh64(text.data(), text.size()), 0xFBCEA83C8A378BF1ULL);
+}
+
+// 测试十六进制转储格式
+TEST_F(CommonUtilTest, HexDump)
+{
+    std::string data = "GET / HTTP/1.1\r\nHost: a\r\n";
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data.data());
+
+    std::string dump;
+    HexDumpUtil::dump(bytes, data.size(), dump);
+    EXPECT_EQ(dump,
+              "0000  47 45 54 20 2f 20 48 54  54 50 2f 31 2e 31 0d 0a  GET / HTTP/1.1..\n"
+              "0010  48 6f 73 74 3a 20 61 0d  0a                       Host: a..\n");
+    EXPECT_LE(dump.size(), HexDumpUtil::dumpSize(data.size()));
+
+    char hex[8];
+    EXPECT_EQ(HexDumpUtil::toHex(bytes, 4, hex), 8u);
+    EXPECT_EQ(std::string(hex, 8), "47455420");
+
+    // 超过64KB时偏移显示8位
+    std::vector<unsigned char> large(0x10001, 0xFF);
+    dump.clear();
+    HexDumpUtil::dump(large.data(), large.size(), dump);
+    EXPECT_EQ(dump.substr(dump.rfind("00010000")), "00010000  ff" + std::string(47, ' ') + " .\n");
+}
+
+// 测试/proc/net/dev解析
+TEST_F(CommonUtilTest, ParseNetDev)
+{
+    std::string content =
+        "Inter-|   Receive                                                |  Transmit\n"
+        " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets "
+        "errs drop fifo colls carrier compressed\n"
+        "    lo:    1000      10    0    0    0     0          0         0     1000      10    "
+        "0    0    0     0       0          0\n"
+        "  eth0: 18446744073709551615 5 0 0 0 0 0 0 300 3 0 0 0 0 0 0\n";
+
+    std::map<std::string, InterfaceCounters> counters;
+    ASSERT_TRUE(NetUtil::parseNetDev(content, counters));
+    ASSERT_EQ(counters.size(), 2u);
+    EXPECT_EQ(counters["lo"].rx_bytes, 1000u);
+    EXPECT_EQ(counters["lo"].tx_packets, 10u);
+    EXPECT_EQ(counters["eth0"].rx_bytes, 18446744073709551615ULL);
+    EXPECT_EQ(counters["eth0"].rx_packets, 5u);
+    EXPECT_EQ(counters["eth0"].tx_bytes, 300u);
+    EXPECT_EQ(counters["eth0"].tx_packets, 3u);
+
+    EXPECT_FALSE(NetUtil::parseNetDev("eth0: 1 2 3\n", counters));
+
+    // 本机的统计文件
+    EXPECT_TRUE(NetUtil::readNetDev(counters));
+    EXPECT_TRUE(counters.count("lo"));
+}
+
+TEST_F(CommonUtilTest, LineAssembler)
+{
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL, 0) | O_NONBLOCK);
+
+    // 一次写入包含多行和半行
+    LineAssembler lines(16);
+    std::string   chunk = "eth0\t60\tTCP\nlo\t42\tU";
+    ASSERT_EQ(write(fds[1], chunk.data(), chunk.size()), static_cast<ssize_t>(chunk.size()));
+    EXPECT_EQ(lines.fill(fds[0]), LineAssembler::STATUS_MORE);
+
+    std::vector<std::string> result;
+    const char*              line;
+    size_t                   length;
+    while (lines.nextLine(line, length))
+    {
+        result.push_back(std::string(line, length));
+    }
+    EXPECT_EQ(lines.fill(fds[0]), LineAssembler::STATUS_MORE);
+    while (lines.nextLine(line, length))
+    {
+        result.push_back(std::string(line, length));
+    }
+    EXPECT_EQ(lines.fill(fds[0]), LineAssembler::STATUS_AGAIN);
+
+    // 补齐半行，过长的行被丢弃
+    chunk = "DP\r\n0123456789abcdefXYZ\nok\n";
+    ASSERT_EQ(write(fds[1], chunk.data(), chunk.size()), static_cast<ssize_t>(chunk.size()));
+    close(fds[1]);
+    LineAssembler::Status status;
+    do
+    {
+        status = lines.fill(fds[0]);
+        while (lines.nextLine(line, length))
+        {
+            result.push_back(std::string(line, length));
+        }
+    } while (status == LineAssembler::STATUS_MORE);
+    close(fds[0]);
+
+    EXPECT_EQ(status, LineAssembler::STATUS_CLOSED);
+    ASSERT_EQ(result.size(), 3u);
+    EXPECT_EQ(result[0], "eth0\t60\tTCP");
+    EXPECT_EQ(result[1], "lo\t42\tUDP");
+    EXPECT_EQ(result[2], "ok");
+    EXPECT_EQ(lines.droppedLines(), 1u);
+
+    uint64_t value;
+    EXPECT_TRUE(CommonUtil::parseUint64("1514", 4, value));
+    EXPECT_EQ(value, 1514u);
+    EXPECT_TRUE(CommonUtil::parseUint64("18446744073709551615", 20, value));
+    EXPECT_EQ(value, 18446744073709551615ULL);
+    EXPECT_FALSE(CommonUtil::parseUint64("18446744073709551616", 20, value));
+    EXPECT_FALSE(CommonUtil::parseUint64("12a", 3, value));
+    EXPECT_FALSE(CommonUtil::parseUint64("", 0, value));
+}
+
 class ProcessUtilTest : public ::testing::Test
 {
 protected:
@@ -314,4 +437,252 @@ TEST_F(SQLiteUtilTest, LocationSearch) {
     EXPECT_TRUE(sqliteUtil.queryPackets(conditions, jsonResult));
     EXPECT_TRUE(jsonResult.find("长沙市") != std::string::npos);
     EXPECT_FALSE(jsonResult.find("株洲市") != std::string::npos);
-}
\ No newline at end of file
+}
+TEST_F(SQLiteUtilTest, DictionaryEncodedColumns) {
+    std::vector<std::shared_ptr<Packet>> packets;
+    const char* protocols[] = {"TCP", "DNS", "TCP", "HTTP"};
+    const char* locations[] = {"中国-湖南省-长沙市", "中国-广东省-深圳市", "", "中国-湖南省-长沙市"};
+    for (int i = 0; i < 4; i++) {
+        auto packet = std::make_shared<Packet>();
+        packet->frame_number = i + 1;
+        packet->protocol = protocols[i];
+        packet->src_location = locations[i];
+        packet->dst_location = locations[(i + 1) % 4];
+        packets.push_back(packet);
+    }
+
+    {
+        SQLiteUtil sqliteUtil(dbPath);
+        EXPECT_TRUE(sqliteUtil.createPacketTable());
+        EXPECT_TRUE(sqliteUtil.insertPacket(packets));
+    }
+
+    // 重新打开数据库，字典从t_protocols、t_locations加载
+    SQLiteUtil sqliteUtil(dbPath);
+    EXPECT_TRUE(sqliteUtil.createPacketTable());
+
+    std::vector<std::shared_ptr<Packet>> queried;
+    EXPECT_TRUE(sqliteUtil.queryPacket(queried));
+    ASSERT_EQ(queried.size(), 4);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(queried[i]->protocol, protocols[i]);
+        EXPECT_EQ(queried[i]->src_location, locations[i]);
+        EXPECT_EQ(queried[i]->dst_location, locations[(i + 1) % 4]);
+    }
+
+    // 按协议过滤
+    std::map<std::string, std::string> conditions;
+    conditions["protocol"] = "tcp";
+    std::string jsonResult;
+    EXPECT_TRUE(sqliteUtil.queryPackets(conditions, jsonResult));
+    EXPECT_TRUE(jsonResult.find("\"total\":2") != std::string::npos);
+    EXPECT_TRUE(jsonResult.find("DNS") == std::string::npos);
+
+    // 条件中的单引号作为普通字符匹配，不会改变SQL
+    conditions["protocol"] = "x' OR '1'='1";
+    EXPECT_TRUE(sqliteUtil.queryPackets(conditions, jsonResult));
+    EXPECT_TRUE(jsonResult.find("\"total\":0") != std::string::npos);
+    conditions.erase("protocol");
+    conditions["location"] = "') OR 1=1 OR name LIKE ('";
+    EXPECT_TRUE(sqliteUtil.queryPackets(conditions, jsonResult));
+    EXPECT_TRUE(jsonResult.find("\"total\":0") != std::string::npos);
+    conditions.erase("location");
+    conditions["port"] = "0 OR 1=1";
+    EXPECT_TRUE(sqliteUtil.queryPackets(conditions, jsonResult));
+    EXPECT_TRUE(jsonResult.find("\"total\":0") != std::string::npos);
+}
+
+TEST_F(SQLiteUtilTest, TimePartitionedTables) {
+    SQLiteUtil sqliteUtil(dbPath);
+    EXPECT_TRUE(sqliteUtil.createPacketTable());
+    EXPECT_TRUE(sqliteUtil.enablePartitioning(3600, 2));
+
+    // 三个小时各一个数据包
+    std::vector<std::shared_ptr<Packet>> packets;
+    for (int i = 0; i < 3; i++) {
+        auto packet = std::make_shared<Packet>();
+        packet->frame_number = i + 1;
+        packet->time = 1700000000 + i * 3600;
+        packet->src_ip = "10.0.0." + std::to_string(i + 1);
+        packets.push_back(packet);
+    }
+    EXPECT_TRUE(sqliteUtil.insertPacket(packets));
+
+    // 只保留最新的两个分区
+    ASSERT_EQ(sqliteUtil.getPartitions().size(), 2);
+    std::vector<std::shared_ptr<Packet>> queried;
+    EXPECT_TRUE(sqliteUtil.queryPacket(queried));
+    ASSERT_EQ(queried.size(), 2);
+
+    // 时间范围查询只命中最后一个分区
+    std::map<std::string, std::string> conditions;
+    conditions["start_time"] = std::to_string(1700000000 + 2 * 3600);
+    conditions["ip_address"] = "10.0.0.*";
+    std::string jsonResult;
+    EXPECT_TRUE(sqliteUtil.queryPackets(conditions, jsonResult));
+    EXPECT_TRUE(jsonResult.find("\"total\":1") != std::string::npos);
+    EXPECT_TRUE(jsonResult.find("10.0.0.3") != std::string::npos);
+
+    // 不是数字的时间条件被拒绝
+    conditions["start_time"] = "yesterday";
+    EXPECT_FALSE(sqliteUtil.queryPackets(conditions, jsonResult));
+    conditions["start_time"] = "1700000000abc";
+    EXPECT_FALSE(sqliteUtil.queryPackets(conditions, jsonResult));
+    conditions["start_time"] = "1e999";
+    EXPECT_FALSE(sqliteUtil.queryPackets(conditions, jsonResult));
+}
+
+TEST_F(SQLiteUtilTest, ManyPartitionsQuery) {
+    SQLiteUtil sqliteUtil(dbPath);
+    EXPECT_TRUE(sqliteUtil.createPacketTable());
+    EXPECT_TRUE(sqliteUtil.enablePartitioning(1));
+
+    // 每秒一个分区，分区数超过SQLite复合SELECT默认的500项上限
+    const int count = 1200;
+    std::vector<std::shared_ptr<Packet>> packets;
+    for (int i = 0; i < count; i++) {
+        auto packet = std::make_shared<Packet>();
+        packet->frame_number = i + 1;
+        packet->time = 1700000000 + i;
+        packet->info = "packet " + std::to_string(i + 1);
+        packets.push_back(packet);
+    }
+    EXPECT_TRUE(sqliteUtil.insertPacket(packets));
+    ASSERT_EQ(sqliteUtil.getPartitions().size(), count);
+
+    std::vector<std::shared_ptr<Packet>> queried;
+    EXPECT_TRUE(sqliteUtil.queryPacket(queried));
+    EXPECT_EQ(queried.size(), count);
+
+    std::map<std::string, std::string> conditions;
+    std::string jsonResult;
+    EXPECT_TRUE(sqliteUtil.queryPackets(conditions, jsonResult));
+    EXPECT_TRUE(jsonResult.find("\"total\":1200") != std::string::npos);
+
+    conditions["start_time"] = std::to_string(1700000000 + 100);
+    conditions["end_time"] = std::to_string(1700000000 + 700);
+    EXPECT_TRUE(sqliteUtil.queryPackets(conditions, jsonResult));
+    EXPECT_TRUE(jsonResult.find("\"total\":600") != std::string::npos);
+
+    // 启用全文索引时对全部分区补建索引
+    ASSERT_TRUE(sqliteUtil.enableFullTextIndex());
+    conditions.clear();
+    conditions["keyword"] = "1111";
+    EXPECT_TRUE(sqliteUtil.queryPackets(conditions, jsonResult));
+    EXPECT_TRUE(jsonResult.find("\"total\":1") != std::string::npos);
+}
+
+TEST_F(SQLiteUtilTest, FullTextKeywordSearch) {
+    SQLiteUtil sqliteUtil(dbPath);
+    EXPECT_TRUE(sqliteUtil.createPacketTable());
+
+    std::vector<std::shared_ptr<Packet>> packets;
+    const char* infos[] = {"Standard query 0x1a2b A www.example.com",
+                           "GET /index.html HTTP/1.1",
+                           "Client Hello (SNI=api.example.org)"};
+    for (int i = 0; i < 3; i++) {
+        auto packet = std::make_shared<Packet>();
+        packet->frame_number = i + 1;
+        packet->info = infos[i];
+        packets.push_back(packet);
+    }
+    // 先插入一部分，验证启用索引时会补建
+    std::vector<std::shared_ptr<Packet>> first(packets.begin(), packets.begin() + 1);
+    std::vector<std::shared_ptr<Packet>> rest(packets.begin() + 1, packets.end());
+    EXPECT_TRUE(sqliteUtil.insertPacket(first));
+    ASSERT_TRUE(sqliteUtil.enableFullTextIndex());
+    EXPECT_TRUE(sqliteUtil.insertPacket(rest));
+
+    std::map<std::string, std::string> conditions;
+    std::string jsonResult;
+
+    conditions["keyword"] = "www.example.com";
+    EXPECT_TRUE(sqliteUtil.queryPackets(conditions, jsonResult));
+    EXPECT_TRUE(jsonResult.find("\"total\":1") != std::string::npos);
+
+    conditions["keyword"] = "index.html";
+    EXPECT_TRUE(sqliteUtil.queryPackets(conditions, jsonResult));
+    EXPECT_TRUE(jsonResult.find("GET /index.html") != std::string::npos);
+
+    conditions["keyword"] = "exam*";
+    EXPECT_TRUE(sqliteUtil.queryPackets(conditions, jsonResult));
+    EXPECT_TRUE(jsonResult.find("\"total\":2") != std::string::npos);
+}
+
+TEST_F(SQLiteUtilTest, PaginatedStreamingQuery) {
+    SQLiteUtil sqliteUtil(dbPath);
+    EXPECT_TRUE(sqliteUtil.createPacketTable());
+
+    std::vector<std::shared_ptr<Packet>> packets;
+    for (int i = 0; i < 5; i++) {
+        auto packet = std::make_shared<Packet>();
+        packet->frame_number = i + 1;
+        packet->src_ip = "192.168.1." + std::to_string(i + 1);
+        packet->protocol = "UDP";
+        packets.push_back(packet);
+    }
+    EXPECT_TRUE(sqliteUtil.insertPacket(packets));
+
+    std::map<std::string, std::string> conditions;
+    conditions["ip_address"] = "192.168.1.*";
+
+    // 按两条一页翻页，直到游标为0
+    std::vector<int> frames;
+    uint32_t cursor = 0;
+    int pages = 0;
+    do {
+        std::string jsonResult;
+        uint32_t nextCursor = 0;
+        ASSERT_TRUE(sqliteUtil.queryPacketsPage(conditions, cursor, 2, jsonResult, nextCursor));
+        rapidjson::Document doc;
+        ASSERT_FALSE(doc.Parse(jsonResult.c_str()).HasParseError());
+        for (auto& packet : doc["packets"].GetArray()) {
+            frames.push_back(packet["frame_number"].GetInt());
+            EXPECT_STREQ(packet["protocol"].GetString(), "UDP");
+        }
+        EXPECT_EQ(doc["next_cursor"].GetUint(), nextCursor);
+        cursor = nextCursor;
+        pages++;
+    } while (cursor != 0);
+
+    EXPECT_EQ(pages, 3);
+    EXPECT_EQ(frames, std::vector<int>({1, 2, 3, 4, 5}));
+
+    // 流式导出全部结果
+    system("mkdir -p /tmp/test_data");
+    std::string testFile = "/tmp/test_data/query_export_test.json";
+    EXPECT_TRUE(sqliteUtil.exportQueryResult(conditions, testFile));
+    std::ifstream file(testFile);
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    rapidjson::Document doc;
+    ASSERT_FALSE(doc.Parse(content.c_str()).HasParseError());
+    EXPECT_EQ(doc["total"].GetUint(), 5u);
+    EXPECT_EQ(doc["next_cursor"].GetUint(), 0u);
+}
+
+// 抓包文件被截断后重新分析，之前写入的数据包被清空，同样的帧编号可以再次写入
+TEST_F(SQLiteUtilTest, ClearPackets) {
+    SQLiteUtil sqliteUtil(dbPath);
+    EXPECT_TRUE(sqliteUtil.createPacketTable());
+    EXPECT_TRUE(sqliteUtil.enablePartitioning(3600));
+
+    std::vector<std::shared_ptr<Packet>> packets;
+    for (int i = 0; i < 2; i++) {
+        auto packet = std::make_shared<Packet>();
+        packet->frame_number = i + 1;
+        packet->time = 1700000000 + i * 3600;
+        packets.push_back(packet);
+    }
+    EXPECT_TRUE(sqliteUtil.insertPacket(packets));
+    ASSERT_EQ(sqliteUtil.getPartitions().size(), 2);
+
+    ASSERT_TRUE(sqliteUtil.clearPackets());
+    EXPECT_TRUE(sqliteUtil.getPartitions().empty());
+    std::vector<std::shared_ptr<Packet>> queried;
+    EXPECT_TRUE(sqliteUtil.queryPacket(queried));
+    EXPECT_TRUE(queried.empty());
+
+    EXPECT_TRUE(sqliteUtil.insertPacket(packets));
+    EXPECT_TRUE(sqliteUtil.queryPacket(queried));
+    EXPECT_EQ(queried.size(), 2);
+}